@@ -134,6 +134,16 @@ sub _cost {
 	return int($r + .5 * ($r <=> 0));
 }
 
+sub _statistics {
+	my $self	= shift;
+	my $context	= shift;
+	my $model	= $context->model;
+	return unless (blessed($model) and $model->can('_store'));
+	my $store	= $model->_store;
+	return unless (blessed($store) and $store->can('statistics'));
+	return $store->statistics;
+}
+
 sub _triple_vars {
 	my $self	= shift;
 	my $t		= shift;
@@ -36,7 +36,7 @@ BEGIN {
 sub new {
 	my $class	= shift;
 	my %args	= @_;
-	my $self	= bless( [{ %args }], $class );
+	my $self	= bless( [{ cache => {}, %args }], $class );
 	return $self;
 }
 
@@ -208,6 +208,18 @@ sub delegate {
 	return $self->_get_value( 'delegate', @_ );
 }
 
+=item C<< cache >>
+
+Returns a HASH reference shared by this context and all of its copies, in which
+plans may keep data for the rest of the query's execution.
+
+=cut
+
+sub cache {
+	my $self	= shift;
+	return $self->_get_value( 'cache', @_ );
+}
+
 sub _get_value {
 	my $self	= shift;
 	my $key		= shift;
@@ -22,6 +22,8 @@ use warnings;
 use Data::Dumper;
 use List::Util qw(reduce);
 use Scalar::Util qw(blessed reftype refaddr);
+use Digest::MD5 qw(md5);
+use Encode qw(encode_utf8);
 use RDF::Query::Error qw(:try);
 use RDF::Query::BGPOptimizer;
 
@@ -32,6 +34,8 @@ use RDF::Query::Plan::Construct;
 use RDF::Query::Plan::Distinct;
 use RDF::Query::Plan::Filter;
 use RDF::Query::Plan::Join::NestedLoop;
+use RDF::Query::Plan::Join::Hash;
+use RDF::Query::Plan::Join::Merge;
 use RDF::Query::Plan::Join::PushDownNestedLoop;
 use RDF::Query::Plan::Limit;
 use RDF::Query::Plan::Offset;
@@ -40,6 +44,7 @@ use RDF::Query::Plan::Extend;
 use RDF::Query::Plan::Quad;
 use RDF::Query::Plan::Service;
 use RDF::Query::Plan::Sort;
+use RDF::Query::Plan::TopK;
 use RDF::Query::Plan::ComputedStatement;
 use RDF::Query::Plan::ThresholdUnion;
 use RDF::Query::Plan::Union;
@@ -554,8 +559,12 @@ sub generate_plans {
 				foreach my $p (@temp_plans) {
 					foreach my $cp (@$cps) {
 						foreach my $join_type (@join_types) {
-							my $plan	= $join_type->new( $p, $cp, 0, {} );
-							push(@plans, $plan);
+							try {
+								my $plan	= $join_type->new( $p, $cp, 0, {} );
+								push(@plans, $plan);
+							} catch RDF::Query::Error::MethodInvocationError with {
+			#					warn "caught MethodInvocationError.";
+							};
 						}
 					}
 				}
@@ -597,7 +606,7 @@ sub generate_plans {
 		push(@return_plans, @plans);
 	} elsif ($type eq 'Limit') {
 		my @base	= $self->generate_plans( $algebra->pattern, $context, %args );
-		my @plans	= map { RDF::Query::Plan::Limit->new( $algebra->limit, $_ ) } @base;
+		my @plans	= map { $self->_top_k_plan( $algebra->limit, $_ ) || RDF::Query::Plan::Limit->new( $algebra->limit, $_ ) } @base;
 		push(@return_plans, @plans);
 	} elsif ($type eq 'NamedGraph') {
 		my @plans;
@@ -869,6 +878,35 @@ sub _csg_plans {
 	return @return_plans;
 }
 
+# Returns a TopK plan equivalent to a limit over $plan if $plan is a sort,
+# optionally below an offset and a projection (which doesn't change the
+# number or order of rows), or undef otherwise.
+sub _top_k_plan {
+	my $self	= shift;
+	my $limit	= shift;
+	my $plan	= shift;
+	my $offset	= 0;
+	if ($plan->isa('RDF::Query::Plan::Offset')) {
+		$offset	= $plan->offset;
+		$plan	= $plan->pattern;
+	}
+	my $project;
+	if ($plan->isa('RDF::Query::Plan::Project')) {
+		$project	= $plan;
+		$plan		= $plan->pattern;
+	}
+	return unless ($plan->isa('RDF::Query::Plan::Sort') and not($plan->isa('RDF::Query::Plan::TopK')));
+	
+	my ($pattern, @order)	= $plan->plan_node_data;
+	my @exprs	= map { [ $_->[1], ($_->[0] eq 'desc' ? 1 : 0) ] } @order;
+	my $topk	= RDF::Query::Plan::TopK->new( $limit, $offset, $pattern, @exprs );
+	if ($project) {
+		my ($keys)	= $project->plan_node_data;
+		return RDF::Query::Plan::Project->new( $topk, $keys );
+	}
+	return $topk;
+}
+
 sub _join_plans {
 	my $self	= shift;
 	my $context	= shift;
@@ -879,6 +917,13 @@ sub _join_plans {
 	my $method		= $args{ method };
 	my @join_types	= RDF::Query::Plan::Join->join_classes( $config );
 	
+	unless (delete $args{ ordered }) {
+		# the first pattern is joined last, so the cheapest ordering is reversed
+		if (my @ordered = $self->_order_patterns_by_cost( $context, $triples )) {
+			$triples	= [ reverse @ordered ];
+		}
+	}
+	
 	my @plans;
 	my $opt		= $context->optimize;
 	my @slice	= ($opt) ? (0 .. $#{ $triples }) : (0);
@@ -890,7 +935,7 @@ sub _join_plans {
 		my @_lhs		= $self->generate_plans( $t, $context, %args );
 		my @lhs_plans	= map { [ $_, [$t] ] } @_lhs;
 		if (@triples) {
-			my @rhs_plans	= $self->_join_plans( $context, \@triples, %args );
+			my @rhs_plans	= $self->_join_plans( $context, \@triples, %args, ordered => 1 );
 			foreach my $i (0 .. $#lhs_plans) {
 				foreach my $j (0 .. $#rhs_plans) {
 					my $a			= $lhs_plans[ $i ][0];
@@ -904,7 +949,7 @@ sub _join_plans {
 							Carp::cluck Dumper($_) 
 						}
 					}
-					foreach my $join_type (@join_types) {
+					foreach my $join_type ($self->_order_join_types( $context, $b, $a, @join_types )) {
 						next if ($join_type eq 'RDF::Query::Plan::Join::PushDownNestedLoop' and $b->subplans_of_type('RDF::Query::Plan::Service'));
 						try {
 							my @algebras;
@@ -942,13 +987,85 @@ sub _join_plans {
 		return @plans;
 	} else {
 		if (@plans) {
-			return $plans[0];	# XXX need to figure out what's the 'best' plan here
+			# the patterns are in cost order if store statistics are available,
+			# and the join types in _order_join_types order
+			return $plans[0];
 		} else {
 			return;
 		}
 	}
 }
 
+# Returns the patterns in @$patterns in the order their join should be
+# evaluated, using the cardinality estimates of the store statistics: the
+# cheapest pattern first, then repeatedly the cheapest pattern given the
+# variables already bound, preferring patterns that share a variable with them.
+# Returns the empty list if the store keeps no statistics, or if a pattern is
+# not a triple, quad or BGP (whose joins can be reordered).
+sub _order_patterns_by_cost {
+	my $self		= shift;
+	my $context		= shift;
+	my $patterns	= shift;
+	return unless (scalar(@$patterns) > 1);
+	my @triples;
+	foreach my $p (@$patterns) {
+		if ($p->isa('RDF::Query::Algebra::BasicGraphPattern')) {
+			push(@triples, [ $p->triples ]);
+		} elsif ($p->isa('RDF::Query::Algebra::Triple') or $p->isa('RDF::Query::Algebra::Quad')) {
+			push(@triples, [ $p ]);
+		} else {
+			return;
+		}
+	}
+	my $stats	= RDF::Query::BGPOptimizer->_statistics( $context ) or return;
+	
+	my @remaining	= (0 .. $#{ $patterns });
+	my (%bound, @ordered);
+	while (@remaining) {
+		my ($best, $best_joined, $best_cost);
+		foreach my $r (0 .. $#remaining) {
+			my $i		= $remaining[ $r ];
+			my %b		= %bound;
+			my $cost	= 1;
+			my $joined	= (@ordered) ? 0 : 1;
+			foreach my $t (@{ $triples[ $i ] }) {
+				my @vars	= $t->referenced_variables;
+				$joined		= 1 if (not(@vars) or grep { $bound{ $_ } } @vars);
+				$cost		*= $stats->cardinality( $t, \%b );
+				$b{ $_ }++ foreach (@vars);
+			}
+			if (not(defined($best)) or $joined > $best_joined or ($joined == $best_joined and $cost < $best_cost)) {
+				($best, $best_joined, $best_cost)	= ($r, $joined, $cost);
+			}
+		}
+		my ($i)	= splice(@remaining, $best, 1);
+		push(@ordered, $patterns->[ $i ]);
+		$bound{ $_ }++ foreach (map { $_->referenced_variables } @{ $triples[ $i ] });
+	}
+	return @ordered;
+}
+
+# Returns the join classes in the order they should be tried for joining $lhs
+# and $rhs. The hash join comes first when it is preferred, and last otherwise.
+sub _order_join_types {
+	my $self	= shift;
+	my $context	= shift;
+	my $lhs		= shift;
+	my $rhs		= shift;
+	my @types	= @_;
+	my $hash	= 'RDF::Query::Plan::Join::Hash';
+	my @other	= grep { $_ ne $hash } @types;
+	my (@first, @last);
+	if (grep { $_ eq $hash } @types) {
+		if ($hash->preferred( $context, $lhs, $rhs )) {
+			push(@first, $hash);
+		} else {
+			push(@last, $hash);
+		}
+	}
+	return (@first, @other, @last);
+}
+
 sub _add_constant_join {
 	my $self		= shift;
 	my $context		= shift;
@@ -1096,7 +1213,11 @@ sub __path_plan {
 			my @join_types	= RDF::Query::Plan::Join->join_classes( $config );
 			my @jplans;
 			foreach my $jclass (@join_types) {
-				push(@jplans, $jclass->new( @plans[0,1], 0 ));
+				try {
+					push(@jplans, $jclass->new( @plans[0,1], 0 ));
+				} catch RDF::Query::Error::MethodInvocationError with {
+	#				warn "caught MethodInvocationError.";
+				};
 			}
 			$l->trace("expanded /-path to: " . $jplans[0]->sse);
 			return $jplans[0];
@@ -1152,7 +1273,11 @@ sub __path_plan {
 				my @p;
 				foreach my $p (@plan) {
 					foreach my $jclass (@join_types) {
-						push(@p, $jclass->new( $p, $q, 0 ));
+						try {
+							push(@p, $jclass->new( $p, $q, 0 ));
+						} catch RDF::Query::Error::MethodInvocationError with {
+		#					warn "caught MethodInvocationError.";
+						};
 					}
 				}
 				@plan	= @p;
@@ -1302,6 +1427,43 @@ sub subplans_of_type {
 	return @patterns;
 }
 
+# Returns the fingerprint of $row's bound values, or undef if a value is not a
+# Resource, Blank or Literal. This matches RDF::Trine::XS::row_fingerprint.
+sub _row_fingerprint_pp {
+	my $row		= shift;
+	my $key		= '';
+	foreach my $name (sort keys %$row) {
+		my $node	= $row->{ $name };
+		next unless (defined($node));
+		return unless (blessed($node));
+		my $nkey;
+		if ($node->isa('RDF::Trine::Node::Resource')) {
+			$nkey	= 'R' . $node->uri_value;
+		} elsif ($node->isa('RDF::Trine::Node::Blank')) {
+			$nkey	= 'B' . $node->blank_identifier;
+		} elsif ($node->isa('RDF::Trine::Node::Literal')) {
+			no warnings 'uninitialized';
+			$nkey	= join("\0", 'L' . $node->literal_value_language, $node->literal_datatype, $node->literal_value);
+		} else {
+			return;
+		}
+		my $n	= encode_utf8( $name );
+		$nkey	= encode_utf8( $nkey );
+		$key	.= length($n) . ':' . $n . length($nkey) . ':' . $nkey;
+	}
+	return md5( $key );
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	no strict 'refs';
+	*{ '_row_fingerprint' }	= (RDF::Trine::XS->can('row_fingerprint'))
+		? \&RDF::Trine::XS::row_fingerprint
+		: \&_row_fingerprint_pp;
+}
+
 1;
 
 __END__
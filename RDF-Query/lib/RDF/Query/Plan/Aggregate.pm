@@ -9,6 +9,31 @@ RDF::Query::Plan::Aggregate - Executable query plan for Aggregates.
 
 This document describes RDF::Query::Plan::Aggregate version 2.919.
 
+=head1 DESCRIPTION
+
+Input rows are folded into a table of groups as they are read. Each group is
+keyed by the 16-byte fingerprint of its grouping values (computed natively if
+L<RDF::Trine::XS> is installed), and keeps only its running aggregate values:
+a count for COUNT, a running total and type for SUM and AVG, the current value
+for MIN, MAX and SAMPLE, and the joined string for GROUP_CONCAT. Input rows are
+not retained. The values already counted by a DISTINCT aggregate are kept as
+16-byte fingerprints.
+
+A GROUP_CONCAT string longer than C<< rdf.query.plan.aggregate.concat_limit >>
+characters (an option of the query), or C<< $RDF::Query::Plan::Aggregate::CONCAT_LIMIT >>
+characters (default 16,777,216), raises an execution error.
+
+If the pattern is ordered on exactly the grouping variables (see
+L<RDF::Query::Plan/ordered>), the groups in the table are returned as soon as
+the ordering values change.
+
+Otherwise, once the table holds C<< rdf.query.plan.aggregate.group_limit >>
+groups (an option of the query), or C<< $RDF::Query::Plan::Aggregate::GROUP_LIMIT >>
+groups (default 100,000), rows of groups that are not in the table are written
+to one of C<< $RDF::Query::Plan::Aggregate::PARTITIONS >> temporary files,
+chosen by a byte of the group key. Each partition is aggregated once the
+table's groups have been returned.
+
 =head1 METHODS
 
 Beyond the methods documented below, this class inherits methods from the
@@ -23,16 +48,23 @@ package RDF::Query::Plan::Aggregate;
 use strict;
 use warnings;
 use base qw(RDF::Query::Plan);
+use Digest::MD5 qw(md5);
+use Encode qw(encode_utf8);
+use File::Temp qw(tempfile);
 use Scalar::Util qw(blessed);
+use Storable qw(store_fd fd_retrieve);
 
 use RDF::Query::Error qw(:try);
 use RDF::Query::Node qw(literal);
 
 ######################################################################
 
-our ($VERSION);
+our ($VERSION, $GROUP_LIMIT, $PARTITIONS, $CONCAT_LIMIT);
 BEGIN {
-	$VERSION	= '2.919';
+	$VERSION		= '2.919';
+	$GROUP_LIMIT	= 100_000;
+	$PARTITIONS		= 16;
+	$CONCAT_LIMIT	= 16_777_216;
 }
 
 ######################################################################
@@ -76,288 +108,33 @@ sub execute ($) {
 	my $plan	= $self->[1];
 	$plan->execute( $context );
 	
-	my $l		= Log::Log4perl->get_logger("rdf.query.plan.aggregate");
 	if ($plan->state == $self->OPEN) {
-		my $query	= $context->query;
-		my $bridge	= $context->model;
-		
-		my %seen;
-		my %groups;
-		my %group_data;
-		my @groupby	= $self->groupby;
-		my @ops		= @{ $self->[3] };
-		local($RDF::Query::Node::Literal::LAZY_COMPARISONS)	= 1;
-		
-		ROW: while (my $row = $plan->next) {
-			$l->debug("aggregate on $row");
-			my @group;
-			foreach my $g (@groupby) {
-				my $v	= $query->var_or_expr_value( $row, $g, $context );
-				if ($g->isa('RDF::Query::Expression::Alias')) {
-					$row->{ $g->name }	= $v;
-				}
-				push(@group, $v);
-			}
-			
-# 			my @group	= map { $query->var_or_expr_value( $row, $_ ) } @groupby;
-			my $group	= join('<<<', map { blessed($_) ? $_->as_string : '' } map { blessed($_) ? $query->var_or_expr_value( $row, $_, $context ) : '' } @group);
-			
-			push( @{ $group_data{ 'rows' }{ $group } }, $row );
-			$group_data{ 'groups' }{ $group }	= \@group;
-			foreach my $i (0 .. $#groupby) {
-				my $g	= $groupby[$i];
-				$group_data{ 'groupby_sample' }{ $group }	= $row;
-			}
-		}
-		
-		my @groups	= values %{ $group_data{'groups'} };
-		if (scalar(@groups) == 0) {
-			$group_data{'rows'}{''}		= [];
-			$group_data{'groups'}{''}	= [];
-		}
+		my $config	= $context->options || {};
+		my $state	= $self->[0];
+		$state->{context}	= $context;
+		$state->{limit}		= $config->{ 'rdf.query.plan.aggregate.group_limit' } || $GROUP_LIMIT;
+		$state->{concat_limit}	= $config->{ 'rdf.query.plan.aggregate.concat_limit' } || $CONCAT_LIMIT;
+		$state->{order}		= $self->_group_order;
 		
-		my @rows;
-		GROUP: foreach my $group (keys %{ $group_data{ 'rows' } }) {
-			$l->debug( "group: $group" );
-			my %options;
-			my %aggregates;
-			my %passthrough_data;
-			my @group	= @{ $group_data{ 'groups' }{ $group } };
-			
-			my $row_sample	= $group_data{ 'groupby_sample' }{ $group };
-			foreach my $g (@groupby) {
-				if ($g->isa('RDF::Query::Expression::Alias') or $g->isa('RDF::Query::Node::Variable')) {
-					my $name	= $g->name;
-					$passthrough_data{ $name }	= $row_sample->{ $name };
-				} elsif ($g->isa('RDF::Query::Expression')) {
-					my @names	= $g->referenced_variables;
-					foreach my $name (@names) {
-						$passthrough_data{ $name }	= $row_sample->{ $name };
-					}
-				} else {
-					my $name	= $g->sse;
-					$passthrough_data{ $name }	= $row_sample->{ $name };
-				}
-			}
-			
-			my @operation_data	= (map { [ @{ $_ }, \%aggregates ] } @ops);
-			foreach my $data (@operation_data) {
-				my $aggregate_data	= pop(@$data);
-				my ($alias, $op, $opts, @cols)	= @$data;
-				$options{ $alias }	= $opts;
-				my $distinct	= ($op =~ /^(.*)-DISTINCT$/);
-				$op				=~ s/-DISTINCT$//;
-				my $col	= $cols[0];
-				my %agg_group_seen;
-				try {
-					foreach my $row (@{ $group_data{ 'rows' }{ $group } }) {
-						my @proj_rows	= map { (blessed($col)) ? $query->var_or_expr_value( $row, $col, $context ) : '*' } @cols;
-						if ($distinct) {
-							next if ($agg_group_seen{ join('<<<', @proj_rows) }++);
-						}
-						
-						$l->debug( "- row: $row" );
-	# 					$groups{ $group }	||= { map { $_ => $row->{ $_ } } @groupby };
-						if ($op eq 'COUNT') {
-							$l->debug("- aggregate op: COUNT");
-							my $should_inc	= 0;
-							if (not(blessed($col)) and $col eq '*') {
-								$should_inc	= 1;
-							} else {
-								my $value	= $query->var_or_expr_value( $row, $col, $context );
-								$should_inc	= (defined $value) ? 1 : 0;
-							}
-							
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							$aggregate_data->{ $alias }{ $group }[1]	+= $should_inc;
-						} elsif ($op eq 'SUM') {
-							$l->debug("- aggregate op: SUM");
-							my $value	= $query->var_or_expr_value( $row, $col, $context );
-							my $type	= _node_type( $value );
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							
-							my $strict	= 1;
-							unless ($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type) {
-								throw RDF::Query::Error::TypeError -text => "Cannot compute SUM aggregate with a non-numeric term: " . $value->as_ntriples;
-							}
-							
-	#						if ($value->isa('RDF::Query::Node::Literal')) {
-							my $v	= $value->numeric_value;
-							if (scalar( @{ $aggregate_data->{ $alias }{ $group } } ) > 1) {
-								if ($type ne $aggregate_data->{ $alias }{ $group }[2] and not($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type and blessed($aggregate_data->{ $alias }{ $group }[1]) and $aggregate_data->{ $alias }{ $group }[1]->isa('RDF::Query::Node::Literal') and $aggregate_data->{ $alias }{ $group }[1]->is_numeric_type)) {
-									if ($context->strict_errors) {
-										delete $aggregate_data->{ $alias }{ $group };
-										throw RDF::Query::Error::ComparisonError -text => "Cannot compute SUM aggregate over nodes of multiple, non-numeric types";
-									} else {
-										$strict	= 0;
-									}
-								}
-								
-								$aggregate_data->{ $alias }{ $group }[1]	+= $v;
-								$aggregate_data->{ $alias }{ $group }[2]	= RDF::Query::Expression::Binary->promote_type('+', $type, $aggregate_data->{ $alias }{ $group }[2]);
-							} else {
-								$aggregate_data->{ $alias }{ $group }[1]	= $v;
-								$aggregate_data->{ $alias }{ $group }[2]	= $type;
-							}
-	#						}
-						} elsif ($op eq 'MAX') {
-							$l->debug("- aggregate op: MAX");
-							my $value	= $query->var_or_expr_value( $row, $col, $context );
-							my $type	= _node_type( $value );
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							
-							my $strict	= 1;
-							if (scalar( @{ $aggregate_data->{ $alias }{ $group } } ) > 1) {
-								if ($type ne $aggregate_data->{ $alias }{ $group }[2] and not($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type and blessed($aggregate_data->{ $alias }{ $group }[1]) and $aggregate_data->{ $alias }{ $group }[1]->isa('RDF::Query::Node::Literal') and $aggregate_data->{ $alias }{ $group }[1]->is_numeric_type)) {
-									if ($context->strict_errors) {
-										delete $aggregate_data->{ $alias }{ $group };
-										throw RDF::Query::Error::ComparisonError -text => "Cannot compute MAX aggregate over nodes of multiple, non-numeric types";
-									} else {
-										$strict	= 0;
-									}
-								}
-								
-								if ($strict) {
-									if ($value > $aggregate_data->{ $alias }{ $group }[1]) {
-										$aggregate_data->{ $alias }{ $group }[1]	= $value;
-										$aggregate_data->{ $alias }{ $group }[2]	= $type;
-									}
-								} else {
-									if ("$value" gt "$aggregate_data->{ $alias }{ $group }[1]") {
-										$aggregate_data->{ $alias }{ $group }[1]	= $value;
-										$aggregate_data->{ $alias }{ $group }[2]	= $type;
-									}
-								}
-							} else {
-								$aggregate_data->{ $alias }{ $group }[1]	= $value;
-								$aggregate_data->{ $alias }{ $group }[2]	= $type;
-							}
-						} elsif ($op eq 'MIN') {
-							$l->debug("- aggregate op: MIN");
-							my $value	= $query->var_or_expr_value( $row, $col, $context );
-							my $type	= _node_type( $value );
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							
-							my $strict	= 1;
-							if (scalar( @{ $aggregate_data->{ $alias }{ $group } } ) > 1) {
-								if ($type ne $aggregate_data->{ $alias }{ $group }[2] and not($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type and blessed($aggregate_data->{ $alias }{ $group }[1]) and $aggregate_data->{ $alias }{ $group }[1]->isa('RDF::Query::Node::Literal') and $aggregate_data->{ $alias }{ $group }[1]->is_numeric_type)) {
-									if ($context->strict_errors) {
-										delete $aggregate_data->{ $alias }{ $group };
-										throw RDF::Query::Error::ComparisonError -text => "Cannot compute MIN aggregate over nodes of multiple, non-numeric types";
-									} else {
-										$strict	= 0;
-									}
-								}
-								
-								if ($strict) {
-									if ($value < $aggregate_data->{ $alias }{ $group }[1]) {
-										$aggregate_data->{ $alias }{ $group }[1]	= $value;
-										$aggregate_data->{ $alias }{ $group }[2]	= $type;
-									}
-								} else {
-									if ("$value" lt "$aggregate_data->{ $alias }{ $group }[1]") {
-										$aggregate_data->{ $alias }{ $group }[1]	= $value;
-										$aggregate_data->{ $alias }{ $group }[2]	= $type;
-									}
-								}
-							} else {
-								$aggregate_data->{ $alias }{ $group }[1]	= $value;
-								$aggregate_data->{ $alias }{ $group }[2]	= $type;
-							}
-						} elsif ($op eq 'SAMPLE') {
-							### this is just the MIN code from above, without the strict comparison checking
-							$l->debug("- aggregate op: SAMPLE");
-							my $value	= $query->var_or_expr_value( $row, $col, $context );
-							my $type	= _node_type( $value );
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							
-							if (scalar( @{ $aggregate_data->{ $alias }{ $group } } ) > 1) {
-								if ("$value" lt "$aggregate_data->{ $alias }{ $group }[1]") {
-									$aggregate_data->{ $alias }{ $group }[1]	= $value;
-									$aggregate_data->{ $alias }{ $group }[2]	= $type;
-								}
-							} else {
-								$aggregate_data->{ $alias }{ $group }[1]	= $value;
-								$aggregate_data->{ $alias }{ $group }[2]	= $type;
-							}
-						} elsif ($op eq 'AVG') {
-							$l->debug("- aggregate op: AVG");
-							my $value	= $query->var_or_expr_value( $row, $col, $context );
-							my $type	= _node_type( $value );
-# 							warn "AVG\t$group\t" . $value->as_string . "\n";
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							
-							unless (blessed($value) and $value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type) {
-								delete $aggregate_data->{ $alias }{ $group };
-								throw RDF::Query::Error::ComparisonError -text => "Cannot compute AVG aggregate over non-numeric nodes";
-							}
-							
-							if (blessed($value) and $value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type) {
-								$aggregate_data->{ $alias }{ $group }[1]++;
-								$aggregate_data->{ $alias }{ $group }[2]	+= $value->numeric_value;
-								if ($aggregate_data->{ $alias }{ $group }[3]) {
-									$aggregate_data->{ $alias }{ $group }[3]	= RDF::Query::Expression::Binary->promote_type('+', $type, $aggregate_data->{ $alias }{ $group }[3]);
-								} else {
-									$aggregate_data->{ $alias }{ $group }[3]	= $type;
-								}
-							}
-						} elsif ($op eq 'GROUP_CONCAT') {
-							$l->debug("- aggregate op: GROUP_CONCAT");
-							$aggregate_data->{ $alias }{ $group }[0]	= $op;
-							
-							my $str		= RDF::Query::Node::Resource->new('sparql:str');
-	
-							my @values	= map {
-								my $expr	= RDF::Query::Expression::Function->new( $str, $query->var_or_expr_value( $row, $_, $context ) );
-								my $val		= $expr->evaluate( $context->query, $row );
-								blessed($val) ? $val->literal_value : '';
-							} @cols;
-							
-		# 					warn "adding '$string' to group_concat aggregate";
-							push( @{ $aggregate_data->{ $alias }{ $group }[1] }, @values );
-						} else {
-							throw RDF::Query::Error -text => "Unknown aggregate operator $op";
-						}
-					}
-				} catch RDF::Query::Error::ComparisonError with {
-					delete $aggregate_data->{ $alias }{ $group };
-				} catch RDF::Query::Error::TypeError with {
-					delete $aggregate_data->{ $alias }{ $group };
-				}
-			}
-			
-			my %row	= %passthrough_data;
-			foreach my $agg (keys %aggregates) {
-				if (defined($aggregates{$agg}{$group})) {
-					my $op			= $aggregates{ $agg }{ $group }[0];
-					if ($op eq 'AVG') {
-						my $value	= ($aggregates{ $agg }{ $group }[2] / $aggregates{ $agg }{ $group }[1]);
-						my $type	= $aggregates{ $agg }{ $group }[3];
-						if ($type eq 'http://www.w3.org/2001/XMLSchema#integer') {
-							$type	= 'http://www.w3.org/2001/XMLSchema#decimal';
-						}
-						$row{ $agg }	= (blessed($value) and $value->isa('RDF::Trine::Node')) ? $value : RDF::Trine::Node::Literal->new( $value, undef, $type, 1 );
-					} elsif ($op eq 'GROUP_CONCAT') {
-						my $j	= (exists $options{$agg}{seperator}) ? $options{$agg}{seperator} : ' ';
-						$row{ $agg }	= RDF::Query::Node::Literal->new( join($j, @{ $aggregates{ $agg }{ $group }[1] }) );
-					} elsif ($op =~ /COUNT/) {
-						my $value	= $aggregates{ $agg }{ $group }[1];
-						$row{ $agg }	= (blessed($value) and $value->isa('RDF::Trine::Node')) ? $value : RDF::Trine::Node::Literal->new( $value, undef, 'http://www.w3.org/2001/XMLSchema#integer', 1 );
-					} else {
-						if (defined($aggregates{$agg}{$group})) {
-							my $value	= $aggregates{ $agg }{ $group }[1];
-							$row{ $agg }	= (blessed($value) and $value->isa('RDF::Trine::Node')) ? $value : RDF::Trine::Node::Literal->new( $value, undef, $aggregates{ $agg }{ $group }[2], 1 );
-						}
-					}
-				}
-			}
-			
-			my $vars	= RDF::Query::VariableBindings->new( \%row );
-			$l->debug("aggregate row: $vars");
-			push(@rows, $vars);
-		}
-		
-		$self->[0]{rows}	= \@rows;
+		# the aggregates' columns are numbered so that a column used by several
+		# aggregates is evaluated once per row
+		my (@columns, %columns);
+		$state->{ops}		= [ map {
+			my ($alias, $op, $opts, @cols)	= @$_;
+			my $distinct	= ($op =~ s/-DISTINCT$//) ? 1 : 0;
+			my @indexes		= map {
+				my $c	= $_;
+				(blessed($c)) ? ($columns{ $c->sse } //= do { push(@columns, $c); $#columns }) : undef
+			} @cols;
+			[ $alias, $op, $distinct, $opts, \@indexes, @cols ]
+		} @{ $self->[3] } ];
+		$state->{columns}	= \@columns;
+		$state->{groups}	= {};
+		$state->{keys}		= [];
+		$state->{count}		= 0;
+		$state->{depth}		= 0;
+		$state->{pending}	= [];
+		$state->{rows}		= [];
 		$self->state( $self->OPEN );
 	} else {
 		warn "could not execute plan in distinct";
@@ -374,7 +151,11 @@ sub next {
 	unless ($self->state == $self->OPEN) {
 		throw RDF::Query::Error::ExecutionError -text => "next() cannot be called on an un-open AGGREGATE";
 	}
-	my $bindings	= shift(@{ $self->[0]{rows} });
+	my $state	= $self->[0];
+	while (not(@{ $state->{rows} }) and not($state->{finished})) {
+		$self->_fill;
+	}
+	my $bindings	= shift(@{ $state->{rows} });
 	if (my $d = $self->delegate) {
 		$d->log_result( $self, $bindings );
 	}
@@ -390,13 +171,352 @@ sub close {
 	unless ($self->state == $self->OPEN) {
 		throw RDF::Query::Error::ExecutionError -text => "close() cannot be called on an un-open AGGREGATE";
 	}
-	delete $self->[0]{rows};
+	delete $self->[0]{$_} for (qw(rows groups keys context input partitions pending last finished exhausted));
 	if (defined($self->[1])) {
 		$self->[1]->close();
 	}
 	$self->SUPER::close();
 }
 
+# Reads input rows into the group table until at least one aggregate row is
+# ready or the input is exhausted.
+sub _fill {
+	my $self	= shift;
+	my $state	= $self->[0];
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.aggregate");
+	my $debug	= $l->is_debug;
+	local($RDF::Query::Node::Literal::LAZY_COMPARISONS)	= 1;
+	
+	while (my ($key, $group, $row) = $self->_next_input) {
+		$l->debug("aggregate on $row") if ($debug);
+		if (my $order = $state->{order}) {
+			# the input is sorted on the grouping variables, so every group
+			# seen so far is complete once the sort values change
+			my @values	= map { $row->{ $_->[0]->name } } @$order;
+			if ($state->{last} and RDF::Query::Plan::Sort::_cmp_values( $order, $state->{last}, \@values )) {
+				push(@{ $state->{rows} }, $self->_finish_groups);
+			}
+			$state->{last}	= \@values;
+		}
+		
+		my $g	= $state->{groups}{ $key };
+		unless ($g) {
+			if (my $parts = $state->{partitions}) {
+				my $fh	= $parts->[ ord(substr($key, $state->{depth}, 1)) % scalar(@$parts) ];
+				store_fd( [ $key, $group, $row ], $fh ) or throw RDF::Query::Error::ExecutionError -text => "Can't write aggregate partition to temporary file";
+				next;
+			}
+			$g	= $state->{groups}{ $key }	= [ $group, $row, [], [] ];
+			push(@{ $state->{keys} }, $key);
+			$state->{count}++;
+			if (not($state->{order}) and $state->{depth} < 16 and scalar(@{ $state->{keys} }) >= $state->{limit}) {
+				$l->debug("spilling aggregate input after $state->{limit} groups");
+				$state->{partitions}	= [ map { my $fh = tempfile(); binmode($fh); $fh } (1 .. $PARTITIONS) ];
+			}
+		}
+		$g->[1]	= $row;
+		$self->_accumulate( $g, $row, $debug );
+		return if (@{ $state->{rows} });
+	}
+	
+	# the current input is exhausted; partitions spilled while reading it are
+	# aggregated next, using the following key byte for any partitions they
+	# spill in turn
+	push(@{ $state->{rows} }, $self->_finish_groups);
+	if (my $parts = delete $state->{partitions}) {
+		my $depth	= $state->{depth} + 1;
+		foreach my $fh (@$parts) {
+			seek( $fh, 0, 0 );
+			unshift( @{ $state->{pending} }, [ $fh, $depth ] );
+		}
+	}
+	if (my $next = shift( @{ $state->{pending} } )) {
+		($state->{input}, $state->{depth})	= @$next;
+	} else {
+		if ($state->{count} == 0) {
+			# an aggregate over no rows has a single (empty) group
+			push(@{ $state->{rows} }, $self->_group_row( [ [], undef, [], [] ] ));
+		}
+		$state->{finished}	= 1;
+	}
+}
+
+# Returns the group key, the group values, and the row for the next input row,
+# reading from the pattern and then from the current spilled partition.
+sub _next_input {
+	my $self	= shift;
+	my $state	= $self->[0];
+	if (my $fh = $state->{input}) {
+		if (eof($fh)) {
+			delete $state->{input};
+			return;
+		}
+		return @{ fd_retrieve( $fh ) };
+	}
+	return if ($state->{exhausted});
+	my $row		= $self->[1]->next;
+	unless ($row) {
+		$state->{exhausted}	= 1;
+		return;
+	}
+	
+	my $context	= $state->{context};
+	my $query	= $context->query;
+	my @group;
+	foreach my $g ($self->groupby) {
+		my $v	= $query->var_or_expr_value( $row, $g, $context );
+		if ($g->isa('RDF::Query::Expression::Alias')) {
+			$row->{ $g->name }	= $v;
+		}
+		push(@group, $v);
+	}
+	return (_group_key( \@group ), \@group, $row);
+}
+
+# Adds $row to the aggregate values of group $g. An aggregate that raises a
+# type or comparison error is unbound for the group, and ignores the group's
+# remaining rows. Debugging messages are logged if $debug is true.
+sub _accumulate {
+	my $self	= shift;
+	my $g		= shift;
+	my $row		= shift;
+	my $debug	= shift;
+	my $state	= $self->[0];
+	my $context	= $state->{context};
+	my $query	= $context->query;
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.aggregate");
+	my $ops		= $state->{ops};
+	my $columns	= $state->{columns};
+	my $accs	= $g->[2];
+	my (%values, %types);
+	$l->debug( "- row: $row" ) if ($debug);
+	foreach my $i (0 .. $#{ $ops }) {
+		next if (exists($accs->[ $i ]) and not(defined($accs->[ $i ])));
+		my ($alias, $op, $distinct, $opts, $indexes, @cols)	= @{ $ops->[ $i ] };
+		my $col	= $cols[0];
+		my $ci	= $indexes->[0];
+		my $acc	= ($accs->[ $i ] ||= []);
+		eval {
+			my @proj_rows	= map {
+				(defined($_))
+					? (exists($values{ $_ }) ? $values{ $_ } : ($values{ $_ } = $query->var_or_expr_value( $row, $columns->[ $_ ], $context )))
+					: '*'
+			} @$indexes;
+			if ($distinct) {
+				my $seen	= ($g->[3][ $i ] ||= {});
+				return if ($seen->{ _group_key( \@proj_rows ) }++);
+			}
+			my $value	= $proj_rows[0];
+			
+			$l->debug("- aggregate op: $op") if ($debug);
+			if ($op eq 'COUNT') {
+				my $should_inc	= 0;
+				if (not(blessed($col)) and $col eq '*') {
+					$should_inc	= 1;
+				} else {
+					$should_inc	= (defined $value) ? 1 : 0;
+				}
+				
+				$acc->[0]	= $op;
+				$acc->[1]	+= $should_inc;
+			} elsif ($op eq 'SUM') {
+				my $type	= ($types{ $ci } //= _node_type( $value ));
+				$acc->[0]	= $op;
+				
+				unless ($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type) {
+					throw RDF::Query::Error::TypeError -text => "Cannot compute SUM aggregate with a non-numeric term: " . $value->as_ntriples;
+				}
+				
+				my $v	= $value->numeric_value;
+				if (scalar(@$acc) > 1) {
+					if ($type ne $acc->[2] and not($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type and blessed($acc->[1]) and $acc->[1]->isa('RDF::Query::Node::Literal') and $acc->[1]->is_numeric_type)) {
+						if ($context->strict_errors) {
+							throw RDF::Query::Error::ComparisonError -text => "Cannot compute SUM aggregate over nodes of multiple, non-numeric types";
+						}
+					}
+					
+					$acc->[1]	+= $v;
+					$acc->[2]	= RDF::Query::Expression::Binary->promote_type('+', $type, $acc->[2]);
+				} else {
+					$acc->[1]	= $v;
+					$acc->[2]	= $type;
+				}
+			} elsif ($op eq 'MAX' or $op eq 'MIN') {
+				my $type	= ($types{ $ci } //= _node_type( $value ));
+				$acc->[0]	= $op;
+				
+				my $strict	= 1;
+				if (scalar(@$acc) > 1) {
+					if ($type ne $acc->[2] and not($value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type and blessed($acc->[1]) and $acc->[1]->isa('RDF::Query::Node::Literal') and $acc->[1]->is_numeric_type)) {
+						if ($context->strict_errors) {
+							throw RDF::Query::Error::ComparisonError -text => "Cannot compute $op aggregate over nodes of multiple, non-numeric types";
+						} else {
+							$strict	= 0;
+						}
+					}
+					
+					my $replace;
+					if ($strict) {
+						$replace	= ($op eq 'MAX') ? ($value > $acc->[1]) : ($value < $acc->[1]);
+					} else {
+						$replace	= ($op eq 'MAX') ? ("$value" gt "$acc->[1]") : ("$value" lt "$acc->[1]");
+					}
+					if ($replace) {
+						$acc->[1]	= $value;
+						$acc->[2]	= $type;
+					}
+				} else {
+					$acc->[1]	= $value;
+					$acc->[2]	= $type;
+				}
+			} elsif ($op eq 'SAMPLE') {
+				### this is just the MIN code from above, without the strict comparison checking
+				$acc->[0]	= $op;
+				
+				# the sampled value is a node, so its type is not needed
+				if (scalar(@$acc) > 1) {
+					if ("$value" lt "$acc->[1]") {
+						$acc->[1]	= $value;
+					}
+				} else {
+					$acc->[1]	= $value;
+				}
+			} elsif ($op eq 'AVG') {
+				$acc->[0]	= $op;
+				
+				unless (blessed($value) and $value->isa('RDF::Query::Node::Literal') and $value->is_numeric_type) {
+					throw RDF::Query::Error::ComparisonError -text => "Cannot compute AVG aggregate over non-numeric nodes";
+				}
+				my $type	= ($types{ $ci } //= _node_type( $value ));
+				
+				$acc->[1]++;
+				$acc->[2]	+= $value->numeric_value;
+				if ($acc->[3]) {
+					$acc->[3]	= RDF::Query::Expression::Binary->promote_type('+', $type, $acc->[3]);
+				} else {
+					$acc->[3]	= $type;
+				}
+			} elsif ($op eq 'GROUP_CONCAT') {
+				$acc->[0]	= $op;
+				
+				# the values are appended as they are added, so the group keeps a
+				# single string rather than a list of values
+				my $str		= RDF::Query::Node::Resource->new('sparql:str');
+				my $j		= (exists $opts->{seperator}) ? $opts->{seperator} : ' ';
+				foreach my $v (@proj_rows) {
+					my $expr	= RDF::Query::Expression::Function->new( $str, $v );
+					my $val		= $expr->evaluate( $context->query, $row );
+					my $string	= blessed($val) ? $val->literal_value : '';
+					if (defined($acc->[1])) {
+						$acc->[1]	.= $j . $string;
+					} else {
+						$acc->[1]	= $string;
+					}
+				}
+				if (length($acc->[1]) > $state->{concat_limit}) {
+					throw RDF::Query::Error::ExecutionError -text => "GROUP_CONCAT aggregate value is longer than $state->{concat_limit} characters";
+				}
+			} else {
+				throw RDF::Query::Error -text => "Unknown aggregate operator $op";
+			}
+		};
+		if (my $e = $@) {
+			if (blessed($e) and ($e->isa('RDF::Query::Error::ComparisonError') or $e->isa('RDF::Query::Error::TypeError'))) {
+				$accs->[ $i ]	= undef;
+			} else {
+				die $e;
+			}
+		}
+	}
+}
+
+# Returns the aggregate rows of the groups in the group table (in the order the
+# groups were first seen), and empties the table.
+sub _finish_groups {
+	my $self	= shift;
+	my $state	= $self->[0];
+	my $groups	= $state->{groups};
+	my @rows	= map { $self->_group_row( $groups->{ $_ } ) } @{ $state->{keys} };
+	$state->{groups}	= {};
+	$state->{keys}		= [];
+	return @rows;
+}
+
+sub _group_row {
+	my $self	= shift;
+	my $g		= shift;
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.aggregate");
+	my ($group, $row_sample, $accs)	= @$g;
+	$row_sample	||= {};
+	
+	my %row;
+	foreach my $g ($self->groupby) {
+		if ($g->isa('RDF::Query::Expression::Alias') or $g->isa('RDF::Query::Node::Variable')) {
+			my $name	= $g->name;
+			$row{ $name }	= $row_sample->{ $name };
+		} elsif ($g->isa('RDF::Query::Expression')) {
+			my @names	= $g->referenced_variables;
+			foreach my $name (@names) {
+				$row{ $name }	= $row_sample->{ $name };
+			}
+		} else {
+			my $name	= $g->sse;
+			$row{ $name }	= $row_sample->{ $name };
+		}
+	}
+	
+	my $ops	= $self->[0]{ops};
+	foreach my $i (0 .. $#{ $ops }) {
+		my $acc	= $accs->[ $i ];
+		next unless (defined($acc) and defined($acc->[0]));
+		my $agg	= $ops->[ $i ][0];
+		my $op	= $acc->[0];
+		if ($op eq 'AVG') {
+			my $value	= ($acc->[2] / $acc->[1]);
+			my $type	= $acc->[3];
+			if ($type eq 'http://www.w3.org/2001/XMLSchema#integer') {
+				$type	= 'http://www.w3.org/2001/XMLSchema#decimal';
+			}
+			$row{ $agg }	= (blessed($value) and $value->isa('RDF::Trine::Node')) ? $value : RDF::Trine::Node::Literal->new( $value, undef, $type, 1 );
+		} elsif ($op eq 'GROUP_CONCAT') {
+			$row{ $agg }	= RDF::Query::Node::Literal->new( $acc->[1] );
+		} elsif ($op =~ /COUNT/) {
+			my $value	= $acc->[1];
+			$row{ $agg }	= (blessed($value) and $value->isa('RDF::Trine::Node')) ? $value : RDF::Trine::Node::Literal->new( $value, undef, 'http://www.w3.org/2001/XMLSchema#integer', 1 );
+		} else {
+			my $value	= $acc->[1];
+			$row{ $agg }	= (blessed($value) and $value->isa('RDF::Trine::Node')) ? $value : RDF::Trine::Node::Literal->new( $value, undef, $acc->[2], 1 );
+		}
+	}
+	
+	my $vars	= RDF::Query::VariableBindings->new( \%row );
+	$l->debug("aggregate row: $vars") if ($l->is_debug);
+	return $vars;
+}
+
+# Returns the ordering of the pattern if it sorts on all of the grouping
+# variables (and only on them) before any other expression, or undef.
+sub _group_order {
+	my $self	= shift;
+	my @groupby	= $self->groupby;
+	return unless (@groupby);
+	my %names;
+	foreach my $g (@groupby) {
+		return unless ($g->isa('RDF::Query::Node::Variable'));
+		$names{ $g->name }++;
+	}
+	my $ordered	= $self->pattern->ordered;
+	my @order;
+	foreach my $o (ref($ordered) ? @$ordered : ()) {
+		last if (scalar(@order) == scalar(keys %names));
+		my $expr	= $o->[0];
+		return unless (blessed($expr) and $expr->isa('RDF::Query::Node::Variable') and $names{ $expr->name });
+		push(@order, $o);
+	}
+	my %seen	= map { $_->[0]->name => 1 } @order;
+	return (scalar(keys %seen) == scalar(keys %names)) ? \@order : undef;
+}
+
 =item C<< pattern >>
 
 Returns the query plan that will be used to produce the aggregated data.
@@ -545,6 +665,16 @@ sub _node_type {
 	}
 }
 
+# Returns the 16-byte key of the group with the (possibly unbound) values in
+# $group, using the same row fingerprints as the distinct plan.
+sub _group_key {
+	my $group	= shift;
+	my %values;
+	@values{ 0 .. $#{ $group } }	= @$group;
+	my $key		= RDF::Query::Plan::_row_fingerprint( \%values );
+	return (defined($key)) ? $key : md5( encode_utf8( join('<<<', map { blessed($_) ? $_->as_string : '' } @$group) ) );
+}
+
 1;
 
 __END__
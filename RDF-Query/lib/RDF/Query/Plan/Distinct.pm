@@ -9,6 +9,26 @@ RDF::Query::Plan::Distinct - Executable query plan for Distincts.
 
 This document describes RDF::Query::Plan::Distinct version 2.919.
 
+=head1 DESCRIPTION
+
+Rows are deduplicated by a 16-byte MD5 fingerprint of their bound variables
+and values (see L<RDF::Trine::XS/row_fingerprint>), kept in a set of seen
+fingerprints. If L<RDF::Trine::XS> is installed, the fingerprints are computed
+natively and kept in an open-addressing table of 16 bytes per row; otherwise
+they are kept in a perl hash.
+
+If the pattern is ordered (see L<RDF::Query::Plan/ordered>) only on variables
+that appear in its rows, rows can only repeat among adjacent rows with equal
+ordering values, so the set is emptied whenever the ordering values change.
+
+Otherwise, once the set grows past C<< rdf.query.plan.distinct.memory_limit >>
+bytes (an option of the query), or C<< $RDF::Query::Plan::Distinct::MEMORY_LIMIT >>
+bytes (default 64MB), rows that have not been seen are written to one of
+C<< $RDF::Query::Plan::Distinct::PARTITIONS >> temporary files by their
+fingerprint instead of being returned. When the pattern is exhausted, each
+partition is deduplicated in turn with a new set, so rows are returned in a
+different order than the pattern produced them.
+
 =head1 METHODS
 
 Beyond the methods documented below, this class inherits methods from the
@@ -22,13 +42,20 @@ package RDF::Query::Plan::Distinct;
 
 use strict;
 use warnings;
+use Digest::MD5 qw(md5);
+use Encode qw(encode_utf8);
+use File::Temp qw(tempfile);
+use Scalar::Util qw(blessed);
+use Storable qw(store_fd fd_retrieve);
 use base qw(RDF::Query::Plan);
 
 ######################################################################
 
-our ($VERSION);
+our ($VERSION, $MEMORY_LIMIT, $PARTITIONS);
 BEGIN {
-	$VERSION	= '2.919';
+	$VERSION		= '2.919';
+	$MEMORY_LIMIT	= 64 * 1024 * 1024;
+	$PARTITIONS		= 16;
 }
 
 ######################################################################
@@ -60,7 +87,13 @@ sub execute ($) {
 	$plan->execute( $context );
 
 	if ($plan->state == $self->OPEN) {
-		$self->[0]{seen}	= {};
+		my $config	= $context->options || {};
+		$self->[0]{context}	= $context;
+		$self->[0]{order}	= $self->_distinct_order;
+		$self->[0]{limit}	= $config->{ 'rdf.query.plan.distinct.memory_limit' } || $MEMORY_LIMIT;
+		$self->[0]{seen}	= _fingerprint_set();
+		$self->[0]{depth}	= 0;
+		$self->[0]{pending}	= [];
 		$self->state( $self->OPEN );
 	} else {
 		warn "could not execute plan in distinct";
@@ -77,16 +110,88 @@ sub next {
 	unless ($self->state == $self->OPEN) {
 		throw RDF::Query::Error::ExecutionError -text => "next() cannot be called on an un-open DISTINCT";
 	}
-	my $plan	= $self->[1];
+	my $state	= $self->[0];
 	while (1) {
-		my $row	= $plan->next;
+		my ($row, $fp)	= $self->_next_input;
 		return undef unless ($row);
-		if (not $self->[0]{seen}{ $row->as_string }++) {
-			if (my $d = $self->delegate) {
-				$d->log_result( $self, $row );
+		
+		if (my $order = $state->{order}) {
+			my @values	= map { $row->{ $_->[0]->name } } @$order;
+			my $group	= $state->{group};
+			if (not($group) or RDF::Query::Plan::Sort::_cmp_values( $order, $group, \@values )) {
+				$state->{seen}	= _fingerprint_set();
+				$state->{group}	= \@values;
 			}
-			return $row;
 		}
+		
+		my $seen	= $state->{seen};
+		if (my $parts = $state->{partitions}) {
+			next if ($seen->contains( $fp ));
+			my $fh	= $parts->[ ord(substr($fp, $state->{depth}, 1)) % scalar(@$parts) ];
+			store_fd( [ $fp, $row ], $fh ) or throw RDF::Query::Error::ExecutionError -text => "Can't write distinct partition to temporary file";
+			next;
+		}
+		next unless ($seen->insert( $fp ));
+		if (not($state->{order}) and $state->{depth} < 16 and $seen->bytes >= $state->{limit}) {
+			$state->{partitions}	= [ map { my $fh = tempfile(); binmode($fh); $fh } (1 .. $PARTITIONS) ];
+		}
+		if (my $d = $self->delegate) {
+			$d->log_result( $self, $row );
+		}
+		return $row;
+	}
+}
+
+# Returns the ordering of the pattern if it sorts only on variables that appear
+# in the pattern's rows, or undef. Other sort expressions can't be re-evaluated
+# to the values the rows were sorted by (e.g. RAND()), and a variable that was
+# projected away is unbound in every row, so neither can delimit the runs of
+# rows that may repeat.
+sub _distinct_order {
+	my $self	= shift;
+	my $plan	= $self->[1];
+	my $order	= $plan->ordered;
+	return unless (ref($order) and @$order);
+	my @vars	= ($plan->isa('RDF::Query::Plan::Project'))
+				? map { $_->name } grep { $_->isa('RDF::Query::Node::Variable') } @{ ($plan->plan_node_data)[0] }
+				: $plan->referenced_variables;
+	my %vars	= map { $_ => 1 } @vars;
+	foreach my $o (@$order) {
+		my $expr	= $o->[0];
+		return unless (blessed($expr) and $expr->isa('RDF::Query::Node::Variable') and $vars{ $expr->name });
+	}
+	return $order;
+}
+
+# Returns the next row to deduplicate and its fingerprint, reading from the
+# pattern and then from each spilled partition in turn.
+sub _next_input {
+	my $self	= shift;
+	my $state	= $self->[0];
+	while (1) {
+		if (my $fh = $state->{input}) {
+			return @{ fd_retrieve( $fh ) }[ 1, 0 ] unless (eof($fh));
+		} elsif (not($state->{exhausted})) {
+			if (my $row = $self->[1]->next) {
+				return ($row, _fingerprint( $row ));
+			}
+			$state->{exhausted}	= 1;
+		}
+		
+		# the current input is exhausted; partitions spilled while reading it
+		# are deduplicated next, using the following fingerprint byte for any
+		# partitions they spill in turn
+		if (my $parts = delete $state->{partitions}) {
+			my $depth	= $state->{depth} + 1;
+			foreach my $fh (@$parts) {
+				seek( $fh, 0, 0 );
+				unshift( @{ $state->{pending} }, [ $fh, $depth ] );
+			}
+		}
+		my $next	= shift( @{ $state->{pending} } );
+		return unless ($next);
+		($state->{input}, $state->{depth})	= @$next;
+		$state->{seen}	= _fingerprint_set();
 	}
 }
 
@@ -99,7 +204,7 @@ sub close {
 	unless ($self->state == $self->OPEN) {
 		throw RDF::Query::Error::ExecutionError -text => "close() cannot be called on an un-open DISTINCT";
 	}
-	delete $self->[0]{seen};
+	delete $self->[0]{$_} for (qw(seen context group input partitions pending exhausted));
 	$self->[1]->close();
 	$self->SUPER::close();
 }
@@ -185,6 +290,56 @@ sub graph {
 }
 
 
+# Returns the fingerprint used to deduplicate $row. Rows binding other kinds of
+# nodes are fingerprinted by their string serialization.
+sub _fingerprint {
+	my $row	= shift;
+	my $fp	= RDF::Query::Plan::_row_fingerprint( $row );
+	return (defined($fp)) ? $fp : md5( encode_utf8( $row->as_string ) );
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	no strict 'refs';
+	*{ '_fingerprint_set' }	= (RDF::Trine::XS::FingerprintSet->can('insert'))
+		? sub { RDF::Trine::XS::FingerprintSet->new() }
+		: sub { RDF::Query::Plan::Distinct::FingerprintSet->new() };
+}
+
+# A perl implementation of the RDF::Trine::XS::FingerprintSet methods used by
+# the distinct plan.
+package RDF::Query::Plan::Distinct::FingerprintSet;
+
+sub new {
+	my $class	= shift;
+	return bless( {}, $class );
+}
+
+sub insert {
+	my $self	= shift;
+	my $fp		= shift;
+	return not($self->{ $fp }++);
+}
+
+sub contains {
+	my $self	= shift;
+	my $fp		= shift;
+	return exists($self->{ $fp });
+}
+
+sub size {
+	my $self	= shift;
+	return scalar(keys %$self);
+}
+
+# an estimate of the memory used by a perl hash with 16-byte keys
+sub bytes {
+	my $self	= shift;
+	return 96 * scalar(keys %$self);
+}
+
 1;
 
 __END__
@@ -0,0 +1,358 @@
+# RDF::Query::Plan::Join::Hash
+# -----------------------------------------------------------------------------
+
+=head1 NAME
+
+RDF::Query::Plan::Join::Hash - Executable query plan for hash joins.
+
+=head1 VERSION
+
+This document describes RDF::Query::Plan::Join::Hash version 2.919.
+
+=head1 DESCRIPTION
+
+The hash join materializes the right-hand-side plan into a hash table keyed on
+the values of the variables shared by both sides of the join, and then probes
+the table with each left-hand-side result. Rows of either side that leave a
+join variable unbound are compared with every row of the other side, as in a
+nested loop join.
+
+If L<RDF::Trine::XS> is installed, the hash keys are computed natively from
+the bound nodes. Nodes are keyed by term, so two literals only join if they are
+the same term.
+
+=head1 METHODS
+
+Beyond the methods documented below, this class inherits methods from the
+L<RDF::Query::Plan::Join> class.
+
+=over 4
+
+=cut
+
+package RDF::Query::Plan::Join::Hash;
+
+use strict;
+use warnings;
+use base qw(RDF::Query::Plan::Join);
+
+use Log::Log4perl;
+use Scalar::Util qw(blessed);
+use Time::HiRes qw(gettimeofday tv_interval);
+
+use RDF::Query::Error qw(:try);
+use RDF::Query::ExecutionContext;
+use RDF::Query::BGPOptimizer;
+
+######################################################################
+
+our ($VERSION, $BUILD_LIMIT);
+BEGIN {
+	$VERSION		= '2.919';
+	$BUILD_LIMIT	= 100_000;
+	$RDF::Query::Plan::Join::JOIN_CLASSES{ 'RDF::Query::Plan::Join::Hash' }++;
+}
+
+######################################################################
+
+=item C<< new ( $lhs, $rhs, $opt, [ \%logging_keys ] ) >>
+
+=cut
+
+sub new {
+	my $class	= shift;
+	my $lhs		= shift;
+	my $rhs		= shift;
+	my $opt		= shift;
+	my $keys	= shift;
+	if ($opt) {
+		throw RDF::Query::Error::MethodInvocationError -text => "Hash join does not support optional joins (use PushDownNestedLoop instead)";
+	}
+	my $self	= $class->SUPER::new( $lhs, $rhs, $opt );
+
+	my %lhs_rv	= map { $_ => 1 } $lhs->referenced_variables;
+	my %join	= map { $_ => 1 } grep { $lhs_rv{ $_ } } $rhs->referenced_variables;
+	$self->[0]{join_variables}	= [ sort keys %join ];
+	$self->[0]{logging_keys}	= $keys;
+	return $self;
+}
+
+=item C<< preferred ( $context, $lhs, $rhs ) >>
+
+Returns true if a hash join should be preferred to the other join algorithms
+for joining the C<< $lhs >> and C<< $rhs >> plans: the plans must share a join
+variable, neither may be sorted on a join variable (in which case the sort
+order can be used by the join instead), and the estimated number of
+right-hand-side results must be no more than the build limit. The build limit
+is the C<< rdf.query.plan.join.hash.build_limit >> option of the query, or
+C<< $RDF::Query::Plan::Join::Hash::BUILD_LIMIT >> (default 100,000 results).
+
+The size of the right-hand side can only be estimated for triple, quad and
+basic graph pattern plans over stores with L<RDF::Trine::Store::Statistics>.
+Quad sizes are estimated over all graphs.
+
+=cut
+
+sub preferred {
+	my $class	= shift;
+	my $context	= shift;
+	my $lhs		= shift;
+	my $rhs		= shift;
+	my %lhs_rv	= map { $_ => 1 } $lhs->referenced_variables;
+	my %join	= map { $_ => 1 } grep { $lhs_rv{ $_ } } $rhs->referenced_variables;
+	return 0 unless (scalar(%join));
+
+	foreach my $plan ($lhs, $rhs) {
+		my $ordered	= $plan->ordered;
+		next unless (ref($ordered) and scalar(@$ordered));
+		my $expr	= $ordered->[0][0];
+		if (blessed($expr) and $expr->isa('RDF::Query::Node::Variable') and $join{ $expr->name }) {
+			return 0;
+		}
+	}
+
+	my $config	= $context->options || {};
+	my $limit	= $config->{ 'rdf.query.plan.join.hash.build_limit' } || $BUILD_LIMIT;
+	my $size	= $class->_estimated_size( $context, $rhs );
+	return (defined($size) and $size <= $limit) ? 1 : 0;
+}
+
+sub _estimated_size {
+	my $class	= shift;
+	my $context	= shift;
+	my $plan	= shift;
+	my $stats	= RDF::Query::BGPOptimizer->_statistics( $context ) or return;
+	my @triples;
+	if ($plan->isa('RDF::Query::Plan::Triple')) {
+		@triples	= ($plan->triple);
+	} elsif ($plan->isa('RDF::Query::Plan::Quad')) {
+		# statistics are kept for the whole store, so the graph is ignored
+		@triples	= (RDF::Trine::Statement->new( ($plan->nodes)[0 .. 2] ));
+	} elsif ($plan->isa('RDF::Query::Plan::BasicGraphPattern')) {
+		@triples	= $plan->plan_node_data;
+	} else {
+		return;
+	}
+
+	my %bound;
+	my $size	= 1;
+	foreach my $t (@triples) {
+		$size	*= $stats->cardinality( $t, \%bound );
+		$bound{ $_->name }	= 1 foreach (grep { $_->isa('RDF::Trine::Node::Variable') } ($t->nodes)[0 .. 2]);
+	}
+	return $size;
+}
+
+=item C<< execute ( $execution_context ) >>
+
+=cut
+
+sub execute ($) {
+	my $self	= shift;
+	my $context	= shift;
+	$self->[0]{delegate}	= $context->delegate;
+	if ($self->state == $self->OPEN) {
+		throw RDF::Query::Error::ExecutionError -text => "Hash join plan can't be executed while already open";
+	}
+
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.join.hash");
+	$self->[0]{start_time}	= [gettimeofday];
+
+	my $vars	= $self->[0]{join_variables};
+	my (@inner, %table, @unkeyed);
+	$self->rhs->execute( $context );
+	my $trace	= $l->is_trace;
+	while (my $row = $self->rhs->next) {
+		if ($trace) {
+			$l->trace("loading hash table with: " . $row);
+		}
+		push(@inner, $row);
+		my $key	= _join_key( $row, $vars );
+		if (defined($key)) {
+			push(@{ $table{ $key } }, $row);
+		} else {
+			push(@unkeyed, $row);
+		}
+	}
+	$self->lhs->execute( $context );
+	if ($self->lhs->state == $self->OPEN) {
+		$self->[0]{inner}			= \@inner;
+		$self->[0]{table}			= \%table;
+		$self->[0]{unkeyed}			= \@unkeyed;
+		$self->[0]{outer}			= $self->lhs;
+		$self->[0]{candidates}		= [];
+		$self->[0]{candidate_index}	= 0;
+		$self->[0]{needs_new_outer}	= 1;
+		$self->[0]{count}			= 0;
+		$self->[0]{logger}			= $context->logger;
+		$self->state( $self->OPEN );
+	} else {
+		warn "no iterator in execute()";
+	}
+	$self;
+}
+
+=item C<< next >>
+
+=cut
+
+sub next {
+	my $self	= shift;
+	unless ($self->state == $self->OPEN) {
+		throw RDF::Query::Error::ExecutionError -text => "next() cannot be called on an un-open Hash join";
+	}
+
+	my $outer	= $self->[0]{outer};
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.join.hash");
+	while (1) {
+		if ($self->[0]{needs_new_outer}) {
+			my $row	= $outer->next;
+			return undef unless (ref($row));
+			$self->[0]{outer_row}		= $row;
+			$self->[0]{needs_new_outer}	= 0;
+			$self->[0]{candidate_index}	= 0;
+
+			# an outer row with an unbound join variable may join with any inner row
+			my $key	= _join_key( $row, $self->[0]{join_variables} );
+			$self->[0]{candidates}	= (defined($key))
+									? [ @{ $self->[0]{table}{ $key } || [] }, @{ $self->[0]{unkeyed} } ]
+									: $self->[0]{inner};
+		}
+
+		my $candidates	= $self->[0]{candidates};
+		while ($self->[0]{candidate_index} < scalar(@$candidates)) {
+			my $inner_row	= $candidates->[ $self->[0]{candidate_index}++ ];
+			if (my $joined = $inner_row->join( $self->[0]{outer_row} )) {
+				if ($l->is_trace) {
+					$l->trace("joined bindings: $inner_row ⋈ $self->[0]{outer_row}");
+				}
+				$self->[0]{count}++;
+				if (my $d = $self->delegate) {
+					$d->log_result( $self, $joined );
+				}
+				return $joined;
+			}
+		}
+
+		$self->[0]{needs_new_outer}	= 1;
+	}
+}
+
+=item C<< close >>
+
+=cut
+
+sub close {
+	my $self	= shift;
+	unless ($self->state == $self->OPEN) {
+		throw RDF::Query::Error::ExecutionError -text => "close() cannot be called on an un-open Hash join";
+	}
+
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.join.hash");
+	my $t0		= delete $self->[0]{start_time};
+	my $count	= delete $self->[0]{count};
+	if (my $log = delete $self->[0]{logger}) {
+		$l->debug("logging hash join execution statistics");
+		my $elapsed = tv_interval ( $t0 );
+		if (my $sparql = $self->logging_keys->{sparql}) {
+			$log->push_key_value( 'execute_time-hashjoin', $sparql, $elapsed );
+			$log->push_key_value( 'cardinality-hashjoin', $sparql, $count );
+		}
+		if (my $bf = $self->logging_keys->{bf}) {
+			$log->push_key_value( 'cardinality-bf-hashjoin', $bf, $count );
+		}
+	}
+	delete $self->[0]{inner};
+	delete $self->[0]{table};
+	delete $self->[0]{unkeyed};
+	delete $self->[0]{outer};
+	delete $self->[0]{outer_row};
+	delete $self->[0]{candidates};
+	delete $self->[0]{candidate_index};
+	delete $self->[0]{needs_new_outer};
+	$self->lhs->close();
+	$self->rhs->close();
+	$self->SUPER::close();
+}
+
+=item C<< join_variables >>
+
+Returns the names of the variables shared by both sides of the join.
+
+=cut
+
+sub join_variables {
+	my $self	= shift;
+	return @{ $self->[0]{join_variables} };
+}
+
+=item C<< plan_node_name >>
+
+Returns the string name of this plan node, suitable for use in serialization.
+
+=cut
+
+sub plan_node_name {
+	return "hash-join";
+}
+
+=item C<< graph ( $g ) >>
+
+=cut
+
+sub graph {
+	my $self	= shift;
+	my $g		= shift;
+	my ($l, $r)	= map { $_->graph( $g ) } ($self->lhs, $self->rhs);
+	$g->add_node( "$self", label => "Join (Hash)" . $self->graph_labels );
+	$g->add_edge( "$self", $l );
+	$g->add_edge( "$self", $r );
+	return "$self";
+}
+
+# Returns the hash table key for the values of the join variables in $row, or
+# undef if any of them is unbound.
+sub _join_key_pp {
+	my $row		= shift;
+	my $vars	= shift;
+	my $key		= '';
+	foreach my $name (@$vars) {
+		my $node	= $row->{ $name };
+		return unless (blessed($node));
+		my $nkey;
+		if ($node->isa('RDF::Trine::Node::Resource')) {
+			$nkey	= 'R' . $node->uri_value;
+		} elsif ($node->isa('RDF::Trine::Node::Blank')) {
+			$nkey	= 'B' . $node->blank_identifier;
+		} elsif ($node->isa('RDF::Trine::Node::Literal')) {
+			no warnings 'uninitialized';
+			$nkey	= join("\0", 'L' . $node->literal_value_language, $node->literal_datatype, $node->literal_value);
+		} else {
+			return;
+		}
+		$key	.= length($nkey) . ':' . $nkey;
+	}
+	return $key;
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	no strict 'refs';
+	*{ '_join_key' }	= (RDF::Trine::XS->can('join_key'))
+		? \&RDF::Trine::XS::join_key
+		: \&_join_key_pp;
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 AUTHOR
+
+ Gregory Todd Williams <gwilliams@cpan.org>
+
+=cut
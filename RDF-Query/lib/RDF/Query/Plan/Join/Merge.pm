@@ -0,0 +1,420 @@
+# RDF::Query::Plan::Join::Merge
+# -----------------------------------------------------------------------------
+
+=head1 NAME
+
+RDF::Query::Plan::Join::Merge - Executable query plan for merge joins.
+
+=head1 VERSION
+
+This document describes RDF::Query::Plan::Join::Merge version 2.919.
+
+=head1 DESCRIPTION
+
+The merge join joins two plans that are both sorted on one or more of the join
+variables (as reported by their C<< ordered >> methods) by reading both in a
+single pass, without materializing either side. Runs of results with equal
+values of the sort variables are read from both sides and joined pairwise.
+
+Only plans that sort their results report an ordering. Triple, quad and BGP
+plans do not, since stores do not return statements in the order used by
+L<RDF::Query::Plan::Sort> (the hexastore, for example, returns them in node ID
+order). As the planner's inputs are almost never sorted, the merge join is not
+one of the join classes the planner tries (see
+L<RDF::Query::Plan::Join/join_classes>); it is constructed directly for inputs
+known to be sorted.
+
+Values are compared in the order used by L<RDF::Query::Plan::Sort>. IRIs and
+blank nodes are compared natively if L<RDF::Trine::XS> is installed.
+
+Results that leave a sort variable unbound cannot be placed in the merge order.
+They are set aside while merging and joined with the other side afterwards,
+which requires executing the other side's plan a second time.
+
+=head1 METHODS
+
+Beyond the methods documented below, this class inherits methods from the
+L<RDF::Query::Plan::Join> class.
+
+=over 4
+
+=cut
+
+package RDF::Query::Plan::Join::Merge;
+
+use strict;
+use warnings;
+use base qw(RDF::Query::Plan::Join);
+
+use Log::Log4perl;
+use Scalar::Util qw(blessed);
+use Time::HiRes qw(gettimeofday tv_interval);
+
+use RDF::Trine::Node;
+use RDF::Query::Error qw(:try);
+use RDF::Query::ExecutionContext;
+
+######################################################################
+
+our ($VERSION);
+BEGIN {
+	$VERSION	= '2.919';
+}
+
+######################################################################
+
+=item C<< new ( $lhs, $rhs, $opt, [ \%logging_keys ] ) >>
+
+Throws a MethodInvocationError unless both plans are sorted on a join variable
+(see C<< merge_keys >>).
+
+=cut
+
+sub new {
+	my $class	= shift;
+	my $lhs		= shift;
+	my $rhs		= shift;
+	my $opt		= shift;
+	my $keys	= shift;
+	if ($opt) {
+		throw RDF::Query::Error::MethodInvocationError -text => "Merge join does not support optional joins (use PushDownNestedLoop instead)";
+	}
+	my @merge	= $class->merge_keys( $lhs, $rhs );
+	unless (scalar(@merge)) {
+		throw RDF::Query::Error::MethodInvocationError -text => "Merge join requires both plans to be sorted on a join variable";
+	}
+	my $self	= $class->SUPER::new( $lhs, $rhs, $opt );
+	$self->[0]{merge_keys}		= \@merge;
+	$self->[0]{logging_keys}	= $keys;
+	return $self;
+}
+
+=item C<< merge_keys ( $lhs, $rhs ) >>
+
+Returns a list of C<< [ $variable_name, $descending ] >> pairs for the longest
+common prefix of the orderings of the C<< $lhs >> and C<< $rhs >> plans that
+consists of join variables sorted in the same direction on both sides. An empty
+list means the plans cannot be merge joined. Called on a merge join object
+without arguments, returns the pairs the join merges on.
+
+=cut
+
+sub merge_keys {
+	my $class	= shift;
+	if (blessed($class) and not(@_)) {
+		return @{ $class->[0]{merge_keys} };
+	}
+	my $lhs		= shift;
+	my $rhs		= shift;
+	my %lhs_rv	= map { $_ => 1 } $lhs->referenced_variables;
+	my %join	= map { $_ => 1 } grep { $lhs_rv{ $_ } } $rhs->referenced_variables;
+	my ($lo, $ro)	= map { my $o = $_->ordered; (ref($o) ? $o : []) } ($lhs, $rhs);
+
+	my @keys;
+	my %seen;
+	foreach my $i (0 .. $#{ $lo }) {
+		last if ($i > $#{ $ro });
+		my ($le, $ldir)	= @{ $lo->[ $i ] };
+		my ($re, $rdir)	= @{ $ro->[ $i ] };
+		last unless (blessed($le) and $le->isa('RDF::Trine::Node::Variable'));
+		last unless (blessed($re) and $re->isa('RDF::Trine::Node::Variable'));
+		my $name	= $le->name;
+		last unless ($re->name eq $name and $join{ $name } and not($seen{ $name }++));
+		last unless (uc($ldir) eq uc($rdir));
+		push(@keys, [ $name, (uc($ldir) eq 'DESC') ? 1 : 0 ]);
+	}
+	return @keys;
+}
+
+=item C<< execute ( $execution_context ) >>
+
+=cut
+
+sub execute ($) {
+	my $self	= shift;
+	my $context	= shift;
+	$self->[0]{delegate}	= $context->delegate;
+	if ($self->state == $self->OPEN) {
+		throw RDF::Query::Error::ExecutionError -text => "Merge join plan can't be executed while already open";
+	}
+
+	$self->[0]{start_time}	= [gettimeofday];
+	$self->lhs->execute( $context );
+	$self->rhs->execute( $context );
+	if ($self->lhs->state == $self->OPEN and $self->rhs->state == $self->OPEN) {
+		$self->[0]{context}	= $context;
+		$self->[0]{phase}	= 'merge';
+		$self->[0]{sides}	= {
+			lhs	=> { plan => $self->lhs, unkeyed => [] },
+			rhs	=> { plan => $self->rhs, unkeyed => [] },
+		};
+		$self->[0]{count}	= 0;
+		$self->[0]{logger}	= $context->logger;
+		$self->state( $self->OPEN );
+	} else {
+		warn "no iterator in execute()";
+	}
+	$self;
+}
+
+=item C<< next >>
+
+=cut
+
+sub next {
+	my $self	= shift;
+	unless ($self->state == $self->OPEN) {
+		throw RDF::Query::Error::ExecutionError -text => "next() cannot be called on an un-open Merge join";
+	}
+
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.join.merge");
+	my $sides	= $self->[0]{sides};
+	while (1) {
+		if (my $pairs = $self->[0]{pairs}) {
+			# join each row from the outer source with every row of the inner list
+			while (1) {
+				my $outer	= $pairs->{outer_row};
+				if ($outer and $pairs->{index} < scalar(@{ $pairs->{inner} })) {
+					my $inner	= $pairs->{inner}[ $pairs->{index}++ ];
+					if (my $joined = $inner->join( $outer )) {
+						if ($l->is_trace) {
+							$l->trace("joined bindings: $inner ⋈ $outer");
+						}
+						$self->[0]{count}++;
+						if (my $d = $self->delegate) {
+							$d->log_result( $self, $joined );
+						}
+						return $joined;
+					}
+					next;
+				}
+				$pairs->{outer_row}	= $pairs->{outer}->();
+				$pairs->{index}		= 0;
+				last unless ($pairs->{outer_row});
+			}
+			delete $self->[0]{pairs};
+		}
+
+		my $phase	= $self->[0]{phase};
+		if ($phase eq 'merge') {
+			my $lrow	= $self->_peek('lhs');
+			my $rrow	= $self->_peek('rhs');
+			unless ($lrow and $rrow) {
+				# set aside the remaining unkeyed rows of both sides
+				1 while ($self->_take('lhs'));
+				1 while ($self->_take('rhs'));
+				$self->[0]{phase}	= 'lhs_unkeyed';
+				next;
+			}
+			my $cmp	= $self->_cmp_rows( $lrow, $rrow );
+			if ($cmp < 0) {
+				$self->_take('lhs');
+			} elsif ($cmp > 0) {
+				$self->_take('rhs');
+			} else {
+				my @lrun	= $self->_take_run('lhs');
+				my @rrun	= $self->_take_run('rhs');
+				$l->trace("merging runs of " . scalar(@lrun) . " and " . scalar(@rrun) . " rows");
+				$self->[0]{pairs}	= { outer => sub { shift(@lrun) }, inner => \@rrun, index => 0 };
+			}
+		} elsif ($phase eq 'lhs_unkeyed') {
+			# unkeyed lhs rows may join with any rhs row
+			$self->[0]{phase}	= 'rhs_unkeyed';
+			my $unkeyed	= $sides->{lhs}{unkeyed};
+			if (scalar(@$unkeyed)) {
+				my $plan	= $self->_reexecute('rhs');
+				$self->[0]{pairs}	= { outer => sub { $plan->next }, inner => $unkeyed, index => 0 };
+			}
+		} elsif ($phase eq 'rhs_unkeyed') {
+			# unkeyed rhs rows may join with any keyed lhs row
+			$self->[0]{phase}	= 'done';
+			my $unkeyed	= $sides->{rhs}{unkeyed};
+			if (scalar(@$unkeyed)) {
+				my $plan	= $self->_reexecute('lhs');
+				my $outer	= sub {
+					while (my $row = $plan->next) {
+						return $row if ($self->_keyed( $row ));
+					}
+					return;
+				};
+				$self->[0]{pairs}	= { outer => $outer, inner => $unkeyed, index => 0 };
+			}
+		} else {
+			return undef;
+		}
+	}
+}
+
+=item C<< close >>
+
+=cut
+
+sub close {
+	my $self	= shift;
+	unless ($self->state == $self->OPEN) {
+		throw RDF::Query::Error::ExecutionError -text => "close() cannot be called on an un-open Merge join";
+	}
+
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.join.merge");
+	my $t0		= delete $self->[0]{start_time};
+	my $count	= delete $self->[0]{count};
+	if (my $log = delete $self->[0]{logger}) {
+		$l->debug("logging merge join execution statistics");
+		my $elapsed = tv_interval ( $t0 );
+		if (my $sparql = $self->logging_keys->{sparql}) {
+			$log->push_key_value( 'execute_time-mergejoin', $sparql, $elapsed );
+			$log->push_key_value( 'cardinality-mergejoin', $sparql, $count );
+		}
+		if (my $bf = $self->logging_keys->{bf}) {
+			$log->push_key_value( 'cardinality-bf-mergejoin', $bf, $count );
+		}
+	}
+	delete $self->[0]{context};
+	delete $self->[0]{phase};
+	delete $self->[0]{sides};
+	delete $self->[0]{pairs};
+	foreach my $plan ($self->lhs, $self->rhs) {
+		$plan->close() if ($plan->state == $plan->OPEN);
+	}
+	$self->SUPER::close();
+}
+
+=item C<< plan_node_name >>
+
+Returns the string name of this plan node, suitable for use in serialization.
+
+=cut
+
+sub plan_node_name {
+	return "merge-join";
+}
+
+=item C<< graph ( $g ) >>
+
+=cut
+
+sub graph {
+	my $self	= shift;
+	my $g		= shift;
+	my ($l, $r)	= map { $_->graph( $g ) } ($self->lhs, $self->rhs);
+	$g->add_node( "$self", label => "Join (Merge)" . $self->graph_labels );
+	$g->add_edge( "$self", $l );
+	$g->add_edge( "$self", $r );
+	return "$self";
+}
+
+# Returns the next row of the given side that binds all the merge variables,
+# without consuming it. Rows that leave a merge variable unbound are set aside
+# as they are read.
+sub _peek {
+	my $self	= shift;
+	my $side	= shift;
+	my $state	= $self->[0]{sides}{ $side };
+	return $state->{next} if ($state->{next});
+	return if ($state->{done});
+	while (my $row = $state->{plan}->next) {
+		unless ($self->_keyed( $row )) {
+			push(@{ $state->{unkeyed} }, $row);
+			next;
+		}
+		if (my $last = $state->{last}) {
+			if ($self->_cmp_rows( $last, $row ) > 0) {
+				throw RDF::Query::Error::ExecutionError -text => "Merge join input is not sorted on the join variables";
+			}
+		}
+		$state->{next}	= $state->{last}	= $row;
+		return $row;
+	}
+	$state->{done}	= 1;
+	return;
+}
+
+sub _take {
+	my $self	= shift;
+	my $side	= shift;
+	my $row		= $self->_peek( $side );
+	delete $self->[0]{sides}{ $side }{next};
+	return $row;
+}
+
+# Consumes and returns the rows of the given side that compare equal to the
+# next row.
+sub _take_run {
+	my $self	= shift;
+	my $side	= shift;
+	my $first	= $self->_take( $side );
+	my @run		= ($first);
+	while (my $row = $self->_peek( $side )) {
+		last if ($self->_cmp_rows( $first, $row ));
+		push(@run, $self->_take( $side ));
+	}
+	return @run;
+}
+
+sub _reexecute {
+	my $self	= shift;
+	my $side	= shift;
+	my $plan	= $self->[0]{sides}{ $side }{plan};
+	$plan->close() if ($plan->state == $plan->OPEN);
+	$plan->execute( $self->[0]{context} );
+	return $plan;
+}
+
+sub _keyed {
+	my $self	= shift;
+	my $row		= shift;
+	foreach my $k (@{ $self->[0]{merge_keys} }) {
+		return 0 unless (blessed($row->{ $k->[0] }));
+	}
+	return 1;
+}
+
+sub _cmp_rows {
+	my $self	= shift;
+	my $a		= shift;
+	my $b		= shift;
+	foreach my $k (@{ $self->[0]{merge_keys} }) {
+		my ($name, $rev)	= @$k;
+		my $cmp		= _cmp_nodes( $a->{ $name }, $b->{ $name } );
+		return ($rev ? -$cmp : $cmp) if ($cmp);
+	}
+	return 0;
+}
+
+# Compares two bound values as RDF::Query::Plan::Sort does. Pairs of literals
+# use the SPARQL ordering of the query engine's literal classes (e.g. numeric
+# comparison of numeric literals); other pairs are ordered by type and value.
+sub _cmp_nodes {
+	my $a	= shift;
+	my $b	= shift;
+	if ($a->isa('RDF::Trine::Node::Literal') and $b->isa('RDF::Trine::Node::Literal')) {
+		no warnings 'numeric';
+		no warnings 'uninitialized';
+		local($RDF::Query::Node::Literal::LAZY_COMPARISONS)	= 1;
+		return $a <=> $b;
+	}
+	my $cmp	= _compare_nodes( $a, $b );
+	return (defined($cmp) ? $cmp : 0);
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	no strict 'refs';
+	*{ '_compare_nodes' }	= (RDF::Trine::XS->can('compare_nodes'))
+		? \&RDF::Trine::XS::compare_nodes
+		: \&RDF::Trine::Node::compare;
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 AUTHOR
+
+ Gregory Todd Williams <gwilliams@cpan.org>
+
+=cut
@@ -9,6 +9,24 @@ RDF::Query::Plan::Path - Executable query plan for Paths.
 
 This document describes RDF::Query::Plan::Path version 2.919.
 
+=head1 DESCRIPTION
+
+Transitive paths (C<< path* >> and C<< path+ >>) with an unbound end, over a
+predicate, an inverse predicate, or an alternative of these, are evaluated over
+an adjacency snapshot of the matching statements in the active graph. The
+snapshot is loaded with one C<< get_statements >> call per predicate and kept
+for the rest of the query execution, and the nodes reachable from each start
+node are found with a breadth-first search. If L<RDF::Trine::XS> is installed,
+the snapshot is kept in compressed sparse row form and searched natively (see
+L<RDF::Trine::XS/Adjacency>). Results are produced as they are read, one start
+node at a time. Other transitive paths are evaluated by recursively evaluating
+the path from each reached node.
+
+If both ends of a transitive path are bound, the path is evaluated one step at
+a time forward from the start and backward from the end, always extending the
+side with fewer unexpanded nodes, and evaluation stops as soon as the two
+sides meet.
+
 =head1 METHODS
 
 Beyond the methods documented below, this class inherits methods from the
@@ -143,6 +161,7 @@ sub _run_nps {
 
 sub _run_zeroormore {
 	my $self	= shift;
+	return if ($self->_run_closure( 0 ));
 	my $context	= $self->[0]{context};
 	my $graph	= $self->[0]{graph};
 	$graph		= RDF::Trine::Node::Nil->new() unless (defined($graph));
@@ -188,25 +207,14 @@ sub _run_zeroormore {
 			push(@{ $self->[0]{results} }, $vb);
 		}
 	} else {
-		# term path+ term
-		my $var	= RDF::Trine::Node::Variable->new();
-		my $start	= $self->start;
-		my $end		= $self->end;
-		my $path	= $self->path;
-		my $r	= [];
-		$self->_alp( $start, $path, $r, {} );
-		foreach my $term (@$r) {
-			if ($term->equal( $end )) {
-				my $vb          = RDF::Query::VariableBindings->new({});
-				push(@{ $self->[0]{results} }, $vb);
-				return;
-			}
-		}
+		# term path* term
+		$self->_run_bidirectional( 0 );
 	}
 }
 
 sub _run_oneormore {
 	my $self	= shift;
+	return if ($self->_run_closure( 1 ));
 	my $context	= $self->[0]{context};
 	my $graph	= $self->[0]{graph};
 	$graph		= RDF::Trine::Node::Nil->new() unless (defined($graph));
@@ -260,24 +268,211 @@ sub _run_oneormore {
 		}
 	} else {
 		# term path+ term
-		my $var	= RDF::Trine::Node::Variable->new();
-		my $start	= $self->start;
-		my $end		= $self->end;
-		my $path	= $self->path;
-		my $x		= $self->_path_eval($start, $path);
-		my $V		= {};
-		while (my $n = $x->next) {
-			my $r	= [];
-			$self->_alp( $n, $path, $r, $V );
-			foreach my $term (@$r) {
-				if ($term->equal( $end )) {
-					my $vb          = RDF::Query::VariableBindings->new({});
-					push(@{ $self->[0]{results} }, $vb);
+		$self->_run_bidirectional( 1 );
+	}
+}
+
+# Answers term path* term (or term path+ term if $min is 1) with breadth-first
+# searches forward over the path from the start and backward over ^path from
+# the end. The smaller frontier is expanded by one step at a time, and the
+# search stops as soon as a step reaches a node the other search has seen.
+sub _run_bidirectional {
+	my $self	= shift;
+	my $min		= shift;
+	my $start	= $self->start;
+	my $end		= $self->end;
+	my $path	= $self->path;
+	if ($min == 0 and $start->equal( $end )) {
+		push(@{ $self->[0]{results} }, RDF::Query::VariableBindings->new({}));
+		return;
+	}
+	
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.path");
+	my @sides	= (
+		{ path => $path, seen => { $start->as_string => 1 }, frontier => [ $start ] },
+		{ path => ['^', $path], seen => { $end->as_string => 1 }, frontier => [ $end ] },
+	);
+	while (@{ $sides[0]{frontier} } and @{ $sides[1]{frontier} }) {
+		my ($side, $other)	= (scalar(@{ $sides[0]{frontier} }) <= scalar(@{ $sides[1]{frontier} })) ? @sides : reverse(@sides);
+		my @next;
+		foreach my $term (@{ $side->{frontier} }) {
+			my $x	= $self->_path_eval( $term, $side->{path} );
+			while (my $n = $x->next) {
+				my $key	= $n->as_string;
+				if ($other->{seen}{ $key }) {
+					$l->trace( "bidirectional path search met at $key" );
+					push(@{ $self->[0]{results} }, RDF::Query::VariableBindings->new({}));
 					return;
 				}
+				next if ($side->{seen}{ $key }++);
+				push(@next, $n);
+			}
+		}
+		$side->{frontier}	= \@next;
+	}
+}
+
+# Evaluates a transitive path with at least one unbound end over an adjacency
+# snapshot of the path's predicates, returning false if the path is not an
+# alternative of (possibly inverse) predicates. Paths of at least $min steps
+# are followed.
+sub _run_closure {
+	my $self	= shift;
+	my $min		= shift;
+	my $graph	= $self->[0]{graph};
+	$graph		= RDF::Trine::Node::Nil->new() unless (defined($graph));
+	return 0 unless ($self->distinct);
+	return 0 if ($graph->isa('RDF::Trine::Node::Variable'));
+	my @preds	= _closure_predicates( $self->path, 0 );
+	return 0 unless (@preds);
+	
+	my $start	= $self->start;
+	my $end		= $self->end;
+	my @vars	= grep { blessed($_) and $_->isa('RDF::Trine::Node::Variable') } ($start, $end);
+	
+	# with both ends bound, a bidirectional search usually touches far less of
+	# the graph than loading the snapshot would
+	return 0 unless (@vars);
+	if (scalar(@vars) == 1 and $start->isa('RDF::Trine::Node::Variable')) {
+		# var path+ term
+		($start, $end)	= ($end, $start);
+		@preds			= map { [ $_->[0], ($_->[1] ? 0 : 1) ] } @preds;
+	}
+	
+	my $adj		= $self->_adjacency( \@preds, $graph );
+	my @terms;
+	my $term	= sub { $terms[ $_[0] ] ||= RDF::Query::Node->from_trine( $adj->node( $_[0] ) ) };
+	if (scalar(@vars) == 2) {
+		# var path+ var
+		my @names	= map { $_->name } @vars;
+		my $same	= ($names[0] eq $names[1]);
+		my $count	= $adj->nodes;
+		my $next	= 0;
+		my $closure	= _closure_stream( $adj, sub { ($next < $count) ? $next++ : undef }, $min, sub {
+			my ($from, $to)	= @_;
+			return if ($same and $from != $to);
+			return RDF::Query::VariableBindings->new({ $names[0] => $term->( $from ), $names[1] => $term->( $to ) });
+		} );
+		
+		# every node in the graph is connected to itself by a zero-length path
+		my @extra;
+		if ($min == 0) {
+			my $model	= $self->[0]{context}->model;
+			my %nodes;
+			foreach my $n ($model->subjects(undef, undef, $graph), $model->objects(undef, undef, $graph)) {
+				$nodes{ $n->as_string } = $n unless (defined($adj->id( $n )));
+			}
+			@extra	= values %nodes;
+		}
+		$self->[0]{stream}	= sub {
+			if (my $vb = $closure->()) {
+				return $vb;
+			}
+			my $n	= shift(@extra);
+			return unless ($n);
+			return RDF::Query::VariableBindings->new({ map { $_ => $n } @names });
+		};
+	} elsif (scalar(@vars) == 1) {
+		# term path+ var
+		my $name	= $vars[0]->name;
+		my $id		= $adj->id( $start );
+		if (defined($id)) {
+			my @starts	= ($id);
+			$self->[0]{stream}	= _closure_stream( $adj, sub { shift(@starts) }, $min, sub {
+				return RDF::Query::VariableBindings->new({ $name => $term->( $_[1] ) });
+			} );
+		} elsif ($min == 0) {
+			push(@{ $self->[0]{results} }, RDF::Query::VariableBindings->new({ $name => $start }));
+		}
+	}
+	return 1;
+}
+
+# Returns a list of [ $predicate, $inverse ] pairs if $path is a predicate, an
+# inverse path, or an alternative of these, or the empty list otherwise.
+sub _closure_predicates {
+	my $path	= shift;
+	my $inverse	= shift;
+	if (blessed($path)) {
+		return unless ($path->isa('RDF::Trine::Node::Resource'));
+		return ([ $path, $inverse ]);
+	}
+	my ($op, @nodes)	= @$path;
+	if ($op eq '^' and scalar(@nodes) == 1) {
+		return _closure_predicates( $nodes[0], ($inverse ? 0 : 1) );
+	} elsif ($op eq '|') {
+		my @preds;
+		foreach my $n (@nodes) {
+			my @p	= _closure_predicates( $n, $inverse );
+			return unless (@p);
+			push(@preds, @p);
+		}
+		return @preds;
+	}
+	return;
+}
+
+# Returns the adjacency snapshot of the statements in $graph matching the
+# [ $predicate, $inverse ] pairs in $preds. Snapshots are kept in the execution
+# context's cache (shared with the copies made for bind joins) until the model's
+# etag changes.
+sub _adjacency {
+	my $self	= shift;
+	my $preds	= shift;
+	my $graph	= shift;
+	my $context	= $self->[0]{context};
+	my $model	= $context->model;
+	my $etag	= $model->etag;
+	my $version	= join(' ', refaddr($model), (defined($etag) ? $etag : ''));
+	my $ccache	= $context->cache || {};
+	my $cache	= $ccache->{ 'rdf.query.plan.path.snapshots' };
+	unless ($cache and $cache->[0] eq $version) {
+		$cache	= $ccache->{ 'rdf.query.plan.path.snapshots' }	= [ $version, {} ];
+	}
+	my $key		= join(' ', $graph->as_string, map { ($_->[1] ? '^' : '') . $_->[0]->as_string } @$preds);
+	return $cache->[1]{ $key } if ($cache->[1]{ $key });
+	
+	my $l		= Log::Log4perl->get_logger("rdf.query.plan.path");
+	my $adj		= _new_adjacency();
+	foreach my $p (@$preds) {
+		my ($pred, $inverse)	= @$p;
+		my $iter	= $model->get_statements( undef, $pred, undef, $graph );
+		while (my $st = $iter->next) {
+			if ($inverse) {
+				$adj->add_edge( $st->object, $st->subject );
+			} else {
+				$adj->add_edge( $st->subject, $st->object );
 			}
 		}
 	}
+	$l->debug( sprintf('path snapshot %s has %d nodes and %d edges', $key, $adj->nodes, $adj->edges) );
+	return $cache->[1]{ $key }	= $adj;
+}
+
+# Returns a closure returning the results of calling $bind with each start node
+# ID returned by $starts and each node ID reachable from it in at least $min
+# steps, skipping calls that return false.
+sub _closure_stream {
+	my $adj		= shift;
+	my $starts	= shift;
+	my $min		= shift;
+	my $bind	= shift;
+	my ($from, $reached, $offset);
+	return sub {
+		while (1) {
+			if (defined($reached) and $offset < length($reached)) {
+				my $to	= unpack('N', substr($reached, $offset, 4));
+				$offset	+= 4;
+				my $vb	= $bind->( $from, $to );
+				return $vb if ($vb);
+				next;
+			}
+			$from	= $starts->();
+			return unless (defined($from));
+			$reached	= $adj->reachable( $from, $min );
+			$offset		= 0;
+		}
+	};
 }
 
 # returns an iterator of terms
@@ -376,6 +571,17 @@ sub next {
 		return $result;
 	}
 	
+	if (my $stream = $self->[0]{stream}) {
+		if (my $result = $stream->()) {
+			$l->trace( 'returning path result: ' . $result );
+			if (my $d = $self->delegate) {
+				$d->log_result( $self, $result );
+			}
+			return $result;
+		}
+		delete $self->[0]{stream};
+	}
+	
 	return;
 }
 
@@ -389,6 +595,8 @@ sub close {
 		throw RDF::Query::Error::ExecutionError -text => "close() cannot be called on an un-open PATH";
 	}
 	delete $self->[0]{iter};
+	delete $self->[0]{stream};
+	delete $self->[0]{context};
 	$self->SUPER::close();
 }
 
@@ -559,6 +767,99 @@ sub _path_as_string {
 	}
 }
 
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	no strict 'refs';
+	*{ '_new_adjacency' }	= (RDF::Trine::XS::Adjacency->can('reachable'))
+		? sub { RDF::Trine::XS::Adjacency->new() }
+		: sub { RDF::Query::Plan::Path::Adjacency->new() };
+}
+
+# A perl implementation of the RDF::Trine::XS::Adjacency methods used by the
+# path plan. Nodes are keyed by their string serialization.
+package RDF::Query::Plan::Path::Adjacency;
+
+use Scalar::Util qw(blessed);
+
+sub new {
+	my $class	= shift;
+	return bless( { ids => {}, nodes => [], out => [], edges => 0 }, $class );
+}
+
+sub _key {
+	my $node	= shift;
+	return unless (blessed($node));
+	return unless ($node->isa('RDF::Trine::Node::Resource') or $node->isa('RDF::Trine::Node::Blank') or $node->isa('RDF::Trine::Node::Literal'));
+	return $node->as_string;
+}
+
+sub add_edge {
+	my $self	= shift;
+	my @ids;
+	foreach my $node (@_) {
+		my $key	= _key( $node );
+		throw RDF::Query::Error::ExecutionError -text => "Adjacency nodes must be resources, blank nodes or literals" unless (defined($key));
+		unless (defined($self->{ids}{ $key })) {
+			push(@{ $self->{nodes} }, $node);
+			$self->{ids}{ $key }	= $#{ $self->{nodes} };
+		}
+		push(@ids, $self->{ids}{ $key });
+	}
+	push(@{ $self->{out}[ $ids[0] ] }, $ids[1]);
+	$self->{edges}++;
+}
+
+sub id {
+	my $self	= shift;
+	my $key		= _key( shift );
+	return (defined($key)) ? $self->{ids}{ $key } : undef;
+}
+
+sub node {
+	my $self	= shift;
+	my $id		= shift;
+	return $self->{nodes}[ $id ];
+}
+
+sub reachable {
+	my $self	= shift;
+	my $start	= shift;
+	my $min		= shift;
+	my $out		= $self->{out};
+	my $seen	= '';
+	my @queue;
+	if ($min) {
+		foreach my $t (@{ $out->[ $start ] || [] }) {
+			next if (vec($seen, $t, 1));
+			vec($seen, $t, 1)	= 1;
+			push(@queue, $t);
+		}
+	} else {
+		vec($seen, $start, 1)	= 1;
+		push(@queue, $start);
+	}
+	for (my $i = 0; $i < scalar(@queue); $i++) {
+		foreach my $t (@{ $out->[ $queue[$i] ] || [] }) {
+			next if (vec($seen, $t, 1));
+			vec($seen, $t, 1)	= 1;
+			push(@queue, $t);
+		}
+	}
+	return pack('N*', @queue);
+}
+
+sub nodes {
+	my $self	= shift;
+	return scalar(@{ $self->{nodes} });
+}
+
+sub edges {
+	my $self	= shift;
+	return $self->{edges};
+}
+
 1;
 
 __END__
@@ -9,6 +9,24 @@ RDF::Query::Plan::Sort - Executable query plan for Sorts.
 
 This document describes RDF::Query::Plan::Sort version 2.919.
 
+=head1 DESCRIPTION
+
+The sort expressions are evaluated once for each input row. If every value is
+unbound, a blank node, an IRI, a plain or language-tagged literal, or a valid
+numeric literal, the values are encoded into a binary key that sorts in the
+same order as the values, and rows are sorted with perl's native string sort.
+Otherwise, rows are sorted by comparing the evaluated values. Unbound values
+sort before all other values.
+
+Rows are sorted in runs of at most C<< rdf.query.plan.sort.run_size >> rows (an
+option of the query), or C<< $RDF::Query::Plan::Sort::RUN_SIZE >> rows (default
+100,000). If the input is larger than a single run, each run is written to a
+temporary file, and the sorted runs are merged as results are read.
+
+If the sort has a limit (see L</top_k>), only the rows that sort within the
+limit are kept, in a bounded heap. If L<RDF::Trine::XS> is installed, the heap
+of binary sort keys is maintained natively.
+
 =head1 METHODS
 
 Beyond the methods documented below, this class inherits methods from the
@@ -22,14 +40,17 @@ package RDF::Query::Plan::Sort;
 
 use strict;
 use warnings;
-use Scalar::Util qw(refaddr);
+use File::Temp qw(tempfile);
+use Scalar::Util qw(blessed refaddr looks_like_number);
+use Storable qw(store_fd fd_retrieve);
 use base qw(RDF::Query::Plan);
 
 ######################################################################
 
-our ($VERSION);
+our ($VERSION, $RUN_SIZE);
 BEGIN {
 	$VERSION	= '2.919';
+	$RUN_SIZE	= 100_000;
 }
 
 ######################################################################
@@ -51,6 +72,22 @@ sub new {
 	return $self;
 }
 
+=item C<< top_k ( [ $k ] ) >>
+
+Returns the number of sorted rows this plan will return, or undef if all rows
+are returned. If C<< $k >> is given, the plan will only return the first
+C<< $k >> rows of the sort order (used by the planner for a sort below a limit).
+
+=cut
+
+sub top_k {
+	my $self	= shift;
+	if (scalar(@_)) {
+		$self->[0]{top_k}	= shift;
+	}
+	return $self->[0]{top_k};
+}
+
 =item C<< execute ( $execution_context ) >>
 
 =cut
@@ -69,20 +106,61 @@ sub execute ($) {
 	$l->trace("executing sort");
 	if ($plan->state == $self->OPEN) {
 		my $exprs	= $self->[2];
-		my @rows	= $plan->get_all;
-		if ($l->is_trace) {
-			$l->trace("sorting result list:");
-			$l->trace("- $_") foreach (@rows);
+		my $query	= $context->query || 'RDF::Query';
+		my $config	= $context->options || {};
+		my $run_size	= $config->{ 'rdf.query.plan.sort.run_size' } || $RUN_SIZE;
+		my $k		= $self->top_k;
+		
+		# sort records are [ $key, \@values, $row, $seq, $run ]. the binary
+		# keys are only used while every row has one.
+		my $binary	= 1;
+		my $cmp		= sub {
+			my ($ra, $rb)	= @_;
+			return ($ra->[0] cmp $rb->[0]) if ($binary);
+			return (_cmp_values( $exprs, $ra->[1], $rb->[1] ) || ($ra->[3] <=> $rb->[3]));
+		};
+		my $max		= sub { $cmp->( $_[1], $_[0] ) };
+		
+		my (@records, @runs);
+		my $seq		= 0;
+		while (my $row = $plan->next) {
+			my $record	= _sort_record( $context, $query, $exprs, $row, $seq++, $binary );
+			$binary		= 0 unless (defined($record->[0]));
+			if (defined($k)) {
+				if ($binary) {
+					_topk_insert( \@records, $k, $record );
+				} elsif (scalar(@records) < $k) {
+					_heap_push( \@records, $max, $record );
+				} elsif ($k > 0 and $cmp->( $record, $records[0] ) < 0) {
+					$records[0]	= $record;
+					_heap_sift_down( \@records, $max );
+				}
+			} else {
+				push(@records, $record);
+				if (scalar(@records) >= $run_size) {
+					push(@runs, _spill_run( _sort_run( \@records, $binary, $cmp ) ));
+					@records	= ();
+				}
+			}
 		}
-		my $query	= $context->query;
 		
-		use sort 'stable';
-		my @sorted	= sort { _cmp_rows( $context, $exprs, $a, $b ) } @rows;
-		if ($l->is_trace) {
-			$l->trace("sorted list:");
-			$l->trace("- $_") foreach (@sorted);
+		my $sorted	= _sort_run( \@records, $binary, $cmp );
+		if (@runs) {
+			push(@runs, _spill_run( $sorted ));
+			$l->debug("merging " . scalar(@runs) . " sorted runs");
+			my @heap;
+			foreach my $i (0 .. $#runs) {
+				if (my $record = _read_record( $runs[ $i ] )) {
+					$record->[4]	= $i;
+					_heap_push( \@heap, $cmp, $record );
+				}
+			}
+			$self->[0]{runs}	= \@runs;
+			$self->[0]{heap}	= \@heap;
+			$self->[0]{cmp}		= $cmp;
+		} else {
+			$self->[0]{rows}	= [ map { $_->[2] } @$sorted ];
 		}
-		$self->[0]{rows}	= \@sorted;
 		$self->state( $self->OPEN );
 	} else {
 		warn "could not execute plan in distinct";
@@ -99,7 +177,21 @@ sub next {
 	unless ($self->state == $self->OPEN) {
 		throw RDF::Query::Error::ExecutionError -text => "next() cannot be called on an un-open SORT";
 	}
-	my $bindings	= shift(@{ $self->[0]{rows} });
+	my $bindings;
+	if (my $runs = $self->[0]{runs}) {
+		my $heap	= $self->[0]{heap};
+		my $cmp		= $self->[0]{cmp};
+		if (my $record = _heap_pop( $heap, $cmp )) {
+			$bindings	= $record->[2];
+			my $run		= $record->[4];
+			if (my $next = _read_record( $runs->[ $run ] )) {
+				$next->[4]	= $run;
+				_heap_push( $heap, $cmp, $next );
+			}
+		}
+	} else {
+		$bindings	= shift(@{ $self->[0]{rows} });
+	}
 	if (my $d = $self->delegate) {
 		$d->log_result( $self, $bindings );
 	}
@@ -115,43 +207,206 @@ sub close {
 	unless ($self->state == $self->OPEN) {
 		throw RDF::Query::Error::ExecutionError -text => "close() cannot be called on an un-open SORT";
 	}
+	if (my $runs = delete $self->[0]{runs}) {
+		CORE::close($_) foreach (@$runs);
+	}
+	delete $self->[0]{heap};
+	delete $self->[0]{cmp};
 	delete $self->[0]{rows};
 	$self->[1]->close();
 	$self->SUPER::close();
 }
 
-sub _cmp_rows {
+# Evaluates the sort expressions for $row, returning a sort record. The record
+# has a binary sort key if $encode is true and all the values can be encoded.
+sub _sort_record {
 	my $context	= shift;
+	my $query	= shift;
 	my $exprs	= shift;
-	my $a		= shift;
-	my $b		= shift;
+	my $row		= shift;
+	my $seq		= shift;
+	my $encode	= shift;
 	
-	my $l		= Log::Log4perl->get_logger("rdf.query.plan.sort");
-	my $query	= $context->query || 'RDF::Query';
-	my $bridge	= $context->model;
+	my @values;
+	my $key		= ($encode) ? '' : undef;
+	foreach my $data (@$exprs) {
+		my ($expr, $rev)	= @$data;
+		my $value	= $query->var_or_expr_value( $row, $expr, $context );
+		push(@values, $value);
+		next unless (defined($key));
+		my $vkey	= _sort_key( $value );
+		if (defined($vkey)) {
+			$key	.= ($rev) ? ~$vkey : $vkey;
+		} else {
+			$key	= undef;
+		}
+	}
+	
+	# the sequence number keeps the sort stable and the keys unique
+	$key	.= pack('N', $seq) if (defined($key));
+	return [ $key, \@values, $row, $seq ];
+}
+
+# Returns a binary string for $node that sorts (with cmp) the same way as
+# RDF::Query's lazy node comparisons, or undef if $node can't be encoded. The
+# encodings are prefix-free, so descending keys can be made by complementing
+# the bytes.
+sub _sort_key {
+	my $node	= shift;
+	return "\x00" unless (blessed($node));
+	if ($node->isa('RDF::Query::Node::Blank')) {
+		return "\x01" . _sort_string( $node->blank_identifier );
+	} elsif ($node->isa('RDF::Query::Node::Resource')) {
+		return "\x02" . _sort_string( $node->uri_value );
+	} elsif ($node->isa('RDF::Query::Node::Literal')) {
+		if ($node->has_language) {
+			return "\x05" . _sort_string( $node->literal_value ) . _sort_string( lc($node->literal_value_language) );
+		} elsif (not($node->has_datatype)) {
+			return "\x03" . _sort_string( $node->literal_value );
+		} elsif ($node->is_numeric_type and looks_like_number( $node->literal_value )) {
+			return "\x04" . _sort_number( $node->numeric_value );
+		}
+	}
+	return;
+}
+
+sub _sort_string {
+	my $string	= shift;
+	utf8::encode( $string );
+	$string	=~ s/\x00/\x00\xFF/g;
+	return $string . "\x00\x00";
+}
+
+sub _sort_number {
+	my $number	= shift;
+	$number		= 0 if ($number == 0);
+	my $bytes	= pack('d>', $number);
+	return (ord($bytes) & 0x80)
+		? ~$bytes
+		: ("\x80" ^ substr($bytes, 0, 1)) . substr($bytes, 1);
+}
+
+sub _cmp_values {
+	my $exprs	= shift;
+	my $avals	= shift;
+	my $bvals	= shift;
 	
 	no warnings 'numeric';
 	no warnings 'uninitialized';
-	foreach my $data (@$exprs) {
-		my ($expr, $rev)	= @$data;
-		my $a_val	= $query->var_or_expr_value( $a, $expr, $context );
-		my $b_val	= $query->var_or_expr_value( $b, $expr, $context );
-		local($RDF::Query::Node::Literal::LAZY_COMPARISONS)	= 1;
-		$l->trace("comparing $a_val <=> $b_val");
-		my $cmp		= $a_val <=> $b_val;
+	local($RDF::Query::Node::Literal::LAZY_COMPARISONS)	= 1;
+	foreach my $i (0 .. $#{ $exprs }) {
+		my $a_val	= $avals->[ $i ];
+		my $b_val	= $bvals->[ $i ];
+		my $cmp		= (blessed($a_val) and blessed($b_val))
+					? ($a_val <=> $b_val)
+					: (blessed($a_val) ? 1 : 0) - (blessed($b_val) ? 1 : 0);
 		if ($cmp != 0) {
-			if ($rev) {
-				$cmp	*= -1;
-			}
-			$l->trace("==> $cmp");
+			$cmp	*= -1 if ($exprs->[ $i ][1]);
 			return $cmp;
-		} else {
 		}
 	}
-	$l->trace("==> 0");
 	return 0;
 }
 
+sub _sort_run {
+	my $records	= shift;
+	my $binary	= shift;
+	my $cmp		= shift;
+	if ($binary) {
+		my %records	= map { $_->[0] => $_ } @$records;
+		return [ @records{ sort keys %records } ];
+	} else {
+		return [ sort { $cmp->( $a, $b ) } @$records ];
+	}
+}
+
+sub _spill_run {
+	my $records	= shift;
+	my $fh		= tempfile();
+	binmode( $fh );
+	foreach my $record (@$records) {
+		store_fd( $record, $fh ) or throw RDF::Query::Error::ExecutionError -text => "Can't write sort run to temporary file";
+	}
+	seek( $fh, 0, 0 );
+	return $fh;
+}
+
+sub _read_record {
+	my $fh	= shift;
+	return if (eof($fh));
+	return fd_retrieve( $fh );
+}
+
+# Adds $record to the max-heap of the $k records with the smallest binary sort
+# keys, if it sorts within them. Returns true if the record was kept.
+sub _topk_insert_pp {
+	my $heap	= shift;
+	my $k		= shift;
+	my $record	= shift;
+	my $max		= sub { $_[1][0] cmp $_[0][0] };
+	if ($k > 0 and scalar(@$heap) < $k) {
+		_heap_push( $heap, $max, $record );
+		return 1;
+	} elsif ($k > 0 and scalar(@$heap) and ($record->[0] cmp $heap->[0][0]) < 0) {
+		$heap->[0]	= $record;
+		_heap_sift_down( $heap, $max );
+		return 1;
+	}
+	return 0;
+}
+
+sub _heap_push {
+	my $heap	= shift;
+	my $cmp		= shift;
+	my $item	= shift;
+	push(@$heap, $item);
+	my $i		= $#{ $heap };
+	while ($i > 0) {
+		my $p	= ($i - 1) >> 1;
+		last if ($cmp->( $heap->[ $p ], $heap->[ $i ] ) <= 0);
+		@{ $heap }[ $p, $i ]	= @{ $heap }[ $i, $p ];
+		$i		= $p;
+	}
+}
+
+sub _heap_pop {
+	my $heap	= shift;
+	my $cmp		= shift;
+	return unless (scalar(@$heap));
+	my $top		= $heap->[0];
+	my $last	= pop(@$heap);
+	if (scalar(@$heap)) {
+		$heap->[0]	= $last;
+		_heap_sift_down( $heap, $cmp );
+	}
+	return $top;
+}
+
+sub _heap_sift_down {
+	my $heap	= shift;
+	my $cmp		= shift;
+	my $size	= scalar(@$heap);
+	my $i		= 0;
+	while (1) {
+		my $c	= 2 * $i + 1;
+		last if ($c >= $size);
+		$c++ if ($c + 1 < $size and $cmp->( $heap->[ $c + 1 ], $heap->[ $c ] ) < 0);
+		last if ($cmp->( $heap->[ $i ], $heap->[ $c ] ) <= 0);
+		@{ $heap }[ $i, $c ]	= @{ $heap }[ $c, $i ];
+		$i		= $c;
+	}
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	no strict 'refs';
+	*{ '_topk_insert' }	= (RDF::Trine::XS->can('topk_insert'))
+		? \&RDF::Trine::XS::topk_insert
+		: \&_topk_insert_pp;
+}
+
 =item C<< pattern >>
 
 Returns the query plan that will be used to produce the data to be sorted.
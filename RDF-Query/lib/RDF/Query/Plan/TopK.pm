@@ -0,0 +1,184 @@
+# RDF::Query::Plan::TopK
+# -----------------------------------------------------------------------------
+
+=head1 NAME
+
+RDF::Query::Plan::TopK - Executable query plan for sorts with limits.
+
+=head1 VERSION
+
+This document describes RDF::Query::Plan::TopK version 2.919.
+
+=head1 DESCRIPTION
+
+The top-k plan returns the rows of its pattern that sort within C<< $offset >>
+and C<< $offset + $limit >>, equivalent to a sort below an (optional) offset and
+a limit. Only the first C<< $offset + $limit >> rows of the sort order are kept
+while the pattern is read, in a bounded heap of precomputed sort keys (see
+L<RDF::Query::Plan::Sort>), so the plan runs in O(n log k) time and O(k) memory.
+
+=head1 METHODS
+
+Beyond the methods documented below, this class inherits methods from the
+L<RDF::Query::Plan::Sort> class.
+
+=over 4
+
+=cut
+
+package RDF::Query::Plan::TopK;
+
+use strict;
+use warnings;
+use Scalar::Util qw(refaddr);
+use base qw(RDF::Query::Plan::Sort);
+
+######################################################################
+
+our ($VERSION);
+BEGIN {
+	$VERSION	= '2.919';
+}
+
+######################################################################
+
+=item C<< new ( $limit, $offset, $pattern, [ $expr1, $rev1 ], ... ) >>
+
+=cut
+
+sub new {
+	my $class	= shift;
+	my $limit	= shift;
+	my $offset	= shift || 0;
+	my $plan	= shift;
+	my $self	= $class->SUPER::new( $plan, @_ );
+	$self->[0]{limit}	= $limit;
+	$self->[0]{offset}	= $offset;
+	$self->top_k( $limit + $offset );
+	return $self;
+}
+
+=item C<< execute ( $execution_context ) >>
+
+=cut
+
+sub execute ($) {
+	my $self	= shift;
+	my $context	= shift;
+	$self->SUPER::execute( $context );
+	if ($self->state == $self->OPEN) {
+		my $rows	= $self->[0]{rows};
+		splice(@$rows, 0, $self->offset);
+	}
+	$self;
+}
+
+=item C<< limit >>
+
+Returns the limit size.
+
+=cut
+
+sub limit {
+	my $self	= shift;
+	return $self->[0]{limit};
+}
+
+=item C<< offset >>
+
+Returns the number of sorted rows skipped before results are returned.
+
+=cut
+
+sub offset {
+	my $self	= shift;
+	return $self->[0]{offset};
+}
+
+=item C<< plan_node_name >>
+
+Returns the string name of this plan node, suitable for use in serialization.
+
+=cut
+
+sub plan_node_name {
+	return 'topk';
+}
+
+=item C<< plan_prototype >>
+
+Returns a list of scalar identifiers for the type of the content (children)
+nodes of this plan node. See L<RDF::Query::Plan> for a list of the allowable
+identifiers.
+
+=cut
+
+sub plan_prototype {
+	my $self	= shift;
+	return qw(i i P *\wE);
+}
+
+=item C<< plan_node_data >>
+
+Returns the data for this plan node that corresponds to the values described by
+the signature returned by C<< plan_prototype >>.
+
+=cut
+
+sub plan_node_data {
+	my $self	= shift;
+	return ($self->limit, $self->offset, $self->SUPER::plan_node_data);
+}
+
+=item C<< graph ( $g ) >>
+
+=cut
+
+sub graph {
+	my $self	= shift;
+	my $g		= shift;
+	my $c		= $self->pattern->graph( $g );
+	my $expr	= join(' ', map { $_->sse( {}, "" ) } @{ $self->[2] });
+	my ($limit, $offset)	= ($self->limit, $self->offset);
+	$g->add_node( "$self", label => "TopK ($limit, $offset; $expr)" . $self->graph_labels );
+	$g->add_edge( "$self", $c );
+	return "$self";
+}
+
+=item C<< explain >>
+
+Returns a string serialization of the plan appropriate for display on the
+command line.
+
+=cut
+
+sub explain {
+	my $self	= shift;
+	my $s		= shift;
+	my $count	= shift;
+	my $indent	= $s x $count;
+	my $type	= $self->plan_node_name;
+	my $string	= sprintf("%s%s (0x%x)\n", $indent, $type, refaddr($self));
+	$string		.= "${indent}${s}limit: " . $self->limit . "\n";
+	$string		.= "${indent}${s}offset: " . $self->offset . "\n";
+	$string		.= "${indent}${s}sort by:\n";
+	foreach my $e (@{ $self->[2] }) {
+		my $dir		= ($e->[1] == 0 ? 'asc  ' : 'desc ');
+		$string		.= "${indent}${s}${s}${dir}" . $e->[0] . "\n";
+	}
+	$string		.= $self->pattern->explain( $s, $count+1 );
+	return $string;
+}
+
+
+1;
+
+__END__
+
+=back
+
+=head1 AUTHOR
+
+ Gregory Todd Williams <gwilliams@cpan.org>
+
+=cut
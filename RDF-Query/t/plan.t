@@ -4,6 +4,7 @@ use warnings;
 
 use URI::file;
 use Test::More;
+use Test::Exception;
 use Scalar::Util qw(blessed);
 use RDF::Query::Node qw(iri);
 use RDF::Query::Error qw(:try);
@@ -135,6 +136,14 @@ END
 		is( _CLEAN_WS($plan->sse), '(order (quad ?p <http://xmlns.com/foaf/0.1/name> ?name (nil)) ((asc ?name)))', 'sse: sort' ) or die;
 	}
 	
+	{
+		my $parser	= RDF::Query::Parser::SPARQL->new();
+		my $parsed	= $parser->parse( 'PREFIX foaf: <http://xmlns.com/foaf/0.1/> SELECT ?name WHERE { ?p foaf:name ?name } ORDER BY ?name LIMIT 2 OFFSET 1' );
+		my ($plan)	= RDF::Query::Plan->generate_plans( $parsed->{triples}[0], $context );
+		isa_ok( $plan->pattern, 'RDF::Query::Plan::TopK', 'limit and sort algebra to plan' );
+		is( _CLEAN_WS($plan->sse), '(project (name) (topk 2 1 (quad ?p <http://xmlns.com/foaf/0.1/name> ?name (nil)) ((asc ?name))))', 'sse: topk' ) or die;
+	}
+	
 	{
 		my $parser	= RDF::Query::Parser::SPARQL->new();
 		my $parsed	= $parser->parse( 'PREFIX foaf: <http://xmlns.com/foaf/0.1/> SELECT * WHERE { ?p a foaf:Person ; foaf:name ?name . FILTER(?name = "Greg") }' );
@@ -301,6 +310,76 @@ END
 		}
 	}
 
+	{
+		# hash join
+		my $var	= RDF::Trine::Node::Variable->new('p');
+		my $plan_a	= RDF::Query::Plan::Quad->new( $var, $foaf->homepage, RDF::Trine::Node::Variable->new('page'), RDF::Trine::Node::Nil->new() );
+		my $plan_b	= RDF::Query::Plan::Quad->new( $var, $foaf->name, RDF::Trine::Node::Variable->new('name'), RDF::Trine::Node::Nil->new() );
+		my $plan	= RDF::Query::Plan::Join::Hash->new( $plan_a, $plan_b );
+		is( _CLEAN_WS($plan->sse), '(hash-join (quad ?p <http://xmlns.com/foaf/0.1/homepage> ?page (nil)) (quad ?p <http://xmlns.com/foaf/0.1/name> ?name (nil)))', 'sse: hash-join' ) or die;
+		is_deeply( [ $plan->join_variables ], ['p'], 'hash join variables' );
+
+		foreach my $pass (1..2) {
+			my $count	= 0;
+			$plan->execute( $context );
+			while (my $row = $plan->next) {
+				isa_ok( $row, 'RDF::Query::VariableBindings', 'variable bindings' );
+				like( $row->{p}, qr#^(_:|<http://kasei.us)#, 'expected person URI or blank node' );
+				like( $row->{page}, qr#^<http://(www.)?(kasei|realify)#, 'expected person homepage' );
+				ok( defined($row->{name}), 'expected person name' );
+				$count++;
+			}
+			is( $count, 2, "expected result count for hash join (pass $pass)" );
+			$plan->close;
+		}
+
+		SKIP: {
+			skip "model has no store statistics", 2 unless (RDF::Query::BGPOptimizer->_statistics( $context ));
+			ok( RDF::Query::Plan::Join::Hash->preferred( $context, $plan_a, $plan_b ), 'hash join preferred for a small quad right-hand side' );
+			my @types	= RDF::Query::Plan->_order_join_types( $context, $plan_a, $plan_b, RDF::Query::Plan::Join->join_classes( $context->options ) );
+			is( $types[0], 'RDF::Query::Plan::Join::Hash', 'hash join tried first for a small quad right-hand side' );
+		}
+	}
+
+	SKIP: {
+		# cost-based ordering of group graph patterns
+		my $stats	= RDF::Query::BGPOptimizer->_statistics( $context );
+		skip "model has no store statistics", 3 unless ($stats);
+		my $var		= RDF::Trine::Node::Variable->new('p');
+		my $type	= RDF::Query::Algebra::Triple->new( $var, $rdf->type, RDF::Trine::Node::Variable->new('type') );
+		my $page	= RDF::Query::Algebra::Triple->new( $var, $foaf->homepage, RDF::Trine::Node::Variable->new('page') );
+		my ($cheap, $costly)	= ($stats->cardinality( $page ) <= $stats->cardinality( $type )) ? ($page, $type) : ($type, $page);
+		my @ordered	= RDF::Query::Plan->_order_patterns_by_cost( $context, [ $costly, $cheap ] );
+		is( scalar(@ordered), 2, 'cost-based ordering returns every pattern' );
+		is( $ordered[0], $cheap, 'cost-based ordering evaluates the pattern with the smallest estimate first' );
+		my $opt		= RDF::Query::Algebra::Optional->new( RDF::Query::Algebra::GroupGraphPattern->new( $type ), RDF::Query::Algebra::GroupGraphPattern->new( $page ) );
+		is_deeply( [ RDF::Query::Plan->_order_patterns_by_cost( $context, [ $type, $opt ] ) ], [], 'patterns other than triples and BGPs are not reordered' );
+	}
+
+	{
+		# merge join
+		my $var	= RDF::Trine::Node::Variable->new('p');
+		my $plan_a	= RDF::Query::Plan::Sort->new( RDF::Query::Plan::Quad->new( $var, $foaf->homepage, RDF::Trine::Node::Variable->new('page'), RDF::Trine::Node::Nil->new() ), [ $var, 0 ] );
+		my $plan_b	= RDF::Query::Plan::Sort->new( RDF::Query::Plan::Quad->new( $var, $foaf->name, RDF::Trine::Node::Variable->new('name'), RDF::Trine::Node::Nil->new() ), [ $var, 0 ] );
+		my $plan	= RDF::Query::Plan::Join::Merge->new( $plan_a, $plan_b );
+		is_deeply( [ $plan->merge_keys ], [ [ 'p', 0 ] ], 'merge join keys' );
+
+		foreach my $pass (1..2) {
+			my $count	= 0;
+			$plan->execute( $context );
+			while (my $row = $plan->next) {
+				like( $row->{page}, qr#^<http://(www.)?(kasei|realify)#, 'expected person homepage' );
+				ok( defined($row->{name}), 'expected person name' );
+				$count++;
+			}
+			is( $count, 2, "expected result count for merge join (pass $pass)" );
+			$plan->close;
+		}
+
+		my $unsorted	= RDF::Query::Plan::Quad->new( $var, $foaf->name, RDF::Trine::Node::Variable->new('name'), RDF::Trine::Node::Nil->new() );
+		throws_ok { RDF::Query::Plan::Join::Merge->new( $plan_a, $unsorted ) } 'RDF::Query::Error::MethodInvocationError', 'merge join requires sorted plans';
+	}
+
 	{
 		# OPTIONAL nested loop join
 		my $var	= RDF::Trine::Node::Variable->new('p');
@@ -437,6 +516,73 @@ END
 			is( $count, 2, "expected result count for distinct (pass $pass)" );
 			$plan->close;
 		}
+
+		{
+			local($RDF::Query::Plan::Distinct::MEMORY_LIMIT)	= 1;
+			$plan->execute( $context );
+			my @preds	= sort map { $_->{p}->uri_value } $plan->get_all;
+			is_deeply( \@preds, [ map { "http://www.w3.org/1999/02/22-rdf-syntax-ns#$_" } qw(first rest) ], 'expected results for distinct with spilled partitions' );
+			$plan->close;
+		}
+
+		{
+			my $sort	= RDF::Query::Plan::Sort->new( $proj, [ $p, 1 ] );
+			my $plan	= RDF::Query::Plan::Distinct->new( $sort );
+			$plan->execute( $context );
+			my @preds	= map { $_->{p}->uri_value } $plan->get_all;
+			is_deeply( \@preds, [ map { "http://www.w3.org/1999/02/22-rdf-syntax-ns#$_" } qw(rest first) ], 'expected results for distinct on ordered input' );
+			$plan->close;
+		}
+
+		{
+			my $rand	= RDF::Query::Expression::Function->new( 'sparql:rand' );
+			my $sort	= RDF::Query::Plan::Sort->new( $proj, [ $rand, 0 ] );
+			my $plan	= RDF::Query::Plan::Distinct->new( $sort );
+			$plan->execute( $context );
+			my @preds	= sort map { $_->{p}->uri_value } $plan->get_all;
+			is_deeply( \@preds, [ map { "http://www.w3.org/1999/02/22-rdf-syntax-ns#$_" } qw(first rest) ], 'expected results for distinct on input ordered by RAND()' );
+			$plan->close;
+		}
+
+		{
+			local($RDF::Query::Plan::Distinct::MEMORY_LIMIT)	= 1;
+			my $sort	= RDF::Query::Plan::Sort->new( $join, [ $r, 0 ] );
+			my $plan	= RDF::Query::Plan::Distinct->new( RDF::Query::Plan::Project->new( $sort, ['p'] ) );
+			$plan->execute( $context );
+			my @preds	= sort map { $_->{p}->uri_value } $plan->get_all;
+			is_deeply( \@preds, [ map { "http://www.w3.org/1999/02/22-rdf-syntax-ns#$_" } qw(first rest) ], 'expected results for distinct on input ordered by a projected-away variable' );
+			ok( $plan->[0]{depth}, 'distinct on input ordered by a projected-away variable spills to disk' );
+			$plan->close;
+		}
+
+		{
+			# grouped input ordered on the grouping variable returns each group
+			# once the next group starts, before the input is exhausted
+			my @ops		= ( [ 'count', 'COUNT', {}, '*' ], [ 'values', 'COUNT-DISTINCT', {}, $r ] );
+			my $unordered	= RDF::Query::Plan::Aggregate->new( $join, [ $p ], expressions => \@ops );
+			$unordered->execute( $context );
+			my %expect	= map { $_->{p}->uri_value => [ $_->{count}->literal_value, $_->{values}->literal_value ] } $unordered->get_all;
+			$unordered->close;
+			
+			my $sort	= RDF::Query::Plan::Sort->new( $join, [ $p, 0 ] );
+			my $plan	= RDF::Query::Plan::Aggregate->new( $sort, [ $p ], expressions => \@ops );
+			$plan->execute( $context );
+			ok( $plan->[0]{order}, 'aggregate on input ordered by the grouping variable uses the ordered path' );
+			my @rows	= ($plan->next);
+			ok( !$plan->[0]{exhausted}, 'aggregate on ordered input returns a group before reading all input' );
+			push(@rows, $plan->get_all);
+			my %got		= map { $_->{p}->uri_value => [ $_->{count}->literal_value, $_->{values}->literal_value ] } @rows;
+			is( scalar(@rows), scalar(keys %got), 'aggregate on ordered input returns each group once' );
+			is_deeply( \%got, \%expect, 'expected results for aggregate on ordered input' );
+			$plan->close;
+		}
+		
+		{
+			local($RDF::Query::Plan::Aggregate::CONCAT_LIMIT)	= 8;
+			my $plan	= RDF::Query::Plan::Aggregate->new( $join, [], expressions => [ [ 'preds', 'GROUP_CONCAT', {}, $p ] ] );
+			$plan->execute( $context );
+			throws_ok { $plan->get_all } 'RDF::Query::Error::ExecutionError', 'GROUP_CONCAT longer than the concat limit throws an error';
+		}
 	}
 	
 	{
@@ -510,7 +656,43 @@ END
 		is_deeply( \@names, [(@expect_name)x3], "expected secondary sort values on plain literals" );
 		$plan->close;
 	}
-	
+
+	{
+		# sort spilling runs to disk, and sort with a limit
+		my $s		= RDF::Trine::Node::Variable->new('__s');
+		my $var		= RDF::Trine::Node::Variable->new('v');
+		my $triple	= RDF::Query::Plan::Quad->new( $s, $foaf->name, $var, $nil );
+		my $proj	= RDF::Query::Plan::Project->new( $triple, ['v'] );
+		my $expr	= RDF::Query::Expression::Function->new( 'sparql:str', $var );
+		my @expect	= reverse('Gary P', 'Gregory Todd Williams', 'Lauren B', 'Liz F');
+
+		{
+			local($RDF::Query::Plan::Sort::RUN_SIZE)	= 1;
+			my $plan	= RDF::Query::Plan::Sort->new( $proj, [$expr, 1] );
+			$plan->execute( $context );
+			my @values	= map { $_->{ v }->literal_value } $plan->get_all;
+			is_deeply( \@values, \@expect, "expected sort values from merged runs" );
+			$plan->close;
+		}
+
+		{
+			my $plan	= RDF::Query::Plan::Sort->new( $proj, [$expr, 1] );
+			$plan->top_k( 2 );
+			$plan->execute( $context );
+			my @values	= map { $_->{ v }->literal_value } $plan->get_all;
+			is_deeply( \@values, [ @expect[0,1] ], "expected top-k sort values" );
+			$plan->close;
+		}
+
+		{
+			my $plan	= RDF::Query::Plan::TopK->new( 2, 1, $proj, [$expr, 1] );
+			$plan->execute( $context );
+			my @values	= map { $_->{ v }->literal_value } $plan->get_all;
+			is_deeply( \@values, [ @expect[1,2] ], "expected top-k sort values with offset" );
+			$plan->close;
+		}
+	}
+
 	{
 		# filter
 		my $parser	= RDF::Query::Parser::SPARQL->new();
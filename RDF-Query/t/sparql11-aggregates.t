@@ -23,7 +23,7 @@ use RDF::Query;
 
 my @files	= map { "data/$_" } qw(t-sparql11-aggregates-1.rdf foaf.xrdf about.xrdf);
 my @models	= test_models( @files );
-my $tests	= (scalar(@models) * 91);
+my $tests	= (scalar(@models) * 93);
 plan tests => $tests;
 
 foreach my $model (@models) {
@@ -122,6 +122,30 @@ END
 		is( $count, 3, 'expected result count with aggregation' );
 	}
 
+	{
+		print "# SELECT MIN with GROUP BY and spilled groups\n";
+		local($RDF::Query::Plan::Aggregate::GROUP_LIMIT)	= 1;
+		my $query	= new RDF::Query ( <<"END", { lang => 'sparql11' } );
+	PREFIX : <http://books.example/>
+	SELECT ?auth (MIN(?lprice) AS ?min)
+	WHERE {
+	  ?org :affiliates ?auth .
+	  ?auth :writesBook ?book .
+	  ?book :price ?lprice .
+	}
+	GROUP BY ?auth
+END
+		warn RDF::Query->error unless ($query);
+		my ($plan, $ctx)	= $query->prepare( $model );
+		my $stream	= $query->execute_plan( $plan, $ctx );
+		my %got;
+		while (my $row = $stream->next) {
+			$got{ $row->{auth}->uri_value }	= $row->{min}->literal_value;
+		}
+		is( scalar(keys %got), 3, 'expected result count with spilled aggregation' );
+		is_deeply( \%got, { 'http://books.example/auth1' => 5, 'http://books.example/auth2' => 7, 'http://books.example/auth3' => 7 }, 'expected MIN values with spilled aggregation' );
+	}
+
 	{
 		print "# SELECT MAX with GROUP BY\n";
 		my $query	= new RDF::Query ( <<"END", { lang => 'sparql11' } );
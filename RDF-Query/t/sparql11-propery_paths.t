@@ -1,4 +1,4 @@
-use Test::More tests => 32;
+use Test::More tests => 38;
 use strict;
 use warnings;
 
@@ -113,6 +113,28 @@ END
 		}
 		is_deeply( \@got, [1, 2, 3], 'all expected values seen' );
 	}
+
+	{
+		print "# transitive closures\n";
+		my %expect	= (
+			'?a rdf:rest* ?b'					=> 19,
+			'<list3> ^rdf:rest+ ?x'				=> 2,
+			'<list1> (rdf:rest|^rdf:rest)+ ?x'	=> 4,
+			'<list1> rdf:rest+ rdf:nil'			=> 1,
+			'<list3> rdf:rest* <list1>'			=> 0,
+			'<list2> (rdf:rest|^rdf:rest)+ <list2>'	=> 1,
+		);
+		foreach my $pattern (sort keys %expect) {
+			my $query	= RDF::Query->new( <<"END", { lang => 'sparql11' } );
+				PREFIX rdf: <http://www.w3.org/1999/02/22-rdf-syntax-ns#>
+				SELECT * WHERE { $pattern }
+END
+			my $count	= 0;
+			my $iter	= $query->execute( $model );
+			$count++ while ($iter->next);
+			is( $count, $expect{ $pattern }, "expected result count for $pattern" );
+		}
+	}
 }
 {
 	print "# property path in GRAPH\n";
@@ -2,22 +2,2602 @@
 #include "perl.h"
 #include "XSUB.h"
 
+#include "md5.h"
+
+#ifdef HAS_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifdef MAP_ANONYMOUS
+#define TRINE_MMAP
+#endif
+#endif
+
+/* Feeds the UTF-8 encoding of the string value of sv into the digest. */
+static void
+_md5_add_sv (pTHX_ trine_md5_ctx* ctx, SV* sv) {
+	STRLEN len;
+	const U8* s;
+	if (sv == NULL || !SvOK(sv)) {
+		return;
+	}
+	s	= (const U8*) SvPV_const(sv, len);
+	if (SvUTF8(sv) || is_invariant_string(s, len)) {
+		trine_md5_update( ctx, s, len );
+	} else {
+		STRLEN ulen	= len;
+		U8* u		= bytes_to_utf8( (U8*) s, &ulen );
+		trine_md5_update( ctx, u, ulen );
+		Safefree(u);
+	}
+}
+
+static SV*
+_av_slot (pTHX_ AV* av, I32 i) {
+	SV** svp	= av_fetch( av, i, 0 );
+	return svp ? *svp : NULL;
+}
+
+/* Computes the 'R'/'B'/'L' prefixed node hash used by RDF::Trine::Store::DBI
+ * directly from the node object's internal array. Returns 0 for nil or
+ * non-node values, and sets *ok to false for node types that have no hash
+ * (e.g. variables). */
+static uint64_t
+_node_hash (pTHX_ SV* node, int* ok) {
+	trine_md5_ctx ctx;
+	AV* av;
+	*ok	= 1;
+	if (!sv_isobject(node)) {
+		return 0;
+	}
+	if (sv_derived_from(node, "RDF::Trine::Node::Nil")) {
+		return 0;
+	}
+	if (SvTYPE(SvRV(node)) != SVt_PVAV) {
+		*ok	= 0;
+		return 0;
+	}
+	av	= (AV*) SvRV(node);
+	trine_md5_init( &ctx );
+	if (sv_derived_from(node, "RDF::Trine::Node::Resource")) {
+		trine_md5_update( &ctx, (const unsigned char*) "R", 1 );
+		_md5_add_sv( aTHX_ &ctx, _av_slot( aTHX_ av, 1 ) );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Blank")) {
+		trine_md5_update( &ctx, (const unsigned char*) "B", 1 );
+		_md5_add_sv( aTHX_ &ctx, _av_slot( aTHX_ av, 1 ) );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Literal")) {
+		trine_md5_update( &ctx, (const unsigned char*) "L", 1 );
+		_md5_add_sv( aTHX_ &ctx, _av_slot( aTHX_ av, 0 ) );
+		trine_md5_update( &ctx, (const unsigned char*) "<", 1 );
+		_md5_add_sv( aTHX_ &ctx, _av_slot( aTHX_ av, 1 ) );
+		trine_md5_update( &ctx, (const unsigned char*) ">", 1 );
+		_md5_add_sv( aTHX_ &ctx, _av_slot( aTHX_ av, 2 ) );
+	} else {
+		*ok	= 0;
+		return 0;
+	}
+	return trine_md5_final64( &ctx );
+}
+
+/* Returns a new SV holding a hash value: a native UV where perl's UVs are
+ * 64 bits wide, and a decimal string otherwise. */
+static SV*
+_hash_value_sv (pTHX_ uint64_t j) {
+#if UVSIZE >= 8
+	return newSVuv( (UV) j );
+#else
+	char hash[21];
+	sprintf( hash, "%llu", (unsigned long long) j );
+	return newSVpv(hash, 0);
+#endif
+}
+
+/* Returns a mortal SV holding the hash value of node. If mask is true, the
+ * high bit is cleared so the value fits a signed 64-bit column. */
+static SV*
+_node_hash_sv (pTHX_ SV* node, int mask) {
+	int ok	= 1;
+	uint64_t j	= node ? _node_hash( aTHX_ node, &ok ) : 0;
+	if (!ok) {
+		return &PL_sv_undef;
+	}
+	if (mask) {
+		j	&= UINT64_C(0x7fffffffffffffff);
+	}
+	return sv_2mortal( _hash_value_sv( aTHX_ j ) );
+}
+
+/* Appends the UTF-8 encoding of the string value of sv to key. */
+static void
+_key_add_sv (pTHX_ SV* key, SV* sv) {
+	STRLEN len;
+	const U8* s;
+	if (sv == NULL || !SvOK(sv)) {
+		return;
+	}
+	s	= (const U8*) SvPV_const(sv, len);
+	if (SvUTF8(sv) || is_invariant_string(s, len)) {
+		sv_catpvn( key, (const char*) s, len );
+	} else {
+		STRLEN ulen	= len;
+		U8* u		= bytes_to_utf8( (U8*) s, &ulen );
+		sv_catpvn( key, (const char*) u, ulen );
+		Safefree(u);
+	}
+}
+
+/* Returns a new SV holding the term table key of node, or NULL if node is not
+ * exactly an RDF::Trine::Node::Resource, Blank or Literal (subclasses may not
+ * share their internal layout). Keys are a type character followed by the
+ * UTF-8 encoded fields. A literal's language and datatype come before its
+ * value, each terminated by a NUL, so that distinct values have distinct keys. */
+static SV*
+_node_key (pTHX_ SV* node) {
+	AV* av;
+	SV* key;
+	const char* class;
+	if (!sv_isobject(node) || SvTYPE(SvRV(node)) != SVt_PVAV) {
+		return NULL;
+	}
+	av		= (AV*) SvRV(node);
+	class	= sv_reftype( SvRV(node), 1 );
+	if (strEQ(class, "RDF::Trine::Node::Resource")) {
+		key	= newSVpvn("R", 1);
+		_key_add_sv( aTHX_ key, _av_slot( aTHX_ av, 1 ) );
+	} else if (strEQ(class, "RDF::Trine::Node::Blank")) {
+		key	= newSVpvn("B", 1);
+		_key_add_sv( aTHX_ key, _av_slot( aTHX_ av, 1 ) );
+	} else if (strEQ(class, "RDF::Trine::Node::Literal")) {
+		key	= newSVpvn("L", 1);
+		_key_add_sv( aTHX_ key, _av_slot( aTHX_ av, 1 ) );
+		sv_catpvn( key, "\0", 1 );
+		_key_add_sv( aTHX_ key, _av_slot( aTHX_ av, 2 ) );
+		sv_catpvn( key, "\0", 1 );
+		_key_add_sv( aTHX_ key, _av_slot( aTHX_ av, 0 ) );
+	} else {
+		return NULL;
+	}
+	return key;
+}
+
+/* Appends the key of a node bound in a join to key, returning false if node
+ * is not a Resource, Blank or Literal. Unlike _node_key, subclasses are
+ * accepted (query engines bind subclasses sharing the RDF::Trine layout), and
+ * each node key is prefixed by its length so that the concatenated keys of
+ * distinct rows are distinct. */
+static int
+_join_key_add (pTHX_ SV* key, SV* node) {
+	AV* av;
+	SV* nkey;
+	STRLEN len;
+	if (!sv_isobject(node) || SvTYPE(SvRV(node)) != SVt_PVAV) {
+		return 0;
+	}
+	av		= (AV*) SvRV(node);
+	nkey	= sv_2mortal( newSVpvn("", 0) );
+	if (sv_derived_from(node, "RDF::Trine::Node::Resource")) {
+		sv_catpvn( nkey, "R", 1 );
+		_key_add_sv( aTHX_ nkey, _av_slot( aTHX_ av, 1 ) );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Blank")) {
+		sv_catpvn( nkey, "B", 1 );
+		_key_add_sv( aTHX_ nkey, _av_slot( aTHX_ av, 1 ) );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Literal")) {
+		sv_catpvn( nkey, "L", 1 );
+		_key_add_sv( aTHX_ nkey, _av_slot( aTHX_ av, 1 ) );
+		sv_catpvn( nkey, "\0", 1 );
+		_key_add_sv( aTHX_ nkey, _av_slot( aTHX_ av, 2 ) );
+		sv_catpvn( nkey, "\0", 1 );
+		_key_add_sv( aTHX_ nkey, _av_slot( aTHX_ av, 0 ) );
+	} else {
+		return 0;
+	}
+	len	= SvCUR(nkey);
+	sv_catpvf( key, "%lu:", (unsigned long) len );
+	sv_catpvn( key, SvPVX(nkey), len );
+	return 1;
+}
+
+/* Returns the position of node's type in the RDF::Trine::Node::compare
+ * ordering (nil, blank, IRI, literal), or -1 for other values. */
+static int
+_node_rank (pTHX_ SV* node) {
+	if (!sv_isobject(node)) {
+		return -1;
+	}
+	if (sv_derived_from(node, "RDF::Trine::Node::Nil")) {
+		return 0;
+	}
+	if (SvTYPE(SvRV(node)) != SVt_PVAV) {
+		return -1;
+	}
+	if (sv_derived_from(node, "RDF::Trine::Node::Blank")) {
+		return 1;
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Resource")) {
+		return 2;
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Literal")) {
+		return 3;
+	}
+	return -1;
+}
+
+/* Compares two optional string fields as perl's cmp does, with undef sorting
+ * as the empty string. */
+static I32
+_field_cmp (pTHX_ SV* a, SV* b) {
+	return sv_cmp( (a && SvOK(a)) ? a : &PL_sv_no, (b && SvOK(b)) ? b : &PL_sv_no );
+}
+
+/* Compares two nodes of the given rank with the RDF::Trine::Node::compare
+ * ordering: blank identifiers and IRIs by value, and literals by value, then
+ * language (if both have one), then datatype (untyped first). */
+static I32
+_node_cmp (pTHX_ SV* a, SV* b, int rank) {
+	AV* ava;
+	AV* avb;
+	SV* x;
+	SV* y;
+	I32 cmp;
+	if (rank == 0) {
+		return 0;
+	}
+	ava	= (AV*) SvRV(a);
+	avb	= (AV*) SvRV(b);
+	if (rank < 3) {
+		return _field_cmp( aTHX_ _av_slot( aTHX_ ava, 1 ), _av_slot( aTHX_ avb, 1 ) );
+	}
+	if ((cmp = _field_cmp( aTHX_ _av_slot( aTHX_ ava, 0 ), _av_slot( aTHX_ avb, 0 ) ))) {
+		return cmp;
+	}
+	x	= _av_slot( aTHX_ ava, 1 );
+	y	= _av_slot( aTHX_ avb, 1 );
+	if (x && SvOK(x) && y && SvOK(y)) {
+		return sv_cmp( x, y );
+	}
+	x	= _av_slot( aTHX_ ava, 2 );
+	y	= _av_slot( aTHX_ avb, 2 );
+	if (x && SvOK(x) && y && SvOK(y)) {
+		return sv_cmp( x, y );
+	} else if (x && SvOK(x)) {
+		return 1;
+	} else if (y && SvOK(y)) {
+		return -1;
+	}
+	return 0;
+}
+
+/* Returns the sort key (the first element) of a top-k heap record, with
+ * undefined keys and non-record values sorting first. */
+static SV*
+_topk_key (pTHX_ SV* record) {
+	SV* key;
+	if (!record || !SvROK(record) || SvTYPE(SvRV(record)) != SVt_PVAV) {
+		return &PL_sv_no;
+	}
+	key	= _av_slot( aTHX_ (AV*) SvRV(record), 0 );
+	return (key && SvOK(key)) ? key : &PL_sv_no;
+}
+
+/* Moves the record at index i of the max-heap up to its place. */
+static void
+_topk_sift_up (pTHX_ SV** heap, SSize_t i) {
+	while (i > 0) {
+		SSize_t p	= (i - 1) / 2;
+		SV* tmp;
+		if (sv_cmp( _topk_key( aTHX_ heap[p] ), _topk_key( aTHX_ heap[i] ) ) >= 0) {
+			break;
+		}
+		tmp		= heap[p];
+		heap[p]	= heap[i];
+		heap[i]	= tmp;
+		i		= p;
+	}
+}
+
+/* Moves the record at index i of the n-record max-heap down to its place. */
+static void
+_topk_sift_down (pTHX_ SV** heap, SSize_t n, SSize_t i) {
+	while (1) {
+		SSize_t c	= 2 * i + 1;
+		SV* tmp;
+		if (c >= n) {
+			break;
+		}
+		if (c + 1 < n && sv_cmp( _topk_key( aTHX_ heap[c + 1] ), _topk_key( aTHX_ heap[c] ) ) > 0) {
+			c++;
+		}
+		if (sv_cmp( _topk_key( aTHX_ heap[i] ), _topk_key( aTHX_ heap[c] ) ) >= 0) {
+			break;
+		}
+		tmp		= heap[i];
+		heap[i]	= heap[c];
+		heap[c]	= tmp;
+		i		= c;
+	}
+}
+
+/* Returns a new reference to the canonical node for the value of node,
+ * recording node as canonical (key -> id, id -> node and refaddr -> id) if no
+ * equal node has been interned. */
+static SV*
+_intern_node (pTHX_ HV* keys, AV* nodes, HV* ids, SV* node) {
+	SV* key	= _node_key( aTHX_ node );
+	SV* canon;
+	HE* he;
+	if (key == NULL) {
+		return newSVsv(node);
+	}
+	he	= hv_fetch_ent( keys, key, 0, 0 );
+	if (he) {
+		/* already interned: return the canonical node */
+		SV** svp	= av_fetch( nodes, SvIV(HeVAL(he)), 0 );
+		canon		= newSVsv( svp ? *svp : node );
+	} else {
+		IV id		= av_len(nodes) + 1;
+		SV* addr	= newSVuv( PTR2UV(SvRV(node)) );
+		av_store( nodes, id, newSVsv(node) );
+		hv_store_ent( keys, key, newSViv(id), 0 );
+		hv_store_ent( ids, addr, newSViv(id), 0 );
+		SvREFCNT_dec(addr);
+		canon	= newSVsv(node);
+	}
+	SvREFCNT_dec(key);
+	return canon;
+}
+
+/* ID pages are strings of sorted, unique, big-endian 32-bit node IDs (the
+ * layout produced by pack('N*', ...)). Big-endian storage means the byte
+ * order of a page matches the numeric order of its IDs. */
+static uint32_t
+_id_page_load (const unsigned char* p) {
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static void
+_id_page_store (unsigned char* p, uint32_t id) {
+	p[0]	= (unsigned char) (id >> 24);
+	p[1]	= (unsigned char) (id >> 16);
+	p[2]	= (unsigned char) (id >> 8);
+	p[3]	= (unsigned char) id;
+}
+
+/* Binary search for id in a page of count IDs. Returns the index of id if
+ * present, or -(insertion point + 1) if it is not. */
+static IV
+_id_page_search (const unsigned char* p, STRLEN count, uint32_t id) {
+	STRLEN lo	= 0;
+	STRLEN hi	= count;
+	while (lo < hi) {
+		STRLEN mid	= lo + ((hi - lo) >> 1);
+		uint32_t v	= _id_page_load( p + (mid * 4) );
+		if (v < id) {
+			lo	= mid + 1;
+		} else if (v > id) {
+			hi	= mid;
+		} else {
+			return (IV) mid;
+		}
+	}
+	return -((IV) lo) - 1;
+}
+
+/* Returns the index of the first ID >= id in a page of count IDs, searching
+ * forward from index from. The search gallops (1, 2, 4, ... IDs ahead) before
+ * narrowing with a binary search, so a run of nearby lookups stays cheap. */
+static STRLEN
+_id_page_gallop (const unsigned char* p, STRLEN count, STRLEN from, uint32_t id) {
+	STRLEN lo	= from;
+	STRLEN hi	= from;
+	STRLEN step	= 1;
+	while (hi < count && _id_page_load( p + (hi * 4) ) < id) {
+		lo		= hi + 1;
+		hi		+= step;
+		step	<<= 1;
+	}
+	if (hi > count) {
+		hi	= count;
+	}
+	while (lo < hi) {
+		STRLEN mid	= lo + ((hi - lo) >> 1);
+		if (_id_page_load( p + (mid * 4) ) < id) {
+			lo	= mid + 1;
+		} else {
+			hi	= mid;
+		}
+	}
+	return lo;
+}
+
+/* N-Triples/N-Quads scanning. A chunk of complete lines is scanned in place;
+ * line ends are found with memchr, terms are decoded straight into UTF-8
+ * SVs (copying through an escape decoder only when a backslash is present),
+ * and the node and statement objects are built as blessed arrays with the
+ * same layout their Perl constructors produce. Values that need the Perl
+ * constructors' extra handling (the nil graph IRI, IRIs the constructor
+ * rejects, and XML literals) are passed to those constructors instead. */
+
+#define TRINE_NIL_GRAPH	"tag:gwilliams@cpan.org,2010-01-01:RT:NIL"
+#define TRINE_XMLLITERAL	"http://www.w3.org/1999/02/22-rdf-syntax-ns#XMLLiteral"
+
+typedef struct {
+	HV* resource;
+	HV* blank;
+	HV* literal;
+	HV* triple;
+	HV* quad;
+	int xml_literals;
+	int formulae;
+	int intern;
+	HV* keys;
+	AV* nodes;
+	HV* ids;
+} trine_nt_state;
+
+#define _nt_is_lower(c)	((c) >= 'a' && (c) <= 'z')
+#define _nt_is_alpha(c)	(_nt_is_lower(c) || ((c) >= 'A' && (c) <= 'Z'))
+#define _nt_is_alnum(c)	(_nt_is_alpha(c) || ((c) >= '0' && (c) <= '9'))
+
+static int
+_nt_is_space (char c) {
+	return (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v');
+}
+
+/* Croaks with a parser error message. Messages end with a newline so that
+ * perl does not append its own location; the caller chomps it. */
+static void
+_nt_croak (pTHX_ IV lineno, const char* msg, const char* near, const char* end) {
+	if (near) {
+		croak("%s at line %" IVdf ", near \"%.*s\"\n", msg, lineno, (int) (end - near), near);
+	}
+	croak("%s at line %" IVdf "\n", msg, lineno);
+}
+
+static int
+_nt_hex (const char* p, const char* end, int digits, int upper_only, UV* cp) {
+	int i;
+	UV v	= 0;
+	if (end - p < digits) {
+		return 0;
+	}
+	for (i = 0; i < digits; i++) {
+		char c	= p[i];
+		v	<<= 4;
+		if (c >= '0' && c <= '9') {
+			v	|= (UV) (c - '0');
+		} else if (c >= 'A' && c <= 'F') {
+			v	|= (UV) (c - 'A' + 10);
+		} else if (!upper_only && c >= 'a' && c <= 'f') {
+			v	|= (UV) (c - 'a' + 10);
+		} else {
+			return 0;
+		}
+	}
+	*cp	= v;
+	return 1;
+}
+
+/* Returns a new UTF-8 SV holding the bytes from start to stop with
+ * N-Triples escapes decoded. IRIs accept the additional \b and \f escapes
+ * and, like the Perl parser, only upper case hex digits. */
+static SV*
+_nt_string (pTHX_ const char* start, const char* stop, int iri, IV lineno) {
+	SV* sv;
+	const char* p	= start;
+	const char* bs	= (const char*) memchr( start, '\\', stop - start );
+	if (bs == NULL) {
+		sv	= newSVpvn( start, stop - start );
+		SvUTF8_on(sv);
+		return sv;
+	}
+	sv	= newSV( stop - start + 1 );
+	SvPOK_on(sv);
+	SvUTF8_on(sv);
+	while (bs) {
+		UV cp;
+		char c;
+		sv_catpvn( sv, p, bs - p );
+		if (bs + 1 >= stop) {
+			SvREFCNT_dec(sv);
+			_nt_croak( aTHX_ lineno, "Backslash in N-Triples node without escaped character", NULL, NULL );
+		}
+		c	= bs[1];
+		p	= bs + 2;
+		switch (c) {
+			case 't':	sv_catpvn( sv, "\t", 1 ); break;
+			case 'n':	sv_catpvn( sv, "\n", 1 ); break;
+			case 'r':	sv_catpvn( sv, "\r", 1 ); break;
+			case '"':	sv_catpvn( sv, "\"", 1 ); break;
+			case '\\':	sv_catpvn( sv, "\\", 1 ); break;
+			case 'b':
+			case 'f':
+				if (!iri) {
+					goto bad_escape;
+				}
+				sv_catpvn( sv, (c == 'b') ? "\b" : "\f", 1 );
+				break;
+			case 'u':
+			case 'U':
+				{
+					U8 buf[UTF8_MAXBYTES + 1];
+					U8* e;
+					int digits	= (c == 'u') ? 4 : 8;
+					if (!_nt_hex( p, stop, digits, iri, &cp )) {
+						SvREFCNT_dec(sv);
+						_nt_croak( aTHX_ lineno, (c == 'u') ? "Bad N-Triples \\u escape" : "Bad N-Triples \\U escape", bs, stop );
+					}
+					e	= uvchr_to_utf8( buf, cp );
+					sv_catpvn( sv, (const char*) buf, e - buf );
+					p	+= digits;
+				}
+				break;
+			default:
+			bad_escape:
+				{
+					char msg[64];
+					sprintf( msg, "Not valid N-Triples escape character '\\%c'", c );
+					SvREFCNT_dec(sv);
+					_nt_croak( aTHX_ lineno, msg, bs, stop );
+				}
+		}
+		bs	= (const char*) memchr( p, '\\', stop - p );
+	}
+	sv_catpvn( sv, p, stop - p );
+	return sv;
+}
+
+static SV*
+_nt_bless (pTHX_ AV* av, HV* stash) {
+	return sv_bless( newRV_noinc( (SV*) av ), stash );
+}
+
+/* Calls $class->new( @args ) and returns a new reference to the result. */
+static SV*
+_nt_call_new (pTHX_ const char* class, SV* a, SV* b, SV* c) {
+	SV* ret;
+	int count;
+	dSP;
+	ENTER;
+	SAVETMPS;
+	PUSHMARK(SP);
+	XPUSHs( sv_2mortal( newSVpv( class, 0 ) ) );
+	XPUSHs( a );
+	if (b || c) {
+		XPUSHs( b ? b : &PL_sv_undef );
+		XPUSHs( c ? c : &PL_sv_undef );
+	}
+	PUTBACK;
+	count	= call_method( "new", G_SCALAR );
+	SPAGAIN;
+	ret		= (count == 1) ? newSVsv( POPs ) : newSV(0);
+	PUTBACK;
+	FREETMPS;
+	LEAVE;
+	return ret;
+}
+
+/* Returns the node, replaced by its canonical node if the term table is
+ * enabled. Takes ownership of node. */
+static SV*
+_nt_node (pTHX_ trine_nt_state* st, SV* node) {
+	SV* canon;
+	if (!st->intern) {
+		return node;
+	}
+	canon	= _intern_node( aTHX_ st->keys, st->nodes, st->ids, node );
+	SvREFCNT_dec(node);
+	return canon;
+}
+
+static SV*
+_nt_resource (pTHX_ trine_nt_state* st, SV* uri) {
+	STRLEN len;
+	const char* s	= SvPV_const(uri, len);
+	STRLEN i;
+	AV* av;
+	int plain	= (len != sizeof(TRINE_NIL_GRAPH) - 1 || memNE( s, TRINE_NIL_GRAPH, len ));
+	for (i = 0; plain && i < len; i++) {
+		switch (s[i]) {
+			case '<': case '>': case '"': case ' ': case '{': case '}':
+			case '|': case '\\': case '^': case '`':
+				plain	= 0;
+		}
+	}
+	if (!plain) {
+		SV* node	= _nt_call_new( aTHX_ "RDF::Trine::Node::Resource", sv_2mortal(uri), NULL, NULL );
+		return node;
+	}
+	av	= newAV();
+	av_extend( av, 1 );
+	av_store( av, 0, newSVpvn( "URI", 3 ) );
+	av_store( av, 1, uri );
+	return _nt_node( aTHX_ st, _nt_bless( aTHX_ av, st->resource ) );
+}
+
+/* Canonicalizes the case of a language tag in place, as
+ * RDF::Trine::Node::Literal does: lower case, except that two letter subtags
+ * are upper case and four letter subtags are title case when they follow a
+ * subtag of at least two characters. */
+static void
+_nt_canonical_lang (char* tag, STRLEN len) {
+	STRLEN i;
+	STRLEN start	= 0;
+	STRLEN prev		= 0;
+	int first		= 1;
+	for (i = 0; i < len; i++) {
+		tag[i]	= toLOWER(tag[i]);
+	}
+	for (i = 0; i <= len; i++) {
+		if (i == len || tag[i] == '-') {
+			STRLEN sublen	= i - start;
+			if (!first && prev >= 2) {
+				if (sublen == 2) {
+					tag[start]		= toUPPER(tag[start]);
+					tag[start+1]	= toUPPER(tag[start+1]);
+				} else if (sublen == 4) {
+					tag[start]		= toUPPER(tag[start]);
+				}
+			}
+			first	= 0;
+			prev	= sublen;
+			start	= i + 1;
+		}
+	}
+}
+
+/* Parses one node starting at *pp, advancing *pp past it. Returns NULL at
+ * the end of the line or at the terminating '.'. */
+static SV*
+_nt_eat_node (pTHX_ trine_nt_state* st, const char** pp, const char* end, IV lineno) {
+	const char* p	= *pp;
+	while (p < end && _nt_is_space(*p)) {
+		p++;
+	}
+	*pp	= p;
+	if (p >= end || *p == '.') {
+		return NULL;
+	}
+	if (*p == '<') {
+		const char* close	= (const char*) memchr( p + 1, '>', end - p - 1 );
+		SV* uri;
+		if (close == NULL) {
+			_nt_croak( aTHX_ lineno, "Missing expected '>'", p, end );
+		}
+		uri	= _nt_string( aTHX_ p + 1, close, 1, lineno );
+		*pp	= close + 1;
+		return _nt_resource( aTHX_ st, uri );
+	} else if (*p == '_') {
+		const char* name	= p + 2;
+		const char* q		= name;
+		AV* av;
+		if (end - p < 3 || p[1] != ':' || !_nt_is_alpha(*name)) {
+			_nt_croak( aTHX_ lineno, "Bad N-Triples blank node identifier", p, end );
+		}
+		while (q < end && _nt_is_alnum(*q)) {
+			q++;
+		}
+		av	= newAV();
+		av_extend( av, 1 );
+		av_store( av, 0, newSVpvn( "BLANK", 5 ) );
+		av_store( av, 1, newSVpvn( name, q - name ) );
+		*pp	= q;
+		return _nt_node( aTHX_ st, _nt_bless( aTHX_ av, st->blank ) );
+	} else if (*p == '"') {
+		const char* q	= p + 1;
+		SV* value;
+		SV* lang	= NULL;
+		SV* dt		= NULL;
+		AV* av;
+		while (q < end && *q != '"') {
+			q	+= (*q == '\\') ? 2 : 1;
+		}
+		if (q >= end) {
+			_nt_croak( aTHX_ lineno, "Ending double quote not found", NULL, NULL );
+		}
+		value	= sv_2mortal( _nt_string( aTHX_ p + 1, q, 0, lineno ) );
+		q++;
+		if (q < end && *q == '@' && q + 1 < end && _nt_is_lower(q[1])) {
+			const char* t	= q + 1;
+			while (t < end && _nt_is_lower(*t)) {
+				t++;
+			}
+			while (t + 1 < end && *t == '-' && _nt_is_alnum(t[1])) {
+				t++;
+				while (t < end && _nt_is_alnum(*t)) {
+					t++;
+				}
+			}
+			lang	= newSVpvn( q + 1, t - q - 1 );
+			_nt_canonical_lang( SvPVX(lang), SvCUR(lang) );
+			q		= t;
+		} else if (end - q >= 3 && q[0] == '^' && q[1] == '^' && q[2] == '<') {
+			const char* close	= (const char*) memchr( q + 3, '>', end - q - 3 );
+			if (close == NULL) {
+				_nt_croak( aTHX_ lineno, "Missing expected '>'", q, end );
+			}
+			if (close > q + 3 && !(close == q + 4 && q[3] == '0')) {
+				dt	= newSVpvn( q + 3, close - q - 3 );
+				SvUTF8_on(dt);
+			}
+			q	= close + 1;
+		}
+		*pp	= q;
+		if (dt && (st->formulae || (st->xml_literals && SvCUR(dt) == sizeof(TRINE_XMLLITERAL) - 1 && memEQ( SvPVX(dt), TRINE_XMLLITERAL, SvCUR(dt) )))) {
+			return _nt_call_new( aTHX_ "RDF::Trine::Node::Literal", value, &PL_sv_undef, sv_2mortal(dt) );
+		}
+		av	= newAV();
+		av_push( av, SvREFCNT_inc(value) );
+		if (lang) {
+			av_push( av, lang );
+			av_push( av, newSV(0) );
+		} else if (dt) {
+			av_push( av, newSV(0) );
+			av_push( av, dt );
+		}
+		return _nt_node( aTHX_ st, _nt_bless( aTHX_ av, st->literal ) );
+	} else {
+		char msg[64];
+		sprintf( msg, "Not valid N-Triples node start character '%c'", *p );
+		_nt_croak( aTHX_ lineno, msg, p, end );
+	}
+	return NULL;
+}
+
+/* Parses the statement on one line (already trimmed, non-empty, and not a
+ * comment) and pushes it onto statements. */
+static void
+_nt_parse_line (pTHX_ trine_nt_state* st, const char* p, const char* end, IV lineno, int quads, AV* statements) {
+	SV* nodes[4];
+	int count	= 0;
+	int max		= quads ? 4 : 3;
+	int i;
+	AV* av;
+	SV* node;
+	while ((node = _nt_eat_node( aTHX_ st, &p, end, lineno ))) {
+		sv_2mortal(node);
+		if (count == max) {
+			_nt_croak( aTHX_ lineno, quads ? "Not valid N-Quads data" : "Not valid N-Triples data", NULL, NULL );
+		}
+		nodes[count++]	= node;
+	}
+	if (p >= end || *p != '.' || p + 1 != end) {
+		_nt_croak( aTHX_ lineno, "Missing expected '.'", NULL, NULL );
+	}
+	if (count < 3) {
+		_nt_croak( aTHX_ lineno, quads ? "Not valid N-Quads data" : "Not valid N-Triples data", NULL, NULL );
+	}
+	av	= newAV();
+	av_extend( av, count - 1 );
+	for (i = 0; i < count; i++) {
+		av_store( av, i, SvREFCNT_inc(nodes[i]) );
+	}
+	av_push( statements, _nt_bless( aTHX_ av, (count == 4) ? st->quad : st->triple ) );
+}
+
+/* Turtle tokenizer used by RDF::Trine::Parser::Turtle::Lexer. The buffer is
+ * scanned as UTF-8 bytes; runs of plain characters in IRIs, names, and
+ * string literals are copied into the token value in one piece, and tokens
+ * are built as RDF::Trine::Parser::Turtle::Token objects (blessed arrays of
+ * type, start line, start column, line, column, and an array of values).
+ * Token types must stay in the order of @EXPORT in
+ * RDF::Trine::Parser::Turtle::Constants.
+ *
+ * Unless eof is set the buffer must end at the end of a line, so only long
+ * string literals can continue past it. */
+
+enum {
+	TT_LBRACKET = 1, TT_RBRACKET, TT_LPAREN, TT_RPAREN, TT_DOT, TT_SEMICOLON,
+	TT_COMMA, TT_HATHAT, TT_A, TT_BOOLEAN, TT_PREFIXNAME, TT_IRI, TT_BNODE,
+	TT_DOUBLE, TT_DECIMAL, TT_INTEGER, TT_WS, TT_COMMENT, TT_STRING3D,
+	TT_STRING3S, TT_STRING1D, TT_STRING1S, TT_BASE, TT_PREFIX, TT_SPARQLBASE,
+	TT_SPARQLPREFIX, TT_LANG, TT_LBRACE, TT_RBRACE, TT_EQUALS
+};
+
+/* _tt_token results other than a token type */
+#define TT_SKIP		0
+#define TT_MORE		-1
+#define TT_ERROR	-2
+
+typedef struct {
+	const char* p;
+	const char* end;
+	IV line;
+	IV col;
+	int eof;
+	HV* stash;
+	SV* error;
+} trine_tt_state;
+
+static int
+_tt_is_pn_chars_base (UV c) {
+	return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')
+		|| (c >= 0x00C0 && c <= 0x00D6) || (c >= 0x00D8 && c <= 0x00F6)
+		|| (c >= 0x00F8 && c <= 0x02FF) || (c >= 0x0370 && c <= 0x037D)
+		|| (c >= 0x037F && c <= 0x1FFF) || (c >= 0x200C && c <= 0x200D)
+		|| (c >= 0x2070 && c <= 0x218F) || (c >= 0x2C00 && c <= 0x2FEF)
+		|| (c >= 0x3001 && c <= 0xD7FF) || (c >= 0xF900 && c <= 0xFDCF)
+		|| (c >= 0xFDF0 && c <= 0xFFFD) || (c >= 0x10000 && c <= 0xEFFFF));
+}
+
+static int
+_tt_is_pn_chars_u (UV c) {
+	return (c == '_' || _tt_is_pn_chars_base(c));
+}
+
+static int
+_tt_is_pn_chars (UV c) {
+	return (_tt_is_pn_chars_u(c) || c == '-' || (c >= '0' && c <= '9') || c == 0x00B7
+		|| (c >= 0x0300 && c <= 0x036F) || (c >= 0x203F && c <= 0x2040));
+}
+
+/* Approximates perl's \w for the \b checks that end keywords and language
+ * tags. */
+static int
+_tt_is_word (UV c) {
+	return (c == '_' || (c >= '0' && c <= '9') || _tt_is_pn_chars(c));
+}
+
+/* Returns the code point at p (which must be before end), setting *len to
+ * its length in bytes. */
+static UV
+_tt_char (pTHX_ const char* p, const char* end, STRLEN* len) {
+	if ((U8) *p < 0x80) {
+		*len	= 1;
+		return (UV) (U8) *p;
+	}
+	return utf8_to_uvchr_buf( (const U8*) p, (const U8*) end, len );
+}
+
+/* Moves the scan position to p, counting lines and (character) columns. */
+static void
+_tt_advance (trine_tt_state* st, const char* p) {
+	const char* q;
+	for (q = st->p; q < p; q++) {
+		if (*q == '\n') {
+			st->line++;
+			st->col	= 1;
+		} else if (((U8) *q & 0xC0) != 0x80) {
+			st->col++;
+		}
+	}
+	st->p	= p;
+}
+
+/* Records an error at position p. */
+static int
+_tt_error (pTHX_ trine_tt_state* st, const char* p, const char* fmt, ...) {
+	va_list args;
+	_tt_advance( st, p );
+	st->error	= newSVpvs("");
+	va_start(args, fmt);
+	sv_vsetpvf( st->error, fmt, &args );
+	va_end(args);
+	SvUTF8_on(st->error);
+	return TT_ERROR;
+}
+
+static void
+_tt_push (pTHX_ trine_tt_state* st, AV* tokens, int type, IV line, IV col, const char* end, SV* a, SV* b) {
+	AV* av		= newAV();
+	AV* args	= newAV();
+	_tt_advance( st, end );
+	if (a) {
+		av_push( args, a );
+	}
+	if (b) {
+		av_push( args, b );
+	}
+	av_extend( av, 5 );
+	av_store( av, 0, newSViv(type) );
+	av_store( av, 1, newSViv(line) );
+	av_store( av, 2, newSViv(col) );
+	av_store( av, 3, newSViv(st->line) );
+	av_store( av, 4, newSViv(st->col) );
+	av_store( av, 5, newRV_noinc( (SV*) args ) );
+	av_push( tokens, sv_bless( newRV_noinc( (SV*) av ), st->stash ) );
+}
+
+static SV*
+_tt_string (pTHX_ const char* start, const char* stop) {
+	SV* sv	= newSVpvn( start, stop - start );
+	SvUTF8_on(sv);
+	return sv;
+}
+
+/* Decodes the \u or \U escape whose letter is at p, appending the character
+ * to sv. Returns the position after the escape, or NULL if the hex digits
+ * are missing (*cp is then set to 0) or invalid. */
+static const char*
+_tt_unicode_escape (pTHX_ SV* sv, const char* p, const char* end, UV* cp) {
+	U8 buf[UTF8_MAXBYTES + 1];
+	U8* e;
+	int digits	= (*p == 'u') ? 4 : 8;
+	*cp	= 0;
+	if (end - p - 1 < digits) {
+		return NULL;
+	}
+	if (!_nt_hex( p + 1, end, digits, 0, cp )) {
+		*cp	= 1;
+		return NULL;
+	}
+	e	= uvchr_to_utf8( buf, *cp );
+	sv_catpvn( sv, (const char*) buf, e - buf );
+	return p + 1 + digits;
+}
+
+/* Returns the number of hex digits available for the \u or \U escape whose
+ * letter is at p, for error messages. */
+static int
+_tt_escape_len (const char* p, const char* end) {
+	int digits	= (*p == 'u') ? 4 : 8;
+	return (end - p - 1 < digits) ? (int) (end - p - 1) : digits;
+}
+
+/* Scans a string literal whose opening quote (or quotes) end at p. */
+static int
+_tt_literal (pTHX_ trine_tt_state* st, AV* tokens, IV line, IV col, const char* p, char quote, int type) {
+	const char* end	= st->end;
+	int long_form	= (type == TT_STRING3D || type == TT_STRING3S);
+	int quotes		= 0;
+	SV* sv			= newSVpvs("");
+	SvUTF8_on(sv);
+	while (1) {
+		const char* q	= p;
+		if (p >= end) {
+			SvREFCNT_dec(sv);
+			if (long_form && !st->eof) {
+				return TT_MORE;
+			}
+			return _tt_error( aTHX_ st, p, "Found EOF in string literal" );
+		}
+		if (*p == quote) {
+			p++;
+			if (!long_form || ++quotes == 3) {
+				break;
+			}
+			continue;
+		}
+		if (quotes) {
+			sv_catpvn( sv, (quote == '"') ? "\"\"" : "''", quotes );
+			quotes	= 0;
+		}
+		if (*p == '\\') {
+			char c;
+			if (p + 1 >= end) {
+				SvREFCNT_dec(sv);
+				if (long_form && !st->eof) {
+					return TT_MORE;
+				}
+				return _tt_error( aTHX_ st, p, "Found EOF in string literal" );
+			}
+			c	= p[1];
+			switch (c) {
+				case '\\':	sv_catpvn( sv, "\\", 1 ); break;
+				case '"':	sv_catpvn( sv, "\"", 1 ); break;
+				case '\'':	sv_catpvn( sv, "'", 1 ); break;
+				case 'r':	sv_catpvn( sv, "\r", 1 ); break;
+				case 't':	sv_catpvn( sv, "\t", 1 ); break;
+				case 'n':	sv_catpvn( sv, "\n", 1 ); break;
+				case 'b':	sv_catpvn( sv, "\b", 1 ); break;
+				case 'f':	sv_catpvn( sv, "\f", 1 ); break;
+				case '>':	sv_catpvn( sv, ">", 1 ); break;
+				case 'u':
+				case 'U':
+					{
+						UV bad;
+						const char* next	= _tt_unicode_escape( aTHX_ sv, p + 1, end, &bad );
+						if (next == NULL) {
+							SvREFCNT_dec(sv);
+							if (!bad && long_form && !st->eof) {
+								return TT_MORE;
+							}
+							return _tt_error( aTHX_ st, p + 2, "Bad unicode escape codepoint '%.*s'", _tt_escape_len( p + 1, end ), p + 2 );
+						}
+						p	= next;
+						continue;
+					}
+				default:
+					{
+						STRLEN len;
+						_tt_char( aTHX_ p + 1, end, &len );
+						SvREFCNT_dec(sv);
+						return _tt_error( aTHX_ st, p + 2, "Unrecognized string escape '%.*s'", (int) len, p + 1 );
+					}
+			}
+			p	+= 2;
+			continue;
+		}
+		if (!long_form && (*p == '\n' || *p == '\r')) {
+			SvREFCNT_dec(sv);
+			return _tt_error( aTHX_ st, p, "Found end of line while expecting string character" );
+		}
+		while (q < end && *q != quote && *q != '\\' && (long_form || (*q != '\n' && *q != '\r'))) {
+			q++;
+		}
+		sv_catpvn( sv, p, q - p );
+		p	= q;
+	}
+	_tt_push( aTHX_ st, tokens, type, line, col, p, sv, NULL );
+	return type;
+}
+
+static int
+_tt_iri (pTHX_ trine_tt_state* st, AV* tokens, IV line, IV col) {
+	const char* end	= st->end;
+	const char* p	= st->p + 1;
+	SV* sv			= newSVpvs("");
+	SvUTF8_on(sv);
+	while (1) {
+		const char* q	= p;
+		if (p >= end) {
+			SvREFCNT_dec(sv);
+			return _tt_error( aTHX_ st, p, "Found EOF while expecting IRI character" );
+		}
+		if (*p == '>') {
+			break;
+		}
+		if (*p == '\\') {
+			UV cp;
+			const char* next;
+			if (p + 1 < end && p[1] == '\\') {
+				sv_catpvn( sv, "\\", 1 );
+				p	+= 2;
+				continue;
+			}
+			if (p + 1 >= end || (p[1] != 'u' && p[1] != 'U')) {
+				SvREFCNT_dec(sv);
+				return _tt_error( aTHX_ st, p + 1, "Unrecognized iri escape '%.*s'", (int) ((p + 1 < end) ? 1 : 0), p + 1 );
+			}
+			next	= _tt_unicode_escape( aTHX_ sv, p + 1, end, &cp );
+			if (next == NULL) {
+				SvREFCNT_dec(sv);
+				return _tt_error( aTHX_ st, p + 2, "Bad unicode escape codepoint '%.*s'", _tt_escape_len( p + 1, end ), p + 2 );
+			}
+			if (p[1] == 'u' && cp < 0x80 && strchr( "<>\" {}|\\^`", (int) cp )) {
+				SvREFCNT_dec(sv);
+				return _tt_error( aTHX_ st, next, "Bad IRI character: '%c' (0x%x)", (int) cp, (unsigned int) cp );
+			}
+			p	= next;
+			continue;
+		}
+		while (q < end && ((U8) *q > 0x20 && !strchr( "<>\\\"{}|^`", *q ))) {
+			q++;
+		}
+		if (q == p) {
+			STRLEN len;
+			_tt_char( aTHX_ p, end, &len );
+			SvREFCNT_dec(sv);
+			return _tt_error( aTHX_ st, p, "Got '%.*s' while expecting IRI character", (int) len, p );
+		}
+		sv_catpvn( sv, p, q - p );
+		p	= q;
+	}
+	_tt_push( aTHX_ st, tokens, TT_IRI, line, col, p + 1, sv, NULL );
+	return TT_IRI;
+}
+
+/* Returns the end of a name made of a first character accepted by first,
+ * followed by PN_CHARS and '.', not ending with a '.'. Returns p if there is
+ * no such name. */
+static const char*
+_tt_name (pTHX_ const char* p, const char* end, int (*first)(UV)) {
+	const char* last;
+	STRLEN len;
+	UV c;
+	if (p >= end) {
+		return p;
+	}
+	c	= _tt_char( aTHX_ p, end, &len );
+	if (!first(c)) {
+		return p;
+	}
+	p		+= len;
+	last	= p;
+	while (p < end) {
+		c	= _tt_char( aTHX_ p, end, &len );
+		if (c == '.') {
+			p	+= len;
+		} else if (_tt_is_pn_chars(c)) {
+			p	+= len;
+			last	= p;
+		} else {
+			break;
+		}
+	}
+	return last;
+}
+
+static int
+_tt_is_bnode_start (UV c) {
+	return (_tt_is_pn_chars_u(c) || (c >= '0' && c <= '9'));
+}
+
+/* Returns the length of the PN_LOCAL_ESCAPED sequence at p, or 0. */
+static int
+_tt_local_escape (const char* p, const char* end) {
+	if (*p == '\\') {
+		return (p + 1 < end && p[1] && strchr( "-~.!&'()*+,;=/?#@%_$", p[1] )) ? 2 : 0;
+	} else if (*p == '%') {
+		return (end - p >= 3 && isXDIGIT(p[1]) && isXDIGIT(p[2])) ? 3 : 0;
+	}
+	return 0;
+}
+
+static int
+_tt_pname (pTHX_ trine_tt_state* st, AV* tokens, IV line, IV col) {
+	const char* end	= st->end;
+	const char* p	= st->p;
+	const char* colon;
+	const char* last;
+	const char* q;
+	SV* ns;
+	SV* local;
+	int first		= 1;
+	colon	= _tt_name( aTHX_ p, end, _tt_is_pn_chars_base );
+	if (colon >= end || *colon != ':') {
+		return _tt_error( aTHX_ st, p, "Expected prefixed name" );
+	}
+	ns		= _tt_string( aTHX_ p, colon + 1 );
+	p		= colon + 1;
+	last	= p;
+	while (p < end) {
+		STRLEN len;
+		UV c	= _tt_char( aTHX_ p, end, &len );
+		int esc	= _tt_local_escape( p, end );
+		if (esc) {
+			p		+= esc;
+			last	= p;
+		} else if (c == ':' || (first ? (_tt_is_pn_chars_u(c) || (c >= '0' && c <= '9')) : _tt_is_pn_chars(c))) {
+			p		+= len;
+			last	= p;
+		} else if (c == '.' && !first) {
+			p		+= len;
+		} else {
+			break;
+		}
+		first	= 0;
+	}
+	if (last == colon + 1) {
+		_tt_push( aTHX_ st, tokens, TT_PREFIXNAME, line, col, last, ns, NULL );
+		return TT_PREFIXNAME;
+	}
+	local	= newSVpvs("");
+	SvUTF8_on(local);
+	p		= colon + 1;
+	while ((q = (const char*) memchr( p, '\\', last - p ))) {
+		sv_catpvn( local, p, q - p );
+		sv_catpvn( local, q + 1, 1 );
+		p	= q + 2;
+	}
+	sv_catpvn( local, p, last - p );
+	_tt_push( aTHX_ st, tokens, TT_PREFIXNAME, line, col, last, ns, local );
+	return TT_PREFIXNAME;
+}
+
+static const char*
+_tt_digits (const char* p, const char* end) {
+	while (p < end && *p >= '0' && *p <= '9') {
+		p++;
+	}
+	return p;
+}
+
+static int
+_tt_number (pTHX_ trine_tt_state* st, AV* tokens, IV line, IV col) {
+	const char* end		= st->end;
+	const char* p		= st->p;
+	const char* int_end;
+	const char* frac	= NULL;
+	const char* frac_end;
+	const char* stop	= NULL;
+	int type			= 0;
+	if (p < end && (*p == '+' || *p == '-')) {
+		p++;
+	}
+	int_end		= _tt_digits( p, end );
+	frac_end	= int_end;
+	if (int_end < end && *int_end == '.') {
+		frac		= int_end + 1;
+		frac_end	= _tt_digits( frac, end );
+	}
+	/* an exponent may follow digits before the '.', digits after it, or both */
+	if (int_end > p || (frac && frac_end > frac)) {
+		const char* e	= (frac && (int_end > p || frac_end > frac)) ? frac_end : int_end;
+		if (e < end && (*e == 'e' || *e == 'E')) {
+			const char* d	= e + 1;
+			const char* x;
+			if (d < end && (*d == '+' || *d == '-')) {
+				d++;
+			}
+			x	= _tt_digits( d, end );
+			if (x > d) {
+				type	= TT_DOUBLE;
+				stop	= x;
+			}
+		}
+	}
+	if (!type && frac && frac_end > frac) {
+		type	= TT_DECIMAL;
+		stop	= frac_end;
+	}
+	if (!type && int_end > p) {
+		type	= TT_INTEGER;
+		stop	= int_end;
+	}
+	if (!type) {
+		return _tt_error( aTHX_ st, st->p, "Expected number" );
+	}
+	_tt_push( aTHX_ st, tokens, type, line, col, stop, _tt_string( aTHX_ st->p, stop ), NULL );
+	return type;
+}
+
+/* Returns true if p is at a word boundary (\b) after a word character. */
+static int
+_tt_word_end (pTHX_ const char* p, const char* end) {
+	STRLEN len;
+	return (p >= end || !_tt_is_word( _tt_char( aTHX_ p, end, &len ) ));
+}
+
+/* Returns true if the keyword ending at p is not the prefix of a longer
+ * word or of a prefixed name. */
+static int
+_tt_keyword_end (pTHX_ const char* p, const char* end) {
+	return ((p >= end || *p != ':') && _tt_word_end( aTHX_ p, end ));
+}
+
+static int
+_tt_match_ci (const char* p, const char* end, const char* word, STRLEN len) {
+	STRLEN i;
+	if ((STRLEN) (end - p) < len) {
+		return 0;
+	}
+	for (i = 0; i < len; i++) {
+		if (toLOWER(p[i]) != word[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int
+_tt_keyword (pTHX_ trine_tt_state* st, AV* tokens, IV line, IV col) {
+	const char* end	= st->end;
+	const char* p	= st->p + 1;
+	const char* q	= p;
+	const char* best	= NULL;
+	if (end - p >= 6 && memEQ( p, "prefix", 6 )) {
+		_tt_push( aTHX_ st, tokens, TT_PREFIX, line, col, p + 6, NULL, NULL );
+		return TT_PREFIX;
+	} else if (end - p >= 4 && memEQ( p, "base", 4 )) {
+		_tt_push( aTHX_ st, tokens, TT_BASE, line, col, p + 4, NULL, NULL );
+		return TT_BASE;
+	}
+	while (q < end && _nt_is_alpha(*q)) {
+		q++;
+	}
+	if (q > p) {
+		/* the tag ends at the longest subtag boundary followed by \b */
+		while (1) {
+			if (_tt_word_end( aTHX_ q, end )) {
+				best	= q;
+			}
+			if (q + 1 < end && *q == '-' && _nt_is_alnum(q[1])) {
+				q++;
+				while (q < end && _nt_is_alnum(*q)) {
+					q++;
+				}
+			} else {
+				break;
+			}
+		}
+	}
+	if (best == NULL) {
+		return _tt_error( aTHX_ st, p, "Expected keyword or language tag" );
+	}
+	_tt_push( aTHX_ st, tokens, TT_LANG, line, col, best, _tt_string( aTHX_ p, best ), NULL );
+	return TT_LANG;
+}
+
+/* Scans the next token at st->p, pushing it onto tokens. Returns its type,
+ * TT_SKIP after whitespace or a comment, TT_MORE if the token may continue
+ * past the end of the buffer, or TT_ERROR. */
+static int
+_tt_token (pTHX_ trine_tt_state* st, AV* tokens) {
+	const char* p	= st->p;
+	const char* end	= st->end;
+	IV line			= st->line;
+	IV col			= st->col;
+	int type		= 0;
+	STRLEN len;
+	UV c;
+	switch (*p) {
+		case ' ': case '\t': case '\r': case '\n':
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+				p++;
+			}
+			_tt_advance( st, p );
+			return TT_SKIP;
+		case '#':
+			while (p < end && *p != '\r' && *p != '\n') {
+				p++;
+			}
+			if (p < end) {
+				p++;
+			}
+			_tt_advance( st, p );
+			return TT_SKIP;
+		case '.':
+			if (p + 1 < end && isDIGIT(p[1])) {
+				return _tt_number( aTHX_ st, tokens, line, col );
+			}
+			type	= TT_DOT;
+			break;
+		case ';':	type	= TT_SEMICOLON; break;
+		case '[':	type	= TT_LBRACKET; break;
+		case ']':	type	= TT_RBRACKET; break;
+		case '(':	type	= TT_LPAREN; break;
+		case ')':	type	= TT_RPAREN; break;
+		case '{':	type	= TT_LBRACE; break;
+		case '}':	type	= TT_RBRACE; break;
+		case ',':	type	= TT_COMMA; break;
+		case '=':	type	= TT_EQUALS; break;
+		case '@':
+			return _tt_keyword( aTHX_ st, tokens, line, col );
+		case '<':
+			return _tt_iri( aTHX_ st, tokens, line, col );
+		case '_':
+			{
+				const char* q;
+				if (end - p < 2 || p[1] != ':') {
+					return _tt_error( aTHX_ st, p, "Expected '_:'" );
+				}
+				q	= _tt_name( aTHX_ p + 2, end, _tt_is_bnode_start );
+				if (q == p + 2) {
+					return _tt_error( aTHX_ st, q, "Expected: name" );
+				}
+				_tt_push( aTHX_ st, tokens, TT_BNODE, line, col, q, _tt_string( aTHX_ p + 2, q ), NULL );
+				return TT_BNODE;
+			}
+		case '"':
+		case '\'':
+			if (end - p >= 3 && p[1] == *p && p[2] == *p) {
+				return _tt_literal( aTHX_ st, tokens, line, col, p + 3, *p, (*p == '"') ? TT_STRING3D : TT_STRING3S );
+			}
+			return _tt_literal( aTHX_ st, tokens, line, col, p + 1, *p, (*p == '"') ? TT_STRING1D : TT_STRING1S );
+		case ':':
+			return _tt_pname( aTHX_ st, tokens, line, col );
+		case '^':
+			if (end - p < 2 || p[1] != '^') {
+				return _tt_error( aTHX_ st, p, "Expected '^^'" );
+			}
+			_tt_push( aTHX_ st, tokens, TT_HATHAT, line, col, p + 2, NULL, NULL );
+			return TT_HATHAT;
+		case '+': case '-':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			return _tt_number( aTHX_ st, tokens, line, col );
+	}
+	if (type) {
+		_tt_push( aTHX_ st, tokens, type, line, col, p + 1, NULL, NULL );
+		return type;
+	}
+	
+	c	= _tt_char( aTHX_ p, end, &len );
+	if (!_tt_is_pn_chars_base(c)) {
+		return _tt_error( aTHX_ st, p, "Unexpected byte '%.*s' (0x%02" UVxf ")", (int) len, p, c );
+	}
+	if (*p == 'a' && p + 1 < end && isSPACE(p[1])) {
+		_tt_push( aTHX_ st, tokens, TT_A, line, col, p + 1, NULL, NULL );
+		return TT_A;
+	} else if ((end - p >= 4 && memEQ( p, "true", 4 ) && _tt_keyword_end( aTHX_ p + 4, end ))
+			|| (end - p >= 5 && memEQ( p, "false", 5 ) && _tt_keyword_end( aTHX_ p + 5, end ))) {
+		const char* q	= p + ((*p == 't') ? 4 : 5);
+		_tt_push( aTHX_ st, tokens, TT_BOOLEAN, line, col, q, _tt_string( aTHX_ p, q ), NULL );
+		return TT_BOOLEAN;
+	} else if (_tt_match_ci( p, end, "base", 4 ) && _tt_keyword_end( aTHX_ p + 4, end )) {
+		_tt_push( aTHX_ st, tokens, TT_SPARQLBASE, line, col, p + 4, NULL, NULL );
+		return TT_SPARQLBASE;
+	} else if (_tt_match_ci( p, end, "prefix", 6 ) && _tt_keyword_end( aTHX_ p + 6, end )) {
+		_tt_push( aTHX_ st, tokens, TT_SPARQLPREFIX, line, col, p + 6, NULL, NULL );
+		return TT_SPARQLPREFIX;
+	}
+	return _tt_pname( aTHX_ st, tokens, line, col );
+}
+
+/* Occurrence counts of nodes, used by RDF::Trine::Store::Statistics. Nodes
+ * are keyed by their 64-bit node hash (as used by RDF::Trine::Store::DBI) in
+ * an open-addressing table of parallel key and count arrays, so each distinct
+ * node costs 12 bytes of table space however long its value is. Key 0 marks
+ * an empty slot (the nil node, whose hash is 0, is counted under key 1), and
+ * removals shift later entries back instead of leaving tombstones. */
+typedef struct {
+	uint64_t* keys;
+	uint32_t* counts;
+	STRLEN size;
+	STRLEN used;
+	UV total;
+} trine_counter;
+
+#define TRINE_COUNTER_MIN	16
+
+static STRLEN
+_counter_slot (trine_counter* c, uint64_t key) {
+	STRLEN mask	= c->size - 1;
+	STRLEN i	= (STRLEN) key & mask;
+	while (c->keys[i] && c->keys[i] != key) {
+		i	= (i + 1) & mask;
+	}
+	return i;
+}
+
+static void
+_counter_resize (trine_counter* c, STRLEN size) {
+	uint64_t* keys		= c->keys;
+	uint32_t* counts	= c->counts;
+	STRLEN old			= c->size;
+	STRLEN i;
+	c->size	= size;
+	Newxz( c->keys, size, uint64_t );
+	Newxz( c->counts, size, uint32_t );
+	for (i = 0; i < old; i++) {
+		if (keys[i]) {
+			STRLEN j	= _counter_slot( c, keys[i] );
+			c->keys[j]		= keys[i];
+			c->counts[j]	= counts[i];
+		}
+	}
+	Safefree( keys );
+	Safefree( counts );
+}
+
+static uint64_t
+_counter_key (pTHX_ SV* node, int* ok) {
+	uint64_t key	= _node_hash( aTHX_ node, ok );
+	return key ? key : 1;
+}
+
+static UV
+_counter_add (trine_counter* c, uint64_t key) {
+	STRLEN i;
+	if ((c->used + 1) * 10 > c->size * 7) {
+		_counter_resize( c, c->size * 2 );
+	}
+	i	= _counter_slot( c, key );
+	if (!c->keys[i]) {
+		c->keys[i]	= key;
+		c->used++;
+	}
+	c->total++;
+	return ++c->counts[i];
+}
+
+static UV
+_counter_remove (trine_counter* c, uint64_t key) {
+	STRLEN mask	= c->size - 1;
+	STRLEN i	= _counter_slot( c, key );
+	STRLEN j;
+	if (!c->keys[i]) {
+		return 0;
+	}
+	c->total--;
+	if (--c->counts[i]) {
+		return c->counts[i];
+	}
+	c->used--;
+	j	= i;
+	while (1) {
+		STRLEN home;
+		j	= (j + 1) & mask;
+		if (!c->keys[j]) {
+			break;
+		}
+		home	= (STRLEN) c->keys[j] & mask;
+		/* move the entry at j into the hole at i unless its home slot lies
+		 * cyclically in (i, j] */
+		if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j)) {
+			c->keys[i]		= c->keys[j];
+			c->counts[i]	= c->counts[j];
+			i	= j;
+		}
+	}
+	c->keys[i]		= 0;
+	c->counts[i]	= 0;
+	return 0;
+}
+
+static trine_counter*
+_counter_sv (pTHX_ SV* self) {
+	if (!sv_isobject(self) || !sv_derived_from(self, "RDF::Trine::XS::Counter")) {
+		croak("Not an RDF::Trine::XS::Counter object");
+	}
+	return INT2PTR( trine_counter*, SvIV( SvRV(self) ) );
+}
+
+/* Computes the 16-byte MD5 fingerprint of a variable binding row into digest,
+ * returning false if a bound value is not a Resource, Blank or Literal. The
+ * digest covers the sorted names of the bound variables, each followed by the
+ * join key of its value, so rows binding the same terms to the same variables
+ * have the same fingerprint. Unbound variables are ignored. */
+static int
+_row_fingerprint (pTHX_ HV* row, unsigned char* digest) {
+	trine_md5_ctx ctx;
+	AV* names	= (AV*) sv_2mortal( (SV*) newAV() );
+	SV* key		= sv_2mortal( newSVpvn("", 0) );
+	SV* name	= sv_2mortal( newSVpvn("", 0) );
+	HE* he;
+	I32 count;
+	I32 i;
+
+	hv_iterinit( row );
+	while ((he = hv_iternext( row ))) {
+		if (SvOK(HeVAL(he))) {
+			av_push( names, newSVsv( hv_iterkeysv(he) ) );
+		}
+	}
+	count	= av_len(names) + 1;
+	if (count > 1) {
+		sortsv( AvARRAY(names), count, Perl_sv_cmp );
+	}
+	for (i = 0; i < count; i++) {
+		SV* n	= AvARRAY(names)[i];
+		he		= hv_fetch_ent( row, n, 0, 0 );
+		SvCUR_set( name, 0 );
+		_key_add_sv( aTHX_ name, n );
+		sv_catpvf( key, "%lu:", (unsigned long) SvCUR(name) );
+		sv_catpvn( key, SvPVX(name), SvCUR(name) );
+		if (he == NULL || !_join_key_add( aTHX_ key, HeVAL(he) )) {
+			return 0;
+		}
+	}
+	trine_md5_init( &ctx );
+	trine_md5_update( &ctx, (const unsigned char*) SvPVX(key), SvCUR(key) );
+	trine_md5_final( &ctx, digest );
+	return 1;
+}
+
+/* A set of 16-byte row fingerprints, used by RDF::Query::Plan::Distinct.
+ * Fingerprints are stored inline in an open-addressing table indexed by their
+ * leading bytes, so each distinct row costs 16 bytes of table space. The
+ * all-zero fingerprint marks an empty slot (and is stored as if its first
+ * byte were 1). */
+typedef struct {
+	unsigned char* keys;
+	STRLEN size;
+	STRLEN used;
+} trine_fpset;
+
+#define TRINE_FPSET_MIN	64
+
+static STRLEN
+_fpset_slot (trine_fpset* s, const unsigned char* fp) {
+	static const unsigned char empty[16]	= { 0 };
+	STRLEN mask	= s->size - 1;
+	uint64_t h;
+	STRLEN i;
+	memcpy( &h, fp, sizeof(h) );
+	i	= (STRLEN) h & mask;
+	while (memcmp( s->keys + 16 * i, empty, 16 ) && memcmp( s->keys + 16 * i, fp, 16 )) {
+		i	= (i + 1) & mask;
+	}
+	return i;
+}
+
+static void
+_fpset_resize (trine_fpset* s, STRLEN size) {
+	static const unsigned char empty[16]	= { 0 };
+	unsigned char* keys	= s->keys;
+	STRLEN old			= s->size;
+	STRLEN i;
+	s->size	= size;
+	Newxz( s->keys, 16 * size, unsigned char );
+	for (i = 0; i < old; i++) {
+		if (memcmp( keys + 16 * i, empty, 16 )) {
+			STRLEN j	= _fpset_slot( s, keys + 16 * i );
+			memcpy( s->keys + 16 * j, keys + 16 * i, 16 );
+		}
+	}
+	Safefree( keys );
+}
+
+/* Copies the fingerprint held by sv into fp. */
+static void
+_fpset_key (pTHX_ SV* sv, unsigned char* fp) {
+	static const unsigned char empty[16]	= { 0 };
+	STRLEN len;
+	const char* s	= SvPVbyte(sv, len);
+	if (len != 16) {
+		croak("Fingerprints must be 16 bytes long");
+	}
+	memcpy( fp, s, 16 );
+	if (!memcmp( fp, empty, 16 )) {
+		fp[0]	= 1;
+	}
+}
+
+static trine_fpset*
+_fpset_sv (pTHX_ SV* self) {
+	if (!sv_isobject(self) || !sv_derived_from(self, "RDF::Trine::XS::FingerprintSet")) {
+		croak("Not an RDF::Trine::XS::FingerprintSet object");
+	}
+	return INT2PTR( trine_fpset*, SvIV( SvRV(self) ) );
+}
+
+/* Adjacency snapshots of the edges matching a property path, used by
+ * RDF::Query::Plan::Path to evaluate transitive paths. Nodes are numbered
+ * from 0 in the order they are first added (keyed by their join key), and
+ * edges are collected as pairs of IDs. The first reachability query freezes
+ * the edges into compressed sparse row form (an offset array indexed by
+ * source ID into a target array); adding another edge discards it again.
+ * Searches mark visited nodes in a bitset that is cleared through the search
+ * queue afterwards, so each search costs time proportional to the part of the
+ * graph it reaches. */
+typedef struct {
+	HV* ids;
+	AV* nodes;
+	uint32_t* edges;
+	STRLEN edge_count;
+	STRLEN edge_size;
+	uint32_t node_count;
+	uint32_t* offsets;
+	uint32_t* targets;
+	uint64_t* seen;
+	uint32_t* queue;
+} trine_adjacency;
+
+#define TRINE_ADJ_SEEN(a, i)	((a)->seen[(i) >> 6] & (UINT64_C(1) << ((i) & 63)))
+#define TRINE_ADJ_MARK(a, i)	((a)->seen[(i) >> 6] |= (UINT64_C(1) << ((i) & 63)))
+#define TRINE_ADJ_CLEAR(a, i)	((a)->seen[(i) >> 6] &= ~(UINT64_C(1) << ((i) & 63)))
+
+static void
+_adjacency_thaw (trine_adjacency* a) {
+	Safefree( a->offsets );
+	Safefree( a->targets );
+	Safefree( a->seen );
+	Safefree( a->queue );
+	a->offsets	= NULL;
+	a->targets	= NULL;
+	a->seen		= NULL;
+	a->queue	= NULL;
+}
+
+static void
+_adjacency_freeze (trine_adjacency* a) {
+	uint32_t n	= a->node_count;
+	uint32_t* fill;
+	STRLEN i;
+	if (a->offsets) {
+		return;
+	}
+	Newxz( a->offsets, n + 1, uint32_t );
+	Newx( a->targets, a->edge_count ? a->edge_count : 1, uint32_t );
+	Newxz( a->seen, (n >> 6) + 1, uint64_t );
+	Newx( a->queue, n ? n : 1, uint32_t );
+	for (i = 0; i < a->edge_count; i++) {
+		a->offsets[ a->edges[2 * i] + 1 ]++;
+	}
+	for (i = 0; i < n; i++) {
+		a->offsets[i + 1]	+= a->offsets[i];
+	}
+	Newx( fill, n ? n : 1, uint32_t );
+	Copy( a->offsets, fill, n, uint32_t );
+	for (i = 0; i < a->edge_count; i++) {
+		a->targets[ fill[ a->edges[2 * i] ]++ ]	= a->edges[2 * i + 1];
+	}
+	Safefree( fill );
+}
+
+/* Returns a new SV holding the key of node in the snapshot, or NULL if node is
+ * not a Resource, Blank or Literal. */
+static SV*
+_adjacency_key (pTHX_ SV* node) {
+	SV* key	= newSVpvn("", 0);
+	if (!_join_key_add( aTHX_ key, node )) {
+		SvREFCNT_dec(key);
+		return NULL;
+	}
+	return key;
+}
+
+/* Returns the ID of node, interning it if add is true. Returns -1 if node has
+ * no key or (unless add is true) has not been added. */
+static IV
+_adjacency_id (pTHX_ trine_adjacency* a, SV* node, int add) {
+	SV* key	= _adjacency_key( aTHX_ node );
+	HE* he;
+	IV id;
+	if (key == NULL) {
+		if (add) {
+			croak("Adjacency nodes must be resources, blank nodes or literals");
+		}
+		return -1;
+	}
+	he	= hv_fetch_ent( a->ids, key, 0, 0 );
+	if (he) {
+		id	= SvIV( HeVAL(he) );
+	} else if (add) {
+		if (a->node_count == UINT32_MAX) {
+			SvREFCNT_dec(key);
+			croak("Too many nodes in adjacency snapshot");
+		}
+		id	= a->node_count++;
+		av_store( a->nodes, id, newSVsv(node) );
+		hv_store_ent( a->ids, key, newSViv(id), 0 );
+	} else {
+		id	= -1;
+	}
+	SvREFCNT_dec(key);
+	return id;
+}
+
+/* Runs a breadth-first search from start, leaving the reached nodes in the
+ * queue and returning their count. If min_length is 0 the start node is
+ * reached first; otherwise it is only reached if it lies on a cycle. */
+static uint32_t
+_adjacency_search (trine_adjacency* a, uint32_t start, int min_length) {
+	uint32_t head	= 0;
+	uint32_t tail	= 0;
+	uint32_t e;
+	if (min_length == 0) {
+		TRINE_ADJ_MARK( a, start );
+		a->queue[tail++]	= start;
+	} else {
+		for (e = a->offsets[start]; e < a->offsets[start + 1]; e++) {
+			uint32_t t	= a->targets[e];
+			if (!TRINE_ADJ_SEEN( a, t )) {
+				TRINE_ADJ_MARK( a, t );
+				a->queue[tail++]	= t;
+			}
+		}
+	}
+	while (head < tail) {
+		uint32_t u	= a->queue[head++];
+		for (e = a->offsets[u]; e < a->offsets[u + 1]; e++) {
+			uint32_t t	= a->targets[e];
+			if (!TRINE_ADJ_SEEN( a, t )) {
+				TRINE_ADJ_MARK( a, t );
+				a->queue[tail++]	= t;
+			}
+		}
+	}
+	for (head = 0; head < tail; head++) {
+		TRINE_ADJ_CLEAR( a, a->queue[head] );
+	}
+	return tail;
+}
+
+static trine_adjacency*
+_adjacency_sv (pTHX_ SV* self) {
+	if (!sv_isobject(self) || !sv_derived_from(self, "RDF::Trine::XS::Adjacency")) {
+		croak("Not an RDF::Trine::XS::Adjacency object");
+	}
+	return INT2PTR( trine_adjacency*, SvIV( SvRV(self) ) );
+}
+
+#ifdef TRINE_MMAP
+/* Memory-mapped files are exposed as read-only scalars whose string buffer
+ * points directly at the mapping. The mapping is one byte longer than the
+ * file so that the buffer is NUL-terminated like any other PV. It is
+ * released by this magic when the scalar is freed. */
+typedef struct {
+	void* addr;
+	size_t len;
+} trine_mapping;
+
+static int
+_mapping_free (pTHX_ SV* sv, MAGIC* mg) {
+	trine_mapping* m	= (trine_mapping*) mg->mg_ptr;
+	if (m) {
+		if (m->len) {
+			munmap( m->addr, m->len + 1 );
+		}
+		Safefree(m);
+		mg->mg_ptr	= NULL;
+	}
+	SvPV_set(sv, NULL);
+	SvCUR_set(sv, 0);
+	SvOK_off(sv);
+	return 0;
+}
+
+static MGVTBL trine_mapping_vtbl	= { NULL, NULL, NULL, NULL, _mapping_free, NULL, NULL, NULL };
+#endif
+
 MODULE = RDF::Trine::XS        PACKAGE = RDF::Trine::XS
 
+SV*
+hash (...)
+	PREINIT:
+		trine_md5_ctx ctx;
+		uint64_t j;
+		I32 i	= 0;
+	CODE:
+		/* the value may follow an object when called as a method */
+		if (items > 1 && SvROK(ST(0))) {
+			i++;
+		}
+		if (i >= items) {
+			croak("Usage: RDF::Trine::XS::hash( $value [, $mask] )");
+		}
+		trine_md5_init( &ctx );
+		_md5_add_sv( aTHX_ &ctx, ST(i) );
+		j	= trine_md5_final64( &ctx );
+		if (i + 1 < items && SvTRUE(ST(i + 1))) {
+			j	&= UINT64_C(0x7fffffffffffffff);
+		}
+		RETVAL	= _hash_value_sv( aTHX_ j );
+	OUTPUT:
+		RETVAL
+
 SV*
 _hash (value)
 	unsigned char* value
 	CODE:
 		uint64_t j	= 0;
 		int k		= 0;
-		char hash[21];
 		
 		for (k = 0; k < 8; k++) {
 			uint64_t l	= value[ k ];
 			j	+= (l << (8 * k));
 		}
 		
-		sprintf( hash, "%llu", j );
-		RETVAL	= newSVpv(hash, 0);
+		RETVAL	= _hash_value_sv( aTHX_ j );
+	OUTPUT:
+		RETVAL
+
+void
+hash_nodes (nodes, ...)
+	SV* nodes
+	PREINIT:
+		AV* av;
+		I32 count;
+		I32 i;
+		int mask	= 0;
+	PPCODE:
+		if (!SvROK(nodes) || SvTYPE(SvRV(nodes)) != SVt_PVAV) {
+			croak("hash_nodes requires an ARRAY reference of nodes");
+		}
+		if (items > 1) {
+			mask	= SvTRUE(ST(1));
+		}
+		av		= (AV*) SvRV(nodes);
+		count	= av_len(av) + 1;
+		EXTEND(SP, count);
+		for (i = 0; i < count; i++) {
+			PUSHs( _node_hash_sv( aTHX_ _av_slot( aTHX_ av, i ), mask ) );
+		}
+
+void
+hash_statement (st, ...)
+	SV* st
+	PREINIT:
+		AV* av;
+		I32 count;
+		I32 i;
+		int mask	= 0;
+	PPCODE:
+		if (!sv_isobject(st) || !sv_derived_from(st, "RDF::Trine::Statement") || SvTYPE(SvRV(st)) != SVt_PVAV) {
+			croak("hash_statement requires an RDF::Trine::Statement object");
+		}
+		if (items > 1) {
+			mask	= SvTRUE(ST(1));
+		}
+		av		= (AV*) SvRV(st);
+		count	= sv_derived_from(st, "RDF::Trine::Statement::Quad") ? 4 : 3;
+		EXTEND(SP, count);
+		for (i = 0; i < count; i++) {
+			PUSHs( _node_hash_sv( aTHX_ _av_slot( aTHX_ av, i ), mask ) );
+		}
+
+SV*
+node_key (node)
+	SV* node
+	CODE:
+		RETVAL	= _node_key( aTHX_ node );
+		if (RETVAL == NULL) {
+			XSRETURN_UNDEF;
+		}
+	OUTPUT:
+		RETVAL
+
+SV*
+join_key (row, vars)
+	HV* row
+	AV* vars
+	PREINIT:
+		I32 count;
+		I32 i;
+	CODE:
+		count	= av_len(vars) + 1;
+		RETVAL	= newSVpvn("", 0);
+		for (i = 0; i < count; i++) {
+			SV* name	= _av_slot( aTHX_ vars, i );
+			HE* he		= name ? hv_fetch_ent( row, name, 0, 0 ) : NULL;
+			if (he == NULL || !SvOK(HeVAL(he)) || !_join_key_add( aTHX_ RETVAL, HeVAL(he) )) {
+				SvREFCNT_dec(RETVAL);
+				XSRETURN_UNDEF;
+			}
+		}
+	OUTPUT:
+		RETVAL
+
+SV*
+row_fingerprint (row)
+	HV* row
+	PREINIT:
+		unsigned char digest[16];
+	CODE:
+		if (!_row_fingerprint( aTHX_ row, digest )) {
+			XSRETURN_UNDEF;
+		}
+		RETVAL	= newSVpvn( (const char*) digest, 16 );
+	OUTPUT:
+		RETVAL
+
+SV*
+compare_nodes (a, b)
+	SV* a
+	SV* b
+	PREINIT:
+		int ra;
+		int rb;
+	CODE:
+		if (!sv_isobject(a)) {
+			RETVAL	= newSViv(-1);
+		} else if (!sv_isobject(b)) {
+			RETVAL	= newSViv(1);
+		} else if (SvRV(a) == SvRV(b)) {
+			RETVAL	= newSViv(0);
+		} else {
+			ra	= _node_rank( aTHX_ a );
+			rb	= _node_rank( aTHX_ b );
+			if (ra < 0 || rb < 0) {
+				XSRETURN_UNDEF;
+			}
+			RETVAL	= newSViv( (ra != rb) ? ((ra < rb) ? -1 : 1) : _node_cmp( aTHX_ a, b, ra ) );
+		}
+	OUTPUT:
+		RETVAL
+
+int
+topk_insert (heap, k, record)
+	AV* heap
+	IV k
+	SV* record
+	PREINIT:
+		SSize_t n;
+	CODE:
+		if (!SvROK(record) || SvTYPE(SvRV(record)) != SVt_PVAV) {
+			croak("topk_insert: record is not an ARRAY reference");
+		}
+		if (SvRMAGICAL((SV*) heap) || !AvREAL(heap)) {
+			croak("topk_insert: heap must be a plain array");
+		}
+		RETVAL	= 0;
+		n		= av_len( heap ) + 1;
+		if (k > 0 && n < k) {
+			av_push( heap, newSVsv(record) );
+			_topk_sift_up( aTHX_ AvARRAY(heap), n );
+			RETVAL	= 1;
+		} else if (k > 0 && n > 0 && sv_cmp( _topk_key( aTHX_ record ), _topk_key( aTHX_ AvARRAY(heap)[0] ) ) < 0) {
+			SvREFCNT_dec( AvARRAY(heap)[0] );
+			AvARRAY(heap)[0]	= newSVsv(record);
+			_topk_sift_down( aTHX_ AvARRAY(heap), n, 0 );
+			RETVAL	= 1;
+		}
+	OUTPUT:
+		RETVAL
+
+SV*
+intern_node (keys, nodes, ids, node)
+	HV* keys
+	AV* nodes
+	HV* ids
+	SV* node
+	CODE:
+		RETVAL	= _intern_node( aTHX_ keys, nodes, ids, node );
+	OUTPUT:
+		RETVAL
+
+int
+id_page_contains (page, id)
+	SV* page
+	UV id
+	PREINIT:
+		STRLEN len;
+		const unsigned char* p;
+	CODE:
+		p		= (const unsigned char*) SvPV_const(page, len);
+		RETVAL	= (_id_page_search( p, len / 4, (uint32_t) id ) >= 0) ? 1 : 0;
+	OUTPUT:
+		RETVAL
+
+IV
+id_page_search (page, id)
+	SV* page
+	UV id
+	PREINIT:
+		STRLEN len;
+		const unsigned char* p;
+	CODE:
+		p		= (const unsigned char*) SvPV_const(page, len);
+		RETVAL	= _id_page_search( p, len / 4, (uint32_t) id );
+	OUTPUT:
+		RETVAL
+
+int
+id_page_insert (pageref, id)
+	SV* pageref
+	UV id
+	PREINIT:
+		SV* page;
+		STRLEN len;
+		IV pos;
+		unsigned char* p;
+	CODE:
+		if (!SvROK(pageref)) {
+			croak("id_page_insert requires a SCALAR reference");
+		}
+		page	= SvRV(pageref);
+		if (!SvOK(page)) {
+			sv_setpvn(page, "", 0);
+		}
+		p		= (unsigned char*) SvPV_force(page, len);
+		pos		= _id_page_search( p, len / 4, (uint32_t) id );
+		if (pos >= 0) {
+			RETVAL	= 0;
+		} else {
+			pos		= -(pos + 1);
+			p		= (unsigned char*) SvGROW(page, len + 5);
+			Move( p + (pos * 4), p + (pos * 4) + 4, len - (pos * 4), unsigned char );
+			_id_page_store( p + (pos * 4), (uint32_t) id );
+			SvCUR_set(page, len + 4);
+			*SvEND(page)	= '\0';
+			RETVAL	= 1;
+		}
+	OUTPUT:
+		RETVAL
+
+int
+id_page_remove (pageref, id)
+	SV* pageref
+	UV id
+	PREINIT:
+		SV* page;
+		STRLEN len;
+		IV pos;
+		unsigned char* p;
+	CODE:
+		if (!SvROK(pageref)) {
+			croak("id_page_remove requires a SCALAR reference");
+		}
+		page	= SvRV(pageref);
+		if (!SvOK(page)) {
+			XSRETURN_IV(0);
+		}
+		p		= (unsigned char*) SvPV_force(page, len);
+		pos		= _id_page_search( p, len / 4, (uint32_t) id );
+		if (pos < 0) {
+			RETVAL	= 0;
+		} else {
+			Move( p + (pos * 4) + 4, p + (pos * 4), len - (pos * 4) - 4, unsigned char );
+			SvCUR_set(page, len - 4);
+			*SvEND(page)	= '\0';
+			RETVAL	= 1;
+		}
+	OUTPUT:
+		RETVAL
+
+SV*
+id_page_intersect (...)
+	PREINIT:
+		const unsigned char** pages;
+		STRLEN* counts;
+		STRLEN* cursors;
+		unsigned char* out;
+		STRLEN outlen	= 0;
+		STRLEN i;
+		I32 k;
+	CODE:
+		if (items == 0) {
+			XSRETURN_PV("");
+		}
+		Newx(pages, items, const unsigned char*);
+		Newx(counts, items, STRLEN);
+		Newxz(cursors, items, STRLEN);
+		for (k = 0; k < items; k++) {
+			STRLEN len;
+			pages[k]	= (const unsigned char*) SvPV_const(ST(k), len);
+			counts[k]	= len / 4;
+		}
+		/* move the smallest page to the front; its IDs drive the search */
+		for (k = 1; k < items; k++) {
+			if (counts[k] < counts[0]) {
+				const unsigned char* p	= pages[0];
+				STRLEN c	= counts[0];
+				pages[0]	= pages[k];
+				counts[0]	= counts[k];
+				pages[k]	= p;
+				counts[k]	= c;
+			}
+		}
+		RETVAL	= newSV( counts[0] * 4 + 1 );
+		SvPOK_on(RETVAL);
+		out		= (unsigned char*) SvPVX(RETVAL);
+		for (i = 0; i < counts[0]; i++) {
+			uint32_t id	= _id_page_load( pages[0] + (i * 4) );
+			int found	= 1;
+			for (k = 1; k < items; k++) {
+				STRLEN pos	= _id_page_gallop( pages[k], counts[k], cursors[k], id );
+				cursors[k]	= pos;
+				if (pos >= counts[k]) {
+					found	= 0;
+					i		= counts[0];
+					break;
+				}
+				if (_id_page_load( pages[k] + (pos * 4) ) != id) {
+					found	= 0;
+					break;
+				}
+			}
+			if (found) {
+				_id_page_store( out + outlen, id );
+				outlen	+= 4;
+			}
+		}
+		SvCUR_set(RETVAL, outlen);
+		*SvEND(RETVAL)	= '\0';
+		Safefree(pages);
+		Safefree(counts);
+		Safefree(cursors);
+	OUTPUT:
+		RETVAL
+
+SV*
+mmap_file (filename)
+	const char* filename
+	PREINIT:
+#ifdef TRINE_MMAP
+		int fd;
+		struct stat st;
+		trine_mapping* m;
+		SV* sv;
+#endif
+	CODE:
+#ifdef TRINE_MMAP
+		fd	= open( filename, O_RDONLY );
+		if (fd < 0) {
+			croak("Cannot open %s: %s", filename, strerror(errno));
+		}
+		if (fstat( fd, &st ) < 0) {
+			close(fd);
+			croak("Cannot stat %s: %s", filename, strerror(errno));
+		}
+		Newxz(m, 1, trine_mapping);
+		m->len	= (size_t) st.st_size;
+		if (m->len) {
+			/* Reserve len + 1 zero bytes and map the file over the start of
+			 * the reservation. The byte after the file is then always mapped
+			 * and zero, even when the file ends on a page boundary. */
+			m->addr	= mmap( NULL, m->len + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+			if (m->addr == MAP_FAILED) {
+				close(fd);
+				Safefree(m);
+				croak("Cannot mmap %s: %s", filename, strerror(errno));
+			}
+			if (mmap( m->addr, m->len, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0 ) == MAP_FAILED) {
+				int err	= errno;
+				munmap( m->addr, m->len + 1 );
+				close(fd);
+				Safefree(m);
+				croak("Cannot mmap %s: %s", filename, strerror(err));
+			}
+		} else {
+			m->addr	= (void*) "";
+		}
+		close(fd);
+		
+		sv	= newSV_type(SVt_PVMG);
+		SvPV_set(sv, (char*) m->addr);
+		SvCUR_set(sv, m->len);
+		SvLEN_set(sv, 0);
+		SvPOK_only(sv);
+		sv_magicext(sv, NULL, PERL_MAGIC_ext, &trine_mapping_vtbl, (const char*) m, 0);
+		SvREADONLY_on(sv);
+		RETVAL	= newRV_noinc(sv);
+#else
+		croak("mmap is not supported on this platform");
+#endif
+	OUTPUT:
+		RETVAL
+
+IV
+parse_ntriples_chunk (buffer, lineno, quads, statements)
+	SV* buffer
+	IV lineno
+	int quads
+	AV* statements
+	PREINIT:
+		trine_nt_state st;
+		STRLEN len;
+		const char* p;
+		const char* end;
+	CODE:
+		p		= SvPVutf8(buffer, len);
+		end		= p + len;
+		st.resource		= gv_stashpv( "RDF::Trine::Node::Resource", GV_ADD );
+		st.blank		= gv_stashpv( "RDF::Trine::Node::Blank", GV_ADD );
+		st.literal		= gv_stashpv( "RDF::Trine::Node::Literal", GV_ADD );
+		st.triple		= gv_stashpv( "RDF::Trine::Statement", GV_ADD );
+		st.quad			= gv_stashpv( "RDF::Trine::Statement::Quad", GV_ADD );
+		st.xml_literals	= SvTRUE( get_sv( "RDF::Trine::Node::Literal::USE_XMLLITERALS", GV_ADD ) );
+		st.formulae		= SvTRUE( get_sv( "RDF::Trine::Node::Literal::USE_FORMULAE", GV_ADD ) );
+		st.intern		= SvTRUE( get_sv( "RDF::Trine::TermTable::ENABLED", GV_ADD ) );
+		st.keys			= get_hv( "RDF::Trine::TermTable::KEYS", GV_ADD );
+		st.nodes		= get_av( "RDF::Trine::TermTable::NODES", GV_ADD );
+		st.ids			= get_hv( "RDF::Trine::TermTable::IDS", GV_ADD );
+		while (p < end) {
+			/* a line ends at the first \n, or at an earlier \r */
+			const char* nl	= (const char*) memchr( p, '\n', end - p );
+			const char* cr	= (const char*) memchr( p, '\r', (nl ? nl : end) - p );
+			const char* eol	= cr ? cr : (nl ? nl : end);
+			const char* next;
+			if (cr) {
+				next	= (cr + 1 < end && cr[1] == '\n') ? cr + 2 : cr + 1;
+			} else {
+				next	= nl ? nl + 1 : end;
+			}
+			lineno++;
+			while (p < eol && _nt_is_space(*p)) {
+				p++;
+			}
+			while (eol > p && _nt_is_space(eol[-1])) {
+				eol--;
+			}
+			if (p < eol && *p != '#') {
+				ENTER;
+				SAVETMPS;
+				_nt_parse_line( aTHX_ &st, p, eol, lineno, quads, statements );
+				FREETMPS;
+				LEAVE;
+			}
+			p	= next;
+		}
+		RETVAL	= lineno;
+	OUTPUT:
+		RETVAL
+
+void
+scan_turtle_tokens (buffer, line, column, eof, tokens)
+	SV* buffer
+	IV line
+	IV column
+	int eof
+	AV* tokens
+	PREINIT:
+		trine_tt_state st;
+		STRLEN len;
+	PPCODE:
+		st.p		= SvPVutf8(buffer, len);
+		st.end		= st.p + len;
+		st.line		= line;
+		st.col		= column;
+		st.eof		= eof;
+		st.stash	= gv_stashpv( "RDF::Trine::Parser::Turtle::Token", GV_ADD );
+		st.error	= NULL;
+		while (st.p < st.end) {
+			int r	= _tt_token( aTHX_ &st, tokens );
+			if (r == TT_MORE || r == TT_ERROR) {
+				break;
+			}
+		}
+		sv_chop( buffer, st.p );
+		EXTEND(SP, 3);
+		mPUSHi(st.line);
+		mPUSHi(st.col);
+		PUSHs( st.error ? sv_2mortal(st.error) : &PL_sv_undef );
+
+
+MODULE = RDF::Trine::XS        PACKAGE = RDF::Trine::XS::Counter
+
+SV*
+new (class)
+	const char* class
+	PREINIT:
+		trine_counter* c;
+	CODE:
+		Newxz( c, 1, trine_counter );
+		c->size	= TRINE_COUNTER_MIN;
+		Newxz( c->keys, c->size, uint64_t );
+		Newxz( c->counts, c->size, uint32_t );
+		RETVAL	= newSV(0);
+		sv_setref_pv( RETVAL, class, (void*) c );
+	OUTPUT:
+		RETVAL
+
+SV*
+add (self, node)
+	SV* self
+	SV* node
+	PREINIT:
+		trine_counter* c;
+		uint64_t key;
+		int ok;
+	CODE:
+		c	= _counter_sv( aTHX_ self );
+		key	= _counter_key( aTHX_ node, &ok );
+		RETVAL	= ok ? newSVuv( _counter_add( c, key ) ) : newSV(0);
+	OUTPUT:
+		RETVAL
+
+SV*
+remove (self, node)
+	SV* self
+	SV* node
+	PREINIT:
+		trine_counter* c;
+		uint64_t key;
+		int ok;
+	CODE:
+		c	= _counter_sv( aTHX_ self );
+		key	= _counter_key( aTHX_ node, &ok );
+		RETVAL	= ok ? newSVuv( _counter_remove( c, key ) ) : newSV(0);
+	OUTPUT:
+		RETVAL
+
+UV
+count (self, node)
+	SV* self
+	SV* node
+	PREINIT:
+		trine_counter* c;
+		uint64_t key;
+		STRLEN i;
+		int ok;
+	CODE:
+		c	= _counter_sv( aTHX_ self );
+		key	= _counter_key( aTHX_ node, &ok );
+		RETVAL	= 0;
+		if (ok) {
+			i	= _counter_slot( c, key );
+			RETVAL	= c->keys[i] ? c->counts[i] : 0;
+		}
+	OUTPUT:
+		RETVAL
+
+UV
+distinct (self)
+	SV* self
+	CODE:
+		RETVAL	= (UV) _counter_sv( aTHX_ self )->used;
+	OUTPUT:
+		RETVAL
+
+UV
+total (self)
+	SV* self
+	CODE:
+		RETVAL	= _counter_sv( aTHX_ self )->total;
+	OUTPUT:
+		RETVAL
+
+void
+DESTROY (self)
+	SV* self
+	PREINIT:
+		trine_counter* c;
+	CODE:
+		c	= _counter_sv( aTHX_ self );
+		Safefree( c->keys );
+		Safefree( c->counts );
+		Safefree( c );
+
+
+MODULE = RDF::Trine::XS        PACKAGE = RDF::Trine::XS::FingerprintSet
+
+SV*
+new (class)
+	const char* class
+	PREINIT:
+		trine_fpset* s;
+	CODE:
+		Newxz( s, 1, trine_fpset );
+		s->size	= TRINE_FPSET_MIN;
+		Newxz( s->keys, 16 * s->size, unsigned char );
+		RETVAL	= newSV(0);
+		sv_setref_pv( RETVAL, class, (void*) s );
+	OUTPUT:
+		RETVAL
+
+bool
+insert (self, fingerprint)
+	SV* self
+	SV* fingerprint
+	PREINIT:
+		static const unsigned char empty[16]	= { 0 };
+		trine_fpset* s;
+		unsigned char fp[16];
+		STRLEN i;
+	CODE:
+		s	= _fpset_sv( aTHX_ self );
+		_fpset_key( aTHX_ fingerprint, fp );
+		if ((s->used + 1) * 10 > s->size * 7) {
+			_fpset_resize( s, s->size * 2 );
+		}
+		i		= _fpset_slot( s, fp );
+		RETVAL	= memcmp( s->keys + 16 * i, empty, 16 ) ? 0 : 1;
+		if (RETVAL) {
+			memcpy( s->keys + 16 * i, fp, 16 );
+			s->used++;
+		}
+	OUTPUT:
+		RETVAL
+
+bool
+contains (self, fingerprint)
+	SV* self
+	SV* fingerprint
+	PREINIT:
+		static const unsigned char empty[16]	= { 0 };
+		trine_fpset* s;
+		unsigned char fp[16];
+	CODE:
+		s	= _fpset_sv( aTHX_ self );
+		_fpset_key( aTHX_ fingerprint, fp );
+		RETVAL	= memcmp( s->keys + 16 * _fpset_slot( s, fp ), empty, 16 ) ? 1 : 0;
+	OUTPUT:
+		RETVAL
+
+UV
+size (self)
+	SV* self
+	CODE:
+		RETVAL	= (UV) _fpset_sv( aTHX_ self )->used;
+	OUTPUT:
+		RETVAL
+
+UV
+bytes (self)
+	SV* self
+	CODE:
+		RETVAL	= (UV) (16 * _fpset_sv( aTHX_ self )->size);
+	OUTPUT:
+		RETVAL
+
+void
+DESTROY (self)
+	SV* self
+	PREINIT:
+		trine_fpset* s;
+	CODE:
+		s	= _fpset_sv( aTHX_ self );
+		Safefree( s->keys );
+		Safefree( s );
+
+
+MODULE = RDF::Trine::XS        PACKAGE = RDF::Trine::XS::Adjacency
+
+SV*
+new (class)
+	const char* class
+	PREINIT:
+		trine_adjacency* a;
+	CODE:
+		Newxz( a, 1, trine_adjacency );
+		a->ids		= newHV();
+		a->nodes	= newAV();
+		RETVAL	= newSV(0);
+		sv_setref_pv( RETVAL, class, (void*) a );
+	OUTPUT:
+		RETVAL
+
+void
+add_edge (self, from, to)
+	SV* self
+	SV* from
+	SV* to
+	PREINIT:
+		trine_adjacency* a;
+		IV f;
+		IV t;
+	CODE:
+		a	= _adjacency_sv( aTHX_ self );
+		f	= _adjacency_id( aTHX_ a, from, 1 );
+		t	= _adjacency_id( aTHX_ a, to, 1 );
+		_adjacency_thaw( a );
+		if (a->edge_count == a->edge_size) {
+			a->edge_size	= a->edge_size ? 2 * a->edge_size : 64;
+			Renew( a->edges, 2 * a->edge_size, uint32_t );
+		}
+		a->edges[2 * a->edge_count]		= (uint32_t) f;
+		a->edges[2 * a->edge_count + 1]	= (uint32_t) t;
+		a->edge_count++;
+
+SV*
+id (self, node)
+	SV* self
+	SV* node
+	PREINIT:
+		IV id;
+	CODE:
+		id	= _adjacency_id( aTHX_ _adjacency_sv( aTHX_ self ), node, 0 );
+		if (id < 0) {
+			XSRETURN_UNDEF;
+		}
+		RETVAL	= newSViv(id);
+	OUTPUT:
+		RETVAL
+
+SV*
+node (self, id)
+	SV* self
+	UV id
+	PREINIT:
+		SV** svp;
+	CODE:
+		svp	= av_fetch( _adjacency_sv( aTHX_ self )->nodes, id, 0 );
+		if (svp == NULL) {
+			XSRETURN_UNDEF;
+		}
+		RETVAL	= newSVsv(*svp);
+	OUTPUT:
+		RETVAL
+
+SV*
+reachable (self, id, min_length)
+	SV* self
+	UV id
+	int min_length
+	PREINIT:
+		trine_adjacency* a;
+		uint32_t count;
+		uint32_t i;
+		unsigned char* p;
+	CODE:
+		a	= _adjacency_sv( aTHX_ self );
+		if (id >= a->node_count) {
+			croak("Node ID %" UVuf " is not in the adjacency snapshot", id);
+		}
+		_adjacency_freeze( a );
+		count	= _adjacency_search( a, (uint32_t) id, min_length );
+		RETVAL	= newSV( 4 * (STRLEN) count + 1 );
+		SvPOK_on(RETVAL);
+		p		= (unsigned char*) SvPVX(RETVAL);
+		for (i = 0; i < count; i++) {
+			_id_page_store( p + 4 * i, a->queue[i] );
+		}
+		SvCUR_set( RETVAL, 4 * (STRLEN) count );
+		*SvEND(RETVAL)	= '\0';
 	OUTPUT:
 		RETVAL
+
+UV
+nodes (self)
+	SV* self
+	CODE:
+		RETVAL	= (UV) _adjacency_sv( aTHX_ self )->node_count;
+	OUTPUT:
+		RETVAL
+
+UV
+edges (self)
+	SV* self
+	CODE:
+		RETVAL	= (UV) _adjacency_sv( aTHX_ self )->edge_count;
+	OUTPUT:
+		RETVAL
+
+void
+DESTROY (self)
+	SV* self
+	PREINIT:
+		trine_adjacency* a;
+	CODE:
+		a	= _adjacency_sv( aTHX_ self );
+		_adjacency_thaw( a );
+		SvREFCNT_dec( (SV*) a->ids );
+		SvREFCNT_dec( (SV*) a->nodes );
+		Safefree( a->edges );
+		Safefree( a );
@@ -0,0 +1,199 @@
+/*
+ * Minimal MD5 message-digest implementation (RFC 1321) used by
+ * RDF::Trine::XS to compute node hashes without calling back into
+ * Digest::MD5. Written from the RFC description; no alignment or
+ * endianness assumptions are made about the input buffer.
+ */
+
+#ifndef RDF_TRINE_XS_MD5_H
+#define RDF_TRINE_XS_MD5_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+	uint32_t a, b, c, d;
+	uint64_t length;
+	unsigned char buffer[64];
+} trine_md5_ctx;
+
+#define TRINE_MD5_F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define TRINE_MD5_G(x, y, z)	((y) ^ ((z) & ((x) ^ (y))))
+#define TRINE_MD5_H(x, y, z)	((x) ^ (y) ^ (z))
+#define TRINE_MD5_I(x, y, z)	((y) ^ ((x) | ~(z)))
+
+#define TRINE_MD5_STEP(f, a, b, c, d, x, t, s) \
+	(a) += f((b), (c), (d)) + (x) + (t); \
+	(a) = (((a) << (s)) | (((a) & 0xffffffff) >> (32 - (s)))); \
+	(a) += (b);
+
+static void
+trine_md5_block (trine_md5_ctx* ctx, const unsigned char* p) {
+	uint32_t a	= ctx->a;
+	uint32_t b	= ctx->b;
+	uint32_t c	= ctx->c;
+	uint32_t d	= ctx->d;
+	uint32_t x[16];
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		x[i]	= (uint32_t) p[i*4]
+				| ((uint32_t) p[i*4+1] << 8)
+				| ((uint32_t) p[i*4+2] << 16)
+				| ((uint32_t) p[i*4+3] << 24);
+	}
+
+	TRINE_MD5_STEP(TRINE_MD5_F, a, b, c, d, x[ 0], 0xd76aa478,  7)
+	TRINE_MD5_STEP(TRINE_MD5_F, d, a, b, c, x[ 1], 0xe8c7b756, 12)
+	TRINE_MD5_STEP(TRINE_MD5_F, c, d, a, b, x[ 2], 0x242070db, 17)
+	TRINE_MD5_STEP(TRINE_MD5_F, b, c, d, a, x[ 3], 0xc1bdceee, 22)
+	TRINE_MD5_STEP(TRINE_MD5_F, a, b, c, d, x[ 4], 0xf57c0faf,  7)
+	TRINE_MD5_STEP(TRINE_MD5_F, d, a, b, c, x[ 5], 0x4787c62a, 12)
+	TRINE_MD5_STEP(TRINE_MD5_F, c, d, a, b, x[ 6], 0xa8304613, 17)
+	TRINE_MD5_STEP(TRINE_MD5_F, b, c, d, a, x[ 7], 0xfd469501, 22)
+	TRINE_MD5_STEP(TRINE_MD5_F, a, b, c, d, x[ 8], 0x698098d8,  7)
+	TRINE_MD5_STEP(TRINE_MD5_F, d, a, b, c, x[ 9], 0x8b44f7af, 12)
+	TRINE_MD5_STEP(TRINE_MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17)
+	TRINE_MD5_STEP(TRINE_MD5_F, b, c, d, a, x[11], 0x895cd7be, 22)
+	TRINE_MD5_STEP(TRINE_MD5_F, a, b, c, d, x[12], 0x6b901122,  7)
+	TRINE_MD5_STEP(TRINE_MD5_F, d, a, b, c, x[13], 0xfd987193, 12)
+	TRINE_MD5_STEP(TRINE_MD5_F, c, d, a, b, x[14], 0xa679438e, 17)
+	TRINE_MD5_STEP(TRINE_MD5_F, b, c, d, a, x[15], 0x49b40821, 22)
+
+	TRINE_MD5_STEP(TRINE_MD5_G, a, b, c, d, x[ 1], 0xf61e2562,  5)
+	TRINE_MD5_STEP(TRINE_MD5_G, d, a, b, c, x[ 6], 0xc040b340,  9)
+	TRINE_MD5_STEP(TRINE_MD5_G, c, d, a, b, x[11], 0x265e5a51, 14)
+	TRINE_MD5_STEP(TRINE_MD5_G, b, c, d, a, x[ 0], 0xe9b6c7aa, 20)
+	TRINE_MD5_STEP(TRINE_MD5_G, a, b, c, d, x[ 5], 0xd62f105d,  5)
+	TRINE_MD5_STEP(TRINE_MD5_G, d, a, b, c, x[10], 0x02441453,  9)
+	TRINE_MD5_STEP(TRINE_MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14)
+	TRINE_MD5_STEP(TRINE_MD5_G, b, c, d, a, x[ 4], 0xe7d3fbc8, 20)
+	TRINE_MD5_STEP(TRINE_MD5_G, a, b, c, d, x[ 9], 0x21e1cde6,  5)
+	TRINE_MD5_STEP(TRINE_MD5_G, d, a, b, c, x[14], 0xc33707d6,  9)
+	TRINE_MD5_STEP(TRINE_MD5_G, c, d, a, b, x[ 3], 0xf4d50d87, 14)
+	TRINE_MD5_STEP(TRINE_MD5_G, b, c, d, a, x[ 8], 0x455a14ed, 20)
+	TRINE_MD5_STEP(TRINE_MD5_G, a, b, c, d, x[13], 0xa9e3e905,  5)
+	TRINE_MD5_STEP(TRINE_MD5_G, d, a, b, c, x[ 2], 0xfcefa3f8,  9)
+	TRINE_MD5_STEP(TRINE_MD5_G, c, d, a, b, x[ 7], 0x676f02d9, 14)
+	TRINE_MD5_STEP(TRINE_MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20)
+
+	TRINE_MD5_STEP(TRINE_MD5_H, a, b, c, d, x[ 5], 0xfffa3942,  4)
+	TRINE_MD5_STEP(TRINE_MD5_H, d, a, b, c, x[ 8], 0x8771f681, 11)
+	TRINE_MD5_STEP(TRINE_MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16)
+	TRINE_MD5_STEP(TRINE_MD5_H, b, c, d, a, x[14], 0xfde5380c, 23)
+	TRINE_MD5_STEP(TRINE_MD5_H, a, b, c, d, x[ 1], 0xa4beea44,  4)
+	TRINE_MD5_STEP(TRINE_MD5_H, d, a, b, c, x[ 4], 0x4bdecfa9, 11)
+	TRINE_MD5_STEP(TRINE_MD5_H, c, d, a, b, x[ 7], 0xf6bb4b60, 16)
+	TRINE_MD5_STEP(TRINE_MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23)
+	TRINE_MD5_STEP(TRINE_MD5_H, a, b, c, d, x[13], 0x289b7ec6,  4)
+	TRINE_MD5_STEP(TRINE_MD5_H, d, a, b, c, x[ 0], 0xeaa127fa, 11)
+	TRINE_MD5_STEP(TRINE_MD5_H, c, d, a, b, x[ 3], 0xd4ef3085, 16)
+	TRINE_MD5_STEP(TRINE_MD5_H, b, c, d, a, x[ 6], 0x04881d05, 23)
+	TRINE_MD5_STEP(TRINE_MD5_H, a, b, c, d, x[ 9], 0xd9d4d039,  4)
+	TRINE_MD5_STEP(TRINE_MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11)
+	TRINE_MD5_STEP(TRINE_MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16)
+	TRINE_MD5_STEP(TRINE_MD5_H, b, c, d, a, x[ 2], 0xc4ac5665, 23)
+
+	TRINE_MD5_STEP(TRINE_MD5_I, a, b, c, d, x[ 0], 0xf4292244,  6)
+	TRINE_MD5_STEP(TRINE_MD5_I, d, a, b, c, x[ 7], 0x432aff97, 10)
+	TRINE_MD5_STEP(TRINE_MD5_I, c, d, a, b, x[14], 0xab9423a7, 15)
+	TRINE_MD5_STEP(TRINE_MD5_I, b, c, d, a, x[ 5], 0xfc93a039, 21)
+	TRINE_MD5_STEP(TRINE_MD5_I, a, b, c, d, x[12], 0x655b59c3,  6)
+	TRINE_MD5_STEP(TRINE_MD5_I, d, a, b, c, x[ 3], 0x8f0ccc92, 10)
+	TRINE_MD5_STEP(TRINE_MD5_I, c, d, a, b, x[10], 0xffeff47d, 15)
+	TRINE_MD5_STEP(TRINE_MD5_I, b, c, d, a, x[ 1], 0x85845dd1, 21)
+	TRINE_MD5_STEP(TRINE_MD5_I, a, b, c, d, x[ 8], 0x6fa87e4f,  6)
+	TRINE_MD5_STEP(TRINE_MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10)
+	TRINE_MD5_STEP(TRINE_MD5_I, c, d, a, b, x[ 6], 0xa3014314, 15)
+	TRINE_MD5_STEP(TRINE_MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21)
+	TRINE_MD5_STEP(TRINE_MD5_I, a, b, c, d, x[ 4], 0xf7537e82,  6)
+	TRINE_MD5_STEP(TRINE_MD5_I, d, a, b, c, x[11], 0xbd3af235, 10)
+	TRINE_MD5_STEP(TRINE_MD5_I, c, d, a, b, x[ 2], 0x2ad7d2bb, 15)
+	TRINE_MD5_STEP(TRINE_MD5_I, b, c, d, a, x[ 9], 0xeb86d391, 21)
+
+	ctx->a	+= a;
+	ctx->b	+= b;
+	ctx->c	+= c;
+	ctx->d	+= d;
+}
+
+static void
+trine_md5_init (trine_md5_ctx* ctx) {
+	ctx->a		= 0x67452301;
+	ctx->b		= 0xefcdab89;
+	ctx->c		= 0x98badcfe;
+	ctx->d		= 0x10325476;
+	ctx->length	= 0;
+}
+
+static void
+trine_md5_update (trine_md5_ctx* ctx, const unsigned char* data, size_t len) {
+	size_t used	= (size_t) (ctx->length & 0x3f);
+	ctx->length	+= len;
+
+	if (used) {
+		size_t avail	= 64 - used;
+		if (len < avail) {
+			memcpy( ctx->buffer + used, data, len );
+			return;
+		}
+		memcpy( ctx->buffer + used, data, avail );
+		trine_md5_block( ctx, ctx->buffer );
+		data	+= avail;
+		len		-= avail;
+	}
+
+	while (len >= 64) {
+		trine_md5_block( ctx, data );
+		data	+= 64;
+		len		-= 64;
+	}
+
+	if (len) {
+		memcpy( ctx->buffer, data, len );
+	}
+}
+
+/* Appends the MD5 padding and message length, leaving the digest in the
+ * state words. */
+static void
+trine_md5_pad (trine_md5_ctx* ctx) {
+	static const unsigned char pad[64]	= { 0x80 };
+	unsigned char bits[8];
+	uint64_t bitlen	= ctx->length << 3;
+	size_t used		= (size_t) (ctx->length & 0x3f);
+	int k;
+
+	for (k = 0; k < 8; k++) {
+		bits[k]	= (unsigned char) (bitlen >> (8 * k));
+	}
+	trine_md5_update( ctx, pad, (used < 56) ? (56 - used) : (120 - used) );
+	trine_md5_update( ctx, bits, 8 );
+}
+
+/* Finishes the digest and returns the first eight bytes of it folded into a
+ * little-endian 64-bit integer (the Redland mysql node-hash algorithm). */
+static uint64_t
+trine_md5_final64 (trine_md5_ctx* ctx) {
+	trine_md5_pad( ctx );
+	return ((uint64_t) ctx->a) | (((uint64_t) ctx->b) << 32);
+}
+
+/* Finishes the digest and writes its 16 bytes to digest. */
+static void
+trine_md5_final (trine_md5_ctx* ctx, unsigned char* digest) {
+	uint32_t words[4];
+	int k;
+
+	trine_md5_pad( ctx );
+	words[0]	= ctx->a;
+	words[1]	= ctx->b;
+	words[2]	= ctx->c;
+	words[3]	= ctx->d;
+	for (k = 0; k < 16; k++) {
+		digest[k]	= (unsigned char) (words[k >> 2] >> (8 * (k & 3)));
+	}
+}
+
+#endif
@@ -0,0 +1,37 @@
+use Test::More tests => 11;
+
+use_ok( 'RDF::Trine::XS' );
+
+# the snapshot reads the node objects' internal arrays directly, so the node
+# classes do not need to be loaded to exercise it.
+@RDF::Query::Node::Resource::ISA	= ('RDF::Trine::Node::Resource');
+my %n		= map { $_ => bless( [ 'URI', "http://example.org/$_" ], 'RDF::Trine::Node::Resource' ) } qw(a b c d e);
+my $lit		= bless( [ 'a', undef, undef ], 'RDF::Trine::Node::Literal' );
+my $var		= bless( [ 'x' ], 'RDF::Trine::Node::Variable' );
+
+sub reach {
+	my $adj	= shift;
+	my $id	= $adj->id( shift );
+	return join(' ', sort map { $adj->node( $_ )->[1] =~ m{/(\w+)$} } unpack('N*', $adj->reachable( $id, shift )));
+}
+
+{
+	# a -> b -> c -> a, c -> d, e isolated except for the literal
+	my $adj	= RDF::Trine::XS::Adjacency->new();
+	isa_ok( $adj, 'RDF::Trine::XS::Adjacency' );
+	$adj->add_edge( @n{ @$_ } ) for ([qw(a b)], [qw(b c)], [qw(c a)], [qw(c d)], [qw(c d)]);
+	$adj->add_edge( $n{e}, $lit );
+	is_deeply( [ $adj->nodes, $adj->edges ], [ 6, 6 ], 'node and edge counts' );
+	is( $adj->id( bless( [ 'URI', 'http://example.org/c' ], 'RDF::Query::Node::Resource' ) ), $adj->id( $n{c} ), 'subclasses share IDs' );
+	is( $adj->id( $var ), undef, 'variables have no ID' );
+	is( reach( $adj, $n{a}, 0 ), 'a b c d', 'zero or more from a' );
+	is( reach( $adj, $n{a}, 1 ), 'a b c d', 'one or more from a (on a cycle)' );
+	is( reach( $adj, $n{d}, 1 ), '', 'one or more from a sink' );
+	is( reach( $adj, $n{d}, 0 ), 'd', 'zero or more from a sink' );
+	
+	# adding an edge after a search rebuilds the snapshot
+	$adj->add_edge( $n{d}, $n{e} );
+	is( reach( $adj, $n{b}, 1 ), 'a b c d e', 'search after adding an edge' );
+	eval { $adj->add_edge( $n{a}, $var ) };
+	like( $@, qr/resources, blank nodes or literals/, 'variables cannot be added' );
+}
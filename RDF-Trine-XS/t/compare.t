@@ -0,0 +1,28 @@
+use Test::More tests => 11;
+
+use utf8;
+use_ok( 'RDF::Trine::XS' );
+
+# compare_nodes reads the node objects' internal arrays directly, so the node
+# classes do not need to be loaded to exercise them.
+my $nil		= bless( [], 'RDF::Trine::Node::Nil' );
+my $blank	= bless( [ 'BLANK', 'r1' ], 'RDF::Trine::Node::Blank' );
+my $uri_a	= bless( [ 'URI', 'http://example.org/a' ], 'RDF::Trine::Node::Resource' );
+my $uri_b	= bless( [ 'URI', 'http://example.org/b' ], 'RDF::Trine::Node::Resource' );
+my $plain	= bless( [ 'a', undef, undef ], 'RDF::Trine::Node::Literal' );
+my $lang	= bless( [ 'a', 'en', undef ], 'RDF::Trine::Node::Literal' );
+my $lang_fr	= bless( [ 'a', 'fr', undef ], 'RDF::Trine::Node::Literal' );
+my $typed	= bless( [ 'a', undef, 'http://www.w3.org/2001/XMLSchema#string' ], 'RDF::Trine::Node::Literal' );
+my $ulit	= bless( [ 'é', undef, undef ], 'RDF::Trine::Node::Literal' );
+my $var		= bless( [ 'x' ], 'RDF::Trine::Node::Variable' );
+
+is_deeply( [ map { RDF::Trine::XS::compare_nodes( @$_ ) } ([$nil, $blank], [$blank, $uri_a], [$uri_a, $plain], [$plain, $uri_a]) ], [ -1, -1, -1, 1 ], 'nil < blank < IRI < literal' );
+is( RDF::Trine::XS::compare_nodes( $uri_a, $uri_b ), -1, 'IRIs compare by value' );
+is( RDF::Trine::XS::compare_nodes( $uri_a, bless( [ 'URI', 'http://example.org/a' ], 'RDF::Trine::Node::Resource' ) ), 0, 'equal IRIs' );
+is( RDF::Trine::XS::compare_nodes( $lang, $lang_fr ), -1, 'literals with the same value compare by language' );
+is( RDF::Trine::XS::compare_nodes( $plain, $typed ), -1, 'untyped literals sort before typed literals' );
+is( RDF::Trine::XS::compare_nodes( $plain, $lang ), 0, 'language is ignored unless both literals have one' );
+is( RDF::Trine::XS::compare_nodes( $plain, $ulit ), -1, 'literal values compare by code point' );
+is( RDF::Trine::XS::compare_nodes( undef, $uri_a ), -1, 'undefined values sort first' );
+is( RDF::Trine::XS::compare_nodes( $uri_a, undef ), 1, 'undefined values sort first (reversed)' );
+is( RDF::Trine::XS::compare_nodes( $var, $uri_a ), undef, 'variables are not comparable' );
@@ -0,0 +1,46 @@
+use Test::More tests => 11;
+
+use_ok( 'RDF::Trine::XS' );
+
+# the counter reads the node objects' internal arrays directly, so the node
+# classes do not need to be loaded to exercise it.
+my $a		= bless( [ 'URI', 'http://example.org/a' ], 'RDF::Trine::Node::Resource' );
+my $a2		= bless( [ 'URI', 'http://example.org/a' ], 'RDF::Trine::Node::Resource' );
+my $lit		= bless( [ 'a' ], 'RDF::Trine::Node::Literal' );
+my $blank	= bless( [ 'BLANK', 'a' ], 'RDF::Trine::Node::Blank' );
+my $var		= bless( [ 'a' ], 'RDF::Trine::Node::Variable' );
+
+{
+	my $c	= RDF::Trine::XS::Counter->new();
+	isa_ok( $c, 'RDF::Trine::XS::Counter' );
+	is( $c->add( $a ), 1, 'first add' );
+	is( $c->add( $a2 ), 2, 'equal nodes share a count' );
+	$c->add( $lit );
+	$c->add( $blank );
+	is_deeply( [ $c->count( $a ), $c->count( $lit ), $c->count( $blank ) ], [ 2, 1, 1 ], 'counts by node type' );
+	is_deeply( [ $c->distinct, $c->total ], [ 3, 4 ], 'distinct and total' );
+	is( $c->add( $var ), undef, 'variables are not counted' );
+	is_deeply( [ $c->remove( $a ), $c->remove( $lit ), $c->remove( $lit ) ], [ 1, 0, 0 ], 'remove' );
+	is_deeply( [ $c->distinct, $c->total, $c->count( $lit ) ], [ 2, 2, 0 ], 'distinct and total after remove' );
+}
+
+{
+	# grow the table well past its initial size, then empty it again in an
+	# order unrelated to the insertion order
+	my $c	= RDF::Trine::XS::Counter->new();
+	my @nodes	= map { bless( [ 'URI', "http://example.org/$_" ], 'RDF::Trine::Node::Resource' ) } (1 .. 1000);
+	foreach my $i (0 .. $#nodes) {
+		$c->add( $nodes[$i] ) for (0 .. ($i % 3));
+	}
+	my $ok	= 1;
+	foreach my $i (0 .. $#nodes) {
+		$ok	= 0 unless ($c->count( $nodes[$i] ) == ($i % 3) + 1);
+	}
+	ok( $ok, 'counts survive table growth' );
+	my @odd		= grep { $_ % 2 } (0 .. $#nodes);
+	my @even	= grep { not($_ % 2) } (0 .. $#nodes);
+	foreach my $i (@odd, reverse(@even)) {
+		$c->remove( $nodes[$i] ) for (0 .. ($i % 3));
+	}
+	is_deeply( [ $c->distinct, $c->total ], [ 0, 0 ], 'counts after removing everything' );
+}
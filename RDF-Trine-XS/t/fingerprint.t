@@ -0,0 +1,37 @@
+use Test::More tests => 12;
+
+use utf8;
+use Digest::MD5 qw(md5);
+use Encode qw(encode_utf8);
+use_ok( 'RDF::Trine::XS' );
+
+# row_fingerprint reads the node objects' internal arrays directly, so the node
+# classes do not need to be loaded to exercise them.
+@RDF::Query::Node::Resource::ISA	= ('RDF::Trine::Node::Resource');
+my $uri		= bless( [ 'URI', 'http://example.org/' ], 'RDF::Trine::Node::Resource' );
+my $quri	= bless( [ 'URI', 'http://example.org/' ], 'RDF::Query::Node::Resource' );
+my $lit		= bless( [ 'é', 'en', undef ], 'RDF::Trine::Node::Literal' );
+my $blank	= bless( [ 'BLANK', 'r1' ], 'RDF::Trine::Node::Blank' );
+my $var		= bless( [ 'x' ], 'RDF::Trine::Node::Variable' );
+
+{
+	my $fp	= RDF::Trine::XS::row_fingerprint( { a => $uri, b => $lit } );
+	is( length($fp), 16, '16-byte fingerprint' );
+	is( $fp, md5( encode_utf8( "1:a20:Rhttp://example.org/1:b7:Len\0\0é" ) ), 'fingerprint is the MD5 of the sorted join keys' );
+	is( RDF::Trine::XS::row_fingerprint( { b => $lit, a => $quri } ), $fp, 'fingerprints ignore key order and node subclasses' );
+	is( RDF::Trine::XS::row_fingerprint( { a => $uri, b => $lit, c => undef } ), $fp, 'unbound variables are ignored' );
+	isnt( RDF::Trine::XS::row_fingerprint( { a => $lit, b => $uri } ), $fp, 'fingerprints depend on variable names' );
+	is( RDF::Trine::XS::row_fingerprint( { a => $uri, d => $var } ), undef, 'variable node has no fingerprint' );
+}
+
+{
+	my $s	= RDF::Trine::XS::FingerprintSet->new();
+	isa_ok( $s, 'RDF::Trine::XS::FingerprintSet' );
+	my @fps	= map { md5($_) } (1 .. 1000);
+	my @new	= map { $s->insert( $_ ) ? 1 : 0 } (@fps, @fps[0 .. 99]);
+	is( scalar(grep { $_ } @new), 1000, 'insert returns true only for new fingerprints' );
+	is_deeply( [ $s->size, $s->contains( $fps[500] ) ? 1 : 0, $s->contains( md5('x') ) ? 1 : 0 ], [ 1000, 1, 0 ], 'size and contains after table growth' );
+	ok( $s->bytes >= 16 * 1000, 'table size in bytes' );
+	eval { $s->insert( 'short' ) };
+	like( $@, qr/16 bytes/, 'short fingerprints are rejected' );
+}
@@ -0,0 +1,61 @@
+use Test::More tests => 10;
+
+use utf8;
+use_ok( 'RDF::Trine::XS' );
+
+# hash_nodes reads the node objects' internal arrays directly, so the node
+# classes do not need to be loaded to exercise it.
+my $uri		= bless( [ 'URI', 'http://xmlns.com/foaf/0.1/name' ], 'RDF::Trine::Node::Resource' );
+my $lit		= bless( [ 'kasei' ], 'RDF::Trine::Node::Literal' );
+my $ulit	= bless( [ '神崎正英', 'ja', undef ], 'RDF::Trine::Node::Literal' );
+my $dtlit	= bless( [ '0', undef, 'http://www.w3.org/2001/XMLSchema#integer' ], 'RDF::Trine::Node::Literal' );
+my $blank	= bless( [ 'BLANK', 'r1' ], 'RDF::Trine::Node::Blank' );
+my $nil		= bless( {}, 'RDF::Trine::Node::Nil' );
+my $var		= bless( [ 'VAR', 'x' ], 'RDF::Trine::Node::Variable' );
+
+{
+	my @hashes	= RDF::Trine::XS::hash_nodes( [ $uri, $lit, $ulit, $dtlit ] );
+	is_deeply( [ map { "$_" } @hashes ], [ '14911999128994829034', '12775641923308277283', '4303572462241715163', '1652511136861928403' ], 'batch node hashes' );
+}
+
+{
+	my ($hash)	= RDF::Trine::XS::hash_nodes( [ $blank ] );
+	is( "$hash", RDF::Trine::XS::hash( 'Br1' ), 'blank node hash' );
+}
+
+{
+	my @hashes	= RDF::Trine::XS::hash_nodes( [ $nil, undef, $var ] );
+	is_deeply( \@hashes, [ 0, 0, undef ], 'nil, undef and variable hashes' );
+}
+
+{
+	my ($hash)	= RDF::Trine::XS::hash_nodes( [ $uri ], 1 );
+	is( "$hash", '5688627092140053226', 'masked (signed) hash' );
+}
+
+{
+	my $latin1	= "caf\x{e9}";
+	utf8::downgrade( $latin1 );
+	my $node	= bless( [ $latin1 ], 'RDF::Trine::Node::Literal' );
+	my ($hash)	= RDF::Trine::XS::hash_nodes( [ $node ] );
+	is( "$hash", RDF::Trine::XS::hash( "L${latin1}<>" ), 'non-utf8 string is utf8 encoded before hashing' );
+}
+
+{
+	my $st		= bless( [ $uri, $uri, $lit ], 'RDF::Trine::Statement' );
+	my @hashes	= RDF::Trine::XS::hash_statement( $st );
+	is( scalar(@hashes), 3, 'triple hash count' );
+	is( "$hashes[2]", '12775641923308277283', 'triple object hash' );
+}
+
+{
+	@RDF::Trine::Statement::Quad::ISA	= ('RDF::Trine::Statement');
+	my $st		= bless( [ $blank, $uri, $lit, $nil ], 'RDF::Trine::Statement::Quad' );
+	my @hashes	= RDF::Trine::XS::hash_statement( $st );
+	is_deeply( [ map { "$_" } @hashes ], [ RDF::Trine::XS::hash('Br1'), '14911999128994829034', '12775641923308277283', 0 ], 'quad hashes' );
+}
+
+{
+	eval { RDF::Trine::XS::hash_nodes( 'foo' ) };
+	like( $@, qr/ARRAY reference/, 'hash_nodes croaks on non-array argument' );
+}
@@ -1,4 +1,5 @@
-use Test::More tests => 6;
+use Test::More tests => 10;
+use Config;
 
 use utf8;
 use_ok( 'RDF::Trine::XS' );
@@ -32,3 +33,25 @@ use_ok( 'RDF::Trine::XS' );
 	my $hash	= RDF::Trine::XS::hash( $value );
 	is( $hash, '1652511136861928403', 'data-typed literal' );
 }
+
+SKIP: {
+	skip "perl does not have 64-bit integers", 1 unless ($Config{uvsize} >= 8);
+	require B;
+	my $hash	= RDF::Trine::XS::hash( 'Rhttp://xmlns.com/foaf/0.1/name' );
+	my $flags	= B::svref_2object( \$hash )->FLAGS;
+	ok( ($flags & B::SVf_IOK()) && !($flags & B::SVf_POK()), 'hash is a native integer' );
+}
+
+{
+	my $value	= 'Rhttp://xmlns.com/foaf/0.1/name';
+	my $self	= bless( {}, 'RDF::Trine::Store::DBI' );
+	is( RDF::Trine::XS::hash( $self, $value ), '14911999128994829034', 'hash called as a method' );
+	is( RDF::Trine::XS::hash( $value, 1 ), '5688627092140053226', 'masked hash' );
+}
+
+{
+	my $latin1	= "L\xe9<>";
+	my $upgraded	= $latin1;
+	utf8::upgrade( $upgraded );
+	is( RDF::Trine::XS::hash( $latin1 ), RDF::Trine::XS::hash( $upgraded ), 'hash of latin-1 string is independent of internal encoding' );
+}
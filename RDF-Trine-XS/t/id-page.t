@@ -0,0 +1,35 @@
+use Test::More tests => 16;
+
+use_ok( 'RDF::Trine::XS' );
+
+{
+	my $page;
+	my @added	= map { RDF::Trine::XS::id_page_insert( \$page, $_ ) } (5, 3, 9, 3, 1, 7);
+	is_deeply( \@added, [1, 1, 1, 0, 1, 1], 'insert reports new IDs only' );
+	is_deeply( [ unpack('N*', $page) ], [1, 3, 5, 7, 9], 'page is kept sorted' );
+	ok( RDF::Trine::XS::id_page_contains( $page, 9 ), 'page contains last ID' );
+	ok( !RDF::Trine::XS::id_page_contains( $page, 4 ), 'page does not contain missing ID' );
+	is( RDF::Trine::XS::id_page_remove( \$page, 3 ), 1, 'remove existing ID' );
+	is( RDF::Trine::XS::id_page_remove( \$page, 3 ), 0, 'remove missing ID' );
+	is_deeply( [ unpack('N*', $page) ], [1, 5, 7, 9], 'page after removal' );
+}
+
+{
+	my $page	= pack('N*', 2, 4, 6);
+	is( RDF::Trine::XS::id_page_search( $page, 6 ), 2, 'search returns the position of a present ID' );
+	is( RDF::Trine::XS::id_page_search( $page, 5 ), -3, 'search returns the negated insertion point of a missing ID' );
+	is( RDF::Trine::XS::id_page_search( '', 1 ), -1, 'search of an empty page' );
+}
+
+{
+	my $page	= pack('N*', 1, 70000, 4294967295);
+	ok( RDF::Trine::XS::id_page_contains( $page, 4294967295 ), 'full 32-bit ID range' );
+}
+
+{
+	my @pages	= map { pack('N*', @$_) } ([1, 3, 5, 7, 9, 11, 40], [2, 3, 4, 9, 10, 11, 12, 13, 14, 15, 40], [3, 11, 40, 41]);
+	is_deeply( [ unpack('N*', RDF::Trine::XS::id_page_intersect( @pages )) ], [3, 11, 40], 'intersection of three pages' );
+	is_deeply( [ unpack('N*', RDF::Trine::XS::id_page_intersect( $pages[0] )) ], [1, 3, 5, 7, 9, 11, 40], 'intersection of one page' );
+	is( RDF::Trine::XS::id_page_intersect( $pages[0], '' ), '', 'intersection with an empty page' );
+	is( RDF::Trine::XS::id_page_intersect( pack('N*', 1, 2), pack('N*', 3, 4) ), '', 'disjoint pages' );
+}
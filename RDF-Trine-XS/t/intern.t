@@ -0,0 +1,36 @@
+use Test::More tests => 11;
+
+use utf8;
+use Encode;
+use Scalar::Util qw(refaddr);
+use_ok( 'RDF::Trine::XS' );
+
+# node_key and intern_node read the node objects' internal arrays directly, so
+# the node classes do not need to be loaded to exercise them.
+my $uri		= bless( [ 'URI', 'http://example.org/' ], 'RDF::Trine::Node::Resource' );
+my $uri2	= bless( [ 'URI', 'http://example.org/' ], 'RDF::Trine::Node::Resource' );
+my $plain	= bless( [ 'en' ], 'RDF::Trine::Node::Literal' );
+my $lang	= bless( [ 'en', 'en', undef ], 'RDF::Trine::Node::Literal' );
+my $ulit	= bless( [ '神崎正英', 'ja', undef ], 'RDF::Trine::Node::Literal' );
+my $blank	= bless( [ 'BLANK', 'r1' ], 'RDF::Trine::Node::Blank' );
+my $var		= bless( [ 'VAR', 'x' ], 'RDF::Trine::Node::Variable' );
+
+is( RDF::Trine::XS::node_key( $uri ), 'Rhttp://example.org/', 'resource key' );
+is( RDF::Trine::XS::node_key( $lang ), "Len\0\0en", 'language literal key' );
+is( RDF::Trine::XS::node_key( $ulit ), "Lja\0\0" . Encode::encode('utf8', '神崎正英'), 'keys are UTF-8 encoded' );
+isnt( RDF::Trine::XS::node_key( $plain ), RDF::Trine::XS::node_key( $lang ), 'plain and language literals have distinct keys' );
+is( RDF::Trine::XS::node_key( $var ), undef, 'variables have no key' );
+
+{
+	my (%keys, %ids);
+	my @nodes	= (undef);
+	my $a	= RDF::Trine::XS::intern_node( \%keys, \@nodes, \%ids, $uri );
+	my $b	= RDF::Trine::XS::intern_node( \%keys, \@nodes, \%ids, $uri2 );
+	is( refaddr($b), refaddr($uri), 'equal node returns the canonical object' );
+	is( $ids{ refaddr($uri) }, 1, 'first term ID' );
+	RDF::Trine::XS::intern_node( \%keys, \@nodes, \%ids, $_ ) for ($plain, $lang, $blank);
+	is_deeply( [ map { $ids{ refaddr($_) } } ($plain, $lang, $blank) ], [2, 3, 4], 'term IDs are assigned in order' );
+	is( refaddr($nodes[3]), refaddr($lang), 'ID to node table' );
+	RDF::Trine::XS::intern_node( \%keys, \@nodes, \%ids, $var );
+	is( scalar(@nodes), 5, 'variables are not interned' );
+}
@@ -0,0 +1,21 @@
+use Test::More tests => 8;
+
+use_ok( 'RDF::Trine::XS' );
+
+# join_key reads the node objects' internal arrays directly, so the node
+# classes do not need to be loaded to exercise them.
+@RDF::Query::Node::Resource::ISA	= ('RDF::Trine::Node::Resource');
+my $uri		= bless( [ 'URI', 'http://example.org/' ], 'RDF::Trine::Node::Resource' );
+my $quri	= bless( [ 'URI', 'http://example.org/' ], 'RDF::Query::Node::Resource' );
+my $lit		= bless( [ 'http://example.org/', undef, undef ], 'RDF::Trine::Node::Literal' );
+my $blank	= bless( [ 'BLANK', 'r1' ], 'RDF::Trine::Node::Blank' );
+my $var		= bless( [ 'x' ], 'RDF::Trine::Node::Variable' );
+
+my $row		= bless( { a => $uri, b => $blank, c => undef, d => $var }, 'RDF::Trine::VariableBindings' );
+is( RDF::Trine::XS::join_key( $row, [qw(a)] ), '20:Rhttp://example.org/', 'single variable key' );
+is( RDF::Trine::XS::join_key( $row, [] ), '', 'empty key for no join variables' );
+is( RDF::Trine::XS::join_key( { a => $quri }, [qw(a)] ), RDF::Trine::XS::join_key( $row, [qw(a)] ), 'subclasses share keys' );
+isnt( RDF::Trine::XS::join_key( { a => $lit }, [qw(a)] ), RDF::Trine::XS::join_key( $row, [qw(a)] ), 'literal and resource keys are distinct' );
+isnt( RDF::Trine::XS::join_key( { a => $uri, b => $blank }, [qw(a b)] ), RDF::Trine::XS::join_key( { a => $blank, b => $uri }, [qw(a b)] ), 'keys depend on variable order' );
+is( RDF::Trine::XS::join_key( $row, [qw(a c)] ), undef, 'unbound variable has no key' );
+is( RDF::Trine::XS::join_key( $row, [qw(a d)] ), undef, 'variable node has no key' );
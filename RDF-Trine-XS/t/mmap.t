@@ -0,0 +1,31 @@
+use Test::More;
+use File::Temp qw(tempfile);
+
+use RDF::Trine::XS;
+
+my ($fh, $filename)	= tempfile();
+binmode($fh);
+print {$fh} "RTHX" . pack('N*', 1, 2, 3);
+close($fh);
+
+my $map	= eval { RDF::Trine::XS::mmap_file( $filename ) };
+if (not($map) and $@ =~ /not supported/) {
+	plan skip_all => 'mmap is not supported on this platform';
+}
+plan tests => 6;
+
+is( length($$map), 16, 'mapped length' );
+is( substr($$map, 0, 4), 'RTHX', 'substr on mapping' );
+is_deeply( [ unpack('x4 N*', $$map) ], [1, 2, 3], 'unpack on mapping' );
+ok( !eval { substr($$map, 0, 1) = 'X'; 1 }, 'mapping is read-only' );
+undef $map;
+
+{
+	open(my $empty, '>', $filename);
+	close($empty);
+	my $map	= RDF::Trine::XS::mmap_file( $filename );
+	is( $$map, '', 'empty file maps to an empty string' );
+}
+
+unlink($filename);
+ok( !eval { RDF::Trine::XS::mmap_file( $filename ); 1 }, 'missing file croaks' );
@@ -0,0 +1,39 @@
+use Test::More tests => 14;
+
+use utf8;
+use_ok( 'RDF::Trine::XS' );
+
+# parse_ntriples_chunk builds the node and statement objects directly, so the
+# node classes do not need to be loaded to exercise it.
+{
+	my @st;
+	my $data	= qq[<http://example.org/s> <http://example.org/p> "caf\\u00E9"\@en-us .\r\n# comment\n\n]
+				. qq[_:b1\t<http://example.org/p> "1"^^<http://www.w3.org/2001/XMLSchema#integer> .\r]
+				. qq[<http://example.org/s> <http://example.org/p> "x\\ty\\"" .\n];
+	my $lineno	= RDF::Trine::XS::parse_ntriples_chunk( $data, 10, 0, \@st );
+	is( $lineno, 15, 'line count for mixed line endings' );
+	is( scalar(@st), 3, 'statement count' );
+	isa_ok( $st[0], 'RDF::Trine::Statement' );
+	is_deeply( [ @{ $st[0] } ], [ [ 'URI', 'http://example.org/s' ], [ 'URI', 'http://example.org/p' ], [ 'café', 'en-US', undef ] ], 'language literal with \\u escape' );
+	is( ref($st[1][0]), 'RDF::Trine::Node::Blank', 'blank node class' );
+	is_deeply( [ @{ $st[1][2] } ], [ '1', undef, 'http://www.w3.org/2001/XMLSchema#integer' ], 'datatyped literal' );
+	is_deeply( [ @{ $st[2][2] } ], [ qq[x\ty"] ], 'plain literal with escapes' );
+}
+
+{
+	my @st;
+	my $data	= qq[<s> <p> "神崎正英" <g> .\n<s> <p> <o> .\n];
+	RDF::Trine::XS::parse_ntriples_chunk( $data, 0, 1, \@st );
+	is( ref($st[0]), 'RDF::Trine::Statement::Quad', 'quad' );
+	is( $st[0][2][0], '神崎正英', 'UTF-8 literal value' );
+	is( ref($st[1]), 'RDF::Trine::Statement', 'triple in quad data' );
+}
+
+{
+	my @st;
+	eval { RDF::Trine::XS::parse_ntriples_chunk( qq[<s> <p> <o> .\n<s> <p> <o> <g> .\n], 0, 0, \@st ) };
+	like( $@, qr/^Not valid N-Triples data at line 2/, 'quad in triple data' );
+	is( scalar(@st), 1, 'statements before the error are kept' );
+	eval { RDF::Trine::XS::parse_ntriples_chunk( qq[<s> <p> "\\q" .\n], 0, 0, [] ) };
+	like( $@, qr/^Not valid N-Triples escape character '\\q' at line 1/, 'bad escape' );
+}
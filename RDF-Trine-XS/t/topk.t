@@ -0,0 +1,14 @@
+use Test::More tests => 6;
+
+use_ok( 'RDF::Trine::XS' );
+
+my @heap;
+my @inserted	= map { RDF::Trine::XS::topk_insert( \@heap, 3, [ $_ ] ) } qw(m c x a q b);
+is_deeply( \@inserted, [ 1, 1, 1, 1, 0, 1 ], 'records are kept while they sort within the limit' );
+is( $heap[0][0], 'c', 'the largest kept key is at the top of the heap' );
+is_deeply( [ sort map { $_->[0] } @heap ], [ qw(a b c) ], 'heap keeps the smallest keys' );
+
+my @empty;
+is( RDF::Trine::XS::topk_insert( \@empty, 0, [ 'a' ] ), 0, 'nothing is kept with a limit of zero' );
+eval { RDF::Trine::XS::topk_insert( \@heap, 3, 'a' ) };
+like( $@, qr/not an ARRAY reference/, 'records must be array references' );
@@ -0,0 +1,50 @@
+use Test::More tests => 13;
+
+use utf8;
+use_ok( 'RDF::Trine::XS' );
+
+# token type numbers from RDF::Trine::Parser::Turtle::Constants
+use constant {
+	DOT			=> 5,
+	COMMA		=> 7,
+	A			=> 9,
+	PREFIXNAME	=> 11,
+	IRI			=> 12,
+	DECIMAL		=> 15,
+	STRING3D	=> 19,
+	STRING1D	=> 21,
+	PREFIX		=> 24,
+	LANG		=> 27,
+};
+
+{
+	my @t;
+	my $data	= qq[\@prefix ex: <http://example.org/\\u00E9> .\n# comment\nex:s a "caf\\u00e9"\@en-US, 1.5 .\n];
+	my ($line, $col, $error)	= RDF::Trine::XS::scan_turtle_tokens( $data, 1, 1, 1, \@t );
+	is_deeply( [ map { $_->[0] } @t ], [ PREFIX, PREFIXNAME, IRI, DOT, PREFIXNAME, A, STRING1D, LANG, COMMA, DECIMAL, DOT ], 'token types' );
+	isa_ok( $t[0], 'RDF::Trine::Parser::Turtle::Token' );
+	is_deeply( $t[2][5], [ 'http://example.org/é' ], 'IRI with \\u escape' );
+	is_deeply( [ @{ $t[4] }[1..5] ], [ 3, 1, 3, 5, [ 'ex:', 's' ] ], 'prefixed name position and values' );
+	is_deeply( $t[6][5], [ 'café' ], 'string with \\u escape' );
+	is( "$line:$col", '4:1', 'final position' );
+	is( $data, '', 'buffer consumed' );
+}
+
+{
+	my @t;
+	my $data	= qq[<s> <p> """神崎\n"a""b];
+	my ($line, $col, $error)	= RDF::Trine::XS::scan_turtle_tokens( $data, 1, 1, 0, \@t );
+	is( scalar(@t), 2, 'tokens before an unfinished long literal' );
+	is( $data, qq["""神崎\n"a""b], 'unfinished long literal left in the buffer' );
+	$data	.= qq[""" .\n];
+	RDF::Trine::XS::scan_turtle_tokens( $data, $line, $col, 1, \@t );
+	is_deeply( [ @{ $t[2] }[0,1,2,3,4,5] ], [ STRING3D, 1, 9, 2, 9, [ qq[神崎\n"a""b] ] ], 'long literal across buffers' );
+}
+
+{
+	my @t;
+	my $data	= qq[<s> <p> "a\\q" .\n];
+	my ($line, $col, $error)	= RDF::Trine::XS::scan_turtle_tokens( $data, 1, 1, 1, \@t );
+	is( scalar(@t), 2, 'tokens before an error are kept' );
+	like( $error, qr/^Unrecognized string escape 'q'/, 'bad escape' );
+}
@@ -0,0 +1,44 @@
+#!/usr/bin/env perl
+
+=head1 NAME
+
+dbi_hash_benchmark.pl - Benchmark tool for DBI store node hashing
+
+=head1 USAGE
+
+ dbi_hash_benchmark.pl [COUNT]
+
+Compares the speed of the pure-perl node hash used by RDF::Trine::Store::DBI
+with the native hash functions of RDF::Trine::XS over COUNT random node
+strings (default 10,000).
+
+=cut
+
+use strict;
+use warnings;
+use Benchmark qw(cmpthese);
+use RDF::Trine;
+use RDF::Trine::Store::DBI;
+
+eval "use RDF::Trine::XS; 1" or die "RDF::Trine::XS is not available\n";
+
+my $count	= shift || 10_000;
+my @chars	= ( 'a' .. 'z', '0' .. '9', '/', chr(0xe9), chr(0x795e) );
+my @nodes	= map {
+	my $value	= join('', map { $chars[ rand(@chars) ] } (1 .. 8 + int(rand(40))));
+	(rand() < 0.5)
+		? RDF::Trine::Node::Resource->new( "http://example.org/$value" )
+		: RDF::Trine::Node::Literal->new( "$value $value", 'en' );
+} (1 .. $count);
+my @strings	= map {
+	$_->isa('RDF::Trine::Node::Resource')
+		? 'R' . $_->uri_value
+		: sprintf('L%s<%s>', $_->literal_value, $_->literal_value_language)
+} @nodes;
+
+printf("Hashing %d node strings per iteration\n", $count);
+cmpthese( -3, {
+	'pp'			=> sub { RDF::Trine::Store::DBI::_mysql_hash_pp( $_ ) foreach (@strings) },
+	'xs hash'		=> sub { RDF::Trine::XS::hash( $_ ) foreach (@strings) },
+	'xs hash_nodes'	=> sub { my @h = RDF::Trine::XS::hash_nodes( \@nodes ) },
+} );
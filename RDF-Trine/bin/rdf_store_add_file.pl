@@ -5,18 +5,25 @@ use warnings;
 no warnings 'redefine';
 use File::Spec;
 use File::Slurp;
+use Getopt::Long;
 use LWP::UserAgent;
 
 use RDF::Trine;
 use RDF::Trine::Store::DBI;
 use RDF::Trine::Statement;
 
+my $workers	= 1;
+my $result	= GetOptions ("workers=i" => \$workers);
+
 unless (@ARGV >= 6) {
 	print <<"END";
-USAGE: $0 server-type dbname username password model-name file base [host]
+USAGE: $0 [--workers=N] server-type dbname username password model-name file base [host]
 
 	server-type can be either 'mysql' or 'sqlite'
 
+	--workers=N parses local N-Triples and N-Quads files with N worker
+	processes.
+
 
 END
 	exit;
@@ -63,7 +70,6 @@ if ($file =~ qr[^http(s?)://]) {
 		$base		= $file;
 	}
 } else {
-	$data	= read_file( $file );
 	unless ($base) {
 		my $abs	= File::Spec->rel2abs( $file );
 		$base	= 'file://' . $abs;
@@ -84,6 +90,13 @@ if ($file =~ qr[^http(s?)://]) {
 # 
 
 my $pclass	= RDF::Trine::Parser->guess_parser_by_filename( $file );
-my $parser	= $pclass->new();
 my $m		= RDF::Trine::Model->new( $store );
-$parser->parse_into_model( $base, $data, $m );
+if (defined($data)) {
+	$pclass->new()->parse_into_model( $base, $data, $m );
+} elsif ($pclass->isa('RDF::Trine::Parser::NTriples')) {
+	# line-based formats are read from the file in chunks, and may be split
+	# across worker processes
+	$pclass->new( workers => $workers )->parse_file_into_model( $base, $file, $m );
+} else {
+	$pclass->new()->parse_into_model( $base, scalar(read_file( $file )), $m );
+}
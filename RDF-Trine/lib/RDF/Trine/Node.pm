@@ -184,6 +184,7 @@ sub compare {
 	my $b	= shift;
 	return -1 unless blessed($a);
 	return 1 unless blessed($b);
+	return 0 if (refaddr($a) == refaddr($b));
 	
 	# (Lowest) no value assigned to the variable or expression in this solution.
 	# Blank nodes
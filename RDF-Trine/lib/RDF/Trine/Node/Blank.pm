@@ -19,7 +19,7 @@ no warnings 'redefine';
 use base qw(RDF::Trine::Node);
 
 use Data::Dumper;
-use Scalar::Util qw(blessed);
+use Scalar::Util qw(blessed refaddr);
 use Carp qw(carp croak confess);
 
 ######################################################################
@@ -69,7 +69,8 @@ my $r_bnode_id				= qr"(?:${r_PN_CHARS_U}|[0-9])((${r_PN_CHARS}|[.])*${r_PN_CHAR
 sub _new {
 	my $class	= shift;
 	my $name	= shift;
-	return bless( [ 'BLANK', $name ], $class );
+	my $node	= bless( [ 'BLANK', $name ], $class );
+	return ($RDF::Trine::TermTable::ENABLED) ? RDF::Trine::TermTable::intern( $node ) : $node;
 }
 
 =item C<< blank_identifier >>
@@ -149,6 +150,11 @@ sub equal {
 	my $self	= shift;
 	my $node	= shift;
 	return 0 unless (blessed($node) and $node->isa('RDF::Trine::Node::Blank'));
+	return 1 if (refaddr($self) == refaddr($node));
+	if ($RDF::Trine::TermTable::ENABLED and RDF::Trine::TermTable::is_interned($self) and RDF::Trine::TermTable::is_interned($node)) {
+		# distinct interned nodes have distinct values
+		return 0;
+	}
 	return ($self->blank_identifier eq $node->blank_identifier);
 }
 
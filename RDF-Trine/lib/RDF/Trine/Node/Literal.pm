@@ -20,7 +20,7 @@ use base qw(RDF::Trine::Node);
 
 use RDF::Trine::Error;
 use Data::Dumper;
-use Scalar::Util qw(blessed looks_like_number);
+use Scalar::Util qw(blessed refaddr looks_like_number);
 use Carp qw(carp croak confess);
 
 ######################################################################
@@ -116,7 +116,8 @@ sub _new {
 	} else {
 		$self	= [ $literal ];
 	}
-	return bless($self, $class);
+	bless($self, $class);
+	return ($RDF::Trine::TermTable::ENABLED) ? RDF::Trine::TermTable::intern( $self ) : $self;
 }
 
 
@@ -129,6 +130,9 @@ Returns the string value of the literal.
 sub literal_value {
 	my $self	= shift;
 	if (@_) {
+		if (defined(&RDF::Trine::TermTable::is_interned) and RDF::Trine::TermTable::is_interned( $self )) {
+			throw RDF::Trine::Error::MethodInvocationError -text => "Cannot change the value of an interned literal";
+		}
 		$self->[0]	= shift;
 	}
 	return $self->[0];
@@ -174,6 +178,14 @@ Returns the SSE string for this literal.
 =cut
 
 sub sse {
+	my $self	= shift;
+	if ($RDF::Trine::TermTable::ENABLED) {
+		return RDF::Trine::TermTable::_cached_ntriples( $self, '_sse' );
+	}
+	return $self->_sse;
+}
+
+sub _sse {
 	my $self	= shift;
 	my $literal	= $self->literal_value;
 	my $escaped	= $self->_unicode_escape( $literal );
@@ -212,16 +224,10 @@ Returns the node in a string form suitable for NTriples serialization.
 
 sub as_ntriples {
 	my $self	= shift;
-	my $literal	= $self->literal_value;
-	my $escaped	= $self->_unicode_escape( $literal );
-	$literal	= $escaped;
-	if (defined(my $lang = $self->literal_value_language)) {
-		return qq("${literal}"\@${lang});
-	} elsif (defined(my $dt = $self->literal_datatype)) {
-		return qq("${literal}"^^<${dt}>);
-	} else {
-		return qq("${literal}");
+	if ($RDF::Trine::TermTable::ENABLED) {
+		return RDF::Trine::TermTable::_cached_ntriples( $self, '_sse' );
 	}
+	return $self->_sse;
 }
 
 =item C<< type >>
@@ -266,6 +272,11 @@ sub equal {
 	my $self	= shift;
 	my $node	= shift;
 	return 0 unless (blessed($node) and $node->isa('RDF::Trine::Node::Literal'));
+	return 1 if (refaddr($self) == refaddr($node));
+	if ($RDF::Trine::TermTable::ENABLED and RDF::Trine::TermTable::is_interned($self) and RDF::Trine::TermTable::is_interned($node)) {
+		# distinct interned nodes have distinct values
+		return 0;
+	}
 	return 0 unless ($self->literal_value eq $node->literal_value);
 	if ($self->literal_datatype or $node->literal_datatype) {
 		no warnings 'uninitialized';
@@ -25,6 +25,7 @@ use Encode;
 use Data::Dumper;
 use Scalar::Util qw(blessed reftype refaddr);
 use Carp qw(carp croak confess);
+use RDF::Trine::Error;
 
 ######################################################################
 
@@ -83,7 +84,8 @@ sub new {
 		throw RDF::Trine::Error -text => sprintf("Bad IRI character: '%s' (0x%x)", $1, ord($1));
 	}
 	
-	return bless( [ 'URI', $uri ], $class );
+	my $node	= bless( [ 'URI', $uri ], $class );
+	return ($RDF::Trine::TermTable::ENABLED) ? RDF::Trine::TermTable::intern( $node ) : $node;
 }
 
 =item C<< uri_value >>
@@ -117,6 +119,9 @@ Returns the URI value of this resource, optionally updating the URI.
 sub uri {
 	my $self	= shift;
 	if (@_) {
+		if (defined(&RDF::Trine::TermTable::is_interned) and RDF::Trine::TermTable::is_interned( $self )) {
+			throw RDF::Trine::Error::MethodInvocationError -text => "Cannot change the IRI of an interned resource";
+		}
 		$self->[1]	= shift;
 		delete $sse{ refaddr($self) };
 		delete $ntriples{ refaddr($self) };
@@ -95,6 +95,8 @@ sub parse_into_model {
 	return $self->parse( $uri, $input, $handler );
 }
 
+sub _xs_quads { 1 }
+
 sub _emit_statement {
 	my $self	= shift;
 	my $handler	= shift;
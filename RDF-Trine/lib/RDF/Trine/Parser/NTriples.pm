@@ -17,7 +17,20 @@ This document describes RDF::Trine::Parser::NTriples version 1.019
 
 =head1 DESCRIPTION
 
-...
+This module implements a parser for the N-Triples format.
+
+If L<RDF::Trine::XS> is installed, input is read in large chunks which are
+scanned natively, and fully constructed statement objects are passed back to
+perl a chunk at a time.
+
+If the parser is constructed with a C<< workers >> count greater than one,
+files named by C<< parse_file >> and C<< parse_file_into_model >> are split
+at line boundaries and each part is parsed in a forked worker process. The
+parsed statements are passed to the handler (or added to the model, inside
+a single C<< begin_bulk_ops >>/C<< end_bulk_ops >> pair) in the parent
+process in file order. Blank node labels are used unchanged by every worker,
+so a label that appears in several parts of the file names the same blank
+node.
 
 =head1 METHODS
 
@@ -41,6 +54,10 @@ use Encode qw(decode);
 use Data::Dumper;
 use Log::Log4perl;
 use Scalar::Util qw(blessed reftype);
+use Config;
+use File::Temp qw(tempfile);
+use POSIX ();
+use Storable qw(freeze thaw);
 
 use RDF::Trine qw(literal);
 use RDF::Trine::Node;
@@ -49,9 +66,11 @@ use RDF::Trine::Error qw(:try);
 
 ######################################################################
 
-our ($VERSION);
+our ($VERSION, $HAVE_XS_PARSER, $CHUNK_SIZE, $BATCH_SIZE);
 BEGIN {
 	$VERSION	= '1.019';
+	$CHUNK_SIZE	= 1 << 20;
+	$BATCH_SIZE	= 10_000;
 	$RDF::Trine::Parser::parser_names{ 'ntriples' }	= __PACKAGE__;
 	foreach my $ext (qw(nt)) {
 		$RDF::Trine::Parser::file_extensions{ $ext }	= __PACKAGE__;
@@ -66,7 +85,11 @@ BEGIN {
 
 ######################################################################
 
-=item C<< new >>
+=item C<< new ( [ workers => $count ] [, canonicalize => 1 ] ) >>
+
+Returns a new N-Triples parser. If C<< workers >> is greater than one (and
+the platform supports C<< fork >>), files given to C<< parse_file >> by name
+are parsed by that many worker processes.
 
 =cut
 
@@ -130,10 +153,28 @@ sub parse_file {
 	unless (ref($fh)) {
 		my $filename	= $fh;
 		undef $fh;
+		if (($self->{workers} || 1) > 1 and $Config{d_fork}) {
+			return $self->_parse_file_parallel( $base, $filename, $handler );
+		}
 		open( $fh, '<:encoding(UTF-8)', $filename ) or throw RDF::Trine::Error::ParserError -text => $!;
 	}
 	
-	my $lineno	= 0;
+	$self->_parse_lines( $base, $fh, $handler, 0 );
+	return;
+}
+
+# Parses all the lines read from $fh, numbering them from $lineno + 1.
+sub _parse_lines {
+	my $self	= shift;
+	my $base	= shift;
+	my $fh		= shift;
+	my $handler	= shift;
+	my $lineno	= shift;
+	
+	if ($HAVE_XS_PARSER) {
+		return $self->_parse_file_xs( $fh, $handler, $lineno );
+	}
+	
 	no warnings 'uninitialized';
 	while (defined(my $line = <$fh>)) {
 LINE:
@@ -161,13 +202,222 @@ LINE:
 		}
 		
 		$self->_emit_statement( $handler, \@nodes, $lineno );
-		if (@extra) {
+		if (@extra and length($extra[0])) {
 			$line	= shift(@extra);
 			goto LINE;
 		}
 	}
+	return $lineno;
+}
+
+# Splits the file into one part per worker at line boundaries, and forks a
+# worker to parse each part. Workers write their results to a temporary file,
+# framed as a type byte and a payload length: 'S' for a batch of statements,
+# 'E' for an error message, and 'D' (with the number of lines in the part)
+# when the part is done. The parent replays the parts in order.
+#
+# A batch is frozen as the list of distinct nodes in the batch and a packed
+# list of node indexes, $width per statement (a context index of 0xFFFFFFFF
+# means a triple). Rebuilding statements from it is much cheaper for the
+# parent than thawing every node object.
+sub _parse_file_parallel {
+	my $self	= shift;
+	my $base	= shift;
+	my $filename	= shift;
+	my $handler	= shift;
+	
+	open( my $fh, '<:raw', $filename ) or throw RDF::Trine::Error::ParserError -text => $!;
+	my $size	= -s $fh;
+	my $workers	= $self->{workers};
+	my $width	= $self->_xs_quads ? 4 : 3;
+	my @offsets	= (0);
+	foreach my $i (1 .. $workers - 1) {
+		my $pos	= int($size * $i / $workers);
+		next unless ($pos > $offsets[-1]);
+		seek( $fh, $pos - 1, 0 );
+		<$fh>;
+		my $boundary	= tell($fh);
+		push(@offsets, $boundary) if ($boundary > $offsets[-1] and $boundary < $size);
+	}
+	push(@offsets, $size);
+	close($fh);
+	
+	my @parts;
+	foreach my $i (0 .. $#offsets - 1) {
+		my ($out, $tmp)	= tempfile();
+		unlink($tmp);
+		binmode($out);
+		my $pid		= fork();
+		unless (defined($pid)) {
+			_reap( @parts );
+			throw RDF::Trine::Error::ParserError -text => "Cannot fork N-Triples parser worker: $!";
+		}
+		if ($pid == 0) {
+			# never let an exception unwind into the parent's stack frames
+			eval { $self->_parse_part( $base, $filename, $offsets[$i], $offsets[$i+1], $out ) };
+			POSIX::_exit( $@ ? 1 : 0 );
+		}
+		push(@parts, { pid => $pid, fh => $out });
+	}
+	
+	my $lines	= 0;
+	my $ok		= eval {
+		while (my $part = shift(@parts)) {
+			waitpid( $part->{pid}, 0 );
+			my $status	= $?;
+			my $in		= $part->{fh};
+			seek( $in, 0, 0 );
+			my $done	= 0;
+			while (read( $in, my $header, 5 ) == 5) {
+				my ($type, $length)	= unpack('a1 N', $header);
+				read( $in, my $payload, $length );
+				if ($type eq 'S') {
+					my ($nodes, $indexes)	= @{ thaw($payload) };
+					if ($RDF::Trine::TermTable::ENABLED) {
+						@$nodes	= map { RDF::Trine::TermTable::intern($_) } @$nodes;
+					}
+					my @indexes	= unpack('N*', $indexes);
+					while (my @i = splice(@indexes, 0, $width)) {
+						if (defined($i[3]) and $i[3] != 0xFFFFFFFF) {
+							$handler->( bless( [ @{ $nodes }[ @i ] ], 'RDF::Trine::Statement::Quad' ) );
+						} else {
+							$handler->( bless( [ @{ $nodes }[ @i[0 .. 2] ] ], 'RDF::Trine::Statement' ) );
+						}
+					}
+				} elsif ($type eq 'E') {
+					my $text	= Encode::decode('utf8', $payload);
+					$text		=~ s/at line (\d+)/'at line ' . ($1 + $lines)/e;
+					throw RDF::Trine::Error::ParserError -text => $text;
+				} elsif ($type eq 'D') {
+					$lines	+= $payload;
+					$done	= 1;
+				}
+			}
+			close($in);
+			unless ($done) {
+				throw RDF::Trine::Error::ParserError -text => "N-Triples parser worker exited with status $status";
+			}
+		}
+		1;
+	};
+	unless ($ok) {
+		my $e	= $@;
+		_reap( @parts );
+		die $e;
+	}
+	return;
 }
 
+# Parses the bytes from $start to $end of $filename in a worker process,
+# writing framed results to $out.
+sub _parse_part {
+	my $self	= shift;
+	my $base	= shift;
+	my $filename	= shift;
+	my $start	= shift;
+	my $end		= shift;
+	my $out		= shift;
+	
+	my $width	= $self->_xs_quads ? 4 : 3;
+	my (@nodes, %ids, @indexes);
+	my $flush	= sub {
+		my $payload	= freeze( [ \@nodes, pack('N*', @indexes) ] );
+		print {$out} pack('a1 N', 'S', length($payload)), $payload;
+		@nodes		= ();
+		%ids		= ();
+		@indexes	= ();
+	};
+	my $handler	= sub {
+		my $st	= shift;
+		my @i;
+		foreach my $n (@$st) {
+			my $key	= (reftype($n) eq 'ARRAY')
+					? join("\0", ref($n), map { defined($_) ? length($_) . ':' . $_ : '' } @$n)
+					: ref($n);
+			my $id	= $ids{ $key };
+			unless (defined($id)) {
+				$id	= $ids{ $key }	= scalar(@nodes);
+				push(@nodes, $n);
+			}
+			push(@i, $id);
+		}
+		push(@i, 0xFFFFFFFF) while (scalar(@i) < $width);
+		push(@indexes, @i);
+		$flush->() if (scalar(@indexes) >= $BATCH_SIZE * $width);
+	};
+	
+	my $lineno	= 0;
+	my $ok		= eval {
+		open( my $fh, '<:raw', $filename ) or die "$!\n";
+		seek( $fh, $start, 0 );
+		my $pos	= $start;
+		while ($pos < $end) {
+			my $want	= ($end - $pos < $CHUNK_SIZE) ? $end - $pos : $CHUNK_SIZE;
+			last unless (read( $fh, my $block, $want ));
+			if ($block !~ /\n\z/ and $pos + length($block) < $end) {
+				my $rest	= <$fh>;
+				$block		.= $rest if (defined($rest));
+			}
+			$pos	+= length($block);
+			open( my $bfh, '<:encoding(UTF-8)', \$block );
+			$lineno	= $self->_parse_lines( $base, $bfh, $handler, $lineno );
+		}
+		$flush->() if (@indexes);
+		1;
+	};
+	if ($ok) {
+		print {$out} pack('a1 N', 'D', length($lineno)), $lineno;
+	} else {
+		my $e		= $@;
+		$flush->() if (@indexes);
+		my $text	= Encode::encode('utf8', (blessed($e) and $e->can('text')) ? $e->text : "$e");
+		print {$out} pack('a1 N', 'E', length($text)), $text;
+	}
+	close($out);
+}
+
+sub _reap {
+	my @parts	= @_;
+	foreach my $part (@parts) {
+		kill( 'TERM', $part->{pid} );
+		waitpid( $part->{pid}, 0 );
+	}
+}
+
+# Reads $fh in chunks of about $CHUNK_SIZE characters, extended to the end of
+# the line, and hands each chunk to the native scanner. Statements parsed
+# before an error in a chunk are still passed to the handler.
+sub _parse_file_xs {
+	my $self	= shift;
+	my $fh		= shift;
+	my $handler	= shift;
+	my $lineno	= shift;
+	my $quads	= $self->_xs_quads;
+	while (read( $fh, my $buffer, $CHUNK_SIZE )) {
+		unless ($buffer =~ /\n\z/) {
+			my $rest	= <$fh>;
+			$buffer		.= $rest if (defined($rest));
+		}
+		my @statements;
+		my $end		= eval { RDF::Trine::XS::parse_ntriples_chunk( $buffer, $lineno, $quads, \@statements ) };
+		my $e		= $@;
+		if ($self->{canonicalize}) {
+			$self->_emit_statement( $handler, [ $_->nodes ], $end ) foreach (@statements);
+		} else {
+			$handler->( $_ ) foreach (@statements);
+		}
+		if ($e) {
+			die $e if (blessed($e));
+			chomp($e);
+			throw RDF::Trine::Error::ParserError -text => $e;
+		}
+		$lineno	= $end;
+	}
+	return $lineno;
+}
+
+sub _xs_quads { 0 }
+
 sub _emit_statement {
 	my $self	= shift;
 	my $handler	= shift;
@@ -327,6 +577,13 @@ sub _unescape {
 	return $value;
 }
 
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	$HAVE_XS_PARSER	= (RDF::Trine::XS->can('parse_ntriples_chunk')) ? 1 : 0;
+}
+
 1;
 
 __END__
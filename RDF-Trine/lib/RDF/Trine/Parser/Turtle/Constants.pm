@@ -29,6 +29,7 @@ our $VERSION;
 our @EXPORT;
 BEGIN {
 	$VERSION				= '1.019';
+	# token types are numbered in this order, which RDF::Trine::XS relies on
 	@EXPORT = qw(
 		LBRACKET
 		RBRACKET
@@ -17,6 +17,12 @@ This document describes RDF::Trine::Parser::Turtle::Lexer version 1.019
    ...
  }
 
+=head1 DESCRIPTION
+
+If L<RDF::Trine::XS> is installed, input is read in large chunks which are
+tokenized natively, and the resulting tokens are returned one at a time by
+C<< get_token >>.
+
 =head1 METHODS
 
 =over 4
@@ -33,9 +39,10 @@ use Moose;
 use Data::Dumper;
 use RDF::Trine::Error;
 
-our $VERSION;
+our ($VERSION, $HAVE_XS_LEXER, $CHUNK_SIZE);
 BEGIN {
 	$VERSION				= '1.019';
+	$CHUNK_SIZE				= 1 << 16;
 }
 
 my $r_nameChar_extra		= qr'[-0-9\x{B7}\x{0300}-\x{036F}\x{203F}-\x{2040}]'o;
@@ -103,6 +110,17 @@ has start_line => (
 	default => -1,
 );
 
+has tokens => (
+	is => 'rw',
+	isa => 'ArrayRef',
+	default => sub { [] },
+);
+
+has error => (
+	is => 'rw',
+	isa => 'Maybe[Str]',
+);
+
 sub BUILDARGS {
 	my $class	= shift;
 	if (scalar(@_) == 1) {
@@ -168,6 +186,9 @@ Returns the next token present in the input.
 
 sub get_token {
 	my $self	= shift;
+	if ($HAVE_XS_LEXER) {
+		return $self->_get_token_xs();
+	}
 	while (1) {
 		unless (length($self->{buffer})) {
 			$self->fill_buffer;
@@ -246,6 +267,41 @@ sub fill_buffer {
 	}
 }
 
+# Returns the next token from those produced by the native tokenizer, scanning
+# another chunk of input when they have all been returned. An error found by
+# the tokenizer is thrown once the tokens preceding it have been returned.
+sub _get_token_xs {
+	my $self	= shift;
+	my $tokens	= $self->{tokens};
+	while (1) {
+		return shift(@$tokens) if (scalar(@$tokens));
+		if (defined(my $error = $self->{error})) {
+			return $self->_throw_error($error);
+		}
+		my $eof	= $self->_fill_buffer_chunk;
+		return if ($eof and not length($self->{buffer}));
+		my ($line, $col, $error)	= RDF::Trine::XS::scan_turtle_tokens( $self->{buffer}, $self->{line}, $self->{column}, $eof, $tokens );
+		$self->{line}	= $line;
+		$self->{column}	= $col;
+		$self->{error}	= $error;
+	}
+}
+
+# Appends about $CHUNK_SIZE characters of input, extended to the end of the
+# line, to the buffer. Returns true if the end of the input has been reached.
+sub _fill_buffer_chunk {
+	my $self	= shift;
+	my $fh		= $self->file;
+	my $read	= read( $fh, my $chunk, $CHUNK_SIZE );
+	return 1 unless ($read);
+	unless ($chunk =~ /\n\z/) {
+		my $rest	= <$fh>;
+		$chunk		.= $rest if (defined($rest));
+	}
+	$self->{buffer}	.= $chunk;
+	return 0;
+}
+
 =item C<< check_for_bom >>
 
 Checks the input buffer for a Unicode BOM, and consumes it if it is present.
@@ -713,6 +769,13 @@ sub _throw_error {
 	);
 }
 
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	$HAVE_XS_LEXER	= (RDF::Trine::XS->can('scan_turtle_tokens')) ? 1 : 0;
+}
+
 __PACKAGE__->meta->make_immutable;
 
 1;
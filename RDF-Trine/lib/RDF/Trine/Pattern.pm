@@ -216,6 +216,43 @@ sub sort_for_join_variables {
 	return $class->merge_patterns(@patterns);
 }
 
+=item C<< sort_by_cardinality ( $statistics ) >>
+
+Returns a new pattern object with the triples ordered for a left-deep join,
+using the cardinality estimates of the supplied
+L<RDF::Trine::Store::Statistics> object. The triple with the smallest
+estimate comes first. Each following triple is the one with the smallest
+estimate given the variables bound by the triples before it, preferring
+triples that share a variable with them over ones that would produce a cross
+product.
+
+=cut
+
+sub sort_by_cardinality {
+	my $self	= shift;
+	my $stats	= shift;
+	my @triples	= $self->triples;
+	return $self if (scalar(@triples) < 2);
+
+	my %bound;
+	my @ordered;
+	while (@triples) {
+		my ($best, $best_joined, $best_card);
+		foreach my $i (0 .. $#triples) {
+			my @vars	= $triples[$i]->referenced_variables;
+			my $joined	= (not(@ordered) or not(@vars) or any { $bound{ $_ } } @vars) ? 1 : 0;
+			my $card	= $stats->cardinality( $triples[$i], \%bound );
+			if (not(defined($best)) or $joined > $best_joined or ($joined == $best_joined and $card < $best_card)) {
+				($best, $best_joined, $best_card)	= ($i, $joined, $card);
+			}
+		}
+		my ($t)	= splice(@triples, $best, 1);
+		push(@ordered, $t);
+		$bound{ $_ }++ foreach ($t->referenced_variables);
+	}
+	return ref($self)->new( @ordered );
+}
+
 
 =item C<< subgroup >>
 
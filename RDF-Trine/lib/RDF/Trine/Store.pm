@@ -53,6 +53,8 @@ RDF::Trine::Store:
 
 =item * C<< size >>
 
+=item * C<< statistics >>
+
 =item * C<< nuke >>
 
 =item * C<< _begin_bulk_ops >>
@@ -269,6 +271,8 @@ sub _get_pattern {
 	
 	if ($bgp->isa('RDF::Trine::Statement')) {
 		$bgp	= RDF::Trine::Pattern->new($bgp);
+	} elsif (scalar($bgp->triples) > 1 and $self->statistics) {
+		$bgp	= $bgp->sort_by_cardinality( $self->statistics );
 	} else {
 		$bgp	= $bgp->sort_for_join_variables();
 	}
@@ -480,6 +484,18 @@ sub etag {
 	return;
 }
 
+=item C<< statistics >>
+
+If the store maintains them, returns an L<RDF::Trine::Store::Statistics> object
+describing the store's data, used to estimate the cardinality of triple
+patterns when ordering joins. Returns undef otherwise.
+
+=cut
+
+sub statistics {
+	return;
+}
+
 =item C<< supports ( [ $feature ] ) >>
 
 If C<< $feature >> is specified, returns true if the feature is supported by the
@@ -46,6 +46,7 @@ use DBIx::Connector;
 use Carp;
 use DBI;
 use Scalar::Util qw(blessed reftype refaddr);
+use Config;
 use Encode;
 use Digest::MD5 ('md5');
 use Math::BigInt;
@@ -489,7 +490,8 @@ sub add_statement {
 # 	Carp::confess unless (blessed($stmt));
 	my $stable	= $self->statements_table;
 	my @nodes	= $stmt->nodes;
-	my @values = map { $self->_add_node( $_ ) } @nodes;
+	my @hashes	= $self->_mysql_node_hashes( @nodes );
+	my @values	= map { $self->_add_node( $nodes[$_], $hashes[$_] ) } (0 .. $#nodes);
 	
 	if ($stmt->isa('RDF::Trine::Statement::Quad')) {
 		if (blessed($context)) {
@@ -542,7 +544,7 @@ sub remove_statement {
 	
 	my @nodes	= $stmt->nodes;
 	my $sth		= $dbh->prepare("DELETE FROM ${stable} WHERE Subject = ? AND Predicate = ? AND Object = ? AND Context = ?");
-	my @values	= map { $self->_mysql_node_hash( $_ ) } (@nodes);
+	my @values	= $self->_mysql_node_hashes( @nodes );
 	$sth->execute( @values );
 }
 
@@ -573,14 +575,15 @@ sub remove_statements {
 	
 	my $where	= join(" AND ", @where);
 	my $sth		= $dbh->prepare( join(' ', "DELETE FROM ${stable}", ($where ? "WHERE ${where}" : ())) );
-	my @values	= map { $self->_mysql_node_hash( $_ ) } (@bind);
+	my @values	= $self->_mysql_node_hashes( @bind );
 	$sth->execute( @values );
 }
 
 sub _add_node {
 	my $self	= shift;
 	my $node	= shift;
-	my $hash	= $self->_mysql_node_hash( $node );
+	my $hash	= shift;
+	$hash		= $self->_mysql_node_hash( $node ) unless (defined($hash));
 	my $dbh		= $self->dbh;
 	
 	my @cols;
@@ -610,7 +613,8 @@ sub _add_node {
 	
 	my $ssql	= "SELECT 1 FROM ${table} WHERE " . join(' AND ', map { join(' = ', $_, '?') } @cols);
 	my $sth	= $dbh->prepare( $ssql );
-	my @values	= map {"$_"} @values{ @cols };
+	# the ID is bound as-is so that native integer hashes reach DBI unchanged
+	my @values	= ($hash, map {"$_"} @values{ @cols[ 1 .. $#cols ] });
 	$sth->execute( @values );
 	unless ($sth->fetch) {
 		my $sql	= "INSERT INTO ${table} (" . join(', ', @cols) . ") VALUES (" . join(',',('?')x scalar(@cols)) . ")";
@@ -1140,13 +1144,10 @@ sub _add_sql_node_clause {
 			_add_var( $context, $name, $col );
 		}
 	} elsif ($node->isa('RDF::Trine::Node::Resource')) {
-		my $uri	= $node->uri_value;
 		my $id	= $self->_mysql_node_hash( $node );
-		$id		=~ s/\D//;
 		_add_where( $context, "${col} = $id" );
 	} elsif ($node->isa('RDF::Trine::Node::Blank')) {
 		my $id	= $self->_mysql_node_hash( $node );
-		$id		=~ s/\D//;
 		_add_where( $context, "${col} = $id" );
 #		my $id	= $node->blank_identifier;
 #		my $b	= "b$level";
@@ -1155,7 +1156,6 @@ sub _add_sql_node_clause {
 #		_add_where( $context, "${b}.Name = '$id'" );
 	} elsif ($node->isa('RDF::Trine::Node::Literal')) {
 		my $id	= $self->_mysql_node_hash( $node );
-		$id		=~ s/\D//;
 		_add_where( $context, "${col} = $id" );
 	} elsif ($node->is_nil) {
 		_add_where( $context, "${col} = 0" );
@@ -1194,16 +1194,27 @@ sub _sql_for_ggp {
 =item C<< _mysql_hash ( $data ) >>
 
 Returns a hash value for the supplied C<$data> string. This value is computed
-using the same algorithm that Redland's mysql storage backend uses.
+using the same algorithm that Redland's mysql storage backend uses. On perls
+with 64-bit integers the value is a native unsigned integer; otherwise it is
+a decimal string. If RDF::Trine::XS is available, the MD5 digest and the
+folded value are computed natively.
 
 =cut
 
+# True if this perl can represent the 64-bit hash values as native integers.
+use constant NATIVE_64BIT_HASH	=> (($Config{uvsize} >= 8) ? 1 : 0);
+
 sub _mysql_hash;
+our $HAVE_XS_NODE_HASH;
 sub _mysql_hash_pp {
 	if (ref($_[0])) {
 		my $self = shift;
 	}
 	my $data	= encode('utf8', shift);
+	if (NATIVE_64BIT_HASH) {
+		return unpack('Q<', md5( $data ));
+	}
+	
 	my @data	= unpack('C*', md5( $data ));
 	my $sum		= Math::BigInt->new('0');
 	foreach my $count (0 .. 7) {
@@ -1224,6 +1235,7 @@ BEGIN {
 	*{ '_mysql_hash' }	= (RDF::Trine::XS->can('hash'))
 		? \&RDF::Trine::XS::hash
 		: \&_mysql_hash_pp;
+	$HAVE_XS_NODE_HASH	= (RDF::Trine::XS->can('hash_nodes')) ? 1 : 0;
 	## use critic
 }
 
@@ -1268,6 +1280,26 @@ sub _mysql_node_hash {
 	return $hash;
 }
 
+=item C<< _mysql_node_hashes ( @nodes ) >>
+
+Returns the list of hash values (as computed by C<_mysql_node_hash>) for the
+supplied C<@nodes>. If RDF::Trine::XS is available, the whole list is hashed
+natively with a single call.
+
+=cut
+
+sub _mysql_node_hashes {
+	my $self	= shift;
+	if ($HAVE_XS_NODE_HASH) {
+		return RDF::Trine::XS::hash_nodes( [ @_ ], $self->_mysql_hash_signed );
+	}
+	return map { $self->_mysql_node_hash( $_ ) } @_;
+}
+
+# True if hash values must fit in a signed 64-bit integer column (see the
+# SQLite subclass).
+sub _mysql_hash_signed { 0 }
+
 =item C<< statements_table >>
 
 Returns the name of the Statements table.
@@ -95,12 +95,17 @@ sub new_with_config {
 # SQLite only supports 64-bit SIGNED integers, so this hash function masks out
 # the high-bit on hash values (unlike the superclass which produces full 64-bit
 # integers)
-sub _mysql_hash {
+sub _mysql_hash;
+sub _mysql_hash_pp {
 	if (ref($_[0])) {
 		my $self = shift;
 	}
 	Carp::confess unless scalar(@_);
 	my $data	= encode('utf8', shift);
+	if (RDF::Trine::Store::DBI::NATIVE_64BIT_HASH()) {
+		return unpack('Q<', md5( $data )) & (~0 >> 1);
+	}
+	
 	my @data	= unpack('C*', md5( $data ));
 	my $sum		= Math::BigInt->new('0');
 	# CHANGE: 7 -> 6, Smaller numbers for Sqlite which does not support real 64-bit :(
@@ -116,6 +121,18 @@ sub _mysql_hash {
 	return $sum;
 }
 
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	no strict 'refs';
+	*{ '_mysql_hash' }	= (RDF::Trine::XS->can('hash'))
+		? sub { shift if (ref($_[0])); return RDF::Trine::XS::hash( shift, 1 ) }
+		: \&_mysql_hash_pp;
+	## use critic
+}
+
+sub _mysql_hash_signed { 1 }
+
 =item C<< init >>
 
 Creates the necessary tables in the underlying database.
@@ -83,11 +83,11 @@ sub add_statement {
 		Carp::confess "No statement passed to add_statement";
 	}
 	my @nodes	= $stmt->nodes;
-	foreach my $n (@nodes) {
-		$self->_add_node( $n );
+	my @values	= $self->_mysql_node_hashes( @nodes );
+	foreach my $i (0 .. $#nodes) {
+		$self->_add_node( $nodes[$i], $values[$i] );
 	}
 	
-	my @values	= map { $self->_mysql_node_hash( $_ ) } @nodes;
 	if ($stmt->isa('RDF::Trine::Statement::Quad')) {
 		if (blessed($context)) {
 			throw RDF::Trine::Error::MethodInvocationError -text => "add_statement cannot be called with both a quad and a context";
@@ -112,7 +112,8 @@ sub add_statement {
 sub _add_node {
 	my $self	= shift;
 	my $node	= shift;
-	my $hash	= $self->_mysql_node_hash( $node );
+	my $hash	= shift;
+	$hash		= $self->_mysql_node_hash( $node ) unless (defined($hash));
 	my $dbh		= $self->dbh;
 	
 	my @cols;
@@ -144,7 +145,7 @@ sub _add_node {
 	
 	my $sql	= "INSERT IGNORE INTO ${table} (" . join(', ', @cols) . ") VALUES (" . join(',',('?')x scalar(@cols)) . ")";
 	my $sth	= $dbh->prepare( $sql );
-	$sth->execute( map "$_", @values{ @cols } );
+	$sth->execute( $hash, map "$_", @values{ @cols[ 1 .. $#cols ] } );
 	return $hash;
 }
 
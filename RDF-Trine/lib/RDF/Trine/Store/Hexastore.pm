@@ -15,6 +15,14 @@ This document describes RDF::Trine::Store::Hexastore version 1.019
 RDF::Trine::Store::Hexastore provides an in-memory triple-store based on
 six-way indexing as popularized by Hexastore.
 
+Nodes are dictionary-encoded as integer IDs. Below the top level of each
+index (a hash from node ID to index page), the node IDs are kept as packed
+strings of sorted 32-bit IDs rather than as Perl hashes and arrays: each
+index page maps the ID of a second node to its terminal list through a
+packed ID page and a parallel array of lists, and the terminal lists are
+packed ID pages themselves. If L<RDF::Trine::XS> is installed, searches,
+inserts and removals on the packed pages are performed natively.
+
 =cut
 
 package RDF::Trine::Store::Hexastore;
@@ -27,6 +35,7 @@ use base qw(RDF::Trine::Store);
 use Data::Dumper;
 use RDF::Trine qw(iri);
 use RDF::Trine::Error;
+use RDF::Trine::Store::Statistics;
 use List::Util qw(first);
 use Scalar::Util qw(refaddr reftype blessed);
 use Storable qw(nstore retrieve);
@@ -168,19 +177,93 @@ This data may be read back in with the C<< load >> method.
 sub store {
 	my $self	= shift;
 	my $fname	= shift;
+	# statistics are rebuilt when next needed rather than stored
+	local($self->{statistics});
 	nstore( $self, $fname );
 }
 
+=item C<< store_mapped ( $filename ) >>
+
+Write the triples data to a file specified by C<< $filename >> in the
+read-only index format described in L<RDF::Trine::Store::Hexastore::Mapped>.
+When read back in with the C<< load >> method, the file is queried in place
+(memory-mapped if L<RDF::Trine::XS> is available) instead of being
+deserialized.
+
+=cut
+
+sub store_mapped {
+	my $self	= shift;
+	my $fname	= shift;
+	require RDF::Trine::Store::Hexastore::Mapped;
+	my @triples;
+	my $subjects	= $self->_index_root->{ subject };
+	foreach my $sid (keys %$subjects) {
+		my $preds	= $self->_index_values_from_key( $subjects->{ $sid }, 'predicate' );
+		foreach my $pid ($self->_index_values( $preds )) {
+			push( @triples, map { pack('N3', $sid, $pid, $_) } $self->_node_values( $self->_node_list_from_id( $preds, $pid ) ) );
+		}
+	}
+	return RDF::Trine::Store::Hexastore::Mapped->_write_file( $fname, $self->{ id2node }, \@triples );
+}
+
 =item C<< load ( $filename ) >>
 
 Returns a new Hexastore object with triples data from the specified file.
+Files written by C<< store_mapped >> are detected automatically, and are
+returned as a L<RDF::Trine::Store::Hexastore::Mapped> object.
 
 =cut
 
 sub load {
 	my $class	= shift;
 	my $fname	= shift;
-	return retrieve($fname);
+	require RDF::Trine::Store::Hexastore::Mapped;
+	if (RDF::Trine::Store::Hexastore::Mapped->is_mapped_file( $fname )) {
+		return RDF::Trine::Store::Hexastore::Mapped->load( $fname );
+	}
+	my $self	= retrieve($fname);
+	$self->_upgrade_index;
+	return $self;
+}
+
+# Converts data written by older versions of this module (node lists stored as
+# arrays, index pages mapping IDs to lists with hashes, and the id2node map
+# stored as a hash) to the current layout.
+sub _upgrade_index {
+	my $self	= shift;
+	if (reftype($self->{id2node}) eq 'HASH') {
+		my $map	= $self->{id2node};
+		my @id2node;
+		@id2node[ keys %$map ]	= values %$map;
+		$self->{id2node}	= \@id2node;
+	}
+	
+	my %seen;
+	my $root	= $self->_index_root;
+	foreach my $key (grep { $_ ne '__type' } keys %$root) {
+		foreach my $index (values %{ $root->{ $key } }) {
+			foreach my $k (grep { $_ ne '__type' } keys %$index) {
+				my $values	= $index->{ $k };
+				next unless (reftype($values) eq 'HASH');
+				my $map		= $self->_new_map_page;
+				foreach my $id (sort { $a <=> $b } keys %$values) {
+					my $list	= $values->{ $id };
+					if (reftype($list) eq 'ARRAY') {
+						# terminal lists are shared between two indexes, so
+						# convert each one once and point both parents at it
+						$list	= $seen{ refaddr($list) } ||= do {
+							my $packed	= pack('N*', sort { $a <=> $b } @$list);
+							\$packed;
+						};
+					}
+					${ $map->[0] }	.= pack('N', $id);
+					push( @{ $map->[1] }, $list );
+				}
+				$index->{ $k }	= $map;
+			}
+		}
+	}
 }
 
 =item C<< temporary_store >>
@@ -369,7 +452,7 @@ sub get_statements {
 	 				return unless (scalar(@skeys));
 					$sid	= shift(@skeys);
 # 					warn "*** using subject $sid\n";
-					@pkeys	= sort { $a <=> $b } keys %{ $subj->{ $sid }{ $order_keys[1] } };
+					@pkeys	= $self->_index_values( $self->_index_values_from_key( $subj->{ $sid }, $order_keys[1] ) );
 					if ($max >= 2) {
 						@pkeys	= grep { $_ == $sid } @pkeys;
 					}
@@ -407,10 +490,15 @@ Returns a stream object of all bindings matching the specified graph pattern.
 sub get_pattern {
 	my $self	= shift;
 	my $bgp		= shift;
-	if ($bgp->isa('RDF::Trine::Pattern')) {
-		$bgp	= $bgp->sort_for_join_variables();
+	if ($bgp->isa('RDF::Trine::Pattern') and scalar($bgp->triples) > 1) {
+		if (my $stats = $self->statistics) {
+			$bgp	= $bgp->sort_by_cardinality( $stats );
+		}
 	}
 	my @triples	= $bgp->triples;
+	if (my $iter = $self->_get_star_pattern( $bgp, @triples )) {
+		return $iter;
+	}
 	if (2 == scalar(@triples)) {
 		my ($t1, $t2)	= @triples;
 		my @v1	= $t1->referenced_variables;
@@ -490,6 +578,124 @@ sub get_pattern {
 	}
 }
 
+# Answers BGPs in which every triple shares one variable (most commonly
+# star-shaped queries about a single subject) by intersecting the sorted node
+# ID lists that each triple allows for the shared variable. The remaining
+# variables are filled in from the terminal lists of the surviving IDs, and
+# nodes are only looked up for the final bindings. Returns undef if the BGP
+# does not have this shape.
+sub _get_star_pattern {
+	my $self	= shift;
+	my $bgp		= shift;
+	my @triples	= @_;
+	return unless (scalar(@triples) > 1);
+	
+	my @names	= NODES;
+	my @shapes;
+	foreach my $t (@triples) {
+		return if ($t->isa('RDF::Trine::Statement::Quad'));
+		my @nodes	= $t->nodes;
+		my (%bound, %vars);
+		foreach my $i (0 .. 2) {
+			my $node	= $nodes[ $i ];
+			if ($node->isa('RDF::Trine::Node::Variable')) {
+				return if (exists $vars{ $node->name });
+				$vars{ $node->name }	= $names[ $i ];
+			} else {
+				my $id	= $self->_existing_node_id( $node );
+				unless (defined($id)) {
+					# a node that isn't in the store can't match anything
+					return RDF::Trine::Iterator::Bindings->new( [], [ $bgp->referenced_variables ] );
+				}
+				$bound{ $names[ $i ] }	= $id;
+			}
+		}
+		return unless (scalar(%bound));
+		push( @shapes, { bound => \%bound, vars => \%vars } );
+	}
+	
+	my $join	= first {
+		my $var	= $_;
+		not(grep { not exists $_->{vars}{ $var } } @shapes)
+	} (sort keys %{ $shapes[0]{vars} });
+	return unless (defined($join));
+	
+	my @lists;
+	foreach my $shape (@shapes) {
+		$shape->{join}	= delete $shape->{vars}{ $join };
+		($shape->{var}, $shape->{pos})	= %{ $shape->{vars} };
+		push( @lists, [ $self->_join_ids( $shape->{bound}, $shape->{join} ) ] );
+	}
+	my @ids		= _intersect_sorted( @lists );
+	my @others	= grep { defined($_->{var}) } @shapes;
+	
+	my @buffer;
+	my $sub		= sub {
+		while (not(scalar(@buffer)) and scalar(@ids)) {
+			my $id		= shift(@ids);
+			my @rows	= ({ $join => $id });
+			foreach my $shape (@others) {
+				my $var		= $shape->{var};
+				my @values	= $self->_join_values( $shape->{bound}, $shape->{join}, $id, $shape->{pos} );
+				my @next;
+				foreach my $row (@rows) {
+					if (exists $row->{ $var }) {
+						push( @next, $row ) if (grep { $_ == $row->{ $var } } @values);
+					} else {
+						push( @next, map { +{ %$row, $var => $_ } } @values );
+					}
+				}
+				@rows	= @next;
+				last unless (scalar(@rows));
+			}
+			foreach my $row (@rows) {
+				my %data	= map { $_ => $self->_id2node( $row->{ $_ } ) } keys %$row;
+				push( @buffer, RDF::Trine::VariableBindings->new( \%data ) );
+			}
+		}
+		return shift(@buffer);
+	};
+	return RDF::Trine::Iterator::Bindings->new( $sub, [ $bgp->referenced_variables ] );
+}
+
+# Returns the intersection of several lists of ascending IDs. Each ID of the
+# shortest list is looked for in the others by galloping forward from the
+# position of the previous match.
+sub _intersect_sorted {
+	my @lists	= sort { scalar(@$a) <=> scalar(@$b) } @_;
+	my $first	= shift(@lists);
+	my @cursor	= (0) x scalar(@lists);
+	my @ids;
+	ID: foreach my $id (@$first) {
+		foreach my $i (0 .. $#lists) {
+			my $list	= $lists[ $i ];
+			my $size	= scalar(@$list);
+			my $lo		= $cursor[ $i ];
+			my $hi		= $lo;
+			my $step	= 1;
+			while ($hi < $size and $list->[ $hi ] < $id) {
+				$lo		= $hi + 1;
+				$hi		+= $step;
+				$step	*= 2;
+			}
+			$hi	= $size if ($hi > $size);
+			while ($lo < $hi) {
+				my $mid	= ($lo + $hi) >> 1;
+				if ($list->[ $mid ] < $id) {
+					$lo	= $mid + 1;
+				} else {
+					$hi	= $mid;
+				}
+			}
+			$cursor[ $i ]	= $lo;
+			last ID if ($lo >= $size);
+			next ID unless ($list->[ $lo ] == $id);
+		}
+		push( @ids, $id );
+	}
+	return @ids;
+}
+
 =item C<< supports ( [ $feature ] ) >>
 
 If C<< $feature >> is specified, returns true if the feature is supported by the
@@ -567,6 +773,7 @@ sub add_statement {
 	if ($added) {
 		$self->{ size }++;
 		$self->{etag} = time;
+		$self->{statistics}->add_statement( $st ) if ($self->{statistics});
 	}
 }
 
@@ -603,6 +810,7 @@ sub remove_statement {
 	if ($removed) {
 		$self->{ size }--;
 		$self->{etag} = time;
+		$self->{statistics}->remove_statement( $st ) if ($self->{statistics});
 	}
 }
 
@@ -620,6 +828,19 @@ sub etag {
 	return $_[0]->{etag};
 }
 
+=item C<< statistics >>
+
+Returns an L<RDF::Trine::Store::Statistics> object for the data in the store.
+The statistics are computed on first use and then kept up to date as
+statements are added and removed.
+
+=cut
+
+sub statistics {
+	my $self	= shift;
+	return $self->{statistics} ||= RDF::Trine::Store::Statistics->new_from_store( $self );
+}
+
 
 =item C<< nuke >>
 
@@ -631,10 +852,11 @@ sub nuke {
 	my $self = shift;
 	$self->{data} = $self->_new_index_page;
 	$self->{node2id} = {};
-	$self->{id2node} = {};
+	$self->{id2node} = [];
 	$self->{next_id} = 1;
 	$self->{size} = 0;
 	$self->{etag} = time;
+	delete $self->{statistics};
 	return $self;
 }
 
@@ -695,9 +917,10 @@ sub _count_statements {
 	} else {
 		my $count	= 0;
 		my $ukey	= shift(@ukeys);
-		my $data	= $data->{ $ukey };
-		foreach my $k (keys %$data) {
-			$count	+= $self->_count_statements( $data->{ $k }, @ukeys );
+		my $map		= $self->_index_values_from_key( $data, $ukey );
+		return 0 unless (ref($map));
+		foreach my $list (@{ $map->[1] }) {
+			$count	+= $self->_count_statements( $list, @ukeys );
 		}
 		return $count;
 	}
@@ -718,7 +941,7 @@ sub _node2id {
 		return $id;
 	} else {
 		$id	= ($self->{ node2id }{ $str } = $self->{ next_id }++);
-		$self->{ id2node }{ $id }	= $node;
+		$self->{ id2node }[ $id ]	= $node;
 		return $id
 	}
 }
@@ -726,22 +949,31 @@ sub _node2id {
 sub _id2node {
 	my $self	= shift;
 	my $id		= shift;
-	if (exists( $self->{ id2node }{ $id } )) {
-		return $self->{ id2node }{ $id };
-	} else {
-		return;
-	}
+	return $self->{ id2node }[ $id ];
+}
+
+# Like _node2id, but returns undef instead of allocating an ID for a node that
+# isn't in the store.
+sub _existing_node_id {
+	my $self	= shift;
+	my $node	= shift;
+	return $self->{ node2id }{ $node->as_string };
 }
 
 sub _seen_nodes {
 	my $self	= shift;
-	return values %{ $self->{ id2node } };
+	return grep { defined($_) } @{ $self->{ id2node } };
 }
 
 ################################################################################
 ### The methods below are the only ones that directly access and manipulate the
 ### index structure. The terminal node lists, however, are manipulated by other
 ### methods (add_statement, remove_statement, etc.).
+###
+### The root maps each position name to a hash from node ID to index page. An
+### index page maps each of the two other position names to a map page: a
+### pair of a packed ID page and an array of the terminal lists for those
+### IDs, in the same order.
 
 sub _index_root {
 	my $self	= shift;
@@ -790,7 +1022,16 @@ sub _add_list_page {
 	my $key		= shift;
 	my $value	= shift;
 	my $list	= shift || $self->_new_list_page;
-	$index->{ $key }{ $value }	= $list;
+	my $map		= $index->{ $key } ||= $self->_new_map_page;
+	my $pos		= _page_search( ${ $map->[0] }, $value );
+	if ($pos >= 0) {
+		$map->[1][ $pos ]	= $list;
+	} else {
+		$pos	= -$pos - 1;
+		substr(${ $map->[0] }, $pos * 4, 0, pack('N', $value));
+		splice( @{ $map->[1] }, $pos, 0, $list );
+	}
+	return $list;
 }
 
 sub _add_index_page {
@@ -806,14 +1047,25 @@ sub _index_from_pair {
 	my $index	= shift;
 	my $key		= shift;
 	my $val		= shift;
-	return $index->{ $key }{ $val };
+	return unless (ref($index));
+	my $values	= $index->{ $key };
+	if (ref($values) eq 'ARRAY') {
+		my $pos	= _page_search( ${ $values->[0] }, $val );
+		return ($pos >= 0) ? $values->[1][ $pos ] : undef;
+	} elsif (ref($values)) {
+		return $values->{ $val };
+	} else {
+		return;
+	}
 }
 
 sub _node_list_from_id {
 	my $self	= shift;
-	my $index	= shift;
+	my $map		= shift;
 	my $id		= shift;
-	return $index->{ $id };
+	return unless (ref($map));
+	my $pos		= _page_search( ${ $map->[0] }, $id );
+	return ($pos >= 0) ? $map->[1][ $pos ] : undef;
 }
 
 sub _index_values_from_key {
@@ -823,11 +1075,47 @@ sub _index_values_from_key {
 	return $index->{ $key };
 }
 
+# Returns the ascending IDs that may appear in position $join of a triple
+# whose other bound positions are given in %$bound (position name => ID).
+sub _join_ids {
+	my $self	= shift;
+	my $bound	= shift;
+	my $join	= shift;
+	my @keys	= %$bound;
+	my $index	= $self->_index_from_pair( $self->_index_root, @keys[ 0,1 ] );
+	if (scalar(@keys) == 4) {
+		my $list	= $self->_index_from_pair( $index, @keys[ 2,3 ] );
+		return $self->_node_values( $list );
+	} else {
+		my $map		= $self->_index_values_from_key( $index, $join );
+		my @ids		= $self->_index_values( $map );
+		return @ids[ grep { $self->_node_count( $map->[1][ $_ ] ) } (0 .. $#ids) ];
+	}
+}
+
+# Returns the IDs in position $pos of the triples matching %$bound with $id in
+# position $join.
+sub _join_values {
+	my $self	= shift;
+	my $bound	= shift;
+	my $join	= shift;
+	my $id		= shift;
+	my $pos		= shift;
+	my @keys	= (%$bound, $join => $id);
+	my $index	= $self->_index_from_pair( $self->_index_root, @keys[ 0,1 ] );
+	my $list	= $self->_index_from_pair( $index, @keys[ 2,3 ] );
+	return $self->_node_values( $list );
+}
+
 sub _index_values {
 	my $self	= shift;
 	my $index	= shift;
 	my $rev		= shift;
-	if ($rev) {
+	return unless (ref($index));
+	if (reftype($index) eq 'ARRAY') {
+		my @values	= unpack('N*', ${ $index->[0] });
+		return ($rev) ? reverse(@values) : @values;
+	} elsif ($rev) {
 		my @values	= sort { $b <=> $a } keys %$index;
 		return @values;
 	} else {
@@ -839,17 +1127,23 @@ sub _index_values {
 #########################################
 #########################################
 
+# Terminal node lists are references to strings of sorted, big-endian 32-bit
+# node IDs, and map pages keep their keys in the same form. The _page_*
+# functions below are replaced by their RDF::Trine::XS equivalents when that
+# module is available.
+
 sub _node_count {
 	my $self	= shift;
 	my $list	= shift;
-	return scalar(@{ $list || [] });
+	return 0 unless (ref($list));
+	return length($$list) / 4;
 }
 
 sub _node_values {
 	my $self	= shift;
 	my $list	= shift;
 	if (ref($list)) {
-		return @$list;
+		return unpack('N*', $$list);
 	} else {
 		return;
 	}
@@ -859,34 +1153,81 @@ sub _page_contains_node {
 	my $self	= shift;
 	my $list	= shift;
 	my $id		= shift;
-	foreach (@$list) {
-		return 1 if ($_ == $id);
-	}
-	return 0;
+	return 0 unless (ref($list));
+	return _page_contains( $$list, $id );
 }
 
 sub _add_node_to_page {
 	my $self	= shift;
 	my $list	= shift;
 	my $id		= shift;
-	if ($self->_page_contains_node( $list, $id )) {
-		return 0;
-	} else {
-		@$list	= sort { $a <=> $b } (@$list, $id);
-		return 1;
-	}
+	return _page_insert( $list, $id );
 }
 
 sub _remove_node_from_page {
 	my $self	= shift;
 	my $list	= shift;
 	my $id		= shift;
-	if ($self->_page_contains_node( $list, $id )) {
-		@$list	= grep { $_ != $id } @$list;
-		return 1;
-	} else {
-		return 0;
+	return _page_remove( $list, $id );
+}
+
+# Returns the position of $id in the packed $page, or -(insertion point + 1)
+# if it is not present.
+sub _page_search_pp {
+	my $page	= shift;
+	my $id		= shift;
+	my $lo		= 0;
+	my $hi		= length($page) / 4;
+	while ($lo < $hi) {
+		my $mid	= ($lo + $hi) >> 1;
+		my $v	= vec($page, $mid, 32);
+		if ($v < $id) {
+			$lo	= $mid + 1;
+		} elsif ($v > $id) {
+			$hi	= $mid;
+		} else {
+			return $mid;
+		}
 	}
+	return -$lo - 1;
+}
+
+sub _page_contains_pp {
+	my $page	= shift;
+	my $id		= shift;
+	return (_page_search( $page, $id ) >= 0) ? 1 : 0;
+}
+
+sub _page_insert_pp {
+	my $list	= shift;
+	my $id		= shift;
+	$$list		= '' unless (defined($$list));
+	my $pos		= _page_search( $$list, $id );
+	return 0 if ($pos >= 0);
+	substr($$list, (-$pos - 1) * 4, 0, pack('N', $id));
+	return 1;
+}
+
+sub _page_remove_pp {
+	my $list	= shift;
+	my $id		= shift;
+	return 0 unless (defined($$list));
+	my $pos		= _page_search( $$list, $id );
+	return 0 if ($pos < 0);
+	substr($$list, $pos * 4, 4, '');
+	return 1;
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	no strict 'refs';
+	my $xs	= RDF::Trine::XS->can('id_page_insert') ? 1 : 0;
+	*{ '_page_search' }		= RDF::Trine::XS->can('id_page_search') ? \&RDF::Trine::XS::id_page_search : \&_page_search_pp;
+	*{ '_page_contains' }	= $xs ? \&RDF::Trine::XS::id_page_contains : \&_page_contains_pp;
+	*{ '_page_insert' }		= $xs ? \&RDF::Trine::XS::id_page_insert : \&_page_insert_pp;
+	*{ '_page_remove' }		= $xs ? \&RDF::Trine::XS::id_page_remove : \&_page_remove_pp;
+	## use critic
 }
 
 sub _new_index_page {
@@ -894,7 +1235,13 @@ sub _new_index_page {
 }
 
 sub _new_list_page {
-	return [];
+	my $page	= '';
+	return \$page;
+}
+
+sub _new_map_page {
+	my $page	= '';
+	return [ \$page, [] ];
 }
 
 ################################################################################
@@ -0,0 +1,600 @@
+=head1 NAME
+
+RDF::Trine::Store::Hexastore::Mapped - Read-only hexastore backed by a memory-mapped index file
+
+=head1 VERSION
+
+This document describes RDF::Trine::Store::Hexastore::Mapped version 1.019
+
+=head1 SYNOPSIS
+
+ use RDF::Trine::Store::Hexastore;
+ $hexastore->store_mapped( $filename );
+
+ my $store	= RDF::Trine::Store::Hexastore->load( $filename );
+
+=head1 DESCRIPTION
+
+RDF::Trine::Store::Hexastore::Mapped provides access to a hexastore that was
+written with L<RDF::Trine::Store::Hexastore/store_mapped>. The file holds a
+term dictionary and the six triple orderings (spo, sop, pso, pos, osp, ops) as
+sorted arrays of fixed-width big-endian ID records, so the store can be
+queried in place: a triple pattern is answered by binary searching the
+ordering whose prefix matches the bound positions, and nodes are decoded from
+the dictionary only as statements are returned.
+
+If L<RDF::Trine::XS> is installed, the file is mapped into memory with
+L<mmap(2)> and opening a store costs the same regardless of its size.
+Otherwise the file is read into memory in a single pass, which still avoids
+rebuilding any Perl data structures.
+
+The store is read-only on disk. The first modification (C<add_statement>,
+C<remove_statement>, C<nuke>, ...) converts the object into a regular
+in-memory L<RDF::Trine::Store::Hexastore> holding the same data.
+
+=head2 File Format
+
+All integers are unsigned and big-endian.
+
+ magic            "RTHX"
+ version          32-bit (currently 1)
+ node count       32-bit (the highest node ID in the dictionary)
+ triple count     32-bit
+ section offsets  9 x 64-bit: term offsets, term data, term index,
+                  spo, sop, pso, pos, osp, ops
+
+The term offset table holds C<< node count + 2 >> 64-bit offsets into the
+term data, the record for ID C<$i> spanning from entry C<$i> to entry
+C<$i + 1>. Records are C<"R"> or C<"B"> followed by the UTF-8 URI or blank
+node ID, or C<"L"> followed by the 32-bit length-prefixed language and
+datatype and then the UTF-8 literal value. The term index lists the IDs of
+all terms sorted by their record bytes. Each ordering section is an array
+of C<triple count> 12-byte records of three 32-bit IDs.
+
+=cut
+
+package RDF::Trine::Store::Hexastore::Mapped;
+
+use strict;
+use warnings;
+no warnings 'redefine';
+use base qw(RDF::Trine::Store::Hexastore);
+
+use RDF::Trine::Error;
+use Encode qw(encode decode);
+use Scalar::Util qw(blessed);
+
+use constant MAGIC			=> 'RTHX';
+use constant FORMAT_VERSION	=> 1;
+use constant ORDERINGS		=> qw(spo sop pso pos osp ops);
+use constant SECTIONS		=> (qw(term_offsets term_data term_index), ORDERINGS);
+use constant HEADER_SIZE	=> 16 + 8 * (() = SECTIONS);
+use constant POSITION		=> { s => 0, p => 1, o => 2 };
+
+######################################################################
+
+our ($VERSION, $HAVE_XS_MMAP);
+BEGIN {
+	$VERSION	= "1.019";
+	eval "use RDF::Trine::XS;";
+	$HAVE_XS_MMAP	= (RDF::Trine::XS->can('mmap_file')) ? 1 : 0;
+}
+
+######################################################################
+
+=head1 METHODS
+
+Beyond the methods documented below, this class inherits methods from the
+L<RDF::Trine::Store::Hexastore> class.
+
+=over 4
+
+=item C<< is_mapped_file ( $filename ) >>
+
+Returns true if C<< $filename >> holds a hexastore index written by
+C<< store_mapped >>.
+
+=cut
+
+sub is_mapped_file {
+	my $class	= shift;
+	my $fname	= shift;
+	open(my $fh, '<:raw', $fname) or return 0;
+	my $magic	= '';
+	read($fh, $magic, length(MAGIC));
+	close($fh);
+	return ($magic eq MAGIC) ? 1 : 0;
+}
+
+=item C<< load ( $filename ) >>
+
+Returns a new store object backed by the index in C<< $filename >>.
+
+=cut
+
+sub load {
+	my $class	= shift;
+	my $fname	= shift;
+	my $map;
+	if ($HAVE_XS_MMAP) {
+		$map	= RDF::Trine::XS::mmap_file( $fname );
+	} else {
+		open(my $fh, '<:raw', $fname) or throw RDF::Trine::Error -text => "Cannot open $fname: $!";
+		local($/)	= undef;
+		my $data	= <$fh>;
+		$map		= \$data;
+	}
+
+	if (length($$map) < HEADER_SIZE or substr($$map, 0, 4) ne MAGIC) {
+		throw RDF::Trine::Error -text => "$fname is not a mapped hexastore file";
+	}
+	my ($version, $nodes, $size, @offsets)	= unpack('x4 N N N N*', substr($$map, 0, HEADER_SIZE));
+	unless ($version == FORMAT_VERSION) {
+		throw RDF::Trine::Error -text => "Unsupported mapped hexastore version $version in $fname";
+	}
+
+	my %sections;
+	foreach my $name (SECTIONS) {
+		my ($hi, $lo)	= splice(@offsets, 0, 2);
+		$sections{ $name }	= $hi * 4294967296 + $lo;
+	}
+
+	my $self	= bless({
+		map			=> $map,
+		filename	=> $fname,
+		nodes		=> $nodes,
+		size		=> $size,
+		sections	=> \%sections,
+		id2node		=> [],
+		etag		=> (stat($fname))[9],
+	}, $class);
+	return $self;
+}
+
+=item C<< get_statements ($subject, $predicate, $object [, $context] ) >>
+
+Returns a stream object of all statements matching the specified subject,
+predicate and objects. Any of the arguments may be undef to match any value.
+
+=cut
+
+sub get_statements {
+	my $self	= shift;
+	my @nodes	= splice(@_, 0, 3);
+	my $context	= shift;
+	my %args	= @_;
+	my @orderby	= (ref($args{orderby})) ? @{$args{orderby}} : ();
+
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return RDF::Trine::Iterator::Graph->new( [] );
+	}
+
+	my $plan	= $self->_plan( \@nodes, @orderby );
+	return RDF::Trine::Iterator::Graph->new( [] ) unless ($plan);
+
+	my ($order, $start, $end, $rev, $dups)	= @{ $plan }{ qw(order start end rev dups) };
+	my $map		= $self->{map};
+	my $base	= $self->{sections}{ $order };
+	my @perm	= map { POSITION->{ $_ } } split(//, $order);
+	my $i		= $rev ? $end - 1 : $start;
+	my $sub		= sub {
+		while ($rev ? ($i >= $start) : ($i < $end)) {
+			my @ids;
+			@ids[ @perm ]	= unpack('N3', substr($$map, $base + 12 * $i, 12));
+			$rev ? $i-- : $i++;
+			next if (grep { $ids[ $_->[0] ] != $ids[ $_->[1] ] } @$dups);
+			return RDF::Trine::Statement->new( map { $self->_id2node( $_ ) } @ids );
+		}
+		return;
+	};
+	return RDF::Trine::Iterator::Graph->new( $sub );
+}
+
+=item C<< count_statements ($subject, $predicate, $object) >>
+
+Returns a count of all the statements matching the specified subject,
+predicate and objects. Any of the arguments may be undef to match any value.
+
+=cut
+
+sub count_statements {
+	my $self	= shift;
+	my @nodes	= splice(@_, 0, 3);
+	my $context	= shift;
+
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return 0;
+	}
+
+	my $plan	= $self->_plan( \@nodes );
+	return 0 unless ($plan);
+	if (@{ $plan->{dups} }) {
+		my $iter	= $self->get_statements( @nodes );
+		my $count	= 0;
+		$count++ while ($iter->next);
+		return $count;
+	}
+	return $plan->{end} - $plan->{start};
+}
+
+=item C<< etag >>
+
+Returns an Etag suitable for use in an HTTP Header.
+
+=cut
+
+sub etag {
+	return $_[0]->{etag};
+}
+
+=item C<< statistics >>
+
+Returns undef. Building L<RDF::Trine::Store::Statistics> would read every
+statement in the file, so mapped stores do not order joins by cardinality
+(a converted in-memory store builds them as usual).
+
+=cut
+
+sub statistics {
+	return;
+}
+
+=item C<< add_statement ( $statement [, $context] ) >>
+
+=item C<< remove_statement ( $statement [, $context]) >>
+
+=item C<< remove_statements ( $subject, $predicate, $object [, $context]) >>
+
+=item C<< store ( $filename ) >>
+
+These methods first convert the object into a regular in-memory
+L<RDF::Trine::Store::Hexastore>, and then behave as documented there.
+
+=cut
+
+sub add_statement {
+	my $self	= shift;
+	$self->_thaw;
+	return $self->add_statement( @_ );
+}
+
+sub remove_statement {
+	my $self	= shift;
+	$self->_thaw;
+	return $self->remove_statement( @_ );
+}
+
+sub remove_statements {
+	my $self	= shift;
+	$self->_thaw;
+	return $self->remove_statements( @_ );
+}
+
+sub store {
+	my $self	= shift;
+	$self->_thaw;
+	return $self->store( @_ );
+}
+
+=item C<< nuke >>
+
+Permanently removes all the data in the store. The index file is left
+untouched, and the object becomes an empty in-memory
+L<RDF::Trine::Store::Hexastore>.
+
+=cut
+
+sub nuke {
+	my $self	= shift;
+	%$self	= ();
+	bless($self, 'RDF::Trine::Store::Hexastore');
+	return $self->nuke;
+}
+
+=item C<< store_mapped ( $filename ) >>
+
+Writes the store to C<< $filename >> in the mapped index format.
+
+=cut
+
+sub store_mapped {
+	my $self	= shift;
+	my $fname	= shift;
+	my @nodes	= map { $self->_id2node( $_ ) } (0 .. $self->{nodes});
+	my $map		= $self->{map};
+	my $base	= $self->{sections}{spo};
+	my @triples	= map { substr($$map, $base + 12 * $_, 12) } (0 .. $self->{size} - 1);
+	return $self->_write_file( $fname, \@nodes, \@triples );
+}
+
+# Writes a mapped index file. $nodes is an array of nodes indexed by ID, and
+# $triples an array of pack('N3', $s, $p, $o) ID records.
+sub _write_file {
+	my $class	= shift;
+	my $fname	= shift;
+	my $nodes	= shift;
+	my $triples	= shift;
+
+	my $count	= (@$nodes) ? $#$nodes : 0;
+	my @records	= map { blessed($_) ? _encode_term( $_ ) : '' } @{ $nodes }[ 0 .. $count ];
+	my $offsets	= '';
+	my $offset	= 0;
+	foreach my $record (@records, '') {
+		$offsets	.= _pack64( $offset );
+		$offset		+= length($record);
+	}
+	my $index	= pack('N*', sort { $records[$a] cmp $records[$b] } grep { length($records[$_]) } (1 .. $count));
+
+	my %sections	= (
+		term_offsets	=> \$offsets,
+		term_data		=> \join('', @records),
+		term_index		=> \$index,
+	);
+	foreach my $order (ORDERINGS) {
+		my @perm	= map { POSITION->{ $_ } } split(//, $order);
+		my $data	= join('', sort map { pack('N3', (unpack('N3', $_))[ @perm ]) } @$triples);
+		$sections{ $order }	= \$data;
+	}
+
+	my $header	= MAGIC . pack('N N N', FORMAT_VERSION, $count, scalar(@$triples));
+	$offset		= HEADER_SIZE;
+	foreach my $name (SECTIONS) {
+		$header	.= _pack64( $offset );
+		$offset	+= length(${ $sections{ $name } });
+	}
+
+	open(my $fh, '>:raw', $fname) or throw RDF::Trine::Error -text => "Cannot open $fname for writing: $!";
+	print {$fh} $header;
+	print {$fh} ${ $sections{ $_ } } foreach (SECTIONS);
+	close($fh) or throw RDF::Trine::Error -text => "Cannot write $fname: $!";
+	return 1;
+}
+
+# Returns the range of records in the ordering that answers the triple
+# pattern in $nodes, along with any equality checks needed for repeated
+# variables. Returns undef if a bound node is not in the dictionary.
+sub _plan {
+	my $self	= shift;
+	my $nodes	= shift;
+	my @orderby	= @_;
+	my @names	= qw(s p o);
+	my (%bound, %vars);
+	foreach my $i (0 .. 2) {
+		my $node	= $nodes->[ $i ];
+		next unless (blessed($node));
+		if ($node->isa('RDF::Trine::Node::Variable')) {
+			push( @{ $vars{ $node->name } }, $i );
+		} else {
+			my $id	= $self->_node2id( $node );
+			return unless (defined($id));
+			$bound{ $names[ $i ] }	= $id;
+		}
+	}
+
+	my @dups;
+	foreach my $pos (values %vars) {
+		push( @dups, map { [ $pos->[0], $_ ] } @{ $pos }[ 1 .. $#$pos ] );
+	}
+
+	my $sortkey	= '';
+	my $rev		= 0;
+	if (@orderby and exists($vars{ $orderby[0] })) {
+		$sortkey	= $names[ $vars{ $orderby[0] }[0] ];
+		$rev		= 1 if (defined($orderby[1]) and $orderby[1] eq 'DESC');
+	}
+
+	my ($order, $key)	= _ordering( \%bound, $sortkey );
+	my ($start, $end)	= $self->_range( $order, $key );
+	return { order => $order, start => $start, end => $end, rev => $rev, dups => \@dups };
+}
+
+# Returns the name of an ordering that starts with the bound positions in
+# %$bound (position letter => ID), followed by $next if possible, and the
+# packed key of the bound IDs in that ordering.
+sub _ordering {
+	my $bound	= shift;
+	my $next	= shift;
+	my $prefix	= join('', sort keys %$bound);
+	my $order;
+	foreach my $o (ORDERINGS) {
+		my $head	= join('', sort split(//, substr($o, 0, length($prefix))));
+		next unless ($head eq $prefix);
+		$order	= $o;
+		last if (not($next) or substr($o, length($prefix), 1) eq $next);
+	}
+	my $key		= pack('N*', map { $bound->{ $_ } } split(//, substr($order, 0, length($prefix))));
+	return ($order, $key);
+}
+
+# Star-pattern support for RDF::Trine::Store::Hexastore::get_pattern. Both
+# methods read a single range of the ordering that has the bound positions
+# followed by the join position, so the IDs come out already sorted.
+sub _join_ids {
+	my $self	= shift;
+	my $bound	= shift;
+	my $join	= shift;
+	my %bound	= map { substr($_, 0, 1) => $bound->{ $_ } } keys %$bound;
+	my $next	= substr($join, 0, 1);
+	my ($order, $key)	= _ordering( \%bound, $next );
+	my ($start, $end)	= $self->_range( $order, $key );
+	my $map		= $self->{map};
+	my $base	= $self->{sections}{ $order } + 4 * index($order, $next);
+	my @ids;
+	foreach my $i ($start .. $end - 1) {
+		my $id	= unpack('N', substr($$map, $base + 12 * $i, 4));
+		push( @ids, $id ) unless (scalar(@ids) and $ids[-1] == $id);
+	}
+	return @ids;
+}
+
+sub _join_values {
+	my $self	= shift;
+	my $bound	= shift;
+	my $join	= shift;
+	my $id		= shift;
+	my $pos		= shift;
+	my %bound	= map { substr($_, 0, 1) => $bound->{ $_ } } keys %$bound;
+	$bound{ substr($join, 0, 1) }	= $id;
+	my ($order, $key)	= _ordering( \%bound );
+	my ($start, $end)	= $self->_range( $order, $key );
+	my $map		= $self->{map};
+	my $base	= $self->{sections}{ $order } + 4 * index($order, substr($pos, 0, 1));
+	return map { unpack('N', substr($$map, $base + 12 * $_, 4)) } ($start .. $end - 1);
+}
+
+# Binary searches the named ordering for the half-open range of records
+# whose leading bytes equal $key.
+sub _range {
+	my $self	= shift;
+	my $order	= shift;
+	my $key		= shift;
+	my $size	= $self->{size};
+	my $len		= length($key);
+	return (0, $size) unless ($len);
+
+	my $map		= $self->{map};
+	my $base	= $self->{sections}{ $order };
+	my ($lo, $hi)	= (0, $size);
+	while ($lo < $hi) {
+		my $mid	= ($lo + $hi) >> 1;
+		if (substr($$map, $base + 12 * $mid, $len) lt $key) {
+			$lo	= $mid + 1;
+		} else {
+			$hi	= $mid;
+		}
+	}
+	my $start	= $lo;
+	$hi			= $size;
+	while ($lo < $hi) {
+		my $mid	= ($lo + $hi) >> 1;
+		if (substr($$map, $base + 12 * $mid, $len) le $key) {
+			$lo	= $mid + 1;
+		} else {
+			$hi	= $mid;
+		}
+	}
+	return ($start, $lo);
+}
+
+sub _node2id {
+	my $self	= shift;
+	my $node	= shift;
+	return unless (blessed($node));
+	return if ($node->isa('RDF::Trine::Node::Variable'));
+
+	my $record	= _encode_term( $node );
+	return unless (defined($record));
+
+	my $map		= $self->{map};
+	my $base	= $self->{sections}{term_index};
+	my ($lo, $hi)	= (0, ($self->{sections}{spo} - $base) / 4);
+	while ($lo < $hi) {
+		my $mid	= ($lo + $hi) >> 1;
+		my $id	= unpack('N', substr($$map, $base + 4 * $mid, 4));
+		my $cmp	= $self->_term_record( $id ) cmp $record;
+		if ($cmp < 0) {
+			$lo	= $mid + 1;
+		} elsif ($cmp > 0) {
+			$hi	= $mid;
+		} else {
+			return $id;
+		}
+	}
+	return;
+}
+
+sub _existing_node_id {
+	my $self	= shift;
+	return $self->_node2id( @_ );
+}
+
+sub _id2node {
+	my $self	= shift;
+	my $id		= shift;
+	return $self->{ id2node }[ $id ] ||= _decode_term( $self->_term_record( $id ) );
+}
+
+sub _seen_nodes {
+	my $self	= shift;
+	return grep { defined($_) } map { $self->_id2node( $_ ) } (1 .. $self->{nodes});
+}
+
+sub _term_record {
+	my $self	= shift;
+	my $id		= shift;
+	my $map		= $self->{map};
+	my ($a, $b, $c, $d)	= unpack('N4', substr($$map, $self->{sections}{term_offsets} + 8 * $id, 16));
+	my $start	= $a * 4294967296 + $b;
+	my $end		= $c * 4294967296 + $d;
+	return substr($$map, $self->{sections}{term_data} + $start, $end - $start);
+}
+
+# Replaces the mapped index with an equivalent in-memory hexastore.
+sub _thaw {
+	my $self	= shift;
+	my $iter	= $self->get_statements( undef, undef, undef );
+	my $store	= RDF::Trine::Store::Hexastore->new();
+	while (my $st = $iter->next) {
+		$store->add_statement( $st );
+	}
+	%$self	= %$store;
+	bless($self, 'RDF::Trine::Store::Hexastore');
+	return $self;
+}
+
+sub _encode_term {
+	my $node	= shift;
+	if ($node->isa('RDF::Trine::Node::Resource')) {
+		return 'R' . encode('utf8', $node->uri_value);
+	} elsif ($node->isa('RDF::Trine::Node::Blank')) {
+		return 'B' . encode('utf8', $node->blank_identifier);
+	} elsif ($node->isa('RDF::Trine::Node::Literal')) {
+		my $lang	= $node->literal_value_language // '';
+		my $dt		= $node->literal_datatype // '';
+		return 'L' . pack('N/a* N/a*', encode('utf8', $lang), encode('utf8', $dt)) . encode('utf8', $node->literal_value);
+	}
+	return;
+}
+
+sub _decode_term {
+	my $record	= shift;
+	return unless (length($record));
+	my $type	= substr($record, 0, 1);
+	my $data	= substr($record, 1);
+	if ($type eq 'R') {
+		return RDF::Trine::Node::Resource->new( decode('utf8', $data) );
+	} elsif ($type eq 'B') {
+		return RDF::Trine::Node::Blank->new( decode('utf8', $data) );
+	} else {
+		my ($lang, $dt, $value)	= unpack('N/a* N/a* a*', $data);
+		return RDF::Trine::Node::Literal->new( decode('utf8', $value), (length($lang) ? decode('utf8', $lang) : undef), (length($dt) ? decode('utf8', $dt) : undef) );
+	}
+}
+
+sub _pack64 {
+	my $value	= shift;
+	return pack('N2', int($value / 4294967296), $value % 4294967296);
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 BUGS
+
+Please report any bugs or feature requests to through the GitHub web interface
+at L<https://github.com/kasei/perlrdf/issues>.
+
+=head1 AUTHOR
+
+Gregory Todd Williams  C<< <gwilliams@cpan.org> >>
+
+=head1 COPYRIGHT
+
+Copyright (c) 2006-2012 Gregory Todd Williams. This
+program is free software; you can redistribute it and/or modify it under
+the same terms as Perl itself.
+
+=cut
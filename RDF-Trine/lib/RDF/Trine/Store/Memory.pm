@@ -14,6 +14,11 @@ This document describes RDF::Trine::Store::Memory version 1.019
 
 RDF::Trine::Store::Memory provides an in-memory triple-store.
 
+Statements are indexed by each of their nodes. Every index entry is a packed
+string of the ascending IDs of the statements that use the node, and
+multi-node lookups intersect these lists starting from the shortest. If
+L<RDF::Trine::XS> is installed, the intersections are performed natively.
+
 =cut
 
 package RDF::Trine::Store::Memory;
@@ -24,7 +29,6 @@ no warnings 'redefine';
 use base qw(RDF::Trine::Store);
 
 use Encode;
-use Set::Scalar;
 use Data::Dumper;
 use Digest::SHA qw(sha1);
 use List::Util qw(first);
@@ -33,6 +37,7 @@ use RDF::Trine::Statement::Quad;
 
 use RDF::Trine qw(iri);
 use RDF::Trine::Error;
+use RDF::Trine::Store::Statistics;
 
 ######################################################################
 
@@ -227,52 +232,36 @@ sub _get_statements_triple {
 	my $bound	= shift;
 	my %bound	= @_;
 	
-	my $match_set	= Set::Scalar->new( 0 .. $#{ $self->{statements} } );
+	# without any bound nodes, walk the statement IDs directly instead of
+	# building a list of all of them
+	my $next_id;
 	if ($bound) {
 # 		warn "getting $bound-bound statements";
-		my @pos		= sort { $a <=> $b } keys %bound;
-		my @names	= @pos_names[ @pos ];
-# 		warn "\tbound nodes are: " . join(', ', @names) . "\n";
-		
-		my @sets;
-		foreach my $i (0 .. $#pos) {
-			my $pos	= $pos[ $i ];
-			my $node	= $bound{ $pos };
-			my $string	= $node->as_string;
-# 			warn $node . " has string: '" . $string . "'\n";
-			my $hash	= $self->{$names[$i]};
-			my $set		= $hash->{ $string };
-			push(@sets, $set);
-		}
-		
-		foreach my $s (@sets) {
-			unless (blessed($s)) {
-				return RDF::Trine::Iterator::Graph->new();
-			}
-		}
-		
-# 		warn "initial set: $i\n";
-		while (@sets) {
-			my $s	= shift(@sets);
-# 			warn "new set: $s\n";
-			$match_set	= $match_set->intersection($s);
-# 			warn "intersection: $i";
+		my $ids		= $self->_match_ids( %bound );
+		unless (defined($ids)) {
+			return RDF::Trine::Iterator::Graph->new();
 		}
+		my $i		= 0;
+		my $count	= length($ids) / 4;
+		$next_id	= sub { return ($i < $count) ? unpack('N', substr($ids, 4 * $i++, 4)) : undef };
+	} else {
+		my $i		= 0;
+		my $last	= $#{ $self->{statements} };
+		$next_id	= sub { return ($i <= $last) ? $i++ : undef };
 	}
 	
 	my $open	= 1;
 	my %seen;
 	
-	my @members	= sort { $a <=> $b } $match_set->members;
 	my $sub	= sub {
 		while (1) {
-			my $e = shift(@members);
+			my $e = $next_id->();
 			unless (defined($e)) {
 				$open	= 0;
 				return;
 			}
 			
-			my $st		= $self->{statements}[ $e++ ];
+			my $st		= $self->{statements}[ $e ];
 			unless (blessed($st)) {
 				next;
 			}
@@ -313,66 +302,24 @@ sub _get_statements_quad {
 		return RDF::Trine::Iterator::Graph->new( $sub );
 	}
 	
-	my $match_set;
-	if ($bound == 1) {
-# 		warn "getting 1-bound statements";
-		my ($pos)		= keys %bound;
-		my $name		= $pos_names[ $pos ];
-# 		warn "\tbound node is $name\n";
-		my $node	= $bound{ $pos };
-		my $string	= $node->as_string;
-		$match_set	= $self->{$name}{ $string };
-# 		warn "\tmatching statements: $match_set\n";
-		unless (blessed($match_set)) {
-			return RDF::Trine::Iterator::Graph->new();
-		}
-	} else {
-# 		warn "getting $bound-bound statements";
-		my @pos		= keys %bound;
-		my @names	= @pos_names[ @pos ];
-# 		warn "\tbound nodes are: " . join(', ', @names) . "\n";
-		
-		my @sets;
-		foreach my $i (0 .. $#pos) {
-			my $pos	= $pos[ $i ];
-			my $node	= $bound{ $pos };
-			my $string	= $node->as_string;
-# 			warn $node . " has string: '" . $string . "'\n";
-			my $hash	= $self->{$names[$i]};
-			my $set		= $hash->{ $string };
-			push(@sets, $set);
-		}
-		
-		foreach my $s (@sets) {
-			unless (blessed($s)) {
-				return RDF::Trine::Iterator::Graph->new();
-			}
-		}
-		my $i	= shift(@sets);
-# 		warn "initial set: $i\n";
-		while (@sets) {
-			my $s	= shift(@sets);
-# 			warn "new set: $s\n";
-			$i	= $i->intersection($s);
-# 			warn "intersection: $i";
-		}
-		$match_set	= $i;
-# 		warn "\tmatching statements: $match_set\n";
+# 	warn "getting $bound-bound statements";
+	my $ids		= $self->_match_ids( %bound );
+	unless (defined($ids)) {
+		return RDF::Trine::Iterator::Graph->new();
 	}
 	
 	my $open	= 1;
-	my @e		= $match_set->elements;
+	my $i		= 0;
+	my $count	= length($ids) / 4;
 	my $sub	= sub {
-		unless (scalar(@e)) {
-			$open	= 0;
-			return;
+		while ($i < $count) {
+			my $e	= unpack('N', substr($ids, 4 * $i++, 4));
+# 			warn "quad iterator returning statement $e";
+			my $st	= $self->{statements}[ $e ];
+			return $st if (blessed($st));
 		}
-		my $e = shift(@e);
-# 		warn "quad iterator returning statement $e";
-		
-		my $st	= $self->{statements}[ $e ];
-# 		warn "returning statement from $bound-bound iterator: " . $st->as_string . "\n";
-		return $st;
+		$open	= 0;
+		return;
 	};
 	return RDF::Trine::Iterator::Graph->new( $sub );
 }
@@ -431,12 +378,13 @@ sub add_statement {
 		my $name	= $pos_names[ $pos ];
 		my $node	= $st->$name();
 		my $string	= $node->as_string;
-		my $set	= $self->{$name}{ $string };
-		unless (blessed($set)) {
-			$set	= Set::Scalar->new();
-			$self->{$name}{ $string }	= $set;
+		my $page	= $self->{$name}{ $string };
+		unless (ref($page)) {
+			$page	= _new_page();
+			$self->{$name}{ $string }	= $page;
 		}
-		$set->insert( $id );
+		# statement IDs only grow, so appending keeps the page sorted
+		$$page	.= pack('N', $id);
 	}
 	
 	my $ctx	= $st->context;
@@ -444,6 +392,7 @@ sub add_statement {
 	unless (exists $self->{ ctx_nodes }{ $str }) {
 		$self->{ ctx_nodes }{ $str }	= $ctx;
 	}
+	$self->{statistics}->add_statement( $st ) if ($self->{statistics});
 	return;
 }
 
@@ -495,15 +444,16 @@ sub remove_statement {
 			my $name	= $pos_names[ $pos ];
 			my $node	= $st->$name();
 			my $str		= $node->as_string;
-			my $set		= $self->{$name}{ $str };
-			$set->delete( $id );
-			if ($set->size == 0) {
+			my $page	= $self->{$name}{ $str };
+			_page_remove( $page, $id );
+			if (length($$page) == 0) {
 				if ($pos == 3) {
 					delete $self->{ ctx_nodes }{ $str };
 				}
 				delete $self->{$name}{ $str };
 			}
 		}
+		$self->{statistics}->remove_statement( $st ) if ($self->{statistics});
 	}
 	return;
 }
@@ -573,39 +523,18 @@ sub count_statements {
 		} elsif ($bound == 1) {
 			my ($pos)	= keys %bound;
 			my $name	= $pos_names[ $pos ];
-			my $set		= $self->{$name}{ $bound{ $pos }->as_string };
-# 			warn Dumper($set) if ($::debug);
-			unless (blessed($set)) {
+			my $page	= $self->{$name}{ $bound{ $pos }->as_string };
+			unless (ref($page)) {
 				return 0;
 			}
-			return $set->size;
+			return length($$page) / 4;
 		} else {
-			my @pos		= keys %bound;
-			my @names	= @pos_names[ @pos ];
-			my @sets;
-			foreach my $i (0 .. $#names) {
-				my $pos		= $pos[ $i ];
-				my $setname	= $names[ $i ];
-				my $data	= $self->{ $setname };
-				
-				my $node	= $bound{ $pos };
-				my $str		= $node->as_string;
-				my $set		= $data->{ $str };
-				push( @sets, $set );
-			}
-			foreach my $s (@sets) {
-# 				warn "set: " . Dumper($s) if ($::debug);
-				unless (blessed($s)) {
-# 					warn "*** returning zero" if ($::debug);
-					return 0;
-				}
-			}
-			my $i	= shift(@sets);
-			while (@sets) {
-				my $s	= shift(@sets);
-				$i	= $i->intersection($s);
+			my $ids		= $self->_match_ids( %bound );
+			unless (defined($ids)) {
+# 				warn "*** returning zero" if ($::debug);
+				return 0;
 			}
-			return $i->size;
+			return length($ids) / 4;
 		}
 	} else {
 		# use_quad is false here
@@ -645,6 +574,19 @@ sub size {
 	return $size;
 }
 
+=item C<< statistics >>
+
+Returns an L<RDF::Trine::Store::Statistics> object for the data in the store.
+The statistics are computed on first use and then kept up to date as
+statements are added and removed.
+
+=cut
+
+sub statistics {
+	my $self	= shift;
+	return $self->{statistics} ||= RDF::Trine::Store::Statistics->new_from_store( $self );
+}
+
 =item C<< supports ( [ $feature ] ) >>
 
 If C<< $feature >> is specified, returns true if the feature is supported by the
@@ -668,39 +610,116 @@ sub _statement_id {
 # 		}
 	}
 	
-	my ($subj, $pred, $obj, $context)	= @nodes;
-	
-	my @pos		= (0 .. 3);
-	my @names	= @pos_names[ @pos ];
-	my @sets;
-	foreach my $i (0 .. $#names) {
-		my $pos		= $pos[ $i ];
-		my $setname	= $names[ $i ];
-		my $data	= $self->{ $setname };
-		my $node	= $nodes[ $pos ];
-		my $str		= $node->as_string;
-		my $set		= $data->{ $str };
-		push( @sets, $set );
-	}
-	
-	foreach my $s (@sets) {
-		unless (blessed($s)) {
-			return -1;
-		}
-	}
-	my $i	= shift(@sets);
-	while (@sets) {
-		my $s	= shift(@sets);
-		$i	= $i->intersection($s);
-	}
-	if ($i->size == 1) {
-		my ($id)	= $i->members;
+	my $ids	= $self->_match_ids( map { $_ => $nodes[ $_ ] } (0 .. 3) );
+	if (defined($ids) and length($ids) == 4) {
+		my ($id)	= unpack('N', $ids);
 		return $id;
 	} else {
 		return -1;
 	}
 }
 
+# Takes a list of (position, node) pairs and returns a packed string of the
+# ascending IDs of the statements that have all of the nodes in the given
+# positions, or undef if one of the nodes isn't used in that position.
+sub _match_ids {
+	my $self	= shift;
+	my %bound	= @_;
+	my @pages;
+	foreach my $pos (keys %bound) {
+		my $page	= $self->{ $pos_names[ $pos ] }{ $bound{ $pos }->as_string };
+		return unless (ref($page));
+		push( @pages, $$page );
+	}
+	return (scalar(@pages) == 1) ? $pages[0] : _page_intersect( @pages );
+}
+
+################################################################################
+# Index pages are references to strings of ascending, big-endian 32-bit
+# statement IDs. The _page_* functions below are replaced by their
+# RDF::Trine::XS equivalents when that module is available.
+
+sub _page_search {
+	my $page	= shift;
+	my $id		= shift;
+	my $lo		= 0;
+	my $hi		= length($page) / 4;
+	while ($lo < $hi) {
+		my $mid	= ($lo + $hi) >> 1;
+		my $v	= unpack('N', substr($page, $mid * 4, 4));
+		if ($v < $id) {
+			$lo	= $mid + 1;
+		} elsif ($v > $id) {
+			$hi	= $mid;
+		} else {
+			return $mid;
+		}
+	}
+	return -$lo - 1;
+}
+
+sub _page_remove_pp {
+	my $page	= shift;
+	my $id		= shift;
+	my $pos		= _page_search( $$page, $id );
+	return 0 if ($pos < 0);
+	substr($$page, $pos * 4, 4, '');
+	return 1;
+}
+
+# Intersects pages starting from the shortest one. Each of its IDs is looked
+# for in the other pages by galloping forward from the previous match, so the
+# cost depends on the size of the smallest page rather than the largest.
+sub _page_intersect_pp {
+	my @pages	= sort { length($a) <=> length($b) } @_;
+	my $first	= shift(@pages);
+	my @cursor	= (0) x scalar(@pages);
+	my $ids		= '';
+	ID: foreach my $id (unpack('N*', $first)) {
+		foreach my $i (0 .. $#pages) {
+			my $page	= $pages[ $i ];
+			my $count	= length($page) / 4;
+			my $lo		= $cursor[ $i ];
+			my $hi		= $lo;
+			my $step	= 1;
+			while ($hi < $count and unpack('N', substr($page, $hi * 4, 4)) < $id) {
+				$lo		= $hi + 1;
+				$hi		+= $step;
+				$step	*= 2;
+			}
+			$hi	= $count if ($hi > $count);
+			while ($lo < $hi) {
+				my $mid	= ($lo + $hi) >> 1;
+				if (unpack('N', substr($page, $mid * 4, 4)) < $id) {
+					$lo	= $mid + 1;
+				} else {
+					$hi	= $mid;
+				}
+			}
+			$cursor[ $i ]	= $lo;
+			last ID if ($lo >= $count);
+			next ID unless (unpack('N', substr($page, $lo * 4, 4)) == $id);
+		}
+		$ids	.= pack('N', $id);
+	}
+	return $ids;
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	no strict 'refs';
+	my $xs	= RDF::Trine::XS->can('id_page_intersect') ? 1 : 0;
+	*{ '_page_remove' }		= $xs ? \&RDF::Trine::XS::id_page_remove : \&_page_remove_pp;
+	*{ '_page_intersect' }	= $xs ? \&RDF::Trine::XS::id_page_intersect : \&_page_intersect_pp;
+	## use critic
+}
+
+sub _new_page {
+	my $page	= '';
+	return \$page;
+}
+
 # sub _debug {
 # 	my $self	= shift;
 # 	my $size	= scalar(@{ $self->{statements} });
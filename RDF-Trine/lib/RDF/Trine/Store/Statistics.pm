@@ -0,0 +1,443 @@
+=head1 NAME
+
+RDF::Trine::Store::Statistics - Per-predicate statistics for estimating pattern cardinality
+
+=head1 VERSION
+
+This document describes RDF::Trine::Store::Statistics version 1.019
+
+=head1 SYNOPSIS
+
+ use RDF::Trine::Store::Statistics;
+ my $stats	= $store->statistics;
+ my $count	= $stats->predicate_count( $p );
+ my $est	= $stats->cardinality( $triple, { s => 1 } );
+
+=head1 DESCRIPTION
+
+RDF::Trine::Store::Statistics keeps, for every predicate in a store, the number
+of statements using it, the number of distinct subjects and objects those
+statements have, and a list of the predicate's most frequent objects. Stores
+keep the statistics up to date as statements are added and removed, and query
+planning uses them to estimate the cardinality of triple patterns when
+choosing a join order.
+
+Subjects and objects are counted by node hash rather than by value. If
+L<RDF::Trine::XS> is installed, the counts are kept in native hash tables at a
+fixed cost of a few bytes per distinct node.
+
+=cut
+
+package RDF::Trine::Store::Statistics;
+
+use strict;
+use warnings;
+no warnings 'redefine';
+
+use Scalar::Util qw(blessed);
+
+######################################################################
+
+our ($VERSION, $TOP_K, $COUNTER_CLASS);
+BEGIN {
+	$VERSION	= '1.019';
+	$TOP_K		= 10;
+}
+
+######################################################################
+
+=head1 METHODS
+
+=over 4
+
+=item C<< new ( [ top_k => $k ] ) >>
+
+Returns a new, empty statistics object that keeps the C<< $k >> (default 10)
+most frequent objects of each predicate.
+
+=cut
+
+sub new {
+	my $class	= shift;
+	my %args	= @_;
+	my $self	= bless({
+		top_k		=> $args{top_k} || $TOP_K,
+		size		=> 0,
+		predicates	=> {},
+	}, $class);
+	return $self;
+}
+
+=item C<< new_from_store ( $store [, top_k => $k ] ) >>
+
+Returns a new statistics object for the statements currently in C<< $store >>.
+
+=cut
+
+sub new_from_store {
+	my $class	= shift;
+	my $store	= shift;
+	my $self	= $class->new( @_ );
+	my $iter	= $store->get_statements( undef, undef, undef, undef );
+	while (my $st = $iter->next) {
+		$self->add_statement( $st );
+	}
+	return $self;
+}
+
+=item C<< add_statement ( $statement ) >>
+
+Updates the statistics for a statement added to the store.
+
+=cut
+
+sub add_statement {
+	my $self	= shift;
+	my $st		= shift;
+	my ($s, $p, $o)	= $st->nodes;
+	my $key		= _key( $p );
+	return unless (defined($key));
+	my $rec		= $self->{predicates}{ $key } ||= {
+		node		=> $p,
+		count		=> 0,
+		subjects	=> $COUNTER_CLASS->new(),
+		objects		=> $COUNTER_CLASS->new(),
+		top			=> [],
+		min			=> 0,
+	};
+	$self->{size}++;
+	$rec->{count}++;
+	$rec->{subjects}->add( $s );
+	my $count	= $rec->{objects}->add( $o );
+	if (defined($count) and (scalar(@{ $rec->{top} }) < $self->{top_k} or $count > $rec->{min})) {
+		$self->_update_top( $rec, $o, $count );
+	}
+	return;
+}
+
+=item C<< remove_statement ( $statement ) >>
+
+Updates the statistics for a statement removed from the store.
+
+=cut
+
+sub remove_statement {
+	my $self	= shift;
+	my $st		= shift;
+	my ($s, $p, $o)	= $st->nodes;
+	my $key		= _key( $p );
+	return unless (defined($key));
+	my $rec		= $self->{predicates}{ $key };
+	return unless ($rec);
+	$self->{size}--;
+	if (--$rec->{count} == 0) {
+		delete $self->{predicates}{ $key };
+		return;
+	}
+	$rec->{subjects}->remove( $s );
+	my $count	= $rec->{objects}->remove( $o );
+	if (defined($count) and $count + 1 >= $rec->{min}) {
+		$self->_update_top( $rec, $o, $count );
+	}
+	return;
+}
+
+=item C<< size >>
+
+Returns the number of statements counted.
+
+=cut
+
+sub size {
+	my $self	= shift;
+	return $self->{size};
+}
+
+=item C<< predicates >>
+
+Returns a list of the predicates of the counted statements.
+
+=cut
+
+sub predicates {
+	my $self	= shift;
+	return map { $_->{node} } values %{ $self->{predicates} };
+}
+
+=item C<< predicate_count ( $predicate ) >>
+
+Returns the number of statements using C<< $predicate >>.
+
+=cut
+
+sub predicate_count {
+	my $self	= shift;
+	my $rec		= $self->_record( shift ) or return 0;
+	return $rec->{count};
+}
+
+=item C<< distinct_subjects ( $predicate ) >>
+
+Returns the number of distinct subjects of statements using C<< $predicate >>.
+
+=cut
+
+sub distinct_subjects {
+	my $self	= shift;
+	my $rec		= $self->_record( shift ) or return 0;
+	return $rec->{subjects}->distinct;
+}
+
+=item C<< distinct_objects ( $predicate ) >>
+
+Returns the number of distinct objects of statements using C<< $predicate >>.
+
+=cut
+
+sub distinct_objects {
+	my $self	= shift;
+	my $rec		= $self->_record( shift ) or return 0;
+	return $rec->{objects}->distinct;
+}
+
+=item C<< subject_count ( $predicate, $subject ) >>
+
+Returns the number of statements with the given predicate and subject.
+
+=cut
+
+sub subject_count {
+	my $self	= shift;
+	my $rec		= $self->_record( shift ) or return 0;
+	return $rec->{subjects}->count( shift ) || 0;
+}
+
+=item C<< object_count ( $predicate, $object ) >>
+
+Returns the number of statements with the given predicate and object.
+
+=cut
+
+sub object_count {
+	my $self	= shift;
+	my $rec		= $self->_record( shift ) or return 0;
+	return $rec->{objects}->count( shift ) || 0;
+}
+
+=item C<< top_objects ( $predicate [, $k ] ) >>
+
+Returns a list of up to C<< $k >> C<< [ $object, $count ] >> pairs for the most
+frequent objects of C<< $predicate >>, most frequent first. Objects are tracked
+as they are added, so after removals an object whose count has not changed
+since may be missing from the list.
+
+=cut
+
+sub top_objects {
+	my $self	= shift;
+	my $rec		= $self->_record( shift ) or return;
+	my $k		= shift || $self->{top_k};
+	my @top		= sort { $b->[1] <=> $a->[1] } @{ $rec->{top} };
+	splice(@top, $k) if (scalar(@top) > $k);
+	return map { [ $_->[0], $_->[1] ] } @top;
+}
+
+=item C<< cardinality ( $triple [, \%bound ] ) >>
+
+Returns an estimate of the number of statements matching the triple pattern
+C<< $triple >>. Variables whose names are keys of C<< %bound >> are taken to be
+bound to an unknown value, as they are when the pattern is evaluated after
+other patterns in a join.
+
+Bound subjects and objects are counted exactly for a bound predicate, and
+otherwise estimated from the average number of statements per distinct subject
+or object. The subject and object are assumed to be independent.
+
+=cut
+
+sub cardinality {
+	my $self	= shift;
+	my $triple	= shift;
+	my $bound	= shift || {};
+	my ($s, $p, $o)	= ($triple->nodes)[0 .. 2];
+	my ($sb, $pb, $ob)	= map { _binding( $_, $bound ) } ($s, $p, $o);
+
+	my @recs;
+	if ($pb == 2) {
+		my $rec	= $self->_record( $p ) or return 0;
+		@recs	= ($rec);
+	} else {
+		@recs	= values %{ $self->{predicates} };
+		return 0 unless (scalar(@recs));
+	}
+
+	my $card	= 0;
+	foreach my $rec (@recs) {
+		my $n	= $rec->{count};
+		my $est	= $n;
+		if ($sb == 2) {
+			$est	= $est * ($rec->{subjects}->count( $s ) || 0) / $n;
+		} elsif ($sb == 1) {
+			$est	/= $rec->{subjects}->distinct;
+		}
+		if ($ob == 2) {
+			$est	= $est * ($rec->{objects}->count( $o ) || 0) / $n;
+		} elsif ($ob == 1) {
+			$est	/= $rec->{objects}->distinct;
+		}
+		$card	+= $est;
+	}
+	if ($pb == 1) {
+		$card	/= scalar(@recs);
+	}
+	return $card;
+}
+
+# Returns 2 for a constant node, 1 for a variable in %$bound, and 0 for a free
+# variable.
+sub _binding {
+	my $node	= shift;
+	my $bound	= shift;
+	return 0 unless (blessed($node));
+	if ($node->isa('RDF::Trine::Node::Variable')) {
+		return $bound->{ $node->name } ? 1 : 0;
+	}
+	return 2;
+}
+
+sub _record {
+	my $self	= shift;
+	my $p		= shift;
+	my $key		= _key( $p );
+	return unless (defined($key));
+	return $self->{predicates}{ $key };
+}
+
+# Records the new count of object $o in the predicate's list of frequent
+# objects, replacing the least frequent entry if the list is full.
+sub _update_top {
+	my $self	= shift;
+	my $rec		= shift;
+	my $o		= shift;
+	my $count	= shift;
+	my $top		= $rec->{top};
+	my $key		= _key( $o );
+	my ($i)		= grep { $top->[$_][2] eq $key } (0 .. $#{ $top });
+	if (defined($i)) {
+		if ($count) {
+			$top->[$i][1]	= $count;
+		} else {
+			splice(@$top, $i, 1);
+		}
+	} elsif ($count) {
+		if (scalar(@$top) < $self->{top_k}) {
+			push(@$top, [ $o, $count, $key ]);
+		} else {
+			my ($min)	= sort { $top->[$a][1] <=> $top->[$b][1] } (0 .. $#{ $top });
+			$top->[$min]	= [ $o, $count, $key ];
+		}
+	}
+	my $min	= 0;
+	if (scalar(@$top) >= $self->{top_k}) {
+		($min)	= sort { $a <=> $b } map { $_->[1] } @$top;
+	}
+	$rec->{min}	= $min;
+}
+
+# Returns a string identifying the value of a node, or undef for variables.
+sub _key {
+	my $node	= shift;
+	return unless (blessed($node));
+	if ($node->isa('RDF::Trine::Node::Resource')) {
+		return 'R' . $node->uri_value;
+	} elsif ($node->isa('RDF::Trine::Node::Blank')) {
+		return 'B' . $node->blank_identifier;
+	} elsif ($node->isa('RDF::Trine::Node::Literal')) {
+		my $lang	= $node->literal_value_language;
+		my $dt		= $node->literal_datatype;
+		return join("\0", 'L', (defined($lang) ? $lang : ''), (defined($dt) ? $dt : ''), $node->literal_value);
+	} elsif ($node->isa('RDF::Trine::Node::Nil')) {
+		return 'N';
+	}
+	return;
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	## use critic
+	$COUNTER_CLASS	= (RDF::Trine::XS::Counter->can('new')) ? 'RDF::Trine::XS::Counter' : 'RDF::Trine::Store::Statistics::Counter';
+}
+
+package RDF::Trine::Store::Statistics::Counter;
+
+# Counts of node occurrences keyed by node value, used when RDF::Trine::XS is
+# not available. The interface matches RDF::Trine::XS::Counter.
+
+use strict;
+use warnings;
+
+sub new {
+	my $class	= shift;
+	return bless({ counts => {}, total => 0 }, $class);
+}
+
+sub add {
+	my $self	= shift;
+	my $key		= RDF::Trine::Store::Statistics::_key( shift );
+	return unless (defined($key));
+	$self->{total}++;
+	return ++$self->{counts}{ $key };
+}
+
+sub remove {
+	my $self	= shift;
+	my $key		= RDF::Trine::Store::Statistics::_key( shift );
+	return unless (defined($key));
+	my $counts	= $self->{counts};
+	return 0 unless ($counts->{ $key });
+	$self->{total}--;
+	my $count	= --$counts->{ $key };
+	delete $counts->{ $key } unless ($count);
+	return $count;
+}
+
+sub count {
+	my $self	= shift;
+	my $key		= RDF::Trine::Store::Statistics::_key( shift );
+	return 0 unless (defined($key));
+	return $self->{counts}{ $key } || 0;
+}
+
+sub distinct {
+	my $self	= shift;
+	return scalar(keys %{ $self->{counts} });
+}
+
+sub total {
+	my $self	= shift;
+	return $self->{total};
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 BUGS
+
+Please report any bugs or feature requests to through the GitHub web interface
+at L<https://github.com/kasei/perlrdf/issues>.
+
+=head1 AUTHOR
+
+Gregory Todd Williams  C<< <gwilliams@cpan.org> >>
+
+=head1 COPYRIGHT
+
+Copyright (c) 2006-2012 Gregory Todd Williams. This
+program is free software; you can redistribute it and/or modify it under
+the same terms as Perl itself.
+
+=cut
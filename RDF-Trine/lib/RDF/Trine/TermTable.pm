@@ -0,0 +1,246 @@
+# RDF::Trine::TermTable
+# -----------------------------------------------------------------------------
+
+=head1 NAME
+
+RDF::Trine::TermTable - Optional global interning of RDF node objects
+
+=head1 VERSION
+
+This document describes RDF::Trine::TermTable version 1.019
+
+=head1 SYNOPSIS
+
+ use RDF::Trine::TermTable;
+ RDF::Trine::TermTable->enable;
+
+ my $a	= RDF::Trine::Node::Resource->new('http://example.org/');
+ my $b	= RDF::Trine::Node::Resource->new('http://example.org/');
+ # $a and $b are now the same object
+ my $id	= RDF::Trine::TermTable->id( $a );
+
+=head1 DESCRIPTION
+
+While the term table is enabled, the constructors of
+L<RDF::Trine::Node::Resource>, L<RDF::Trine::Node::Blank> and
+L<RDF::Trine::Node::Literal> return a single canonical object for each
+distinct node value. Each canonical node is assigned a stable integer ID,
+and its N-Triples/SSE serialization is computed at most once.
+
+Because equal nodes are the same object, C<< equal >> and C<< compare >>
+calls between two interned nodes reduce to a reference comparison, and
+code that builds index keys from nodes can use the term ID instead of a
+serialized string.
+
+Interned nodes are shared, so they cannot be modified in place: the
+C<< uri >> and C<< literal_value >> setters throw an error when called on an
+interned node.
+
+The table never shrinks. Canonical nodes are kept alive by the table, even
+when nothing else refers to them, until C<< clear >> is called.
+
+If L<RDF::Trine::XS> is installed, term keys are computed and looked up
+natively.
+
+=head1 METHODS
+
+=over 4
+
+=cut
+
+package RDF::Trine::TermTable;
+
+use strict;
+use warnings;
+no warnings 'redefine';
+
+use Encode qw(encode);
+use Scalar::Util qw(blessed refaddr);
+
+######################################################################
+
+our ($VERSION, $ENABLED, %KEYS, @NODES, %IDS, %NTRIPLES);
+BEGIN {
+	$VERSION	= '1.019';
+	$ENABLED	= 0;
+	@NODES		= (undef);
+}
+
+######################################################################
+
+=item C<< enable >>
+
+Turns on interning of newly constructed nodes.
+
+=cut
+
+sub enable {
+	$ENABLED	= 1;
+	return 1;
+}
+
+=item C<< disable >>
+
+Turns off interning of newly constructed nodes. Nodes that are already
+interned keep their IDs.
+
+=cut
+
+sub disable {
+	$ENABLED	= 0;
+	return 1;
+}
+
+=item C<< is_enabled >>
+
+Returns true if newly constructed nodes are being interned.
+
+=cut
+
+sub is_enabled {
+	return $ENABLED;
+}
+
+=item C<< intern ( $node ) >>
+
+Returns the canonical node object for the value of C<< $node >>, adding
+C<< $node >> to the table if no equal node has been interned. Resources, blank
+nodes and literals (plain, language-tagged and typed) are interned; other
+nodes, including instances of subclasses of these node classes, are returned
+unchanged.
+
+=cut
+
+sub intern {
+	my $node	= pop;
+	return _intern( \%KEYS, \@NODES, \%IDS, $node );
+}
+
+=item C<< id ( $node ) >>
+
+Returns the integer term ID of C<< $node >>, interning it if necessary.
+Returns undef for nodes that cannot be interned.
+
+=cut
+
+sub id {
+	my $node	= pop;
+	my $id		= $IDS{ refaddr($node) };
+	return $id if (defined($id));
+	return $IDS{ refaddr( _intern( \%KEYS, \@NODES, \%IDS, $node ) ) };
+}
+
+=item C<< is_interned ( $node ) >>
+
+Returns true if C<< $node >> is a canonical node object in the table.
+
+=cut
+
+sub is_interned {
+	my $node	= pop;
+	return (blessed($node) and exists $IDS{ refaddr($node) }) ? 1 : 0;
+}
+
+=item C<< node ( $id ) >>
+
+Returns the canonical node object with the term ID C<< $id >>.
+
+=cut
+
+sub node {
+	my $id		= pop;
+	return $NODES[ $id ];
+}
+
+=item C<< size >>
+
+Returns the number of interned nodes.
+
+=cut
+
+sub size {
+	return $#NODES;
+}
+
+=item C<< clear >>
+
+Removes all nodes from the table. Previously interned nodes remain valid
+objects, but are no longer canonical.
+
+=cut
+
+sub clear {
+	%KEYS		= ();
+	%IDS		= ();
+	%NTRIPLES	= ();
+	@NODES		= (undef);
+	return 1;
+}
+
+# Returns the cached serialization of an interned node, computing it with
+# $code the first time. Nodes that aren't interned are serialized each time.
+sub _cached_ntriples {
+	my $node	= shift;
+	my $code	= shift;
+	my $ra		= refaddr($node);
+	return $node->$code() unless (exists $IDS{ $ra });
+	return $NTRIPLES{ $ra } //= $node->$code();
+}
+
+sub _node_key_pp {
+	my $node	= shift;
+	my $class	= ref($node);
+	if ($class eq 'RDF::Trine::Node::Resource') {
+		return 'R' . encode('utf8', $node->[1]);
+	} elsif ($class eq 'RDF::Trine::Node::Blank') {
+		return 'B' . encode('utf8', $node->[1]);
+	} elsif ($class eq 'RDF::Trine::Node::Literal') {
+		return join("\0", 'L' . encode('utf8', $node->[1] // ''), encode('utf8', $node->[2] // ''), encode('utf8', $node->[0]));
+	}
+	return;
+}
+
+sub _intern_pp {
+	my ($keys, $nodes, $ids, $node)	= @_;
+	my $key		= _node_key_pp( $node );
+	return $node unless (defined($key));
+	my $id		= $keys->{ $key };
+	return $nodes->[ $id ] if (defined($id));
+	$id					= scalar(@$nodes);
+	$nodes->[ $id ]		= $node;
+	$keys->{ $key }		= $id;
+	$ids->{ refaddr($node) }	= $id;
+	return $node;
+}
+
+BEGIN {
+	## no critic
+	eval "use RDF::Trine::XS;";
+	no strict 'refs';
+	my $xs	= RDF::Trine::XS->can('intern_node') ? 1 : 0;
+	*{ '_intern' }	= $xs ? \&RDF::Trine::XS::intern_node : \&_intern_pp;
+	## use critic
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 BUGS
+
+Please report any bugs or feature requests to through the GitHub web interface
+at L<https://github.com/kasei/perlrdf/issues>.
+
+=head1 AUTHOR
+
+Gregory Todd Williams  C<< <gwilliams@cpan.org> >>
+
+=head1 COPYRIGHT
+
+Copyright (c) 2006-2012 Gregory Todd Williams. This
+program is free software; you can redistribute it and/or modify it under
+the same terms as Perl itself.
+
+=cut
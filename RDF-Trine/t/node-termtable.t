@@ -0,0 +1,67 @@
+use strict;
+use warnings;
+no warnings 'redefine';
+use Test::More tests => 22;
+use Test::Exception;
+
+use utf8;
+use Scalar::Util qw(refaddr);
+
+use RDF::Trine qw(iri literal blank variable statement);
+use RDF::Trine::TermTable;
+
+my $xsd_int	= 'http://www.w3.org/2001/XMLSchema#integer';
+
+{
+	my $a	= iri('http://example.org/');
+	my $b	= iri('http://example.org/');
+	isnt( refaddr($a), refaddr($b), 'nodes are not interned by default' );
+	ok( not(RDF::Trine::TermTable->is_interned( $a )), 'is_interned is false by default' );
+}
+
+RDF::Trine::TermTable->enable;
+ok( RDF::Trine::TermTable->is_enabled, 'term table enabled' );
+
+{
+	my $a	= iri('http://example.org/');
+	my $b	= iri('http://example.org/');
+	is( refaddr($a), refaddr($b), 'equal resources are the same object' );
+	ok( RDF::Trine::TermTable->is_interned( $a ), 'is_interned' );
+	
+	my $id	= RDF::Trine::TermTable->id( $a );
+	ok( $id, 'term ID' );
+	is( refaddr( RDF::Trine::TermTable->node( $id ) ), refaddr($a), 'node for term ID' );
+	
+	my @lits	= (literal('1'), literal('1', 'en'), literal('1', undef, $xsd_int), literal('1', 'EN'), literal('1', undef, $xsd_int));
+	my %ids		= map { RDF::Trine::TermTable->id( $_ ) => 1 } @lits;
+	is( scalar(keys %ids), 3, 'distinct literals have distinct term IDs' );
+	is( refaddr($lits[1]), refaddr($lits[3]), 'language tags are canonicalized before interning' );
+	ok( $lits[2]->equal( $lits[4] ), 'interned literals equal' );
+	ok( not($lits[0]->equal( $lits[1] )), 'interned literals not equal' );
+	is( RDF::Trine::Node::compare( $lits[2], $lits[4] ), 0, 'interned literals compare' );
+	
+	my $u	= literal('神崎正英', 'ja');
+	is( $u->as_ntriples, '"\u795E\u5D0E\u6B63\u82F1"@ja', 'N-Triples serialization' );
+	ok( exists $RDF::Trine::TermTable::NTRIPLES{ refaddr($u) }, 'N-Triples serialization is cached' );
+	is( $u->sse, $u->as_ntriples, 'sse' );
+	
+	is( refaddr(blank('b1')), refaddr(blank('b1')), 'equal blank nodes are the same object' );
+	ok( not(blank('b1')->equal( blank('b2') )), 'interned blank nodes not equal' );
+	
+	my $size	= RDF::Trine::TermTable->size;
+	variable('x');
+	is( RDF::Trine::TermTable->size, $size, 'variables are not interned' );
+	
+	throws_ok { $lits[0]->literal_value('2') } 'RDF::Trine::Error::MethodInvocationError', 'interned literal values cannot be changed';
+	is( $lits[0]->literal_value, '1', 'interned literal value is unchanged' );
+	throws_ok { $a->uri('http://example.com/') } 'RDF::Trine::Error::MethodInvocationError', 'interned resource IRIs cannot be changed';
+}
+
+RDF::Trine::TermTable->disable;
+RDF::Trine::TermTable->clear;
+
+{
+	my $a	= iri('http://example.org/');
+	my $b	= iri('http://example.org/');
+	isnt( refaddr($a), refaddr($b), 'nodes are not interned after disable' );
+}
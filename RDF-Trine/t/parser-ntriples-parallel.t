@@ -0,0 +1,82 @@
+use Test::More;
+use Test::Exception;
+use File::Temp qw(tempfile);
+use Config;
+use utf8;
+use strict;
+use warnings;
+
+use RDF::Trine qw(iri blank literal);
+use RDF::Trine::Parser;
+
+unless ($Config{d_fork}) {
+	plan skip_all => 'fork is not available';
+}
+plan tests => 14;
+
+my $ntriples	= '';
+foreach my $i (1 .. 200) {
+	$ntriples	.= qq[_:b${\ ($i % 7)} <http://example.org/p> <http://example.org/o$i> .\n];
+	$ntriples	.= qq[<http://example.org/s$i> <http://example.org/name> "caf\\u00E9 $i"\@fr .\r\n];
+	$ntriples	.= qq[# comment\n] if ($i % 10 == 0);
+}
+my $file	= _file( $ntriples );
+
+{
+	my (@serial, @parallel);
+	RDF::Trine::Parser->new('ntriples')->parse_file( undef, $file, sub { push(@serial, shift->as_string) } );
+	RDF::Trine::Parser->new('ntriples', workers => 4)->parse_file( undef, $file, sub { push(@parallel, shift->as_string) } );
+	is( scalar(@parallel), 400, 'expected statement count from parallel parse' );
+	is_deeply( \@parallel, \@serial, 'parallel parse matches serial parse, in order' );
+}
+
+{
+	my $model	= RDF::Trine::Model->temporary_model;
+	RDF::Trine::Parser->new('ntriples', workers => 3)->parse_file_into_model( undef, $file, $model );
+	is( $model->size, 400, 'expected model size after parallel parse_file_into_model' );
+	is( $model->count_statements( blank('b1') ), 29, 'blank node labels are consistent across parts' );
+	is( $model->count_statements( undef, undef, literal("café 7", 'fr') ), 1, 'escaped literal' );
+}
+
+{
+	my $parser	= RDF::Trine::Parser->new('ntriples', workers => 8);
+	my @st;
+	$parser->parse_file( undef, _file( qq[<a> <b> <c> .\n] ), sub { push(@st, shift) } );
+	is( scalar(@st), 1, 'more workers than lines' );
+	@st	= ();
+	$parser->parse_file( undef, _file( '' ), sub { push(@st, shift) } );
+	is( scalar(@st), 0, 'empty file' );
+}
+
+{
+	my $bad	= $ntriples . qq[<a> <b> "c .\n] . $ntriples;
+	my $lines	= ($ntriples =~ tr/\n//) + 1;
+	my @st;
+	throws_ok { RDF::Trine::Parser->new('ntriples', workers => 4)->parse_file( undef, _file( $bad ), sub { push(@st, shift) } ) } 'RDF::Trine::Error::ParserError', 'parse error in a worker';
+	like( $@->text, qr/at line $lines\b/, 'parse error reports the line number in the whole file' );
+	is( scalar(@st), 400, 'statements before the error are passed to the handler' );
+}
+
+{
+	my $cr	= join('', map { qq[<http://example.org/s$_> <http://example.org/p> "$_" .] . ($_ % 10 ? "\r" : "\n") } (1 .. 200));
+	my $bad	= $cr . qq[<a> <b> "c .\n] . $cr;
+	throws_ok { RDF::Trine::Parser->new('ntriples', workers => 4)->parse_file( undef, _file( $bad ), sub {} ) } 'RDF::Trine::Error::ParserError', 'parse error in a worker after CR line endings';
+	like( $@->text, qr/at line 201\b/, 'lone CR line endings are counted as lines' );
+}
+
+{
+	my $nquads	= join('', map { qq[<http://example.org/s$_> <http://example.org/p> "$_" <http://example.org/g> .\n<http://example.org/s$_> <http://example.org/p> "$_" .\n] } (1 .. 50));
+	my $model	= RDF::Trine::Model->temporary_model;
+	RDF::Trine::Parser->new('nquads', workers => 4)->parse_file_into_model( undef, _file( $nquads ), $model );
+	is( $model->count_statements( undef, undef, undef, iri('http://example.org/g') ), 50, 'parallel N-Quads parse keeps contexts' );
+	is( $model->count_statements( undef, undef, undef, undef ), 100, 'parallel N-Quads parse keeps triples' );
+}
+
+sub _file {
+	my $data	= shift;
+	my ($fh, $filename)	= tempfile( UNLINK => 1 );
+	binmode( $fh, ':utf8' );
+	print {$fh} $data;
+	close($fh);
+	return $filename;
+}
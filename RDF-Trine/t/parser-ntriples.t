@@ -1,4 +1,4 @@
-use Test::More tests => 21;
+use Test::More tests => 25;
 use Test::Exception;
 use FindBin qw($Bin);
 use File::Spec;
@@ -141,3 +141,30 @@ END
 		is( $model->count_statements(undef, undef, literal(qq[0a1])), 1, 'expected plain literal with U-encoding' );
 	}
 }
+
+SKIP: {
+	# the native scanner must produce the same statements as the perl parser,
+	# including across chunk boundaries
+	skip 'RDF::Trine::XS parser not available', 4 unless ($RDF::Trine::Parser::NTriples::HAVE_XS_PARSER);
+	my $ntriples	= join('',
+		qq[<http://example.com/resum\\u00E9> <http://example.com/p> "caf\\u00E9"\@fr .\r\n],
+		qq[# comment\n\n],
+		qq[_:a\t<http://example.com/p> "1"^^<http://www.w3.org/2001/XMLSchema#integer> .\r],
+		qq[_:a <http://example.com/p> "x"\@en-latn-us .\n],
+		qq[<a> <http://example.com/p> "0\\"\\\\\\t1\\U00000061" .\n],
+	) x 20;
+	my %strings;
+	foreach my $xs (0, 1) {
+		local($RDF::Trine::Parser::NTriples::HAVE_XS_PARSER)	= $xs;
+		local($RDF::Trine::Parser::NTriples::CHUNK_SIZE)		= 50;
+		my @st;
+		$parser->parse( undef, $ntriples, sub { push(@st, shift->as_string) } );
+		$strings{ $xs }	= \@st;
+	}
+	is( scalar(@{ $strings{1} }), 80, 'expected statement count from native parser' );
+	is_deeply( $strings{1}, $strings{0}, 'native and perl parsers agree' );
+	
+	my @st;
+	throws_ok { $parser->parse( undef, qq[<a> <b> <c> .\n<a> <b> "c .\n], sub { push(@st, shift) } ) } 'RDF::Trine::Error::ParserError', 'native parser error is a ParserError';
+	is( scalar(@st), 1, 'statements before a native parser error are emitted' );
+}
@@ -111,6 +111,32 @@ END
 	is($got, $expect, "Finding UTF-8 string");
 }
 
+SKIP: {
+	# the native tokenizer must produce the same statements as the perl lexer,
+	# including for long literals that span chunk boundaries
+	skip 'RDF::Trine::XS tokenizer not available', scalar(@good) + 1 unless ($RDF::Trine::Parser::Turtle::Lexer::HAVE_XS_LEXER);
+	my $parser	= RDF::Trine::Parser::Turtle->new();
+	foreach my $file (@good) {
+		my (undef, undef, $test)	= File::Spec->splitpath( $file );
+		my %strings;
+		foreach my $xs (0, 1) {
+			local($RDF::Trine::Parser::Turtle::Lexer::HAVE_XS_LEXER)	= $xs;
+			local($RDF::Trine::Parser::Turtle::Lexer::CHUNK_SIZE)		= 16;
+			my @st;
+			$parser->parse_file( 'http://example.org/', $file, sub {
+				# generated blank node names differ between runs
+				(my $string = shift->as_string) =~ s/_:r\d+r\d+/_:anon/g;
+				push(@st, $string);
+			} );
+			$strings{ $xs }	= \@st;
+		}
+		is_deeply( $strings{1}, $strings{0}, "native and perl lexers agree: $test" );
+	}
+	
+	my @st;
+	throws_ok { $parser->parse( undef, qq[<a> <b> <c> .\n<a> <b> "c\\q" .\n], sub { push(@st, shift) } ) } 'RDF::Trine::Error::ParserError', 'native tokenizer error is a ParserError';
+}
+
 done_testing();
 
 sub _SILENCE {
@@ -0,0 +1,47 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+
+use RDF::Trine;
+use RDF::Trine::Store::DBI;
+
+eval "use RDF::Trine::XS; 1";
+if ($@ or not RDF::Trine::XS->can('hash')) {
+	plan skip_all => 'RDF::Trine::XS is not available';
+}
+plan tests => 5;
+
+is( RDF::Trine::Store::DBI->can('_mysql_hash'), \&RDF::Trine::XS::hash, 'DBI store hashes with RDF::Trine::XS' );
+
+# cross-check the native hash against the pure-perl algorithm for a random
+# corpus of node strings, including NULs, latin-1 and astral characters
+srand( 1017 );
+my @chars	= ( 'a' .. 'z', 'A' .. 'Z', '0' .. '9', ' ', '<', '>', ':', '/', "\x00", "\t", "\n", map { chr } (0xa0, 0xe9, 0xff, 0x100, 0x3b1, 0x5d0, 0x795e, 0xfeff, 0x1f600, 0x10ffff) );
+my @corpus;
+foreach (1 .. 20_000) {
+	my $prefix	= (qw(R B L))[ rand(3) ];
+	my $length	= int(rand(80));
+	push(@corpus, $prefix . join('', map { $chars[ rand(@chars) ] } (1 .. $length)));
+}
+my @latin1	= map { my $l = int(rand(40)); join('', map { chr(int(rand(256))) } (1 .. $l)) } (1 .. 2_000);
+push(@corpus, '', @latin1);
+
+my (@mismatch, @masked_mismatch);
+foreach my $data (@corpus) {
+	push(@mismatch, $data) unless (RDF::Trine::XS::hash( $data ) eq RDF::Trine::Store::DBI::_mysql_hash_pp( $data ));
+	push(@masked_mismatch, $data) unless (RDF::Trine::XS::hash( $data, 1 ) eq RDF::Trine::Store::DBI::SQLite::_mysql_hash_pp( $data ));
+}
+is( scalar(@mismatch), 0, 'native hash matches _mysql_hash_pp for ' . scalar(@corpus) . ' random strings' );
+is( scalar(@masked_mismatch), 0, 'native masked hash matches the SQLite _mysql_hash_pp' );
+
+{
+	my $data	= 'L神崎正英<ja>';
+	is( RDF::Trine::Store::DBI::SQLite->can('_mysql_hash')->( $data ), RDF::Trine::Store::DBI::SQLite::_mysql_hash_pp( $data ), 'SQLite hash method uses the masked native hash' );
+}
+
+{
+	my $node	= RDF::Trine::Node::Literal->new( '神崎正英', 'ja' );
+	my ($hash)	= RDF::Trine::XS::hash_nodes( [ $node ] );
+	is( $hash, RDF::Trine::Store::DBI::_mysql_hash_pp( 'L神崎正英<ja>' ), 'node hash matches the hash of the prefixed node string' );
+}
@@ -0,0 +1,96 @@
+use Test::More tests => 38;
+
+use strict;
+use warnings;
+no warnings 'redefine';
+use File::Temp qw(tempfile);
+
+use RDF::Trine qw(iri literal blank variable statement);
+use RDF::Trine::Store::Hexastore;
+
+(undef, my $filename) = tempfile();
+
+my $foo		= iri('http://example.org/foo');
+my $zzz		= iri('http://example.org/zzz');
+my $bar		= iri('http://example.org/bar');
+my $baz		= iri('http://example.org/baz');
+my $xsd_int	= 'http://www.w3.org/2001/XMLSchema#integer';
+
+{
+	my $store	= RDF::Trine::Store::Hexastore->new();
+	my $parser	= RDF::Trine::Parser->new('turtle');
+	$parser->parse_into_model( 'http://example.org/', <<"END", RDF::Trine::Model->new( $store ) );
+\@prefix eg: <http://example.org/> .
+\@prefix xsd: <http://www.w3.org/2001/XMLSchema#> .
+eg:foo eg:bar 23, 24 ; eg:baz "quux", "quux"\@en, "caf\x{e9}" .
+eg:zzz eg:bar 999 ; eg:baz _:b1 .
+_:b1 eg:baz _:b1 .
+END
+	$store->remove_statement( statement( $foo, $baz, literal('quux', 'en') ) );
+	$store->store_mapped( $filename );
+}
+
+{
+	my $store	= RDF::Trine::Store::Hexastore->load( $filename );
+	_do_tests( $store, "loading $filename directly" );
+}
+
+{
+	my $store	= RDF::Trine::Store->new_with_string( 'Hexastore;file=' . $filename );
+	_do_tests( $store, "using $filename in config string" );
+}
+
+{
+	my $store	= RDF::Trine::Store::Hexastore->load( $filename );
+	(undef, my $copy) = tempfile();
+	$store->store_mapped( $copy );
+	my $again	= RDF::Trine::Store::Hexastore->load( $copy );
+	is( $again->count_statements, 7, 'mapped store written back out from a mapped store' );
+
+	$store->add_statement( statement( $zzz, $bar, literal('1000', undef, $xsd_int) ) );
+	is( ref($store), 'RDF::Trine::Store::Hexastore', 'store converted to in-memory hexastore on update' );
+	is( $store->count_statements, 8, 'add_statement on a mapped store' );
+	is( $store->count_statements( $zzz, $bar, undef ), 2, 'count_statements(bbf) after update' );
+	is( RDF::Trine::Store::Hexastore->load( $filename )->count_statements, 7, 'index file unchanged by update' );
+
+	$store->nuke;
+	is( $store->count_statements, 0, 'nuke' );
+}
+
+{
+	my $store	= RDF::Trine::Store::Hexastore->new();
+	$store->store_mapped( $filename );
+	my $mapped	= RDF::Trine::Store::Hexastore->load( $filename );
+	is( $mapped->count_statements, 0, 'empty mapped store' );
+	is( scalar(my @all = $mapped->get_statements( undef, undef, undef )->get_all), 0, 'empty mapped store has no statements' );
+}
+
+sub _do_tests {
+	my ($store, $group) = @_;
+	note "Tests for $group";
+	isa_ok( $store, 'RDF::Trine::Store::Hexastore::Mapped' );
+	is( $store->count_statements, 7, 'count_statements(fff)' );
+	is( $store->size, 7, 'size' );
+	is( $store->count_statements( $foo ), 4, 'count_statements(bff)' );
+	is( $store->count_statements( undef, $bar, undef ), 3, 'count_statements(fbf)' );
+	is( $store->count_statements( $foo, $bar, undef ), 2, 'count_statements(bbf)' );
+	is( $store->count_statements( $foo, $baz, literal("caf\x{e9}") ), 1, 'count_statements(bbb) with non-ASCII literal' );
+	is( $store->count_statements( $foo, $baz, literal('quux', 'en') ), 0, 'removed statement not in mapped store' );
+	is( $store->count_statements( iri('http://example.org/nope') ), 0, 'count_statements for unknown node' );
+	is( $store->count_statements( variable('x'), undef, variable('x') ), 1, 'count_statements with repeated variable' );
+
+	my @objects	= map { $_->object->literal_value } $store->get_statements( undef, $bar, variable('o'), undef, orderby => [ o => 'ASC' ] )->get_all;
+	is_deeply( [ sort { $a <=> $b } @objects ], [ 23, 24, 999 ], 'get_statements(fbf)' );
+	my @dt		= grep { $_->object->literal_datatype eq $xsd_int } $store->get_statements( undef, $bar, undef )->get_all;
+	is( scalar(@dt), 3, 'datatyped literals round trip' );
+
+	my ($st)	= $store->get_statements( variable('x'), $baz, variable('x') )->get_all;
+	ok( $st->subject->isa('RDF::Trine::Node::Blank'), 'get_statements with repeated variable' );
+
+	my $subjects	= [ map { $_->subject->uri_value } $store->get_statements( variable('s'), $bar, undef, undef, orderby => [ s => 'DESC' ] )->get_all ];
+	is( $subjects->[0], 'http://example.org/zzz', 'get_statements with descending orderby' );
+
+	my $iter	= $store->get_pattern( RDF::Trine::Pattern->new( statement( variable('s'), $bar, variable('o') ), statement( variable('s'), $baz, variable('b') ) ) );
+	my @rows	= $iter->get_all;
+	is( scalar(@rows), 5, 'get_pattern join' );
+}
@@ -193,6 +193,64 @@ END
 	}
 }
 
+{
+	# star-shaped patterns are answered by intersecting node ID lists
+	my $bar		= iri('http://example.org/bar');
+	my $baz		= iri('http://example.org/baz');
+	my $int		= 'http://www.w3.org/2001/XMLSchema#integer';
+	
+	{
+		# ?s eg:bar 23 . ?s eg:bar ?value .
+		my $pattern	= RDF::Trine::Pattern->new(
+						statement( variable('s'), $bar, literal('23', undef, $int) ),
+						statement( variable('s'), $bar, variable('value') ),
+					);
+		my @rows	= $store->get_pattern( $pattern )->get_all;
+		is( scalar(@rows), 4, 'expected count on star pattern' );
+		my %values	= map { join(' ', $_->{s}->uri_value, $_->{value}->literal_value) => 1 } @rows;
+		is_deeply( [ sort keys %values ], [ map { "http://example.org/$_" } ('foo 23', 'foo 24', 'zzz 23', 'zzz 999') ], 'expected star pattern bindings' );
+	}
+	
+	{
+		# ?s eg:bar ?value . ?s eg:baz ?other .
+		my $pattern	= RDF::Trine::Pattern->new(
+						statement( variable('s'), $bar, variable('value') ),
+						statement( variable('s'), $baz, variable('other') ),
+					);
+		my @rows	= $store->get_pattern( $pattern )->get_all;
+		is( scalar(@rows), 2, 'expected count on star pattern with two free variables' );
+		is_deeply( [ sort map { $_->{value}->literal_value } @rows ], [23, 24], 'expected star pattern bindings' );
+		is( $rows[0]{other}->literal_value, 'quux', 'expected star pattern binding for second variable' );
+	}
+	
+	{
+		# ?s ?p 23 . ?s ?p 999 .
+		my $pattern	= RDF::Trine::Pattern->new(
+						statement( variable('s'), variable('p'), literal('23', undef, $int) ),
+						statement( variable('s'), variable('p'), literal('999', undef, $int) ),
+					);
+		my @rows	= $store->get_pattern( $pattern )->get_all;
+		is( scalar(@rows), 1, 'expected count on star pattern with shared non-join variable' );
+		is( $rows[0]{s}->uri_value, 'http://example.org/zzz', 'expected star pattern binding' );
+	}
+	
+	{
+		# ?s eg:bar 24 . ?s eg:baz "nope" .
+		my $pattern	= RDF::Trine::Pattern->new(
+						statement( variable('s'), $bar, literal('24', undef, $int) ),
+						statement( variable('s'), $baz, literal('nope') ),
+					);
+		my @rows	= $store->get_pattern( $pattern )->get_all;
+		is( scalar(@rows), 0, 'star pattern with unknown node' );
+		ok( not(defined($store->_existing_node_id( literal('nope') ))), 'star pattern does not add unknown nodes to the dictionary' );
+	}
+	
+	{
+		my @ids	= RDF::Trine::Store::Hexastore::_intersect_sorted( [1, 3, 5, 7, 9, 11, 40], [2, 3, 4, 9, 10, 11, 12, 13, 14, 15, 40], [3, 11, 40, 41] );
+		is_deeply( \@ids, [3, 11, 40], 'sorted ID list intersection' );
+	}
+}
+
 ################
 
 sub _add_rdf {
@@ -0,0 +1,104 @@
+use Test::More tests => 34;
+
+use strict;
+use warnings;
+no warnings 'redefine';
+
+use RDF::Trine qw(iri literal blank variable statement);
+use RDF::Trine::Namespace qw(rdf foaf);
+use RDF::Trine::Pattern;
+use RDF::Trine::Store::Memory;
+use RDF::Trine::Store::Hexastore;
+use RDF::Trine::Store::Statistics;
+
+my $ex		= RDF::Trine::Namespace->new('http://example.org/');
+
+my @statements;
+foreach my $i (1 .. 20) {
+	my $p	= $ex->["person$i"];
+	push(@statements, statement( $p, $rdf->type, $foaf->Person ));
+	push(@statements, statement( $p, $foaf->name, literal("Person $i") ));
+	push(@statements, statement( $p, $foaf->knows, $ex->["person" . (($i % 20) + 1)] ));
+	push(@statements, statement( $p, $foaf->knows, $ex->["person" . ((($i + 1) % 20) + 1)] ));
+}
+push(@statements, statement( $ex->person1, $rdf->type, $foaf->Agent ));
+
+foreach my $xs (1, 0) {
+	SKIP: {
+		if ($xs and $RDF::Trine::Store::Statistics::COUNTER_CLASS ne 'RDF::Trine::XS::Counter') {
+			skip( 'RDF::Trine::XS::Counter is not available', 8 );
+		}
+		local($RDF::Trine::Store::Statistics::COUNTER_CLASS)	= 'RDF::Trine::Store::Statistics::Counter' unless ($xs);
+		my $impl	= $RDF::Trine::Store::Statistics::COUNTER_CLASS;
+		my $stats	= RDF::Trine::Store::Statistics->new( top_k => 2 );
+		$stats->add_statement( $_ ) foreach (@statements);
+
+		is( $stats->size, 81, "size ($impl)" );
+		is( $stats->predicate_count( $foaf->knows ), 40, "predicate count ($impl)" );
+		is_deeply( [ $stats->distinct_subjects( $rdf->type ), $stats->distinct_objects( $rdf->type ) ], [ 20, 2 ], "distinct subjects and objects ($impl)" );
+		is( $stats->object_count( $rdf->type, $foaf->Person ), 20, "object count ($impl)" );
+		is( $stats->subject_count( $foaf->knows, $ex->person3 ), 2, "subject count ($impl)" );
+		is_deeply( [ map { [ $_->[0]->uri_value, $_->[1] ] } $stats->top_objects( $rdf->type ) ], [ [ $foaf->Person->uri_value, 20 ], [ $foaf->Agent->uri_value, 1 ] ], "top objects ($impl)" );
+
+		$stats->remove_statement( statement( $ex->person1, $rdf->type, $foaf->Agent ) );
+		$stats->remove_statement( statement( $ex->person1, $rdf->type, $foaf->Person ) );
+		is_deeply( [ $stats->predicate_count( $rdf->type ), $stats->distinct_subjects( $rdf->type ), $stats->distinct_objects( $rdf->type ) ], [ 19, 19, 1 ], "counts after remove ($impl)" );
+		is_deeply( [ map { $_->[1] } $stats->top_objects( $rdf->type ) ], [ 19 ], "top objects after remove ($impl)" );
+	}
+}
+
+{
+	my $stats	= RDF::Trine::Store::Statistics->new();
+	$stats->add_statement( $_ ) foreach (@statements);
+	is( $stats->cardinality( statement( variable('s'), $foaf->knows, variable('o') ) ), 40, 'cardinality with bound predicate' );
+	is( $stats->cardinality( statement( variable('s'), $rdf->type, $foaf->Person ) ), 20, 'cardinality with bound predicate and object' );
+	is( $stats->cardinality( statement( $ex->person1, variable('p'), variable('o') ) ), 5, 'cardinality with bound subject' );
+	is( $stats->cardinality( statement( variable('s'), $foaf->knows, variable('o') ), { s => 1 } ), 2, 'cardinality with a variable bound by a join' );
+	is( $stats->cardinality( statement( variable('s'), $ex->nothing, variable('o') ) ), 0, 'cardinality of unused predicate' );
+}
+
+{
+	my $pattern	= RDF::Trine::Pattern->new(
+		statement( variable('p'), $foaf->knows, variable('q') ),
+		statement( variable('q'), $foaf->name, variable('name') ),
+		statement( variable('p'), $foaf->name, literal('Person 7') ),
+		statement( variable('x'), $rdf->type, $foaf->Agent ),
+	);
+	my $stats	= RDF::Trine::Store::Statistics->new();
+	$stats->add_statement( $_ ) foreach (@statements);
+	my $sorted	= $pattern->sort_by_cardinality( $stats );
+	is_deeply(
+		[ map { $_->as_string } $sorted->triples ],
+		[ map { $_->as_string } ($pattern->triples)[2, 0, 1, 3] ],
+		'join order by cardinality, connected triples first'
+	);
+}
+
+foreach my $class (qw(RDF::Trine::Store::Memory RDF::Trine::Store::Hexastore)) {
+	my $store	= $class->new();
+	$store->add_statement( $_ ) foreach (@statements[0 .. 9]);
+	my $stats	= $store->statistics;
+	isa_ok( $stats, 'RDF::Trine::Store::Statistics' );
+	is( $stats->size, 10, "statistics built from existing data ($class)" );
+	$store->add_statement( $_ ) foreach (@statements[10 .. $#statements]);
+	$store->add_statement( $statements[0] );
+	is( $stats->predicate_count( $rdf->type ), 21, "statistics updated on add ($class)" );
+	$store->remove_statement( $statements[0] );
+	is( $stats->predicate_count( $rdf->type ), 20, "statistics updated on remove ($class)" );
+
+	my $model	= RDF::Trine::Model->new( $store );
+	my $iter	= $model->get_pattern( RDF::Trine::Pattern->new(
+		statement( variable('p'), $foaf->knows, variable('q') ),
+		statement( variable('p'), $foaf->name, literal('Person 7') ),
+	) );
+	is( scalar(@{ [ $iter->get_all ] }), 2, "get_pattern with statistics ($class)" );
+}
+
+{
+	my $store	= RDF::Trine::Store::Hexastore->new();
+	$store->add_statement( $_ ) foreach (@statements);
+	my $model	= RDF::Trine::Model->new( $store );
+	my $iter	= $model->get_pattern( RDF::Trine::Pattern->new( statement( variable('p'), $rdf->type, $foaf->Person ) ) );
+	is( scalar(@{ [ $iter->get_all ] }), 20, 'single-triple get_pattern' );
+	ok( not(exists($store->{statistics})), 'single-triple get_pattern does not build statistics' );
+}
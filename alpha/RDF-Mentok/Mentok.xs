@@ -11,6 +11,208 @@
 
 typedef struct hx_model * RDF_Mentok;
 
+/* A running evaluation of a BGP. The bindings are read in batches by
+ * next_batch. Statement lookups are run as a one-triple BGP; for those,
+ * template holds the bound nodes of the pattern and columns maps each
+ * unbound position to its binding column, so that rows can be returned as
+ * statement objects. */
+typedef struct {
+	SV* model;
+	hx_execution_context* ctx;
+	hx_bgp* bgp;
+	hx_variablebindings_iter* iter;
+	int size;
+	char** names;
+	int statements;
+	SV* template[3];
+	int columns[3];
+} plmentok_iter;
+
+typedef plmentok_iter * RDF_Mentok_Iterator;
+
+/* Stashes used to build node objects directly as blessed arrays, with the
+ * same layout their Perl constructors produce. */
+typedef struct {
+	HV* resource;
+	HV* blank;
+	HV* literal;
+	HV* statement;
+} plmentok_classes;
+
+static void
+_plmentok_classes_init (pTHX_ plmentok_classes* c) {
+	c->resource		= gv_stashpv( "RDF::Trine::Node::Resource", GV_ADD );
+	c->blank		= gv_stashpv( "RDF::Trine::Node::Blank", GV_ADD );
+	c->literal		= gv_stashpv( "RDF::Trine::Node::Literal", GV_ADD );
+	c->statement	= gv_stashpv( "RDF::Trine::Statement", GV_ADD );
+}
+
+static SV*
+_plmentok_string (pTHX_ const char* value) {
+	SV* sv	= newSVpv( value, 0 );
+	SvUTF8_on(sv);
+	return sv;
+}
+
+static SV*
+_plmentok_bless (pTHX_ AV* av, HV* stash) {
+	return sv_bless( newRV_noinc( (SV*) av ), stash );
+}
+
+/* Returns a new RDF::Trine node object for a Mentok node. */
+static SV*
+_plmentok_sv (pTHX_ plmentok_classes* c, hx_node* n) {
+	AV* av;
+	if (!n) {
+		return newSV(0);
+	}
+	av	= newAV();
+	if (hx_node_is_resource( n )) {
+		av_push( av, newSVpvs( "URI" ) );
+		av_push( av, _plmentok_string( aTHX_ hx_node_value( n ) ) );
+		return _plmentok_bless( aTHX_ av, c->resource );
+	} else if (hx_node_is_blank( n )) {
+		av_push( av, newSVpvs( "BLANK" ) );
+		av_push( av, _plmentok_string( aTHX_ hx_node_value( n ) ) );
+		return _plmentok_bless( aTHX_ av, c->blank );
+	} else if (hx_node_is_literal( n )) {
+		av_push( av, _plmentok_string( aTHX_ hx_node_value( n ) ) );
+		if (hx_node_is_lang_literal( n )) {
+			av_push( av, _plmentok_string( aTHX_ hx_node_lang( (hx_node_lang_literal*) n ) ) );
+			av_push( av, newSV(0) );
+		} else if (hx_node_is_dt_literal( n )) {
+			av_push( av, newSV(0) );
+			av_push( av, _plmentok_string( aTHX_ hx_node_dt( (hx_node_dt_literal*) n ) ) );
+		}
+		return _plmentok_bless( aTHX_ av, c->literal );
+	}
+	SvREFCNT_dec( (SV*) av );
+	return newSV(0);
+}
+
+static char*
+_plmentok_av_string (pTHX_ AV* av, I32 i) {
+	SV** svp	= av_fetch( av, i, 0 );
+	if (!svp || !SvOK(*svp)) {
+		return NULL;
+	}
+	return SvPVutf8_nolen( *svp );
+}
+
+static int
+_plmentok_is_bound (pTHX_ SV* node) {
+	return (node && sv_isobject(node) && !sv_derived_from(node, "RDF::Trine::Node::Variable"));
+}
+
+/* Returns a new Mentok node for an RDF::Trine node. Variables are numbered
+ * by name in vars (Mentok variable ids are negative); an undefined node
+ * becomes a new anonymous variable. The returned node is owned by the
+ * caller. */
+static hx_node*
+_plmentok_node (pTHX_ SV* node, HV* vars) {
+	AV* av;
+	if (!node || !sv_isobject(node)) {
+		int id	= -1 - (int) HvUSEDKEYS(vars);
+		char name[32];
+		sprintf( name, " anon%d", -id );
+		(void) hv_store( vars, name, strlen(name), newSViv( id ), 0 );
+		return hx_new_node_named_variable( id, name );
+	}
+	if (SvTYPE(SvRV(node)) != SVt_PVAV) {
+		croak("Unsupported node type for RDF::Mentok: %s", sv_reftype(SvRV(node), 1));
+	}
+	av	= (AV*) SvRV(node);
+	if (sv_derived_from(node, "RDF::Trine::Node::Variable")) {
+		char* name	= _plmentok_av_string( aTHX_ av, 0 );
+		SV** idp;
+		int id;
+		if (!name) {
+			croak("RDF::Mentok variable has no name");
+		}
+		if ((idp = hv_fetch( vars, name, strlen(name), 0 ))) {
+			id	= SvIV( *idp );
+		} else {
+			id	= -1 - (int) HvUSEDKEYS(vars);
+			(void) hv_store( vars, name, strlen(name), newSViv( id ), 0 );
+		}
+		return hx_new_node_named_variable( id, name );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Resource")) {
+		return hx_new_node_resource( _plmentok_av_string( aTHX_ av, 1 ) );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Blank")) {
+		return hx_new_node_blank( _plmentok_av_string( aTHX_ av, 1 ) );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Literal")) {
+		char* value	= _plmentok_av_string( aTHX_ av, 0 );
+		char* lang	= _plmentok_av_string( aTHX_ av, 1 );
+		char* dt	= _plmentok_av_string( aTHX_ av, 2 );
+		if (lang) {
+			return (hx_node*) hx_new_node_lang_literal( value, lang );
+		} else if (dt) {
+			return (hx_node*) hx_new_node_dt_literal( value, dt );
+		} else {
+			return hx_new_node_literal( value );
+		}
+	}
+	croak("Unsupported node type for RDF::Mentok: %s", sv_reftype(SvRV(node), 1));
+	return NULL;
+}
+
+static SV*
+_plmentok_av_node (pTHX_ AV* av, I32 i) {
+	SV** svp	= av_fetch( av, i, 0 );
+	return svp ? *svp : NULL;
+}
+
+/* Starts evaluating an array of RDF::Trine statements as a BGP. */
+static plmentok_iter*
+_plmentok_execute (pTHX_ SV* model, AV* triples, HV* vars) {
+	RDF_Mentok m	= INT2PTR( RDF_Mentok, SvIV( SvRV(model) ) );
+	I32 count	= av_len( triples ) + 1;
+	hx_triple** t;
+	plmentok_iter* it;
+	I32 i;
+	
+	if (count < 1) {
+		croak("Cannot evaluate an empty BGP");
+	}
+	Newxz( t, count, hx_triple* );
+	for (i = 0; i < count; i++) {
+		SV* st	= _plmentok_av_node( aTHX_ triples, i );
+		AV* nodes;
+		if (!st || !sv_isobject(st) || SvTYPE(SvRV(st)) != SVt_PVAV) {
+			Safefree( t );
+			croak("RDF::Mentok BGPs must contain only statements");
+		}
+		nodes	= (AV*) SvRV(st);
+		t[i]	= hx_new_triple(
+					_plmentok_node( aTHX_ _plmentok_av_node( aTHX_ nodes, 0 ), vars ),
+					_plmentok_node( aTHX_ _plmentok_av_node( aTHX_ nodes, 1 ), vars ),
+					_plmentok_node( aTHX_ _plmentok_av_node( aTHX_ nodes, 2 ), vars )
+				);
+	}
+	
+	Newxz( it, 1, plmentok_iter );
+	it->model	= newSVsv( model );
+	it->ctx		= hx_new_execution_context( NULL, m );
+	/* the BGP takes ownership of the triples and their nodes */
+	it->bgp		= hx_new_bgp( count, t );
+	it->iter	= hx_bgp_execute( it->ctx, it->bgp );
+	it->size	= hx_variablebindings_iter_size( it->iter );
+	it->names	= hx_variablebindings_iter_names( it->iter );
+	Safefree( t );
+	return it;
+}
+
+static int
+_plmentok_column (plmentok_iter* it, const char* name) {
+	int i;
+	for (i = 0; i < it->size; i++) {
+		if (strcmp( it->names[i], name ) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
 
 double plmentok_test ( void ) {
 	return 13;
@@ -48,6 +250,145 @@ long plmentok_size ( m )
 	OUTPUT:
 		RETVAL
 		
+void
+plmentok_add_statement ( m, st )
+		RDF_Mentok m
+		SV* st
+	PREINIT:
+		HV* vars;
+		hx_node* n[3];
+		AV* nodes;
+		int i;
+	CODE:
+		if (!sv_isobject(st) || SvTYPE(SvRV(st)) != SVt_PVAV) {
+			croak("Not a statement object");
+		}
+		nodes	= (AV*) SvRV(st);
+		for (i = 0; i < 3; i++) {
+			if (!_plmentok_is_bound( aTHX_ _plmentok_av_node( aTHX_ nodes, i ) )) {
+				croak("RDF::Mentok cannot store a statement with unbound nodes");
+			}
+		}
+		vars	= (HV*) sv_2mortal( (SV*) newHV() );
+		for (i = 0; i < 3; i++) {
+			n[i]	= _plmentok_node( aTHX_ _plmentok_av_node( aTHX_ nodes, i ), vars );
+		}
+		hx_model_add_triple( m, n[0], n[1], n[2] );
+		for (i = 0; i < 3; i++) {
+			hx_free_node( n[i] );
+		}
+
+void
+plmentok_remove_statement ( m, st )
+		RDF_Mentok m
+		SV* st
+	PREINIT:
+		HV* vars;
+		hx_node* n[3];
+		AV* nodes;
+		int i;
+	CODE:
+		if (!sv_isobject(st) || SvTYPE(SvRV(st)) != SVt_PVAV) {
+			croak("Not a statement object");
+		}
+		nodes	= (AV*) SvRV(st);
+		vars	= (HV*) sv_2mortal( (SV*) newHV() );
+		for (i = 0; i < 3; i++) {
+			n[i]	= _plmentok_node( aTHX_ _plmentok_av_node( aTHX_ nodes, i ), vars );
+		}
+		hx_model_remove_triple( m, n[0], n[1], n[2] );
+		for (i = 0; i < 3; i++) {
+			hx_free_node( n[i] );
+		}
+
+UV
+plmentok_count_statements ( m, s, p, o )
+		RDF_Mentok m
+		SV* s
+		SV* p
+		SV* o
+	PREINIT:
+		HV* vars;
+		hx_node* n[3];
+		SV* nodes[3];
+		int i;
+	CODE:
+		nodes[0]	= s;
+		nodes[1]	= p;
+		nodes[2]	= o;
+		vars	= (HV*) sv_2mortal( (SV*) newHV() );
+		for (i = 0; i < 3; i++) {
+			/* count_statements ignores variable names, as get_statements does */
+			n[i]	= _plmentok_node( aTHX_ _plmentok_is_bound( aTHX_ nodes[i] ) ? nodes[i] : NULL, vars );
+		}
+		RETVAL	= (UV) hx_model_count_statements( m, n[0], n[1], n[2] );
+		for (i = 0; i < 3; i++) {
+			hx_free_node( n[i] );
+		}
+	OUTPUT:
+		RETVAL
+
+RDF_Mentok_Iterator
+plmentok_find_statements ( m, s, p, o )
+		RDF_Mentok m
+		SV* s
+		SV* p
+		SV* o
+	PREINIT:
+		HV* vars;
+		AV* pattern;
+		AV* triples;
+		SV* nodes[3];
+		int i;
+		const char* positions[3]	= { " s", " p", " o" };
+		plmentok_iter* it;
+	CODE:
+		PERL_UNUSED_VAR(m);
+		nodes[0]	= s;
+		nodes[1]	= p;
+		nodes[2]	= o;
+		/* unbound positions become variables whose names start with a space,
+		 * so they cannot clash with the names of RDF::Trine variables */
+		pattern	= newAV();
+		for (i = 0; i < 3; i++) {
+			if (_plmentok_is_bound( aTHX_ nodes[i] )) {
+				av_push( pattern, newSVsv( nodes[i] ) );
+			} else {
+				AV* var	= newAV();
+				av_push( var, newSVpv( positions[i], 0 ) );
+				av_push( pattern, sv_bless( newRV_noinc( (SV*) var ), gv_stashpv( "RDF::Trine::Node::Variable", GV_ADD ) ) );
+			}
+		}
+		triples	= (AV*) sv_2mortal( (SV*) newAV() );
+		av_push( triples, newRV_noinc( (SV*) pattern ) );
+		vars	= (HV*) sv_2mortal( (SV*) newHV() );
+		it		= _plmentok_execute( aTHX_ ST(0), triples, vars );
+		it->statements	= 1;
+		for (i = 0; i < 3; i++) {
+			if (_plmentok_is_bound( aTHX_ nodes[i] )) {
+				it->template[i]	= newSVsv( nodes[i] );
+				it->columns[i]	= -1;
+			} else {
+				it->columns[i]	= _plmentok_column( it, positions[i] );
+			}
+		}
+		RETVAL	= it;
+	OUTPUT:
+		RETVAL
+
+RDF_Mentok_Iterator
+plmentok_execute_bgp ( m, triples )
+		RDF_Mentok m
+		AV* triples
+	PREINIT:
+		HV* vars;
+	CODE:
+		PERL_UNUSED_VAR(m);
+		vars	= (HV*) sv_2mortal( (SV*) newHV() );
+		RETVAL	= _plmentok_execute( aTHX_ ST(0), triples, vars );
+	OUTPUT:
+		RETVAL
+
 void
 plmentok_DESTROY (model)
 		RDF_Mentok model
@@ -55,3 +396,90 @@ plmentok_DESTROY (model)
 //		hx_model_debug( model );
 		hx_free_model(model);
 
+
+MODULE = RDF::Mentok		PACKAGE = RDF::Mentok::Iterator	PREFIX = plmentok_iter_
+
+void
+plmentok_iter_names ( it )
+		RDF_Mentok_Iterator it
+	PREINIT:
+		int i;
+	PPCODE:
+		if (it->statements) {
+			XSRETURN_EMPTY;
+		}
+		EXTEND(SP, it->size);
+		for (i = 0; i < it->size; i++) {
+			PUSHs(sv_2mortal(_plmentok_string( aTHX_ it->names[i] )));
+		}
+
+SV*
+plmentok_iter_next_batch ( it, n )
+		RDF_Mentok_Iterator it
+		IV n
+	PREINIT:
+		plmentok_classes c;
+		RDF_Mentok m;
+		AV* batch;
+		IV count;
+		int i;
+	CODE:
+		_plmentok_classes_init( aTHX_ &c );
+		m		= INT2PTR( RDF_Mentok, SvIV( SvRV(it->model) ) );
+		batch	= newAV();
+		if (n > 0) {
+			av_extend( batch, n - 1 );
+		}
+		for (count = 0; count < n && it->iter && !hx_variablebindings_iter_finished( it->iter ); count++) {
+			hx_variablebindings* b;
+			hx_variablebindings_iter_current( it->iter, &b );
+			if (it->statements) {
+				AV* st	= newAV();
+				av_extend( st, 2 );
+				for (i = 0; i < 3; i++) {
+					SV* node	= (it->columns[i] < 0)
+								? newSVsv( it->template[i] )
+								: _plmentok_sv( aTHX_ &c, hx_variablebindings_node_for_binding( b, m->store, it->columns[i] ) );
+					av_store( st, i, node );
+				}
+				av_push( batch, _plmentok_bless( aTHX_ st, c.statement ) );
+			} else {
+				HV* row	= newHV();
+				for (i = 0; i < it->size; i++) {
+					const char* name	= it->names[i];
+					if (name[0] == ' ') {
+						continue;
+					}
+					(void) hv_store( row, name, strlen(name), _plmentok_sv( aTHX_ &c, hx_variablebindings_node_for_binding( b, m->store, i ) ), 0 );
+				}
+				av_push( batch, newRV_noinc( (SV*) row ) );
+			}
+			hx_free_variablebindings( b );
+			hx_variablebindings_iter_next( it->iter );
+		}
+		RETVAL	= newRV_noinc( (SV*) batch );
+	OUTPUT:
+		RETVAL
+
+void
+plmentok_iter_DESTROY ( it )
+		RDF_Mentok_Iterator it
+	PREINIT:
+		int i;
+	CODE:
+		if (it->iter) {
+			hx_free_variablebindings_iter( it->iter );
+		}
+		if (it->bgp) {
+			hx_free_bgp( it->bgp );
+		}
+		if (it->ctx) {
+			hx_free_execution_context( it->ctx );
+		}
+		for (i = 0; i < 3; i++) {
+			if (it->template[i]) {
+				SvREFCNT_dec( it->template[i] );
+			}
+		}
+		SvREFCNT_dec( it->model );
+		Safefree( it );
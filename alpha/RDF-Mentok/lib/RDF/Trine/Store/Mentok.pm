@@ -0,0 +1,356 @@
+=head1 NAME
+
+RDF::Trine::Store::Mentok - RDF store using the Mentok hexastore library
+
+=head1 VERSION
+
+This document describes RDF::Trine::Store::Mentok version 0.01
+
+=head1 SYNOPSIS
+
+    use RDF::Trine::Store::Mentok;
+    my $store	= RDF::Trine::Store::Mentok->new();
+    $store->load_file( 'data.nt' );
+    my $model	= RDF::Trine::Model->new( $store );
+
+=head1 DESCRIPTION
+
+RDF::Trine::Store::Mentok provides an in-memory triple-store using the Mentok
+library's hexastore indexes. Statement lookups and counts use Mentok's native
+indexes, and whole basic graph patterns passed to C<< get_pattern >> are
+evaluated by Mentok's BGP engine in C, with the resulting bindings converted to
+RDF::Trine objects in batches (see C<< new >>).
+
+BGPs are evaluated with C<< hx_bgp_execute >> on a default execution context.
+The store does not implement threaded BGP evaluation: it sets no threading or
+batch parameters on the execution context, and Mentok's
+C<< THREADED_BATCH_SIZE >> and C<< RDF_ITER_FLAGS_BOUND_* >> constants are not
+used.
+
+Mentok stores triples only. Statements added with a context are stored in the
+default graph, and lookups for any other context find nothing.
+
+=head1 DEPENDENCIES
+
+The Mentok library and L<RDF::Mentok>.
+
+=cut
+
+package RDF::Trine::Store::Mentok;
+
+use strict;
+use warnings;
+no warnings 'redefine';
+use base qw(RDF::Trine::Store);
+
+use Scalar::Util qw(blessed);
+
+use RDF::Mentok;
+use RDF::Trine::Error;
+use RDF::Trine::Iterator;
+use RDF::Trine::Pattern;
+
+our ($VERSION, $BATCH_SIZE);
+BEGIN {
+	$VERSION	= '0.01';
+	$BATCH_SIZE	= 1000;
+	my $class	= __PACKAGE__;
+	$RDF::Trine::Store::STORE_CLASSES{ $class }	= $VERSION;
+}
+
+=head1 METHODS
+
+Beyond the methods documented below, this class inherits methods from the
+L<RDF::Trine::Store> class.
+
+=over 4
+
+=item C<< new ( [ $filename ] [, batch_size => $size ] ) >>
+
+Returns a new, empty storage object. If C<< $filename >> is given, the RDF
+data in the file is loaded into the store.
+
+Results are read from Mentok C<< batch_size >> at a time, by default
+C<< $RDF::Trine::Store::Mentok::BATCH_SIZE >> (1000).
+
+=cut
+
+sub new {
+	my $class	= shift;
+	my $file	= shift;
+	my %args	= @_;
+	my $size	= $args{ batch_size } || $BATCH_SIZE;
+	unless ($size =~ /^\d+$/ and $size > 0) {
+		throw RDF::Trine::Error::MethodInvocationError -text => "Invalid batch size for Mentok store: $size";
+	}
+	my $self	= bless({ model => RDF::Mentok::new_model(), batch_size => $size }, $class);
+	$self->load_file( $file ) if (defined($file));
+	return $self;
+}
+
+sub _new_with_string {
+	my $class	= shift;
+	my $config	= shift;
+	return $class->new( length($config) ? $config : undef );
+}
+
+sub _new_with_config {
+	my $class	= shift;
+	my $config	= shift;
+	return $class->new( $config->{file}, batch_size => $config->{batch_size} );
+}
+
+sub _config_meta {
+	return {
+		required_keys	=> [],
+		fields			=> {
+			file		=> { description => 'RDF file to load', type => 'filename' },
+			batch_size	=> { description => 'Number of results read from Mentok at a time', type => 'int' },
+		}
+	}
+}
+
+=item C<< temporary_store >>
+
+Returns a new, empty storage object.
+
+=cut
+
+sub temporary_store {
+	my $class	= shift;
+	return $class->new();
+}
+
+=item C<< load_file ( $filename ) >>
+
+Parses the RDF file C<< $filename >> with Mentok's parser and adds its triples
+directly to the store.
+
+=cut
+
+sub load_file {
+	my $self	= shift;
+	my $file	= shift;
+	unless (defined($file) and -r $file) {
+		throw RDF::Trine::Error::MethodInvocationError -text => "Cannot read file for loading";
+	}
+	$self->{model}->load_file( $file );
+}
+
+=item C<< get_statements ($subject, $predicate, $object [, $context] ) >>
+
+Returns a stream object of all statements matching the specified subject,
+predicate and objects. Any of the arguments may be undef to match any value.
+
+=cut
+
+sub get_statements {
+	my $self	= shift;
+	my @nodes	= splice(@_, 0, 3);
+	my $context	= shift;
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return RDF::Trine::Iterator::Graph->new( [] );
+	}
+	my $iter	= $self->{model}->find_statements( @nodes );
+	return RDF::Trine::Iterator::Graph->new( $self->_batch_sub( $iter ) );
+}
+
+=item C<< get_pattern ( $bgp [, $context] [, %args ] ) >>
+
+Returns a stream object of all bindings matching the specified graph pattern.
+The whole pattern is evaluated by Mentok.
+
+=cut
+
+sub get_pattern {
+	my $self	= shift;
+	my $bgp		= shift;
+	my $context	= shift;
+	my @args	= @_;
+	my %args	= @args;
+
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return RDF::Trine::Iterator::Bindings->new( [], [] );
+	}
+	if ($bgp->isa('RDF::Trine::Statement')) {
+		$bgp	= RDF::Trine::Pattern->new( $bgp );
+	}
+	my @triples	= $bgp->triples;
+	if (grep { $_->isa('RDF::Trine::Statement::Quad') } @triples) {
+		# graph variables cannot be bound by a triple store
+		return $self->SUPER::_get_pattern( $bgp, $context, @args );
+	}
+
+	my $iter	= $self->{model}->execute_bgp( \@triples );
+	my @names	= grep { not(/^ /) } $iter->names;
+	my $bindings	= RDF::Trine::Iterator::Bindings->new( $self->_batch_sub( $iter ), \@names );
+	if (my $ob = $args{orderby}) {
+		$bindings	= $self->_sort_bindings( $bindings, $ob );
+	}
+	return $bindings;
+}
+
+=item C<< get_contexts >>
+
+Returns an empty iterator, as contexts are not supported by Mentok.
+
+=cut
+
+sub get_contexts {
+	return RDF::Trine::Iterator->new( [] );
+}
+
+=item C<< add_statement ( $statement [, $context] ) >>
+
+Adds the specified C<$statement> to the underlying model.
+
+=cut
+
+sub add_statement {
+	my $self	= shift;
+	my $st		= shift;
+	if ($st->isa('RDF::Trine::Statement::Quad')) {
+		$st	= RDF::Trine::Statement->new( ($st->nodes)[0 .. 2] );
+	}
+	$self->{model}->add_statement( $st );
+}
+
+=item C<< remove_statement ( $statement [, $context]) >>
+
+Removes the specified C<$statement> from the underlying model.
+
+=cut
+
+sub remove_statement {
+	my $self	= shift;
+	my $st		= shift;
+	if ($st->isa('RDF::Trine::Statement::Quad')) {
+		$st	= RDF::Trine::Statement->new( ($st->nodes)[0 .. 2] );
+	}
+	$self->{model}->remove_statement( $st );
+}
+
+=item C<< remove_statements ( $subject, $predicate, $object [, $context]) >>
+
+Removes all statements matching the supplied C<$subject>, C<$predicate> and
+C<$object> from the underlying model.
+
+=cut
+
+sub remove_statements {
+	my $self	= shift;
+	my @st		= $self->get_statements( @_ )->get_all;
+	foreach my $st (@st) {
+		$self->{model}->remove_statement( $st );
+	}
+}
+
+=item C<< count_statements ($subject, $predicate, $object) >>
+
+Returns a count of all the statements matching the specified subject,
+predicate and objects. Any of the arguments may be undef to match any value.
+
+=cut
+
+sub count_statements {
+	my $self	= shift;
+	my @nodes	= splice(@_, 0, 3);
+	my $context	= shift;
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return 0;
+	}
+	unless (grep { blessed($_) and not($_->is_variable) } @nodes) {
+		return $self->{model}->size;
+	}
+	return $self->{model}->count_statements( @nodes );
+}
+
+=item C<< supports ( [ $feature ] ) >>
+
+If C<< $feature >> is specified, returns true if the feature is supported by the
+store, false otherwise. If C<< $feature >> is not specified, returns a list of
+supported features.
+
+=cut
+
+sub supports {
+	my $self	= shift;
+	my %features	= ();
+	if (@_) {
+		my $f	= shift;
+		return $features{ $f };
+	} else {
+		return keys %features;
+	}
+}
+
+# Returns a closure returning the results of a native iterator one at a time,
+# reading them in batches.
+sub _batch_sub {
+	my $self	= shift;
+	my $iter	= shift;
+	my $size	= $self->{batch_size};
+	my @batch;
+	return sub {
+		unless (scalar(@batch)) {
+			return unless ($iter);
+			@batch	= @{ $iter->next_batch( $size ) };
+			unless (scalar(@batch)) {
+				undef $iter;
+				return;
+			}
+		}
+		return shift(@batch);
+	};
+}
+
+sub _sort_bindings {
+	my $self	= shift;
+	my $iter	= shift;
+	my $ob		= shift;
+	my @order	= @$ob;
+	if (scalar(@order) % 2) {
+		throw RDF::Trine::Error::MethodInvocationError -text => "Invalid arguments to orderby argument in get_pattern";
+	}
+	my @names	= $iter->binding_names;
+	my %seen	= map { $_ => 1 } @names;
+	my @results	= $iter->get_all;
+	my $order_vars	= scalar(@order) / 2;
+	@results	= sort {
+		my $r	= 0;
+		foreach my $i (0 .. ($order_vars-1)) {
+			my $var	= $order[$i*2];
+			my $rev	= ($order[$i*2+1] =~ /DESC/i);
+			$r	= RDF::Trine::Node::compare( $a->{$var}, $b->{$var} );
+			$r	*= -1 if ($rev);
+			last if ($r);
+		}
+		$r;
+	} @results;
+
+	my @sortedby;
+	foreach my $i (0 .. ($order_vars-1)) {
+		my $var	= $order[$i*2];
+		my $dir	= $order[$i*2+1];
+		push(@sortedby, $var, $dir) if ($seen{$var});
+	}
+	return RDF::Trine::Iterator::Bindings->new( \@results, \@names, sorted_by => \@sortedby );
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 AUTHOR
+
+Gregory Todd Williams  C<< <gwilliams@cpan.org> >>
+
+=head1 COPYRIGHT
+
+Copyright (c) 2006-2012 Gregory Todd Williams. This
+program is free software; you can redistribute it and/or modify it under
+the same terms as Perl itself.
+
+=cut
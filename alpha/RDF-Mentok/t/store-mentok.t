@@ -0,0 +1,52 @@
+use strict;
+use warnings;
+use Test::More tests => 9;
+
+use RDF::Trine qw(iri literal variable statement);
+use RDF::Trine::Pattern;
+use RDF::Trine::Store::Mentok;
+
+my $ex		= 'http://example.org/';
+my $type	= iri('http://www.w3.org/1999/02/22-rdf-syntax-ns#type');
+my $name	= iri('http://xmlns.com/foaf/0.1/name');
+my $person	= iri('http://xmlns.com/foaf/0.1/Person');
+
+# a batch size of 2 makes the results span several batches
+my $store	= RDF::Trine::Store::Mentok->new( undef, batch_size => 2 );
+isa_ok( $store, 'RDF::Trine::Store::Mentok' );
+
+foreach my $i (1 .. 5) {
+	my $p	= iri("${ex}p$i");
+	$store->add_statement( statement( $p, $type, $person ) );
+	$store->add_statement( statement( $p, $name, literal("Person $i") ) );
+}
+$store->add_statement( statement( iri("${ex}thing"), $name, literal('Thing') ) );
+
+is( $store->count_statements(), 11, 'count_statements' );
+is( $store->count_statements( undef, $name, undef ), 6, 'count_statements with bound predicate' );
+
+{
+	my @st	= $store->get_statements( undef, $type, undef )->get_all;
+	is( scalar(@st), 5, 'get_statements across batches' );
+}
+
+{
+	my $bgp	= RDF::Trine::Pattern->new(
+		statement( variable('p'), $type, $person ),
+		statement( variable('p'), $name, variable('name') ),
+	);
+	my $iter	= $store->get_pattern( $bgp );
+	isa_ok( $iter, 'RDF::Trine::Iterator::Bindings' );
+	is_deeply( [ sort $iter->binding_names ], [qw(name p)], 'get_pattern binding names' );
+	my %names	= map { $_->{p}->uri_value => $_->{name}->literal_value } $iter->get_all;
+	is_deeply( \%names, { map { ("${ex}p$_" => "Person $_") } (1 .. 5) }, 'get_pattern round-trip' );
+}
+
+{
+	my $bgp	= RDF::Trine::Pattern->new( statement( variable('p'), $name, variable('name') ) );
+	my @r	= $store->get_pattern( $bgp, undef, orderby => [ 'name' => 'DESC' ] )->get_all;
+	is( $r[0]{name}->literal_value, 'Thing', 'get_pattern with orderby' );
+}
+
+eval { RDF::Trine::Store::Mentok->new( undef, batch_size => 'x' ) };
+isa_ok( $@, 'RDF::Trine::Error::MethodInvocationError', 'invalid batch size' );
@@ -2,15 +2,425 @@
 #include "perl.h"
 #include "XSUB.h"
 #include <b.h>
+#include <raptor.h>
 #include <string.h>
 #include <stdlib.h>
 
+#define B_XMLLITERAL	"http://www.w3.org/1999/02/22-rdf-syntax-ns#XMLLiteral"
+
+/* Stashes used to build node and statement objects directly as blessed
+ * arrays, with the same layout their Perl constructors produce. */
+typedef struct {
+	HV* resource;
+	HV* blank;
+	HV* literal;
+	HV* statement;
+	int xml_literals;
+} b_node_classes;
+
+static void
+_b_node_classes_init (pTHX_ b_node_classes* c) {
+	c->resource		= gv_stashpv( "RDF::Trine::Node::Resource", GV_ADD );
+	c->blank		= gv_stashpv( "RDF::Trine::Node::Blank", GV_ADD );
+	c->literal		= gv_stashpv( "RDF::Trine::Node::Literal", GV_ADD );
+	c->statement	= gv_stashpv( "RDF::Trine::Statement", GV_ADD );
+	c->xml_literals	= SvTRUE( get_sv( "RDF::Trine::Node::Literal::USE_XMLLITERALS", GV_ADD ) );
+}
+
+static SV*
+_b_string (pTHX_ const unsigned char* value) {
+	SV* sv	= newSVpv( (const char*) value, 0 );
+	SvUTF8_on(sv);
+	return sv;
+}
+
+static SV*
+_b_bless (pTHX_ AV* av, HV* stash) {
+	return sv_bless( newRV_noinc( (SV*) av ), stash );
+}
+
+static SV*
+_b_tagged_node (pTHX_ HV* stash, const char* tag, const unsigned char* value) {
+	AV* av	= newAV();
+	av_extend( av, 1 );
+	av_store( av, 0, newSVpv( tag, 0 ) );
+	av_store( av, 1, _b_string( aTHX_ value ) );
+	return _b_bless( aTHX_ av, stash );
+}
+
+/* XML literals need the subclass chosen by the Literal constructor. */
+static SV*
+_b_xml_literal (pTHX_ const unsigned char* value, const unsigned char* datatype) {
+	dSP;
+	int count;
+	SV* sv;
+	ENTER;
+	SAVETMPS;
+	PUSHMARK(SP);
+	XPUSHs(sv_2mortal(newSVpv( "RDF::Trine::Node::Literal", 0 )));
+	XPUSHs(sv_2mortal(_b_string( aTHX_ value )));
+	XPUSHs(&PL_sv_undef);
+	XPUSHs(sv_2mortal(_b_string( aTHX_ datatype )));
+	PUTBACK;
+	count	= call_method("new", G_SCALAR);
+	SPAGAIN;
+	if (count != 1)
+		croak("Big trouble");
+	sv	= newSVsv( POPs );
+	PUTBACK;
+	FREETMPS;
+	LEAVE;
+	return sv;
+}
+
+/* Returns a new node object for the given libb term, or undef if the term
+ * is not set. */
+static SV*
+_b_node (pTHX_ b_node_classes* c, const unsigned char* uri, const unsigned char* bnode, const unsigned char* literal, const unsigned char* lang, const unsigned char* datatype) {
+	if (uri) {
+		return _b_tagged_node( aTHX_ c->resource, "URI", uri );
+	} else if (bnode) {
+		return _b_tagged_node( aTHX_ c->blank, "BLANK", bnode );
+	} else if (literal) {
+		AV* av;
+		if (datatype && c->xml_literals && strcmp( (const char*) datatype, B_XMLLITERAL ) == 0) {
+			return _b_xml_literal( aTHX_ literal, datatype );
+		}
+		av	= newAV();
+		av_push( av, _b_string( aTHX_ literal ) );
+		if (lang) {
+			av_push( av, _b_string( aTHX_ lang ) );
+			av_push( av, newSV(0) );
+		} else if (datatype) {
+			av_push( av, newSV(0) );
+			av_push( av, _b_string( aTHX_ datatype ) );
+		}
+		return _b_bless( aTHX_ av, c->literal );
+	}
+	return newSV(0);
+}
+
+static SV*
+_b_statement (pTHX_ b_node_classes* c, b_triple_t* t) {
+	AV* av	= newAV();
+	av_extend( av, 2 );
+	av_store( av, 0, _b_node( aTHX_ c, t->subject_uri, t->subject_bnode, NULL, NULL, NULL ) );
+	av_store( av, 1, _b_node( aTHX_ c, t->property, NULL, NULL, NULL, NULL ) );
+	av_store( av, 2, _b_node( aTHX_ c, t->object_uri, t->object_bnode, t->object_literal, t->lang, t->datatype ) );
+	return _b_bless( aTHX_ av, c->statement );
+}
+
+/* Fields of a libb triple taken from an RDF::Trine node. The strings point
+ * into the node's own scalars, so they are only valid while the node is. */
+typedef struct {
+	char* uri;
+	b_uint64 uri_len;
+	char* bnode;
+	b_uint64 bnode_len;
+	char* literal;
+	b_uint64 literal_len;
+	char* lang;
+	b_uint64 lang_len;
+	char* datatype;
+	b_uint64 datatype_len;
+} b_term;
+
+static char*
+_b_av_string (pTHX_ AV* av, I32 i, b_uint64* len) {
+	SV** svp	= av_fetch( av, i, 0 );
+	STRLEN l;
+	char* s;
+	if (!svp || !SvOK(*svp)) {
+		*len	= 0;
+		return NULL;
+	}
+	s		= SvPVutf8( *svp, l );
+	*len	= l;
+	return s;
+}
+
+static SV*
+_b_av_node (pTHX_ AV* av, I32 i) {
+	SV** svp	= av_fetch( av, i, 0 );
+	return svp ? *svp : NULL;
+}
+
+/* Fills term from the node's internal array. Returns false if the node is
+ * undefined or a variable (an unbound position), and croaks for node types
+ * libb cannot store. */
+static int
+_b_term (pTHX_ SV* node, b_term* term) {
+	AV* av;
+	Zero( term, 1, b_term );
+	if (!node || !sv_isobject(node) || sv_derived_from(node, "RDF::Trine::Node::Variable")) {
+		return 0;
+	}
+	if (SvTYPE(SvRV(node)) != SVt_PVAV) {
+		croak("Unsupported node type for RDF::Trine::Store::B: %s", sv_reftype(SvRV(node), 1));
+	}
+	av	= (AV*) SvRV(node);
+	if (sv_derived_from(node, "RDF::Trine::Node::Resource")) {
+		term->uri		= _b_av_string( aTHX_ av, 1, &term->uri_len );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Blank")) {
+		term->bnode		= _b_av_string( aTHX_ av, 1, &term->bnode_len );
+	} else if (sv_derived_from(node, "RDF::Trine::Node::Literal")) {
+		term->literal	= _b_av_string( aTHX_ av, 0, &term->literal_len );
+		term->lang		= _b_av_string( aTHX_ av, 1, &term->lang_len );
+		term->datatype	= _b_av_string( aTHX_ av, 2, &term->datatype_len );
+	} else {
+		croak("Unsupported node type for RDF::Trine::Store::B: %s", sv_reftype(SvRV(node), 1));
+	}
+	return 1;
+}
+
+/* Fills the terms of three nodes, croaking if they can't form a libb triple.
+ * With incomplete set, undefined and variable nodes are left unbound. */
+static void
+_b_terms (pTHX_ b_term* st, b_term* pt, b_term* ot, SV* s, SV* p, SV* o, int incomplete) {
+	int bound	= _b_term( aTHX_ s, st ) + _b_term( aTHX_ p, pt ) + _b_term( aTHX_ o, ot );
+	if (!incomplete && bound != 3) {
+		croak("RDF::Trine::Store::B cannot store a statement with unbound nodes");
+	}
+	if (st->literal || pt->literal || pt->bnode) {
+		croak("RDF::Trine::Store::B triples need a resource or blank node subject and a resource predicate");
+	}
+}
+
+/* Returns the internal array of a statement object, croaking if it is not
+ * one that libb can store. Allocates nothing, so statements can be checked
+ * before a transaction is started. */
+static AV*
+_b_statement_av (pTHX_ SV* statement) {
+	b_term st, pt, ot;
+	AV* av;
+	if (!statement || !sv_isobject(statement) || SvTYPE(SvRV(statement)) != SVt_PVAV) {
+		croak("Not a statement object");
+	}
+	av	= (AV*) SvRV(statement);
+	_b_terms( aTHX_ &st, &pt, &ot, _b_av_node( aTHX_ av, 0 ), _b_av_node( aTHX_ av, 1 ), _b_av_node( aTHX_ av, 2 ), 0 );
+	return av;
+}
+
+/* Creates a libb triple from three nodes. With incomplete set, undefined
+ * and variable nodes are left unbound for use as an iterator pattern. */
+static b_error_t
+_b_triple (pTHX_ b_triple_t** t, SV* s, SV* p, SV* o, int incomplete) {
+	b_term st, pt, ot;
+	_b_terms( aTHX_ &st, &pt, &ot, s, p, o, incomplete );
+	if (incomplete) {
+		return b_triple_new_incomplete (t,
+			(unsigned char*) st.uri, st.uri_len,
+			(unsigned char*) st.bnode, st.bnode_len,
+			(unsigned char*) pt.uri, pt.uri_len,
+			(unsigned char*) ot.uri, ot.uri_len,
+			(unsigned char*) ot.bnode, ot.bnode_len,
+			(unsigned char*) ot.literal, ot.literal_len,
+			NULL, 0,
+			(unsigned char*) ot.datatype, ot.datatype_len,
+			(unsigned char*) ot.lang, ot.lang_len
+		);
+	}
+	return b_triple_new (t,
+		(unsigned char*) st.uri, st.uri_len,
+		(unsigned char*) st.bnode, st.bnode_len,
+		(unsigned char*) pt.uri, pt.uri_len,
+		(unsigned char*) ot.uri, ot.uri_len,
+		(unsigned char*) ot.bnode, ot.bnode_len,
+		(unsigned char*) ot.literal, ot.literal_len,
+		NULL, 0,
+		(unsigned char*) ot.datatype, ot.datatype_len,
+		(unsigned char*) ot.lang, ot.lang_len
+	);
+}
+
+/* Adds (or removes) one statement object, given as the blessed array of an
+ * RDF::Trine::Statement. */
+static b_error_t
+_b_update_statement (pTHX_ b_t* b, SV* statement, int remove) {
+	b_triple_t* t;
+	b_error_t err;
+	AV* av	= _b_statement_av( aTHX_ statement );
+	if ((err = _b_triple( aTHX_ &t, _b_av_node( aTHX_ av, 0 ), _b_av_node( aTHX_ av, 1 ), _b_av_node( aTHX_ av, 2 ), 0 )) != B_OK) {
+		return err;
+	}
+	err	= remove ? b_remove_triple( b, t ) : b_add_triple( b, t );
+	b_triple_destroy( t );
+	return err;
+}
+
+/* Adds (or removes) an array of statements inside one libb transaction. The
+ * statements are all checked first, so that invalid input croaks before the
+ * transaction is started rather than leaving it open. */
+static void
+_b_update_statements (pTHX_ b_t* b, AV* statements, int remove) {
+	b_error_t err;
+	I32 i;
+	I32 last	= av_len( statements );
+	for (i = 0; i <= last; i++) {
+		_b_statement_av( aTHX_ _b_av_node( aTHX_ statements, i ) );
+	}
+	if ((err = b_transaction_start( b )) != B_OK) {
+		croak("b_transaction_start: %s\n", b_strerror(err));
+	}
+	for (i = 0; i <= last; i++) {
+		if ((err = _b_update_statement( aTHX_ b, _b_av_node( aTHX_ statements, i ), remove )) != B_OK) {
+			b_transaction_abort( b );
+			croak("%s: %s\n", remove ? "b_remove_triple" : "b_add_triple", b_strerror(err));
+		}
+	}
+	if ((err = b_transaction_commit( b )) != B_OK) {
+		croak("b_transaction_commit: %s\n", b_strerror(err));
+	}
+}
+
+/* Native loading: raptor parses the file and each statement is added to
+ * libb from the statement handler, without creating any perl objects. The
+ * adds are committed in a single transaction, or in transactions of batch
+ * triples if batch is not zero. */
+typedef struct {
+	b_t* b;
+	raptor_parser* parser;
+	b_uint64 count;
+	b_uint64 committed;
+	b_uint64 batch;
+	b_uint64 interval;
+	SV* progress;
+	b_error_t err;
+	const char* failed;
+	SV* error;
+} b_load_state;
+
+/* Sets the libb term fields for a raptor node. Ordinal URIs are written to
+ * the caller's buffer. */
+static void
+_b_raptor_term (b_term* term, const void* node, raptor_identifier_type type, const unsigned char* lang, raptor_uri* datatype, char* ordinal) {
+	Zero( term, 1, b_term );
+	switch (type) {
+		case RAPTOR_IDENTIFIER_TYPE_LITERAL:
+			term->literal		= (char*) node;
+			term->literal_len	= strlen( term->literal );
+			if (lang) {
+				term->lang		= (char*) lang;
+				term->lang_len	= strlen( term->lang );
+			} else if (datatype) {
+				term->datatype		= (char*) raptor_uri_as_string( datatype );
+				term->datatype_len	= strlen( term->datatype );
+			}
+			break;
+		case RAPTOR_IDENTIFIER_TYPE_XML_LITERAL:
+			term->literal		= (char*) node;
+			term->literal_len	= strlen( term->literal );
+			term->datatype		= B_XMLLITERAL;
+			term->datatype_len	= sizeof(B_XMLLITERAL) - 1;
+			break;
+		case RAPTOR_IDENTIFIER_TYPE_ANONYMOUS:
+			term->bnode		= (char*) node;
+			term->bnode_len	= strlen( term->bnode );
+			break;
+		case RAPTOR_IDENTIFIER_TYPE_ORDINAL:
+			sprintf( ordinal, "http://www.w3.org/1999/02/22-rdf-syntax-ns#_%d", *((int*) node) );
+			term->uri		= ordinal;
+			term->uri_len	= strlen( ordinal );
+			break;
+		case RAPTOR_IDENTIFIER_TYPE_RESOURCE:
+		case RAPTOR_IDENTIFIER_TYPE_PREDICATE:
+			term->uri		= (char*) raptor_uri_as_string( (raptor_uri*) node );
+			term->uri_len	= strlen( term->uri );
+			break;
+		default:
+			break;
+	}
+}
+
+/* Calls the progress callback with the number of triples loaded so far.
+ * The callback runs in an eval, as dying here would unwind through raptor;
+ * an error stops the parse and is rethrown once raptor has returned. */
+static void
+_b_load_progress (pTHX_ b_load_state* st) {
+	dSP;
+	ENTER;
+	SAVETMPS;
+	PUSHMARK(SP);
+	XPUSHs(sv_2mortal(newSVuv( (UV) st->count )));
+	PUTBACK;
+	call_sv( st->progress, G_DISCARD | G_EVAL );
+	if (SvTRUE(ERRSV)) {
+		st->error	= newSVsv( ERRSV );
+		raptor_parse_abort( st->parser );
+	}
+	FREETMPS;
+	LEAVE;
+}
+
+static void
+_b_load_statement (void* user_data, const raptor_statement* triple) {
+	dTHX;
+	b_load_state* st	= (b_load_state*) user_data;
+	b_term s, p, o;
+	b_triple_t* t;
+	char s_ordinal[64], p_ordinal[64], o_ordinal[64];
+	if (st->failed || st->error) {
+		return;
+	}
+	_b_raptor_term( &s, triple->subject, triple->subject_type, NULL, NULL, s_ordinal );
+	_b_raptor_term( &p, triple->predicate, triple->predicate_type, NULL, NULL, p_ordinal );
+	_b_raptor_term( &o, triple->object, triple->object_type, triple->object_literal_language, triple->object_literal_datatype, o_ordinal );
+	if ((st->err = b_triple_new (&t,
+				(unsigned char*) s.uri, s.uri_len,
+				(unsigned char*) s.bnode, s.bnode_len,
+				(unsigned char*) p.uri, p.uri_len,
+				(unsigned char*) o.uri, o.uri_len,
+				(unsigned char*) o.bnode, o.bnode_len,
+				(unsigned char*) o.literal, o.literal_len,
+				NULL, 0,
+				(unsigned char*) o.datatype, o.datatype_len,
+				(unsigned char*) o.lang, o.lang_len
+			)) != B_OK) {
+		st->failed	= "b_triple_new";
+	} else {
+		st->err	= b_add_triple( st->b, t );
+		b_triple_destroy( t );
+		if (st->err != B_OK) {
+			st->failed	= "b_add_triple";
+		}
+	}
+	if (!st->failed) {
+		st->count++;
+	}
+	if (!st->failed && st->batch && st->count % st->batch == 0) {
+		if ((st->err = b_transaction_commit( st->b )) != B_OK) {
+			st->failed	= "b_transaction_commit";
+		} else {
+			st->committed	= st->count;
+			if ((st->err = b_transaction_start( st->b )) != B_OK) {
+				st->failed	= "b_transaction_start";
+			}
+		}
+	}
+	if (st->failed) {
+		raptor_parse_abort( st->parser );
+	} else if (st->progress && st->interval && st->count % st->interval == 0) {
+		_b_load_progress( aTHX_ st );
+	}
+}
+
+static void
+_b_load_error (void* user_data, raptor_locator* locator, const char* message) {
+	dTHX;
+	b_load_state* st	= (b_load_state*) user_data;
+	if (!st->error) {
+		st->error	= newSVpvf( "%s at line %d", message, locator ? raptor_locator_line( locator ) : -1 );
+	}
+}
+
 MODULE = RDF::Trine::Store::B        PACKAGE = RDF::Trine::Store::B
 PROTOTYPES: DISABLE
 
+BOOT:
+	raptor_init();
+
 b_t*
-new (class, filename_prefix)
-	char* class
+_open (filename_prefix)
 	char* filename_prefix
 	PREINIT:
 		b_t *b;
@@ -50,147 +460,171 @@ b_find_statements (b, s, p, o)
 		b_triple_t* t;
 		b_error_t err;
 		b_iterator_triple_t *iterator;
-		char *subject_uri, *predicate_uri, *object_uri;
-		b_uint64 subject_uri_len, predicate_uri_len, object_uri_len;
-		char *subject_bnode, *object_bnode;
-		b_uint64 subject_bnode_len, object_bnode_len;
-		char *object_literal;
-		b_uint64 object_literal_len;
-		char *lang;
-		b_uint64 lang_len;
-		char *datatype;
-		b_uint64 datatype_len;
-		SV* ssv;
-		SV* psv;
-		SV* osv;
 	CODE:
-		ssv					= NULL;
-		psv					= NULL;
-		osv					= NULL;
-		subject_uri			= NULL;
-		subject_uri_len		= 0;
-		subject_bnode		= NULL;
-		subject_bnode_len	= 0;
-		predicate_uri		= NULL;
-		predicate_uri_len	= 0;
-		object_uri			= NULL;
-		object_uri_len		= 0;
-		object_bnode		= NULL;
-		object_bnode_len	= 0;
-		object_literal		= NULL;
-		object_literal_len	= 0;
-		datatype			= NULL;
-		datatype_len		= 0;
-		lang				= NULL;
-		lang_len			= 0;
-		
-		if (SvOK(s)) {
-			STRLEN len;
-			dSP;
-			int count;
-			ENTER;
-			SAVETMPS;
-			PUSHMARK(SP);
-			XPUSHs(s);
-			PUTBACK;
-			count	= call_method("uri_value", G_SCALAR);
-			fprintf( stderr, "call_method returned %d results\n", count );
-			SPAGAIN;
-			if (count != 1)
-				croak("Big trouble");
-			ssv	= POPs;
-			SvREFCNT_inc(ssv);
-			PUTBACK;
-			FREETMPS;
-			LEAVE;
-			subject_uri		= SvPV( ssv, len );
-			subject_uri_len	= len;
-			fprintf( stderr, "*** subject: %s (%d)\n", subject_uri, subject_uri_len );
-		}
-		
-		if (SvOK(p)) {
-			STRLEN len;
-			dSP;
-			int count;
-			ENTER;
-			SAVETMPS;
-			PUSHMARK(SP);
-			XPUSHs(p);
-			PUTBACK;
-			count	= call_method("uri_value", G_SCALAR);
-			fprintf( stderr, "call_method returned %d results\n", count );
-			SPAGAIN;
-			if (count != 1)
-				croak("Big trouble");
-			psv	= POPs;
-			SvREFCNT_inc(psv);
-			PUTBACK;
-			FREETMPS;
-			LEAVE;
-			predicate_uri		= SvPV( psv, len );
-			predicate_uri_len	= len;
-			fprintf( stderr, "*** predicate: %s (%d)\n", predicate_uri, predicate_uri_len );
-		}
-
-		if (SvOK(o)) {
-			STRLEN len;
-			fprintf( stderr, "o: %p\n", o );
-			fprintf( stderr, "undef: %p\n", &PL_sv_undef );
-			dSP;
-			int count;
-			ENTER;
-			SAVETMPS;
-			PUSHMARK(SP);
-			XPUSHs(o);
-			PUTBACK;
-			count	= call_method("uri_value", G_SCALAR);
-			fprintf( stderr, "call_method returned %d results\n", count );
-			SPAGAIN;
-			if (count != 1)
-				croak("Big trouble");
-			osv	= POPs;
-			SvREFCNT_inc(osv);
-			PUTBACK;
-			FREETMPS;
-			LEAVE;
-			object_uri		= SvPV( osv, len );
-			object_uri_len	= len;
-			fprintf( stderr, "*** object: %s (%d)\n", object_uri, object_uri_len );
-		}
-		
-		if ((err = b_triple_new_incomplete(
-					&t,
-					(unsigned char*) subject_uri, subject_uri_len,
-					(unsigned char*) subject_bnode, subject_bnode_len,
-					(unsigned char*) predicate_uri, predicate_uri_len,
-					(unsigned char*) object_uri, object_uri_len,
-					(unsigned char*) object_bnode, object_bnode_len,
-					(unsigned char*) object_literal, object_literal_len,
-					NULL, 0,
-					(unsigned char*) datatype, datatype_len,
-					(unsigned char*) lang, lang_len
-				) != B_OK) || !t) {
+		if ((err = _b_triple( aTHX_ &t, s, p, o, 1 )) != B_OK || !t) {
 			croak("b_triple_new_incomplete: %s\n", b_strerror(err));
 		}
-		
-		fprintf( stderr, "incomplete triple: %p ", t );
-//		b_triple_print( stderr, t );
 		if ((err = b_iterator_triple_new (b, &iterator, t)) != B_OK) {
 			b_triple_destroy( t );
 			croak("b_iterator_new: %s\n", b_strerror (err));
 		}
-		
-		if (ssv)
-			SvREFCNT_dec(ssv);
-		if (psv)
-			SvREFCNT_dec(psv);
-		if (osv)
-			SvREFCNT_dec(osv);
-		
 		RETVAL	= iterator;
 	OUTPUT:
 		RETVAL
 
+void
+b_add_statement (b, st)
+	b_t* b
+	SV* st
+	PREINIT:
+		b_error_t err;
+	CODE:
+		if ((err = _b_update_statement( aTHX_ b, st, 0 )) != B_OK) {
+			croak("b_add_triple: %s\n", b_strerror(err));
+		}
+
+void
+b_add_statements (b, statements)
+	b_t* b
+	AV* statements
+	CODE:
+		_b_update_statements( aTHX_ b, statements, 0 );
+
+void
+b_remove_statement (b, st)
+	b_t* b
+	SV* st
+	PREINIT:
+		b_error_t err;
+	CODE:
+		if ((err = _b_update_statement( aTHX_ b, st, 1 )) != B_OK) {
+			croak("b_remove_triple: %s\n", b_strerror(err));
+		}
+
+void
+b_remove_statements (b, statements)
+	b_t* b
+	AV* statements
+	CODE:
+		_b_update_statements( aTHX_ b, statements, 1 );
+
+SV*
+b_count_statements (b, s, p, o)
+	b_t* b
+	SV* s
+	SV* p
+	SV* o
+	PREINIT:
+		b_error_t err;
+		b_term term;
+		b_triple_t* t;
+		b_triple_t* triple;
+		b_iterator_triple_t* iterator;
+		b_uint64 count;
+		int bound;
+	CODE:
+		bound	= _b_term( aTHX_ s, &term ) + _b_term( aTHX_ p, &term ) + _b_term( aTHX_ o, &term );
+		if (bound == 0) {
+			if ((err = b_count_triple( b, &count )) != B_OK) {
+				croak("b_count_triple: %s\n", b_strerror(err));
+			}
+		} else {
+			/* count the matching triples without converting them to perl */
+			if ((err = _b_triple( aTHX_ &t, s, p, o, 1 )) != B_OK || !t) {
+				croak("b_triple_new_incomplete: %s\n", b_strerror(err));
+			}
+			if ((err = b_iterator_triple_new( b, &iterator, t )) != B_OK) {
+				b_triple_destroy( t );
+				croak("b_iterator_new: %s\n", b_strerror(err));
+			}
+			count	= 0;
+			while ((err = b_iterator_triple_step( iterator, &triple )) == B_OK && triple) {
+				count++;
+				b_triple_destroy( triple );
+			}
+			b_iterator_triple_destroy( iterator );
+			if (err != B_OK) {
+				croak("b_iterator_step: %s\n", b_strerror(err));
+			}
+		}
+		RETVAL	= newSVuv( (UV) count );
+	OUTPUT:
+		RETVAL
+
+SV*
+b_load_file (b, filename, syntax, progress, interval, batch)
+	b_t* b
+	char* filename
+	SV* syntax
+	SV* progress
+	UV interval
+	UV batch
+	PREINIT:
+		b_load_state st;
+		const char* name;
+		unsigned char* uri_string;
+		raptor_uri* uri;
+		raptor_uri* base_uri;
+		b_error_t err;
+		int rc;
+	CODE:
+		if (SvOK(syntax)) {
+			name	= SvPV_nolen(syntax);
+		} else {
+			name	= raptor_guess_parser_name( NULL, NULL, NULL, 0, (const unsigned char*) filename );
+		}
+		if (!name || !raptor_syntax_name_check( name )) {
+			croak("Unknown RDF syntax '%s'\n", name ? name : "");
+		}
+		Zero( &st, 1, b_load_state );
+		st.b			= b;
+		st.progress		= SvOK(progress) ? progress : NULL;
+		st.interval		= interval;
+		st.batch		= batch;
+		if (!(st.parser = raptor_new_parser( name ))) {
+			croak("raptor_new_parser: cannot create a '%s' parser\n", name);
+		}
+		raptor_set_statement_handler( st.parser, &st, _b_load_statement );
+		raptor_set_error_handler( st.parser, &st, _b_load_error );
+		raptor_set_fatal_error_handler( st.parser, &st, _b_load_error );
+		uri_string	= raptor_uri_filename_to_uri_string( filename );
+		uri			= raptor_new_uri( uri_string );
+		base_uri	= raptor_uri_copy( uri );
+		if ((err = b_transaction_start( b )) != B_OK) {
+			st.failed	= "b_transaction_start";
+			st.err		= err;
+			rc			= 1;
+		} else {
+			rc	= raptor_parse_file( st.parser, uri, base_uri );
+			if (st.failed || st.error || rc) {
+				/* a failed load keeps only the batches committed before the error */
+				b_transaction_abort( b );
+			} else if ((err = b_transaction_commit( b )) != B_OK) {
+				st.failed	= "b_transaction_commit";
+				st.err		= err;
+			}
+		}
+		raptor_free_uri( base_uri );
+		raptor_free_uri( uri );
+		raptor_free_memory( uri_string );
+		raptor_free_parser( st.parser );
+		if (st.failed) {
+			if (st.error)
+				SvREFCNT_dec( st.error );
+			croak("%s: %s (%lu triples committed)\n", st.failed, b_strerror(st.err), (unsigned long) st.committed);
+		}
+		if (st.error) {
+			/* rethrow progress callback errors (possibly objects) unchanged */
+			sv_setsv( ERRSV, sv_2mortal(st.error) );
+			croak(NULL);
+		}
+		if (rc) {
+			croak("Failed to parse %s (%lu triples committed)\n", filename, (unsigned long) st.committed);
+		}
+		RETVAL	= newSVuv( (UV) st.count );
+	OUTPUT:
+		RETVAL
+
 void
 b_DESTROY(b)
 	b_t* b
@@ -222,6 +656,35 @@ iter_next (iter)
 	OUTPUT:
 		RETVAL
 		
+SV*
+iter_next_batch (iter, n)
+	b_iterator_triple_t *iter
+	IV n
+	PREINIT:
+		b_triple_t *triple;
+		b_error_t err;
+		b_node_classes classes;
+		AV* statements;
+		IV count;
+	CODE:
+		_b_node_classes_init( aTHX_ &classes );
+		statements	= newAV();
+		if (n > 0)
+			av_extend( statements, n - 1 );
+		for (count = 0; count < n; count++) {
+			if ((err = b_iterator_triple_step(iter, &triple)) != B_OK) {
+				SvREFCNT_dec( (SV*) statements );
+				croak("b_iterator_step: %s\n", b_strerror (err));
+			}
+			if (!triple)
+				break;
+			av_push( statements, _b_statement( aTHX_ &classes, triple ) );
+			b_triple_destroy( triple );
+		}
+		RETVAL	= newRV_noinc( (SV*) statements );
+	OUTPUT:
+		RETVAL
+
 void
 iter_DESTROY(iter)
 	b_iterator_triple_t *iter
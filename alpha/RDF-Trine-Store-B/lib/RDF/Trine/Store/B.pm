@@ -11,83 +11,198 @@ This document describes RDF::Trine::Store::B version 0.109
 =head1 SYNOPSIS
 
     use RDF::Trine::Store::B;
+    my $store	= RDF::Trine::Store::B->new('/tmp/triplestore');
+    my $model	= RDF::Trine::Model->new( $store );
 
 =head1 DESCRIPTION
 
-=for author to fill in:
-    Write a full description of the module and its features here.
-    Use subsections (=head2, =head3) as appropriate.
+RDF::Trine::Store::B provides a persistent, disk-backed triple-store using the
+libb library. Statement lookups use libb's native iterators, and matching
+statements are converted to RDF::Trine objects in batches (whose nodes are
+interned if L<RDF::Trine::TermTable> is enabled). Counts are computed
+by libb without creating any perl objects.
 
+Statements added between C<< begin_bulk_ops >> and C<< end_bulk_ops >> are
+buffered and written in batches, each inside a single libb transaction.
 
-=head1 DEPENDENCIES
+libb stores triples only. Statements added with a context are stored in the
+default graph, and lookups for any other context find nothing.
 
-=for author to fill in:
-    A list of all the other modules that this module relies upon,
-    including any restrictions on versions, and an indication whether
-    the module is part of the standard Perl distribution, part of the
-    module's distribution, or must be installed separately. ]
+=head1 DEPENDENCIES
 
-None.
+The libb and raptor libraries.
 
 =cut
 
+package RDF::Trine::Store::B;
+
 use strict;
 use warnings;
 no warnings 'redefine';
+use base qw(RDF::Trine::Store);
 use XSLoader;
 
-our $VERSION	= 0.109;
+use File::Temp qw(tempdir);
+use File::Spec;
+use Scalar::Util qw(blessed);
+
+our ($VERSION, $BATCH_SIZE);
+BEGIN {
+	$VERSION	= 0.109;
+	$BATCH_SIZE	= 1000;
+	my $class	= __PACKAGE__;
+	$RDF::Trine::Store::STORE_CLASSES{ $class }	= $VERSION;
+}
 XSLoader::load "RDF::Trine::Store::B", $VERSION;
 
 use RDF::Trine::Error;
+use RDF::Trine::Iterator;
 
 
 =head1 METHODS
 
+Beyond the methods documented below, this class inherits methods from the
+L<RDF::Trine::Store> class.
+
 =over 4
 
 =item C<new ( $filename_prefix )>
 
-Returns a new storage object using the supplied arguments to construct a DBI
-object for the underlying database.
+Returns a new storage object using the libb data files with the supplied
+filename prefix, creating them if necessary.
 
 =cut
 
+sub new {
+	my $class	= shift;
+	my $prefix	= shift;
+	unless (defined($prefix)) {
+		throw RDF::Trine::Error::MethodInvocationError -text => "$class needs a filename prefix";
+	}
+	my $b		= _open( $prefix );
+	my $self	= bless({ b => $b, prefix => $prefix, bulk_ops => 0, pending => [] }, $class);
+	return $self;
+}
 
+sub _new_with_string {
+	my $class	= shift;
+	my $config	= shift;
+	return $class->new( $config );
+}
 
+sub _new_with_config {
+	my $class	= shift;
+	my $config	= shift;
+	return $class->new( $config->{prefix} );
+}
 
+sub _config_meta {
+	return {
+		required_keys	=> [qw(prefix)],
+		fields			=> {
+			prefix	=> { description => 'Filename prefix of the data files', type => 'filename' },
+		}
+	}
+}
 
 =item C<< temporary_store >>
 
+Returns a new store using data files in a temporary directory which is removed
+when the program exits.
+
 =cut
 
 sub temporary_store {
+	my $class	= shift;
+	my $dir		= tempdir( CLEANUP => 1 );
+	return $class->new( File::Spec->catfile( $dir, 'b' ) );
 }
 
-=item C<< get_statements ($subject, $predicate, $object [, $context] ) >>
+=item C<< load_file ( $filename [, $syntax] [, progress => \&callback, interval => $count] [, batch => $count] ) >>
 
-Returns a stream object of all statements matching the specified subject,
-predicate and objects. Any of the arguments may be undef to match any value.
+Parses the RDF file C<< $filename >> with the raptor library and adds its
+triples directly to the store, without creating any RDF::Trine objects.
+C<< $syntax >> is a raptor parser name such as C<< ntriples >>, C<< turtle >> or
+C<< rdfxml >>; if it is not given, raptor guesses it from the filename.
+
+If a C<< progress >> callback is given, it is called with the number of triples
+loaded so far every C<< interval >> triples (default 10000). Returns the number
+of triples loaded.
+
+The file is loaded in a single transaction, so a load that fails (or whose
+progress callback dies) leaves the store unchanged. If C<< batch >> is given,
+a transaction is instead committed every C<< batch >> triples; the load is
+then not atomic, and a failed load keeps the batches committed before the
+error (their count is given in the error message of libb and parse errors).
 
 =cut
 
-sub get_statements {
+sub load_file {
+	my $self		= shift;
+	my $filename	= shift;
+	my $syntax		= (scalar(@_) % 2) ? shift : undef;
+	my %args		= @_;
+	unless (defined($filename) and -r $filename) {
+		throw RDF::Trine::Error::MethodInvocationError -text => "Cannot read file for loading";
+	}
+	$self->_flush;
+	my $interval	= $args{interval} || 10000;
+	my $batch		= $args{batch} || 0;
+	return $self->{b}->load_file( $filename, $syntax, $args{progress}, $interval, $batch );
 }
 
-=item C<< get_pattern ( $bgp [, $context] ) >>
+=item C<< get_statements ($subject, $predicate, $object [, $context] ) >>
 
-Returns a stream object of all bindings matching the specified graph pattern.
+Returns a stream object of all statements matching the specified subject,
+predicate and objects. Any of the arguments may be undef to match any value.
 
 =cut
 
-sub get_pattern {
+sub get_statements {
+	my $self	= shift;
+	my @nodes	= splice(@_, 0, 3);
+	my $context	= shift;
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return RDF::Trine::Iterator::Graph->new( [] );
+	}
+	$self->_flush;
+	unless ($self->_storable_pattern( @nodes )) {
+		return RDF::Trine::Iterator::Graph->new( [] );
+	}
+
+	my $b		= $self->{b};
+	my $iter	= (grep { blessed($_) and not($_->is_variable) } @nodes)
+				? $b->find_statements( map { (blessed($_) and not($_->is_variable)) ? $_ : undef } @nodes )
+				: $b->iterate;
+	my @batch;
+	my $sub		= sub {
+		unless (scalar(@batch)) {
+			return unless ($iter);
+			@batch	= @{ $iter->next_batch( $BATCH_SIZE ) };
+			unless (scalar(@batch)) {
+				undef $iter;
+				return;
+			}
+			if ($RDF::Trine::TermTable::ENABLED) {
+				# the nodes are built natively, bypassing the node constructors
+				foreach my $st (@batch) {
+					@$st	= map { RDF::Trine::TermTable::intern($_) } @$st;
+				}
+			}
+		}
+		return shift(@batch);
+	};
+	return RDF::Trine::Iterator::Graph->new( $sub );
 }
 
 =item C<< get_contexts >>
 
+Returns an empty iterator, as contexts are not supported by libb.
+
 =cut
 
 sub get_contexts {
+	return RDF::Trine::Iterator->new( [] );
 }
 
 =item C<< add_statement ( $statement [, $context] ) >>
@@ -97,6 +212,18 @@ Adds the specified C<$statement> to the underlying model.
 =cut
 
 sub add_statement {
+	my $self	= shift;
+	my $st		= shift;
+	if ($st->isa('RDF::Trine::Statement::Quad')) {
+		$st	= RDF::Trine::Statement->new( $st->nodes );
+	}
+	if ($self->{bulk_ops}) {
+		my $pending	= $self->{pending};
+		push(@$pending, $st);
+		$self->_flush if (scalar(@$pending) >= $BATCH_SIZE);
+	} else {
+		$self->{b}->add_statement( $st );
+	}
 }
 
 =item C<< remove_statement ( $statement [, $context]) >>
@@ -106,15 +233,26 @@ Removes the specified C<$statement> from the underlying model.
 =cut
 
 sub remove_statement {
+	my $self	= shift;
+	my $st		= shift;
+	$self->_flush;
+	if ($st->isa('RDF::Trine::Statement::Quad')) {
+		$st	= RDF::Trine::Statement->new( $st->nodes );
+	}
+	$self->{b}->remove_statement( $st );
 }
 
 =item C<< remove_statements ( $subject, $predicate, $object [, $context]) >>
 
-Removes the specified C<$statement> from the underlying model.
+Removes all statements matching the supplied C<$subject>, C<$predicate> and
+C<$object> from the underlying model.
 
 =cut
 
 sub remove_statements {
+	my $self	= shift;
+	my @st		= $self->get_statements( @_ )->get_all;
+	$self->{b}->remove_statements( \@st ) if (scalar(@st));
 }
 
 =item C<< count_statements ($subject, $predicate, $object) >>
@@ -125,13 +263,85 @@ predicate and objects. Any of the arguments may be undef to match any value.
 =cut
 
 sub count_statements {
+	my $self	= shift;
+	my @nodes	= splice(@_, 0, 3);
+	my $context	= shift;
+	if (defined($context) and not($context->isa('RDF::Trine::Node::Nil'))) {
+		return 0;
+	}
+	$self->_flush;
+	return 0 unless ($self->_storable_pattern( @nodes ));
+	return $self->{b}->count_statements( @nodes[0 .. 2] );
 }
 
-=item C<< init >>
+=item C<< supports ( [ $feature ] ) >>
 
-Creates the necessary tables in the underlying database.
+If C<< $feature >> is specified, returns true if the feature is supported by the
+store, false otherwise. If C<< $feature >> is not specified, returns a list of
+supported features.
 
 =cut
 
-sub init {
+sub supports {
+	my $self	= shift;
+	my %features	= ();
+	if (@_) {
+		my $f	= shift;
+		return $features{ $f };
+	} else {
+		return keys %features;
+	}
+}
+
+# Returns false if a bound subject is a literal or a bound predicate is not an
+# IRI, as such patterns cannot match any triple stored by libb.
+sub _storable_pattern {
+	my $self	= shift;
+	my ($s, $p)	= @_;
+	return 0 if (blessed($s) and $s->isa('RDF::Trine::Node::Literal'));
+	return 0 if (blessed($p) and not($p->is_variable) and not($p->isa('RDF::Trine::Node::Resource')));
+	return 1;
+}
+
+sub _begin_bulk_ops {
+	my $self	= shift;
+	$self->{bulk_ops}	= 1;
 }
+
+sub _end_bulk_ops {
+	my $self	= shift;
+	$self->_flush;
+	$self->{bulk_ops}	= 0;
+}
+
+# Writes the statements buffered during bulk operations in one transaction.
+sub _flush {
+	my $self	= shift;
+	my $pending	= $self->{pending};
+	return unless (scalar(@$pending));
+	my @st		= splice(@$pending);
+	$self->{b}->add_statements( \@st );
+}
+
+sub DESTROY {
+	my $self	= shift;
+	$self->_flush if ($self->{b});
+}
+
+1;
+
+__END__
+
+=back
+
+=head1 AUTHOR
+
+Gregory Todd Williams  C<< <gwilliams@cpan.org> >>
+
+=head1 COPYRIGHT
+
+Copyright (c) 2006-2012 Gregory Todd Williams. This
+program is free software; you can redistribute it and/or modify it under
+the same terms as Perl itself.
+
+=cut
@@ -0,0 +1,70 @@
+use strict;
+use warnings;
+use Test::More tests => 19;
+use Scalar::Util qw(refaddr);
+
+use RDF::Trine qw(iri blank literal statement);
+use RDF::Trine::Model;
+use RDF::Trine::Store::B;
+
+my $ex		= 'http://example.org/';
+my $name	= iri('http://xmlns.com/foaf/0.1/name');
+my $knows	= iri('http://xmlns.com/foaf/0.1/knows');
+
+my $store	= RDF::Trine::Store::B->temporary_store();
+isa_ok( $store, 'RDF::Trine::Store::B' );
+is( $store->count_statements(), 0, 'new store is empty' );
+
+{
+	# add, count and remove single statements
+	my $st	= statement( iri("${ex}alice"), $name, literal('Alice', 'en') );
+	$store->add_statement( $st );
+	is( $store->count_statements(), 1, 'add_statement' );
+	is( $store->count_statements( undef, $name, undef ), 1, 'count_statements with bound predicate' );
+	is( $store->count_statements( undef, $knows, undef ), 0, 'count_statements with no match' );
+	is( $store->count_statements( iri("${ex}alice"), undef, undef ), 1, 'count_statements with bound subject' );
+
+	my @st	= $store->get_statements( undef, $name, undef )->get_all;
+	is( scalar(@st), 1, 'get_statements' );
+	ok( $st[0]->equal( $st ), 'statement round-trip' );
+
+	$store->remove_statement( $st );
+	is( $store->count_statements(), 0, 'remove_statement' );
+}
+
+{
+	# bulk operations are buffered and written when they end
+	my $model	= RDF::Trine::Model->new( $store );
+	$model->begin_bulk_ops;
+	foreach my $i (1 .. 2500) {
+		$store->add_statement( statement( iri("${ex}p$i"), $knows, blank("b$i") ) );
+		$store->add_statement( statement( iri("${ex}p$i"), $name, literal("Person $i") ) );
+	}
+	$model->end_bulk_ops;
+	is( $store->count_statements(), 5000, 'bulk add' );
+	is( $store->count_statements( undef, $knows, undef ), 2500, 'bulk add count with bound predicate' );
+	my @st	= $store->get_statements( iri("${ex}p42"), undef, undef )->get_all;
+	is( scalar(@st), 2, 'get_statements after bulk add' );
+	my ($lit)	= map { $_->object } grep { $_->object->isa('RDF::Trine::Node::Literal') } @st;
+	is( $lit->literal_value, 'Person 42', 'literal round-trip' );
+
+	$store->remove_statements( undef, $knows, undef );
+	is( $store->count_statements(), 2500, 'remove_statements' );
+	is( $store->count_statements( undef, $knows, undef ), 0, 'remove_statements removed matching statements' );
+}
+
+{
+	# patterns that cannot match any stored triple
+	is( $store->count_statements( literal('x'), undef, undef ), 0, 'literal subject count' );
+	is( scalar(@{[ $store->get_statements( undef, blank('p'), undef )->get_all ]}), 0, 'blank predicate lookup' );
+}
+
+{
+	# nodes built natively are interned when the term table is enabled
+	require RDF::Trine::TermTable;
+	RDF::Trine::TermTable->enable;
+	my ($st)	= $store->get_statements( iri("${ex}p7"), $name, undef )->get_all;
+	ok( RDF::Trine::TermTable::is_interned( $st->subject ), 'subject is interned' );
+	is( refaddr( $st->predicate ), refaddr( iri('http://xmlns.com/foaf/0.1/name') ), 'predicate is the canonical node' );
+	RDF::Trine::TermTable->disable;
+}
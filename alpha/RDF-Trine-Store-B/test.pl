@@ -14,15 +14,11 @@ my $s	= RDF::Trine::Node::Resource->new('http://www.Department0.University0.edu/
 my $p	= RDF::Trine::Node::Resource->new('http://www.lehigh.edu/%7Ezhp2/2004/0401/univ-bench.owl#mastersDegreeFrom');
 my $o	= undef; #RDF::Trine::Node::Resource->new('http://www.University367.edu');
 
-my $i	= $b->find_statements( $s, $p, $o );
-#my $i	= $b->iterate;
+my $i	= $b->get_statements( $s, $p, $o );
+#my $i	= $b->get_statements( undef, undef, undef );
 
-while (my $t = $i->next) {
-	my $st	= RDF::Trine::Statement->new(
-		$t->subject,
-		$t->predicate,
-		$t->object,
-	);
+while (my $st = $i->next) {
 	print "OBJECT: " . $st->as_string . "\n";
 }
 
+print "COUNT: " . $b->count_statements( $s, $p, $o ) . "\n";